@@ -0,0 +1,23 @@
+#pragma once
+#include <Arduino.h>
+
+// ===== Firmware da estufa: boot e um passo de cada task =====
+// O main.cpp só cria as tasks, o timer do controlador e o display; o corpo
+// de cada volta fica aqui para o SIL (test/native) rodar o mesmo código.
+
+static const uint32_t CONTROL_UPDATE_MS = 1000;  // controlador 1 Hz (esp_timer, fase fixa)
+static const uint32_t LCD_UPDATE_MS     = 150;   // LCD
+static const uint32_t SSR_TICK_MS       = 10;    // chamada frequente do apply_output
+static const uint32_t NET_TICK_MS       = 10;    // pausa entre voltas da task de rede
+
+// setup() até antes das tasks: journal, módulos do processo e rede.
+// resetMsg = motivo do reset (vai no evt RESET quando o MQTT conectar)
+void app_begin(const char* resetMsg);
+
+// Task de controle, 1x por volta (a cada SSR_TICK_MS ou disparo do timer):
+// ticks = disparos do timer desde a volta anterior, fireUs = esp_timer do
+// último disparo
+void app_ctrl_step(uint32_t ticks, int64_t fireUs);
+
+// Task de rede, 1x por volta (depois dorme NET_TICK_MS)
+void app_net_step();
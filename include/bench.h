@@ -0,0 +1,25 @@
+#pragma once
+#include <Arduino.h>
+
+// ===== Microbenchmark na placa (cmd "bench") =====
+// Mede em ciclos de CPU (ESP.getCycleCount) os trechos quentes do firmware,
+// na placa em produção, p/ comparar revisões de placa/toolchain/config na
+// frota sem bancada:
+//   ctrl    controlador_update (cópia local do CAAP, não mexe no controle)
+//   state   msg_state_json
+//   parse   mqtt_parse_cmd (comando típico)
+//   log     formatação da linha do log_mirror_printf (sem Serial/fila)
+//   lcd     reenvio completo da tela   } medidos por quem é dono do
+//   ds18b20 getTempC no 1-Wire         } barramento (task do display /
+//                                        task de controle), sem disputa
+// Os 4 primeiros rodam numa task de prioridade BENCH_TASK_PRIO no core 0
+// (abaixo da rede; o controle fica sozinho no core 1). Por trecho: min,
+// mediana e máx (preempção/cache só aumentam: compare o min).
+// Resultado no evt {"type":"bench","id":..,"chip":..,"rev":..,"mhz":..,
+//   "idf":..,"arduino":..,"gcc":..,"build":..,"n":..,
+//   "k":{"ctrl":[min,med,max],..,"lcd":[..]|null}} (ciclos; null = sem hw)
+
+bool bench_start(const char* msgId, uint16_t iters);   // false = já rodando
+
+// Somente na task de rede (publica o resultado)
+void bench_poll();
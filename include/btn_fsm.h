@@ -0,0 +1,72 @@
+#pragma once
+#include <stdint.h>
+
+// ===== Máquina de estados dos botões (sem Arduino, compila no host) =====
+// Entrada: bordas com timestamp (ms) capturadas na ISR; saída: eventos com o
+// instante em que aconteceram. Tudo é calculado a partir dos timestamps
+// (avaliação preguiçosa): um loop atrasado não perde toque curto nem muda o
+// ritmo do repeat.
+//
+// Semântica (igual à versão por polling):
+//   - nível só vale depois de ficar parado debounceMs
+//   - EV_PRESS no instante em que o "apertado" estabilizou
+//   - EV_REPEAT em press + repeatDelayMs e depois a cada repeatRateMs
+//     (atrasado: sai um só, o ritmo recomeça dali)
+//   - EV_LONG uma vez em press + longMs (0 = desligado)
+//   - EV_CHORD: os dois botões do acorde apertados com até chordMs entre
+//     eles. O EV_PRESS desses botões espera chordMs pelo outro; no acorde
+//     nenhum dos dois gera PRESS/REPEAT/LONG até ambos soltarem.
+//
+// Replay no host: btn_pad_init + btn_pad_edge(t, botão, nível) para cada
+// borda gravada + btn_pad_advance(t_final), conferindo os eventos no sink.
+
+enum BtnEvent : uint8_t { EV_NONE = 0, EV_PRESS, EV_REPEAT, EV_LONG, EV_RELEASE, EV_CHORD };
+
+#define BTN_MAX      4
+#define BTN_NO_CHORD 0xFF
+
+struct BtnCfg {
+  uint16_t debounceMs;
+  uint16_t repeatDelayMs;   // 0 = sem repeat
+  uint16_t repeatRateMs;
+  uint16_t longMs;          // 0 = sem long press
+};
+
+struct BtnFsm {
+  BtnCfg   cfg;
+  uint8_t  raw;             // último nível visto (pull-up: 0 = apertado)
+  uint8_t  stable;
+  uint32_t tChange;         // última borda
+  bool     pressed;
+  bool     longDone;
+  uint32_t tPress;
+  uint32_t tNextRep;
+};
+
+// evento pronto (btn = índice; no EV_CHORD, o 1º botão do acorde)
+typedef void (*BtnSink)(void* ctx, uint8_t btn, BtnEvent ev, uint32_t t);
+
+struct BtnPad {
+  uint8_t  n;
+  BtnFsm   b[BTN_MAX];
+
+  uint8_t  chordA, chordB;  // BTN_NO_CHORD = sem acorde
+  uint16_t chordMs;
+  bool     pendA, pendB;    // PRESS segurado esperando o outro botão
+  uint32_t tA, tB;
+  bool     chordActive;
+
+  uint32_t tNow;            // relógio da máquina (só anda p/ frente)
+  BtnSink  sink;
+  void*    ctx;
+};
+
+void btn_pad_init(BtnPad& p, BtnSink sink, void* ctx);
+// level = nível atual do pino no boot
+void btn_pad_add(BtnPad& p, const BtnCfg& cfg, uint8_t level, uint32_t now);
+void btn_pad_set_chord(BtnPad& p, uint8_t a, uint8_t b, uint16_t chordMs);
+
+// Bordas em ordem de tempo; nível repetido é ignorado
+void btn_pad_edge(BtnPad& p, uint8_t btn, uint8_t level, uint32_t t);
+// Avança o relógio (debounce/repeat/long/janela do acorde) até 'now'
+void btn_pad_advance(BtnPad& p, uint32_t now);
@@ -1,12 +1,28 @@
 #pragma once
 #include <Arduino.h>
+#include "btn_fsm.h"
 
-enum BtnEvent { EV_NONE, EV_PRESS, EV_REPEAT };
+// Botões: INPUT_PULLUP (pressionado = LOW). As bordas são capturadas por
+// interrupção com timestamp; buttons_update() só drena a fila e roda a
+// btn_fsm, então o ritmo do loop não afeta debounce/repeat/long.
+
+enum BtnId : uint8_t { BTN_ONOFF = 0, BTN_UP, BTN_DOWN, BTN_COUNT };
+
+struct BtnInput {
+  uint8_t  btn;     // BtnId (EV_CHORD: BTN_UP)
+  BtnEvent ev;
+  uint32_t t;       // millis() do evento
+};
 
 void buttons_begin(uint8_t pinOnOff, uint8_t pinUp, uint8_t pinDown);
+
+// Drena as bordas da ISR e avança as máquinas até nowMs
 void buttons_update(unsigned long nowMs);
 
-// eventos “latched” do último update
-BtnEvent buttons_onoff_event();
-BtnEvent buttons_up_event();
-BtnEvent buttons_down_event();
+// Próximo evento gerado pelos updates (false = fila vazia).
+// ON/OFF: PRESS/RELEASE. UP/DOWN: PRESS/REPEAT/LONG/RELEASE.
+// UP+DOWN juntos: EV_CHORD (o PRESS deles sai com até BTN_CHORD_MS de atraso).
+bool buttons_next(BtnInput& out);
+
+// Bordas perdidas por fila cheia (ressincroniza pelo nível do pino)
+uint32_t buttons_edges_lost();
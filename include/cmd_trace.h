@@ -0,0 +1,39 @@
+#pragma once
+#include <Arduino.h>
+#include "json_out.h"
+#include "mqtt_link.h"
+
+// ===== Latência dos comandos (chegada -> ack -> efeito) =====
+// Carimbos em micros() (mesmo relógio nos dois cores):
+//   rx    chegada (mqtt_callback / datagrama da LAN)
+//   net   quanto a mensagem pode ter esperado no socket: rx - fim do
+//         mqtt.loop() anterior (limite superior da culpa do loop de rede)
+//   disp  entrada no on_mqtt_cmd
+//   ack   ack montado
+//   eff   task de controle aplicou (set_on/set_sp/inc_sp/dec_sp)
+// O ack leva "lat":{"net":us,"disp":us,"ack":us} (tudo desde rx) e, com NTP,
+// "rx_s"/"rx_ms" = hora da chegada, p/ separar ida/volta do broker no host
+// (tools/cmd_latency.py). O handler não espera o controle: o efeito chega
+// depois pela task de rede e sai no evt {"type":"eff","id":..,"eff":us}
+// (só comando próprio; grupo/broadcast/LAN só no histograma). Histogramas
+// log2 por etapa no evt "lat" (comando lat_hist). Tudo na task de rede.
+
+enum TraceStage : uint8_t { TS_NET = 0, TS_DISP, TS_EFF, TS_ACK, TS_COUNT };
+
+#define TRACE_BUCKETS 16     // bucket i: < (TRACE_B0_US << i) us; o último sem teto
+#define TRACE_B0_US   64
+#define TRACE_PENDING 16     // comandos com ack enviado esperando o efeito (o mais velho sai)
+
+// on_mqtt_cmd (início): abre o rastro do comando em execução
+void    cmd_trace_dispatch(const MqttCommand& c);
+uint8_t cmd_trace_tag();                 // marca p/ o CtrlCmd (nunca 0)
+// mqtt_link: campos do ack (carimba o ack) e fim do handler
+void    cmd_trace_ack_json(JsonOut& j);
+void    cmd_trace_done();
+
+// Task de rede: o controle aplicou 'tag' em atUs (ctrl_cmd_done). Conta no
+// histograma e monta o evt "eff" em out; 0 = nada a publicar
+size_t  cmd_trace_effect(uint8_t tag, uint32_t atUs, char* out, size_t cap);
+
+size_t  cmd_trace_hist_json(char* out, size_t cap);
+void    cmd_trace_reset();
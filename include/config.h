@@ -52,11 +52,295 @@
   #define MQTT_STATE_PUB_MS 500   // 0.5s (pode subir p/ 1000ms se quiser)
 #endif
 
+#ifndef MQTT_STATE_PUB_OTA_MS
+  #define MQTT_STATE_PUB_OTA_MS 5000   // state durante OTA (MQTT mantido)
+#endif
+
 #ifndef MQTT_KEEPALIVE_S
   #define MQTT_KEEPALIVE_S 30
 #endif
 
+#ifndef MQTT_BUF_SIZE
+  #define MQTT_BUF_SIZE 1024   // buffer do PubSubClient (maior payload: hist)
+#endif
+
 // ====== TOPIC BASE ======
 #ifndef MQTT_BASE
   #define MQTT_BASE "perferro/estufa/v1"
 #endif
+
+// ====== OTA ======
+// Pipeline: task de rede enche buffers, task do OTA grava na flash
+#ifndef OTA_BUF_COUNT
+  #define OTA_BUF_COUNT 4         // nº de buffers no pipeline
+#endif
+
+#ifndef OTA_BUF_SIZE
+  #define OTA_BUF_SIZE 4096       // 1 setor de flash por buffer
+#endif
+
+#ifndef OTA_PROGRESS_MS
+  #define OTA_PROGRESS_MS 2000    // intervalo mínimo entre eventos DOWNLOADING
+#endif
+
+#ifndef OTA_STREAM_TIMEOUT_MS
+  #define OTA_STREAM_TIMEOUT_MS 20000
+#endif
+
+// Retomada (HTTP Range): tentativas na mesma execução e checkpoint na NVS
+#ifndef OTA_RESUME_TRIES
+  #define OTA_RESUME_TRIES 5
+#endif
+
+#ifndef OTA_RESUME_BACKOFF_MS
+  #define OTA_RESUME_BACKOFF_MS 2000   // espera = backoff * nº da tentativa
+#endif
+
+#ifndef OTA_RESUME_SAVE_BYTES
+  #define OTA_RESUME_SAVE_BYTES (64 * 1024)  // grava progresso a cada 64 KB
+#endif
+
+// Orçamento de heap p/ manter MQTT/TLS no ar durante o OTA (2 sessões TLS).
+// Se não couber, o OTA pausa o MQTT como antes.
+#ifndef OTA_KEEP_MQTT
+  #define OTA_KEEP_MQTT 1
+#endif
+
+#ifndef OTA_TLS_SESSION_BYTES
+  #define OTA_TLS_SESSION_BYTES (44 * 1024)  // IN 16K + OUT 4K + handshake/contexto
+#endif
+
+#ifndef OTA_TLS_BLOCK_MIN
+  #define OTA_TLS_BLOCK_MIN (17 * 1024)      // buffer IN do mbedtls é contíguo
+#endif
+
+#ifndef OTA_HEAP_RESERVE
+  #define OTA_HEAP_RESERVE (24 * 1024)       // folga p/ WiFi/LwIP/tasks
+#endif
+
+// ====== TSDB (série temporal na partição spiffs, ver tsdb.h) ======
+// Setores de 4 KB por nível (~300-500 registros comprimidos cada); o resto
+// da partição fica livre
+#ifndef TSDB_PARTITION
+  #define TSDB_PARTITION "spiffs"
+#endif
+
+#ifndef TSDB_SECT_MIN
+  #define TSDB_SECT_MIN 30        // ~1-2 semanas de minutos
+#endif
+
+#ifndef TSDB_SECT_HOUR
+  #define TSDB_SECT_HOUR 4        // ~2-4 meses de horas
+#endif
+
+#ifndef TSDB_SECT_DAY
+  #define TSDB_SECT_DAY 2         // > 1 ano de dias
+#endif
+
+#ifndef TSDB_QUEUE_LEN
+  #define TSDB_QUEUE_LEN 8        // minutos aguardando gravação
+#endif
+
+// ===== Journal de estado (mesma partição, setores logo após o TSDB) =====
+#ifndef JRNL_SECTORS
+  #define JRNL_SECTORS 4          // mín. 3; o mais antigo é esvaziado quando o head avança
+#endif
+
+#ifndef JRNL_FLUSH_MS
+  #define JRNL_FLUSH_MS 5000      // gravações juntadas em lote
+#endif
+
+#ifndef JRNL_PENDING
+  #define JRNL_PENDING 32         // chaves distintas aguardando gravação (importação: 26)
+#endif
+
+// ===== Consulta de histórico (hist_query) =====
+// Chunks em vôo sem hist_ack (0 = sem controle de fluxo, só HISTQ_GAP_MS)
+#ifndef HISTQ_WINDOW
+  #define HISTQ_WINDOW 4
+#endif
+
+#ifndef HISTQ_WINDOW_MAX
+  #define HISTQ_WINDOW_MAX 8      // também = quantos chunks dá p/ retomar por seq
+#endif
+
+#ifndef HISTQ_GAP_MS
+  #define HISTQ_GAP_MS 20         // intervalo mínimo entre chunks sem janela
+#endif
+
+#ifndef HISTQ_IDLE_MS
+  #define HISTQ_IDLE_MS 30000     // sem ack/resume por esse tempo -> consulta cai
+#endif
+
+#ifndef HISTQ_SCAN_MAX
+  #define HISTQ_SCAN_MAX 256      // registros lidos da flash por poll
+#endif
+
+#ifndef HISTQ_CHUNK_BYTES
+  #define HISTQ_CHUNK_BYTES (MQTT_BUF_SIZE - 128)   // sobra p/ header MQTT + tópico
+#endif
+
+// ===== Botões (ISR + btn_fsm) =====
+#ifndef BTN_EDGE_QUEUE
+  #define BTN_EDGE_QUEUE 32       // bordas entre dois buttons_update (bounce incluso)
+#endif
+
+#ifndef BTN_LONG_MS
+  #define BTN_LONG_MS 1500        // UP/DOWN segurado: passo grande no setpoint
+#endif
+
+#ifndef BTN_CHORD_MS
+  #define BTN_CHORD_MS 80         // UP+DOWN: 2º botão até N ms depois do 1º
+#endif
+
+// ===== Estado controle <-> rede (ctrl_state) =====
+#ifndef CTRL_CMD_QUEUE
+  #define CTRL_CMD_QUEUE 8        // comandos MQTT aguardando a task de controle
+#endif
+
+// ===== Diagnóstico (diag) =====
+#ifndef DIAG_PERIOD_MS
+  #define DIAG_PERIOD_MS 0        // publicação periódica no boot (0 = só por comando)
+#endif
+
+#ifndef DIAG_PERIOD_MIN_MS
+  #define DIAG_PERIOD_MIN_MS 2000
+#endif
+
+#ifndef DIAG_MAX_TASKS
+  #define DIAG_MAX_TASKS 24       // tasks listadas (Arduino + IDF + nossas ~ 18)
+#endif
+
+// ===== Resumos de janela (tstats) =====
+#ifndef TSTATS_BAND_C
+  #define TSTATS_BAND_C 0.5f      // "na banda": |sp - T| <= isso
+#endif
+
+#ifndef TSTATS_HEATER_W
+  #define TSTATS_HEATER_W 0       // potência do aquecedor (W); 0 = não publica Wh
+#endif
+
+// ===== Comandos por grupo / broadcast =====
+// <base>/all/cmd e <base>/grp/<nome>/cmd; acks desses comandos saem juntos,
+// depois de um atraso aleatório (não chegam 500 acks no mesmo instante)
+#ifndef GRP_MAX
+  #define GRP_MAX 4               // grupos por controlador
+#endif
+
+#ifndef GRP_NAME_MAX
+  #define GRP_NAME_MAX 15
+#endif
+
+#ifndef GRP_ACK_JITTER_MS
+  #define GRP_ACK_JITTER_MS 5000  // ack agregado sai em [0, N) ms
+#endif
+
+#ifndef GRP_ACK_BATCH
+  #define GRP_ACK_BATCH 8         // acks por mensagem agregada
+#endif
+
+// ===== Programa de setpoint (agenda diária / rampa) =====
+#ifndef SCHED_MAX_STEPS
+  #define SCHED_MAX_STEPS 16      // passos por programa (máx. 16: rampMask)
+#endif
+
+#ifndef SCHED_TZ_MIN
+  #define SCHED_TZ_MIN (-180)     // fuso padrão do tipo D (min em relação a UTC)
+#endif
+
+// ===== Controle local (LAN, UDP + mDNS) =====
+// Mesmos comandos do MQTT sem passar pelo broker (ver lan_link.h)
+#ifndef LAN_PSK
+  #define LAN_PSK ""              // chave pré-compartilhada; "" = endpoint desligado
+#endif
+
+#ifndef LAN_UDP_PORT
+  #define LAN_UDP_PORT 47800
+#endif
+
+#ifndef LAN_MAX_PEERS
+  #define LAN_MAX_PEERS 4         // sessões simultâneas (a mais antiga sai)
+#endif
+
+#ifndef LAN_STATE_MIN_MS
+  #define LAN_STATE_MIN_MS 100    // período mínimo do stream de state
+#endif
+
+#ifndef LAN_SUB_TTL_MS
+  #define LAN_SUB_TTL_MS 60000    // lan_sub sem renovar expira
+#endif
+
+// ===== Microbenchmark na placa (cmd "bench", ver bench.h) =====
+#ifndef BENCH_ITERS
+  #define BENCH_ITERS 32          // repetições por trecho de CPU (value do cmd)
+#endif
+
+#ifndef BENCH_ITERS_MAX
+  #define BENCH_ITERS_MAX 64
+#endif
+
+#ifndef BENCH_HW_SAMPLES
+  #define BENCH_HW_SAMPLES 3      // reenvios do LCD / leituras do DS18B20
+#endif
+
+#ifndef BENCH_TASK_PRIO
+  #define BENCH_TASK_PRIO 0       // = idle do core 0: não atrasa rede nem controle
+#endif
+
+// ===== Heap depois do boot (ver heap_guard.h) =====
+// 1 = tasks/filas/buffers de runtime estáticos + guarda de alocação; ligado
+// pelo env esp32doit-devkit-v1-static do platformio.ini (precisa dos
+// -Wl,--wrap de lá). Custa ~80 KB de .bss fixos (buffers do OTA 16 KB,
+// dicionário gzip ~43 KB, pilhas ota/ota_net/bench 18 KB)
+#ifndef HEAP_STATIC
+  #define HEAP_STATIC 0
+#endif
+
+#ifndef HEAP_GUARD_SITES
+  #define HEAP_GUARD_SITES 8      // locais de chamada distintos guardados
+#endif
+
+#ifndef HEAP_GUARD_REPORT_MS
+  #define HEAP_GUARD_REPORT_MS 60000   // aviso no log no máx. 1x por período
+#endif
+
+#ifndef HEAP_TREND_MS
+  #define HEAP_TREND_MS 3600000UL // 1 amostra/h do maior bloco livre
+#endif
+
+#ifndef HEAP_TREND_N
+  #define HEAP_TREND_N 48         // 2 dias de tendência
+#endif
+
+// ===== Faltas e tráfego do evt (ver fault.h) =====
+#ifndef FAULT_RAISE_MS
+  #define FAULT_RAISE_MS 3000     // ativa por tanto tempo antes do raise
+#endif
+
+#ifndef FAULT_CLEAR_MS
+  #define FAULT_CLEAR_MS 10000    // inativa por tanto tempo antes do clear
+#endif
+
+#ifndef FAULT_HOLDOFF_MS
+  #define FAULT_HOLDOFF_MS 300000UL   // raise do mesmo código no máx. 1x a cada 5 min
+#endif
+
+#ifndef FAULT_REMIND_MS
+  #define FAULT_REMIND_MS 1800000UL   // lembrete enquanto ativa (0 = sem)
+#endif
+
+// Acks no tópico <id>/ack, fora do evt (faltas, OTA, log); "evt" = como
+// antes, p/ app que ainda não assina o ack
+#ifndef MQTT_ACK_SUFFIX
+  #define MQTT_ACK_SUFFIX "ack"
+#endif
+
+// Linhas do log_mirror no evt: balde de fichas (média/s e rajada). Sem
+// ficha a fila segura; cheia, descarta e conta ("drop" na próxima linha)
+#ifndef LOG_MQTT_RATE
+  #define LOG_MQTT_RATE 5
+#endif
+
+#ifndef LOG_MQTT_BURST
+  #define LOG_MQTT_BURST 20
+#endif
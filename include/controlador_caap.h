@@ -17,14 +17,19 @@ struct CAAP_Data {
     // Configurações
     float lambda;       // Fator de esquecimento
     float polo_desejado;
+    float Ts;           // Período nominal da amostra (s) em que a1/b0 valem
     float u_calculado;  // Saída 0-100%
+    float erro_pred;    // Último erro de predição a priori (C, já em Ts)
 };
 
 // Inicializa os parâmetros do controlador
 void controlador_begin(CAAP_Data &data, float temp_inicial);
 
-// Executa a identificação RLS e calcula a nova lei de controle (deve rodar a cada 1s)
-void controlador_update(CAAP_Data &data, float temp_atual, float setpoint);
+// Executa a identificação RLS e calcula a nova lei de controle (deve rodar a cada Ts).
+// dt_s = tempo real desde a amostra anterior: a amostra é convertida para o
+// equivalente em Ts antes do RLS; fora de [DT_RATIO_MIN, DT_RATIO_MAX]·Ts
+// a identificação pula esta amostra (a lei de controle roda igual).
+void controlador_update(CAAP_Data &data, float temp_atual, float setpoint, float dt_s);
 
 // Gera o sinal PWM de baixa frequência para o SSR (deve rodar em todo loop)
 void controlador_apply_output(const CAAP_Data &data, uint8_t pin_ssr, unsigned long janela_ms);
\ No newline at end of file
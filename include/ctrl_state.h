@@ -0,0 +1,62 @@
+#pragma once
+#include <Arduino.h>
+
+// ===== Estado compartilhado controle <-> rede =====
+// Controle -> rede: um snapshot versionado publicado por seqlock. Só a task
+// de controle escreve; leitores (outro core) nunca travam o escritor e
+// nunca veem metade de uma atualização.
+// Rede -> controle: comandos numa fila; quem aplica é a task de controle,
+// que passa a ser a única dona de systemOn/setpoint/u.
+
+struct CtrlSnapshot {
+  uint32_t version;     // preenchido por ctrl_state_publish
+  uint32_t sampleMs;    // millis() da amostra
+
+  bool  systemOn;
+  bool  tempValid;
+  bool  heating;
+  bool  alertReset;
+  bool  alertSensor;
+
+  float tempC;
+  float setpoint;
+  float u_pct;          // já zerado com OFF/sensor inválido
+
+  // controlador (CAAP)
+  float a1;
+  float b0;
+  float lambda;
+  float polo;
+
+  // programa de setpoint
+  int8_t   schedSeg;    // passo em vigor, -1 = nenhum
+  bool     schedOvr;    // ajuste manual segurando até o próximo passo
+  uint32_t schedStart;  // R/L: epoch do início
+};
+
+enum CtrlCmdType : uint8_t {
+  CC_SET_ON = 0,        // b
+  CC_SET_SP,            // f (absoluto)
+  CC_ADD_SP,            // f (passo, pode ser negativo)
+};
+
+struct CtrlCmd {
+  CtrlCmdType type;
+  bool        b;
+  float       f;
+  uint8_t     tag;      // != 0: avisa quando aplicou (ctrl_cmd_done)
+};
+
+void ctrl_state_begin();
+
+// Só a task de controle
+void ctrl_state_publish(CtrlSnapshot& s);
+bool ctrl_cmd_take(CtrlCmd& out);
+void ctrl_cmd_applied(uint8_t tag);     // micros() do efeito p/ a task de rede
+
+// Qualquer task
+void ctrl_state_read(CtrlSnapshot& out);
+bool ctrl_cmd_post(const CtrlCmd& c);   // false = fila cheia
+// Comando já aplicado pela task de controle (sem esperar): tag e micros() do
+// efeito; false = nenhum novo
+bool ctrl_cmd_done(uint8_t& tag, uint32_t& atUs);
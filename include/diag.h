@@ -0,0 +1,33 @@
+#pragma once
+#include <Arduino.h>
+
+// ===== Diagnóstico em campo (tópico diag) =====
+// Publica periodicamente (desligado por padrão; cmd "diag"):
+//   {"type":"sys"}   heap livre/mínimo/maior bloco, uptime, histogramas de
+//                    atraso do passo de controle (timer -> execução),
+//                    tempo por volta do loop de controle e do loop de rede
+//   {"type":"heap"}  tendência do maior bloco livre, fragmentação e
+//                    alocações depois do boot (heap_guard.h)
+//   {"type":"tasks"} por task: nome, CPU% na janela (se o core tiver
+//                    runtime stats), stack livre mínimo (bytes), prioridade
+// Histogramas em us, bordas DIAG_EDGES_US; cada janela mostra só o que
+// aconteceu desde a publicação anterior.
+
+void diag_begin();
+
+// Task de controle, 1x por volta: tempo ocupado
+void diag_ctrl_tick(uint32_t busyUs);
+
+// Task de controle, 1x por passo do controlador: atraso desde o disparo do
+// timer e ticks perdidos (disparos que chegaram sem o passo anterior rodar)
+void diag_ctrl_step(uint32_t lateUs, uint32_t missed);
+
+// Task de rede, 1x por volta: tempo da volta (sem o delay)
+void diag_net_loop(uint32_t busyUs);
+
+// 0 = desliga. Retorna o período aplicado (limitado a DIAG_PERIOD_MIN_MS)
+uint32_t diag_set_period(uint32_t ms);
+void     diag_request();          // publica uma vez no próximo poll
+
+// Somente na task de rede (publica via MQTT)
+void diag_poll();
@@ -2,10 +2,54 @@
 #include <Arduino.h>
 
 void display_begin(uint8_t addr, uint8_t cols, uint8_t rows);
+
+// Síncrono: só no setup(), antes de display_start_task()
 void display_show_boot(const char* line1, const char* line2);
 
-// Adicionado o parâmetro 'heaterOn' ao final
-void display_update(bool systemOn, float setpoint, bool tempValid, float tempC, bool heaterOn);
+// ===== Task do display =====
+// Quem controla só publica o "modelo" da tela (display_post, não bloqueia);
+// a task do display renderiza o mais recente e fala com o I2C.
+enum DisplayPage : uint8_t { PAGE_MAIN = 0, PAGE_MODEL, PAGE_NET, PAGE_INFO, PAGE_COUNT };
+
+struct DisplayModel {
+  uint8_t page;           // DisplayPage
+  bool  systemOn;
+  bool  tempValid;
+  bool  heaterOn;
+  float tempC;
+  float setpoint;
+  float u_pct;
+  float a1;
+  float b0;
+
+  // alerta com prioridade sobre qualquer página (alert0 = nullptr: sem alerta)
+  // strings precisam ser estáticas (literais)
+  const char* alert0;
+  const char* alert1;
+  bool  alertBlink;
+};
+
+// Cria a task (prioridade baixa, core 1; 1x por boot); periodMs = re-render sem modelo novo (pisca)
+void display_start_task(uint32_t periodMs);
+void display_post(const DisplayModel& m);
+
+// Estado da rede p/ a página NET (chamado pela task de rede)
+void display_set_net(bool wifi, bool mqtt, int rssi);
+
+// Renderização: as telas são formatadas num framebuffer (sem String/heap) e
+// só as células que mudaram em relação ao que já está no LCD vão pelo I2C.
+struct DisplayStats {
+  uint32_t renders;
+  uint32_t cellsSent;       // caracteres enviados
+  uint32_t lcdBytes;        // caracteres + comandos (setCursor)
+  uint32_t i2cBytes;        // estimado (PCF8574, 12 bytes por byte do LCD)
+  uint32_t i2cBytesPerSec;  // última janela de 1 s
+  uint32_t renderUsLast;
+  uint32_t renderUsMax;
+  uint32_t fulls;           // reenvios completos (periódico ou forçado)
+  uint32_t fullCycLast;     // ciclos de CPU do último (core da task do display)
+};
 
-// NOVO: alerta com prioridade (sobrepõe display_update)
-void display_set_alert(bool enabled, const char* line1, const char* line2, bool blink);
\ No newline at end of file
+void display_get_stats(DisplayStats& out);
+// Próximo render reenvia a tela inteira (bench)
+void display_force_full();
@@ -0,0 +1,30 @@
+#pragma once
+#include <Arduino.h>
+
+// ===== Faltas (evt {"type":"fault"}) =====
+// Quem detecta só informa o nível, a cada amostra e de qualquer task
+// (fault_set é uma escrita); a task de rede transforma em eventos:
+//   raise   ativa por FAULT_RAISE_MS seguidos
+//   clear   inativa por FAULT_CLEAR_MS seguidos (só se o raise saiu)
+//   active  lembrete a cada FAULT_REMIND_MS enquanto ativa, e 1x ao
+//           reconectar o MQTT
+// Nova subida do mesmo código antes de FAULT_HOLDOFF_MS do último raise não
+// publica (conta em "sup"); se continuar ativa, o raise sai quando o
+// hold-off vence. "n" = ocorrências desde o boot (publicadas ou não).
+//   {"type":"fault","code":..,"msg":..,"state":"raise"|"active"|"clear",
+//    "n":..,"sup":..,"dur":s ativa}
+// No máx. 1 evento por volta da task de rede; sem MQTT fica pendente.
+
+enum FaultId : uint8_t {
+  FLT_SENSOR = 0,   // DS18B20 sem leitura válida
+  FLT_HEAP,         // maior bloco livre < OTA_TLS_BLOCK_MIN (reconexão TLS falha)
+  FLT_COUNT
+};
+
+void fault_set(FaultId id, bool active);
+
+// Somente na task de rede (publica via MQTT)
+void fault_poll(uint32_t nowMs);
+
+// {"type":"faults","f":[{"code":..,"on":..,"n":..,"sup":..,"dur":s},..]}
+size_t fault_json(char* out, size_t cap, uint32_t nowMs);
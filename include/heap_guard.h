@@ -0,0 +1,52 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "config.h"
+
+// ===== Heap depois do boot =====
+// Semanas ligadas, alocações soltas em runtime fragmentam o heap e a
+// reconexão TLS (bloco contíguo de ~17 KB) passa a falhar.
+//
+// HEAP_STATIC=1 (env "-static" do platformio.ini): tudo que o firmware cria
+// depois do setup() vem de armazenamento estático dimensionado em
+// compilação (tasks do OTA/bench, filas e buffers do OTA, dicionário gzip),
+// e o guarda conta toda alocação depois de heap_guard_seal(): malloc/calloc/
+// realloc/heap_caps_malloc/calloc (via -Wl,--wrap, pega também lib/IDF) e
+// new. Por local de chamada (pc -> addr2line) e task, no diag "heap" e num
+// aviso do log_mirror. TLS/lwIP/WiFi alocam por natureza: aparecem como
+// sites próprios (só reconexão/tráfego), o que importa é o que é nosso.
+//
+// Em qualquer modo: tendência do maior bloco livre (amostra a cada
+// HEAP_TREND_MS, inclinação em B/dia), mínimo desde o boot e nº de blocos
+// livres (fragmentação) no diag {"type":"heap"}.
+
+void   heap_guard_seal();                     // fim do setup()
+void   heap_guard_poll(uint32_t nowMs);       // task de rede
+size_t heap_guard_json(char* out, size_t cap);
+
+// ----- Tasks criadas em runtime -----
+// Com HEAP_STATIC: pilha e TCB estáticos por slot. A task termina com
+// task_slot_exit() (se suspende); o próximo task_slot_start do mesmo slot
+// apaga a anterior (já parada, o TCB volta na hora) e reaproveita.
+// Sem HEAP_STATIC: xTaskCreatePinnedToCore / vTaskDelete como sempre.
+struct TaskSlot {
+  StackType_t*  stack;
+  uint32_t      stackBytes;
+  TaskHandle_t  h;
+#if HEAP_STATIC
+  StaticTask_t  tcb;
+#endif
+};
+
+#if HEAP_STATIC
+  #define TASK_SLOT(name, bytes) \
+    static StackType_t name##Stk[bytes]; \
+    static TaskSlot name = { name##Stk, bytes, nullptr, {} }
+#else
+  #define TASK_SLOT(name, bytes) static TaskSlot name = { nullptr, bytes, nullptr }
+#endif
+
+bool task_slot_start(TaskSlot& s, TaskFunction_t fn, const char* name, void* arg,
+                     UBaseType_t prio, BaseType_t core);
+void task_slot_exit();   // no lugar de vTaskDelete(nullptr)
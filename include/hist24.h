@@ -0,0 +1,23 @@
+#pragma once
+#include <Arduino.h>
+
+// ===== Histórico 24h do app (1 ponto/hora, req_hist) =====
+// Anel de 24 pontos no journal (JK_HIST_META + JK_HIST0..). No 1º boot com
+// journal, importa o anel antigo do NVS ("smarttemp": h_head/h_cnt/h_blob).
+
+struct HistPoint {
+  uint32_t ts;   // epoch (segundos). Se não tiver, 0.
+  float temp;
+};
+
+// Depois do jrnl_begin() (antes das tasks)
+void hist24_begin();
+
+// Task de controle: 1 ponto por hora (e só se temp válida)
+void hist24_maybe_store(uint32_t nowMs, bool tempValid, float tempC);
+
+// Mais antigo -> mais novo; devolve quantos
+uint8_t hist24_copy(HistPoint out[24]);
+
+// Task de rede: envia em chunks no formato do app (tópico hist)
+void hist24_publish_all();
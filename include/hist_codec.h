@@ -0,0 +1,80 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// ===== Codec do histórico (estilo Gorilla, inteiros quantizados) =====
+// Cada linha = ts + HC_FIELDS inteiros. Codifica a diferença para a linha
+// anterior: ts por delta-of-delta, campos por delta. Cada valor vira zigzag
+// com prefixo de tamanho (MSB primeiro):
+//
+//   0                 -> 0
+//   10   + 4 bits     -> 1..15
+//   110  + 8 bits     -> < 2^8
+//   1110 + 16 bits    -> < 2^16
+//   1111 + 32 bits    -> resto
+//
+// Intervalo regular e valor parado custam 1 bit. Estado começa zerado, então a
+// 1ª linha de um bloco/frame é autocontida. Sem Arduino, compila no host.
+// Decoder de referência: tools/hist_decode.py
+//
+// Bloco (transmissão, little-endian):
+//   "HC" | ver u8 | tier u8 | seq u16 | flags u8 | qid u8 | count u16 | bits...
+
+#define HC_FIELDS        12
+#define HC_VER           1
+#define HC_BLOCK_HDR     10
+#define HC_ROW_MAX_BITS  ((HC_FIELDS + 1) * 36)
+#define HC_ROW_MAX_BYTES ((HC_ROW_MAX_BITS + 7) / 8)
+
+#define HC_FLAG_LAST     0x01   // último bloco da resposta
+
+struct HcRow {
+  uint32_t ts;
+  int32_t  v[HC_FIELDS];
+};
+
+// linha anterior + último delta de ts
+struct HcState {
+  uint32_t ts;
+  int32_t  dts;
+  int32_t  v[HC_FIELDS];
+};
+
+struct HcWriter {
+  uint8_t* buf;
+  size_t   cap;    // bytes
+  size_t   bits;   // bits escritos
+};
+
+struct HcReader {
+  const uint8_t* buf;
+  size_t len;      // bytes
+  size_t bit;      // próximo bit
+};
+
+void   hc_state_reset(HcState& s);
+
+// buf é zerado; escrita faz OR bit a bit
+void   hc_writer_init(HcWriter& w, uint8_t* buf, size_t cap);
+size_t hc_writer_bytes(const HcWriter& w);
+
+// false se não sobra espaço p/ o pior caso (HC_ROW_MAX_BITS); nada é escrito
+bool   hc_put_row(HcWriter& w, HcState& s, const HcRow& r);
+
+void   hc_reader_init(HcReader& r, const uint8_t* buf, size_t len);
+// false se os bits acabaram no meio da linha
+bool   hc_get_row(HcReader& r, HcState& s, HcRow& out);
+
+// ---- Bloco de transmissão ----
+struct HcBlock {
+  HcWriter w;
+  HcState  st;
+  uint16_t count;
+};
+
+// false se cap < HC_BLOCK_HDR + HC_ROW_MAX_BYTES
+// qid: 8 bits baixos do id da consulta (hist_query), 0 = avulso
+bool   hc_block_begin(HcBlock& b, uint8_t* buf, size_t cap, uint8_t tier, uint16_t seq, uint8_t qid = 0);
+bool   hc_block_add(HcBlock& b, const HcRow& r);
+// fecha (count/flags no header) e retorna o tamanho em bytes
+size_t hc_block_end(HcBlock& b, uint8_t flags);
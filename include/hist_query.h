@@ -0,0 +1,47 @@
+#pragma once
+#include <Arduino.h>
+
+// ===== Consulta de histórico por intervalo (sobre o TSDB) =====
+// Uma consulta ativa por vez. O resultado nunca é montado inteiro: um cursor
+// no TSDB agrega registros em buckets de 'step' segundos e cada
+// hist_query_poll() (task de rede) lê no máx. HISTQ_SCAN_MAX registros e
+// publica no máx. 1 chunk.
+//
+// Comandos (tópico cmd):
+//   hist_query  {qid, from, to, step, agg, fmt, win, seq}
+//   hist_ack    {qid, seq}   -> libera chunks até seq + win
+//   hist_cancel {qid}
+//
+// Chunk JSON (tópico hist):
+//   {"qid","seq","tier","step","agg","next","last","p":[[ts, ...], ...]}
+//   agg avg|min|max: [ts, temp, sp, u]   agg all: [ts, tMin, tAvg, tMax, sp, u, on]
+//   temp = null se o bucket não teve leitura válida; bucket vazio não sai.
+//   Buckets alinhados ao epoch (ts múltiplo de step); "next" = onde retomar.
+// Chunk bin (tópico hist/bin): bloco hist_codec com seq, qid (8 bits) e
+// HC_FLAG_LAST; linhas = TsdbRec agregado (min/avg/max de tudo).
+//
+// Retomar: hist_query com o mesmo qid e seq. Se a consulta ainda está ativa e
+// o chunk está entre os últimos HISTQ_WINDOW_MAX, volta para ele; senão abre
+// uma nova a partir de 'from' (use o "next" do último chunk recebido)
+// numerando a partir de seq.
+
+struct HistQueryArgs {
+  uint32_t qid;
+  uint32_t from;      // epoch (inclusive)
+  uint32_t to;        // epoch (exclusivo), 0 = agora
+  uint32_t step;      // s, 0 = resolução nativa (60)
+  char     agg[8];    // avg|min|max|all ("" = avg)
+  bool     bin;
+  uint8_t  win;       // 0 = sem hist_ack
+  bool     hasSeq;
+  uint32_t seq;
+};
+
+// false + msg se parâmetros inválidos ou outra consulta em andamento
+bool hist_query_start(const HistQueryArgs& a, char* err, size_t errLen);
+bool hist_query_ack(uint32_t qid, uint32_t seq);
+bool hist_query_cancel(uint32_t qid);
+
+// Chamar SOMENTE na task de rede (mesma do mqtt.loop)
+void hist_query_poll();
+bool hist_query_active();
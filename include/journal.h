@@ -0,0 +1,60 @@
+#pragma once
+#include <Arduino.h>
+
+// ===== Journal de estado (append-only, partição do TSDB) =====
+// Chave -> valor pequeno (até JRNL_VAL_MAX bytes); vale o registro mais novo.
+// Os registros vão sendo anexados num anel de JRNL_SECTORS setores, com CRC,
+// e o boot reconstrói o índice relendo tudo. Antes de o anel voltar a um
+// setor, os registros ainda vivos nele são copiados para o head (compactação),
+// então nenhum setor é apagado com dado que não existe em outro lugar.
+//
+// jrnl_put() só copia para RAM (O(1), não toca flash): a task do journal
+// grava em lote a cada JRNL_FLUSH_MS, e puts repetidos da mesma chave no
+// intervalo viram uma gravação só.
+
+#define JRNL_VAL_MAX 32
+
+enum JrnlKey : uint8_t {
+  JK_HIST_META = 1,     // {head, count} do anel de 24 pontos
+  JK_SETPOINT  = 2,     // float
+  JK_BOOTS     = 3,     // uint32
+  JK_GROUPS    = 4,     // char[JRNL_VAL_MAX]: grupos MQTT "a,b"
+  JK_SCHED     = 5,     // uint32: CRC do programa de setpoint
+  JK_SCHED0    = 8,     // 8..15: SchedProg em pedaços de JRNL_VAL_MAX
+  JK_HIST0     = 32,    // 32..55: pontos do anel de 24 pontos
+  JK_MAX       = 64,
+};
+
+struct JrnlStats {
+  uint32_t puts;          // jrnl_put aceitos
+  uint32_t coalesced;     // puts que sobrescreveram um pendente da mesma chave
+  uint32_t dropped;       // fila de pendentes cheia
+  uint32_t records;       // registros gravados (inclui cópias da compactação)
+  uint32_t relocated;     // cópias da compactação
+  uint32_t userBytes;     // bytes pedidos em jrnl_put
+  uint32_t flashBytes;    // bytes gravados (registros + headers)
+  uint32_t erases;        // desde o boot
+  uint32_t wearMin;       // apagamentos por setor (vida toda, header)
+  uint32_t wearMax;
+  uint32_t crcErrors;
+  uint16_t live;          // chaves com valor
+  uint32_t headSeq;
+};
+
+// Relê o anel e monta o índice; false se a partição não existir/couber
+bool jrnl_begin();
+
+// Valor mais novo (pendente ou em flash); false se não existe ou len difere
+bool jrnl_get(uint8_t key, void* out, size_t len);
+
+// Agenda a gravação; false se key/len inválidos ou fila cheia
+bool jrnl_put(uint8_t key, const void* data, size_t len);
+
+// Pede gravação imediata dos pendentes (não bloqueia)
+void jrnl_flush();
+
+// Grava os pendentes agora, na task de quem chama (espera a flash; não usar
+// na task de controle). true = tudo que estava pendente está na flash.
+bool jrnl_sync();
+
+void jrnl_get_stats(JrnlStats& out);
@@ -0,0 +1,65 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// ===== Writer JSON sem alocação (telemetria) =====
+// Escreve direto no buffer do chamador: sem documento intermediário nem
+// segundo buffer. Cada mensagem tem o seu esquema numa função só
+// (msg_json.h), com o tipo de cada campo fixo no código.
+//
+// Floats, sem printf; NaN/inf -> null:
+//   f(key, v)      como o ArduinoJson 6 escrevia (float -> double, 9 casas
+//                  menos as da parte inteira, zeros caem, exponencial fora
+//                  de [1e-5, 1e7)): "29.87000084", "1.6777216e7". Mensagens
+//                  que já existiam com o ArduinoJson (msg_json.h)
+//   f(key, v, dec) ponto fixo com dec casas (inteiro escalado), zeros caem
+//                  ("30.5", "1", "0.000512"); |v| >= 9e15 em exponencial
+//                  com 7 algarismos ("1.844674e19"). Mensagens novas
+// Strings escapadas (" \ e controle; o ArduinoJson deixava os controles
+// fora de \b\f\n\r\t crus, JSON inválido). Buffer estourou: ok() = false e o
+// conteúdo não deve ser publicado. Sem Arduino, compila no host.
+//
+//   char out[128];
+//   JsonOut j(out);
+//   j.obj().s("type", "ack").b("ok", true).end();
+//   if (j.ok()) publish(out, j.len());
+
+#define JSON_OUT_DEPTH 8
+
+class JsonOut {
+ public:
+  template <size_t N> explicit JsonOut(char (&buf)[N]) : JsonOut(buf, N) {}
+  JsonOut(char* buf, size_t cap);
+
+  // objeto/array: sem key = valor (raiz ou item de array)
+  JsonOut& obj(const char* key = nullptr);
+  JsonOut& arr(const char* key = nullptr);
+  JsonOut& end();
+
+  // campos (key = nullptr: item de array)
+  JsonOut& s(const char* key, const char* v);          // nullptr -> ""
+  JsonOut& b(const char* key, bool v);
+  JsonOut& u(const char* key, uint32_t v);
+  JsonOut& i(const char* key, int32_t v);
+  JsonOut& f(const char* key, float v);                 // como o ArduinoJson
+  JsonOut& f(const char* key, float v, uint8_t dec);    // dec <= 9
+  JsonOut& null(const char* key);
+
+  size_t len() const { return ok() ? _n : 0; }
+  bool   ok()  const { return !_over && _depth == 0; }
+
+ private:
+  void put(char c);
+  void put(const char* s, size_t n);
+  void sep(const char* key);
+  void uint_dec(uint32_t v);
+  JsonOut& f_exp(bool neg, double a);
+
+  char*    _buf;
+  size_t   _cap;
+  size_t   _n;
+  bool     _over;
+  uint8_t  _depth;
+  uint8_t  _empty;        // bit d = nível d ainda sem item
+  char     _close[JSON_OUT_DEPTH];
+};
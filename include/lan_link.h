@@ -0,0 +1,30 @@
+#pragma once
+#include <Arduino.h>
+#include "mqtt_link.h"
+
+// ===== Controle local (LAN, UDP, sem passar pelo broker) =====
+// Mesmo JSON de comando do tópico cmd, mesmo handler e mesmo state; tudo
+// autenticado com chave pré-compartilhada (LAN_PSK). Anunciado por mDNS
+// como _perferro._udp (TXT id=<CTRL_ID>). LAN_PSK vazio = desligado.
+//
+// Datagrama (little endian):
+//   'P' 'L' ver(1) tipo(1) | sessão u32 | seq u32 | payload | tag[16]
+//   tag = HMAC-SHA256(LAN_PSK, tudo antes da tag)[0:16]
+// Tipos:
+//   1 HELLO    cliente -> ctrl, sessão 0, payload = 8 bytes aleatórios
+//   2 WELCOME  ctrl -> cliente, sessão nova, payload = os mesmos 8 bytes
+//   3 CMD      cliente -> ctrl, JSON do comando; seq > último aceito
+//   4 MSG      ctrl -> cliente, JSON (ack/evt do comando, state)
+// Cada HELLO abre uma sessão nova (número aleatório), então datagrama
+// gravado de outra sessão não é aceito de novo.
+//
+// Extra só da LAN: {"cmd":"lan_sub","value":ms} = stream do state a cada
+// ms (>= LAN_STATE_MIN_MS; 0 = para); renovar antes de LAN_SUB_TTL_MS.
+// Cliente de teste: tools/lan_client.py
+
+// Só a task de rede
+void lan_begin();
+void lan_update(uint32_t now);     // sobe/desce com o WiFi, atende datagramas
+
+bool lan_state_due(uint32_t now);  // algum assinante quer state agora
+void lan_publish_state(const MqttState& s, uint32_t now);
@@ -3,6 +3,8 @@
 
 enum LogLvl : uint8_t { LOG_D=0, LOG_I=1, LOG_W=2, LOG_E=3 };
 
+static const int LOG_MSG_MAX = 220;   // linha formatada; manter baixo p/ não estourar buffer MQTT
+
 // Inicia fila + (opcional) captura logs do core (ESP_LOGx / WiFiClientSecure etc)
 void log_mirror_begin(bool hook_esp_log = true);
 
@@ -1,5 +1,6 @@
 #pragma once
 #include <Arduino.h>
+#include "config.h"
 
 struct MqttState {
   const char* id;
@@ -32,25 +33,61 @@ struct MqttCommand {
   bool hasReboot;
   bool reboot;
 
+  // SHA-256 esperado da imagem (hex) opcional
+  bool hasSha;
+  char sha256[65];
+
+  // formato de resposta (req_hist/hist_query: "bin" = blocos hist_codec)
+  char fmt[8];
+
+  // hist_query / hist_ack / hist_cancel
+  uint32_t qid;
+  uint32_t from, to, step;
+  char     agg[8];
+  uint8_t  win;
+  bool     hasSeq;
+  uint32_t seq;
+
   char msgId[32];
   char src[16];
+
+  // de onde veio: cmd próprio, broadcast (all), grupo (grp = nome) ou LAN
+  uint8_t scope;
+  char    grp[GRP_NAME_MAX + 1];
+
+  // latência (cmd_trace.h): micros() na chegada (0 = sem) e espera no socket
+  uint32_t rxUs;
+  uint32_t netUs;
 };
 
+enum CmdScope : uint8_t { CMD_DIRECT = 0, CMD_GROUP, CMD_ALL, CMD_LAN };
+
 typedef void (*MqttCmdHandler)(const MqttCommand& c);
 
 void mqtt_set_cmd_handler(MqttCmdHandler h);
 
+// Comando que não veio do broker (LAN): mesmo parser e mesmo handler.
+// Durante o handler, ack e evt vão para 'reply' em vez do tópico evt.
+typedef void (*CmdReplyFn)(const char* payload, size_t len, void* ctx);
+bool mqtt_parse_cmd(const char* json, MqttCommand& out);   // false = JSON inválido
+void mqtt_dispatch_local(MqttCommand& c, CmdReplyFn reply, void* ctx);
+
 void mqtt_begin();
 void mqtt_update();
 
 bool mqtt_is_connected();
 bool mqtt_just_connected();   // true 1x quando conecta
 
-bool mqtt_publish_state(const MqttState& s);     // retained
+bool mqtt_publish_state(const MqttState& s);     // retained (JSON: msg_json.h)
+// Acks no tópico ack (MQTT_ACK_SUFFIX), separados do evt.
+// Comando de grupo/broadcast: o ack entra no lote agregado (ack
+// {"type":"acks","a":[{"id":..,"ok":..[,"msg":..]},..]}) com atraso aleatório
 bool mqtt_publish_ack(const char* msgId, bool ok, const char* msg = nullptr);
-bool mqtt_publish_fault(const char* code, const char* msg);
 
 bool mqtt_publish_hist(const char* payload, size_t len, bool retained=false);
+bool mqtt_publish_hist_bin(const uint8_t* payload, size_t len);   // blocos hist_codec
+bool mqtt_publish_diag(const char* payload, size_t len);          // módulo diag
+bool mqtt_publish_stats(const char* payload, size_t len);         // resumos tstats
 
 // NOVO: publicar EVT genérico (usado pelo OTA)
 bool mqtt_publish_evt(const char* payload, size_t len);
@@ -59,5 +96,15 @@ bool mqtt_publish_evt(const char* payload, size_t len);
 bool mqtt_publish_reset(const char* msg);
 
 // ===== OTA helper: pausa MQTT/TLS para liberar heap durante HTTPS OTA =====
+// O desconecta de fato acontece no próximo mqtt_update() (task de rede):
+// PubSubClient não é thread-safe.
 void mqtt_pause(bool paused);
 bool mqtt_is_paused();
+
+// Heap consumido pela sessão TLS do MQTT (medido no último connect)
+uint32_t mqtt_tls_heap();
+
+// Grupos deste controlador: "a,b" (até GRP_MAX nomes [A-Za-z0-9_-]);
+// "" = nenhum. Reassina na hora se conectado. false = lista inválida.
+bool        mqtt_set_groups(const char* csv);
+const char* mqtt_groups();
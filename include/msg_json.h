@@ -0,0 +1,60 @@
+#pragma once
+#include <Arduino.h>
+#include "mqtt_link.h"
+#include "hist24.h"
+
+// ===== Esquemas das mensagens publicadas (JsonOut) =====
+// Chaves, ordem e tipo de cada mensagem num lugar só; quem publica só
+// preenche os campos. Saída de referência: test/native/test_msg_json.
+// Retorno = bytes escritos em out; 0 = não coube (não publicar).
+//
+// Mesmos bytes que o ArduinoJson (StaticJsonDocument + serializeJson)
+// gerava antes: chaves, ordem, tipos e floats (JsonOut::f sem casas,
+// "29.87000084"). Conferido contra o ArduinoJson em test_msg_json. Única
+// diferença: controle fora de \b\f\n\r\t sai \u00XX (antes cru).
+// Mensagens novas (acks, lat, stats, diag...) escolhem as casas.
+
+// <ctrl>/state (retained), LAN
+// {"id":..,"online":true,"ms":..,"tempC":..,"tempValid":..,"setpoint":..,
+//  "systemOn":..,"heating":..,"u_pct":..,"a1":..,"b0":..,"rssi":..}
+size_t msg_state_json(const MqttState& s, char* out, size_t cap);
+
+// ack: {"type":"ack","id":..,"ok":..[,"msg":..][,"lat":{..},"rx_s":..,"rx_ms":..]}
+// ("lat"/"rx_*" do cmd_trace, só com comando em execução)
+size_t msg_ack_json(char* out, size_t cap, const char* msgId, bool ok, const char* msg);
+
+// lote de acks de grupo: {"type":"acks","lost":..,"a":[{"id":..,"ok":..[,"msg":..]},..]}
+struct MsgAck {
+  char msgId[32];
+  bool ok;
+  char msg[40];     // "" = sem msg
+};
+size_t msg_acks_json(char* out, size_t cap, uint32_t lost, const MsgAck* a, uint8_t n);
+
+// evt: {"type":"RESET","msg":..}
+size_t msg_reset_json(char* out, size_t cap, const char* msg);
+
+// evt: {"type":"OTA","stage":..[,"pct":..][,"msg":..]}  (pct < 0 / msg vazio: sem)
+size_t msg_ota_json(char* out, size_t cap, const char* stage, int pct, const char* msg);
+
+// evt: {"type":"OTA","stage":"STATS",...} resumo do pipeline
+struct MsgOtaStats {
+  const char* fmt;          // "raw" | "delta"
+  bool     gzip;
+  uint32_t bytes, unzBytes, outBytes, ms;
+  float    kbps, unzKbps;
+  uint32_t netStallMs, flashIdleMs;
+  uint32_t writeMaxUs, writeAvgUs;
+  uint32_t bufs, bufSize;
+  uint32_t resumes, resumedFrom;
+  bool     mqttKept;
+  uint32_t tlsMqtt, tlsHttp;
+  uint32_t heapMin, blkMin;
+};
+size_t msg_ota_stats_json(char* out, size_t cap, const MsgOtaStats& s);
+
+// evt: {"type":"LOG","id":CTRL_ID,"ms":..,"lvl":"D|I|W|E","msg":..[,"drop":..]}
+size_t msg_log_json(char* out, size_t cap, uint32_t ms, const char* lvl, const char* msg, uint32_t drop);
+
+// hist (formato do app): {"id":CTRL_ID,"seq":..,"total":..,"points":[[ts,temp],..]}
+size_t msg_hist_json(char* out, size_t cap, uint8_t seq, uint8_t total, const HistPoint* p, uint8_t n);
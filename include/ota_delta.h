@@ -0,0 +1,73 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// ===== Delta OTA (patch binário contra a imagem que está rodando) =====
+// Formato (little-endian), gerado no host por tools/ota_delta.py:
+//
+//   header: "EDP1" | base_size u32 | base_sha256[32] | target_size u32 | target_sha256[32]
+//   ops:    0x01 COPY  off u32, len u32              -> copia len bytes da base
+//           0x02 ADD   len u32, len bytes             -> bytes literais
+//           0x03 DIFF  off u32, len u32, len bytes    -> base[off+i] + d[i] (mod 256)
+//           0x00 END
+//
+// O apply é streaming: consome o patch em pedaços de qualquer tamanho e usa
+// só DELTA_SCRATCH bytes de RAM (sem Arduino, compila no host).
+
+#define DELTA_MAGIC        "EDP1"
+#define DELTA_HDR_SIZE     76
+#define DELTA_SCRATCH      1024
+
+enum DeltaOp : uint8_t { DOP_END = 0x00, DOP_COPY = 0x01, DOP_ADD = 0x02, DOP_DIFF = 0x03 };
+
+enum DeltaStatus : uint8_t {
+  DELTA_OK = 0,       // consumiu tudo, quer mais
+  DELTA_DONE,         // chegou no END
+  DELTA_ERR_MAGIC,
+  DELTA_ERR_HEADER,   // on_header recusou (base errada, sem espaço...)
+  DELTA_ERR_OP,
+  DELTA_ERR_RANGE,    // COPY/DIFF fora da base ou saída maior que target_size
+  DELTA_ERR_READ,
+  DELTA_ERR_WRITE,
+  DELTA_ERR_TRAILING  // dados depois do END
+};
+
+struct DeltaHeader {
+  uint32_t base_size;
+  uint8_t  base_sha256[32];
+  uint32_t target_size;
+  uint8_t  target_sha256[32];
+};
+
+typedef bool (*DeltaHeaderFn)(void* ctx, const DeltaHeader& h);
+typedef bool (*DeltaReadFn)(void* ctx, uint32_t off, uint8_t* buf, size_t len);
+typedef bool (*DeltaWriteFn)(void* ctx, const uint8_t* buf, size_t len);
+
+struct DeltaApply {
+  // callbacks
+  DeltaHeaderFn on_header;
+  DeltaReadFn   read_base;
+  DeltaWriteFn  write_out;
+  void*         ctx;
+
+  // parser
+  uint8_t  state;
+  uint8_t  op;
+  uint8_t  hdrBuf[DELTA_HDR_SIZE];
+  uint8_t  argBuf[8];
+  uint8_t  pos;          // bytes acumulados em hdrBuf/argBuf
+  uint32_t srcOff;
+  uint32_t remaining;
+  uint8_t  status;
+
+  DeltaHeader hdr;
+  uint32_t outPos;
+
+  uint8_t  scratch[DELTA_SCRATCH];
+};
+
+void        delta_begin(DeltaApply& d, DeltaHeaderFn on_header, DeltaReadFn read_base,
+                        DeltaWriteFn write_out, void* ctx);
+DeltaStatus delta_feed(DeltaApply& d, const uint8_t* data, size_t len);
+bool        delta_done(const DeltaApply& d);
+const char* delta_status_str(DeltaStatus s);
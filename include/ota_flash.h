@@ -0,0 +1,25 @@
+#pragma once
+#include <Arduino.h>
+#include <esp_partition.h>
+
+// ===== Gravação direta na partição OTA inativa =====
+// Substitui o Update para permitir retomar a partir de um offset (OTA
+// resumível): apaga setor a setor conforme escreve, nunca a partição toda.
+// A troca de boot só acontece em ota_flash_finish(), que valida a imagem.
+
+// offset precisa ser múltiplo de SPI_FLASH_SEC_SIZE (retomada) ou 0
+bool     ota_flash_begin(uint32_t offset);
+bool     ota_flash_write(const uint8_t* buf, size_t len);
+
+uint32_t ota_flash_written();     // bytes gravados (inclui offset inicial)
+uint32_t ota_flash_committed();   // parte contígua em setores completos
+const esp_partition_t* ota_flash_partition();
+
+// SHA-256 dos primeiros len bytes lidos de volta da flash
+bool     ota_flash_sha256(uint32_t len, uint8_t out[32]);
+
+// Valida a imagem (esp_image_verify) e troca a partição de boot
+bool     ota_flash_finish();
+void     ota_flash_abort();
+
+const char* ota_flash_error();
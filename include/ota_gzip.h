@@ -0,0 +1,34 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+// ===== Descompressão gzip em streaming (OTA) =====
+// Usa o inflate (tinfl) da ROM do ESP32 com janela circular de 32 KB:
+// RAM fixa ~43 KB (dicionário + estado), alocada só durante o OTA
+// (estática com HEAP_STATIC).
+// Confere CRC32 e ISIZE do trailer gzip.
+
+enum GzStatus : uint8_t {
+  GZ_OK = 0,        // consumiu tudo, quer mais
+  GZ_DONE,          // trailer conferido
+  GZ_ERR_HEADER,
+  GZ_ERR_DATA,      // deflate inválido
+  GZ_ERR_CRC,       // CRC32/ISIZE não conferem
+  GZ_ERR_WRITE,
+  GZ_ERR_TRAILING
+};
+
+// heap alocado por gz_begin (dicionário 32 KB + tinfl_decompressor)
+static const uint32_t GZ_HEAP_BYTES = HEAP_STATIC ? 0 : 43 * 1024;
+
+typedef bool (*GzWriteFn)(void* ctx, const uint8_t* buf, size_t len);
+
+// Aloca dicionário/estado; false se faltar heap
+bool        gz_begin(GzWriteFn out, void* ctx);
+GzStatus    gz_feed(const uint8_t* data, size_t len);
+bool        gz_done();
+void        gz_end();
+
+uint32_t    gz_bytes_in();
+uint32_t    gz_bytes_out();
+const char* gz_status_str(GzStatus s);
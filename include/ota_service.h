@@ -2,7 +2,15 @@
 #include <Arduino.h>
 
 // Inicia OTA por URL (HTTP/HTTPS). Roda em task separada.
-bool ota_start_url(const char* url, bool reboot_after);
+// sha256_hex (opcional, 64 hex): hash esperado da imagem final.
+bool ota_start_url(const char* url, bool reboot_after, const char* sha256_hex = nullptr);
+
+// Retoma download interrompido (progresso salvo na NVS). Chamar quando o
+// WiFi conecta; false se não havia nada pendente.
+bool ota_resume_pending();
+
+// Publica eventos do OTA enfileirados. Chamar SOMENTE na task de rede.
+void ota_poll();
 
 // Status
 bool ota_is_running();
@@ -14,9 +14,19 @@ static inline void topic_cmd  (char* out, size_t n, const char* ctrl_id) { topic
 static inline void topic_evt  (char* out, size_t n, const char* ctrl_id) { topic_make(out, n, ctrl_id, "evt"); }
 static inline void topic_lwt  (char* out, size_t n, const char* ctrl_id) { topic_make(out, n, ctrl_id, "lwt"); }
 static inline void topic_hist (char* out, size_t n, const char* ctrl_id) { topic_make(out, n, ctrl_id, "hist"); }
+static inline void topic_hist_bin(char* out, size_t n, const char* ctrl_id) { topic_make(out, n, ctrl_id, "hist/bin"); }
+static inline void topic_diag (char* out, size_t n, const char* ctrl_id) { topic_make(out, n, ctrl_id, "diag"); }
+static inline void topic_stats(char* out, size_t n, const char* ctrl_id) { topic_make(out, n, ctrl_id, "stats"); }
+static inline void topic_ack  (char* out, size_t n, const char* ctrl_id) { topic_make(out, n, ctrl_id, MQTT_ACK_SUFFIX); }
+
+// Comandos para vários controladores (mesmo JSON do cmd individual)
+static inline void topic_all_cmd(char* out, size_t n) { snprintf(out, n, "%s/all/cmd", MQTT_BASE); }
+static inline void topic_grp_cmd(char* out, size_t n, const char* grp) { snprintf(out, n, "%s/grp/%s/cmd", MQTT_BASE, grp); }
 
 
 // wildcard para dashboard (assinatura):
 // perferro/estufa/v1/+/state  (dashboard)
 // perferro/estufa/v1/+/lwt
 // perferro/estufa/v1/+/evt
+// perferro/estufa/v1/+/ack    (acks de comando; MQTT_ACK_SUFFIX)
+// perferro/estufa/v1/+/stats  (resumos de 1/15 min; dispensa o state cru)
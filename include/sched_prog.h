@@ -0,0 +1,64 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+// ===== Programa de setpoint local (agenda diária / rampa) =====
+// Avaliado na task de controle a cada passo, com o relógio do NTP; fica
+// salvo no journal e volta no boot, então o perfil segue sem a nuvem.
+//
+// Texto compacto (comando sched_set):
+//   tipo[@tz]:passo,passo,...        passo = [~]min=sp
+//   D  diário: min = minuto do dia local (tz = minutos em relação a UTC,
+//      padrão SCHED_TZ_MIN)
+//   R  rampa única: min desde o início (1º passo em 0); no fim segura o
+//      último sp
+//   L  rampa em loop: como R; o último passo marca o recomeço
+//   "~" = chega em sp nesse minuto em rampa linear desde o passo anterior;
+//   sem "~" = degrau.
+// Ex.: "D@-180:360=30,~480=35,1320=28"  06h 30 °C, sobe até 35 °C às 08h,
+//                                        22h 28 °C
+//      "R:0=25,~120=35,360=35,~420=28"  sobe 2 h, segura 4 h, desce 1 h
+//
+// Ajuste manual (botões, set_sp, inc_sp) vale até o próximo passo.
+// Sem hora válida o programa espera (setpoint fica onde está).
+
+enum SchedKind : uint8_t { SK_NONE = 0, SK_DAILY, SK_ONCE, SK_LOOP };
+
+struct SchedProg {
+  uint8_t  kind;
+  uint8_t  n;
+  int16_t  tzMin;
+  uint16_t rampMask;                 // bit i: passo i chega em rampa
+  uint32_t start;                    // R/L: epoch do início (0 = ao ter hora)
+  uint32_t t[SCHED_MAX_STEPS];       // s do dia local (D) ou desde o início
+  float    sp[SCHED_MAX_STEPS];
+};
+
+struct SchedOut {
+  float    sp;
+  uint8_t  seg;        // passo em vigor
+  uint32_t segStart;   // epoch em que ele começou (identifica o trecho)
+  bool     done;       // R terminou
+};
+
+// ---- puras (compilam no host) ----
+// "" = sem programa (SK_NONE)
+bool   sched_parse(const char* s, float spMin, float spMax, SchedProg& p, char* err, size_t errLen);
+size_t sched_format(const SchedProg& p, char* out, size_t cap);
+// false = sem programa, sem hora ou R ainda sem início
+bool   sched_eval(const SchedProg& p, uint32_t epoch, SchedOut& o);
+
+// ---- runtime ----
+void sched_begin();                          // carrega do journal (antes das tasks)
+
+// Task de rede
+void             sched_post(const SchedProg& p);   // troca o programa (SK_NONE desliga)
+const SchedProg& sched_prog();                     // último postado/carregado
+
+// Task de controle (único dono do programa em execução e do journal dele;
+// a rede vê seg/override/início pelo CtrlSnapshot)
+bool     sched_step(uint32_t epoch, float& sp);   // true = aplicar sp
+void     sched_override();                        // ajuste manual: segura até o próximo passo
+bool     sched_overridden();
+int8_t   sched_seg();                             // -1 = nada em vigor
+uint32_t sched_start();
@@ -7,3 +7,7 @@ void  sensor_update(unsigned long nowMs);
 bool  sensor_ok();          // sensor detectado (endereço encontrado)
 bool  sensor_has_value();   // temperatura válida disponível
 float sensor_get_c();       // última temperatura (°C)
+
+// Ciclos de CPU do último getTempC (busca + scratchpad no 1-Wire, na task
+// que chama sensor_update); seq conta as leituras
+void  sensor_read_timing(uint32_t& seq, uint32_t& cycles);
@@ -0,0 +1,65 @@
+#pragma once
+#include <Arduino.h>
+#include "hist_codec.h"
+
+// ===== Série temporal em flash (partição "spiffs", sem sistema de arquivos) =====
+// 3 níveis com min/média/máx de temperatura, setpoint e duty:
+//   MIN  = 1 registro/minuto (alimentado pela task de controle)
+//   HOUR = rollup incremental dos minutos
+//   DAY  = rollup incremental das horas (dia UTC)
+// Cada nível é um anel de setores com tamanho fixo (config.h): quando enche,
+// o setor mais antigo é apagado. Registros ficam comprimidos (hist_codec.h,
+// delta contra o anterior no mesmo setor). A gravação roda numa task de
+// baixa prioridade.
+
+enum TsdbTier : uint8_t { TSDB_MIN = 0, TSDB_HOUR, TSDB_DAY, TSDB_TIERS };
+
+// Temperatura/setpoint em 0.01 °C, duty em 0.01 %
+struct TsdbRec {
+  uint32_t ts;        // epoch do início do intervalo (0 = sem NTP)
+  uint32_t n;         // amostras (1 Hz) no intervalo
+  uint32_t nT;        // amostras com temperatura válida (0 = t* inválidos)
+  int16_t  tMin, tAvg, tMax;
+  int16_t  spMin, spAvg, spMax;
+  uint16_t uMin, uAvg, uMax;
+  uint8_t  tier;
+  uint8_t  onPct;     // % das amostras com sistema ligado
+  uint16_t rsv;
+};
+
+struct TsdbStats {
+  uint32_t written[TSDB_TIERS];
+  uint32_t bytes[TSDB_TIERS];   // bytes gravados (frames) -> taxa de compressão
+  uint32_t dropped;       // fila cheia (task de gravação atrasada)
+  uint32_t crcErrors;     // registros corrompidos ignorados na leitura
+  uint32_t erases;
+  uint32_t writeMaxUs;
+};
+
+// Abre/recupera os anéis; false se a partição não existir
+bool     tsdb_begin();
+
+// Amostra de 1 Hz da task de controle. O(1), não toca a flash.
+void     tsdb_add(uint32_t nowMs, bool tempValid, float tempC, float setpoint, float u_pct, bool on);
+
+// Leitura sequencial (mais antigo -> mais novo). Seguro contra a task de
+// gravação: se o setor do cursor for reciclado, pula para o mais antigo.
+struct TsdbCursor {
+  uint8_t  tier;
+  uint32_t seq;       // setor
+  uint16_t off;       // próximo frame no setor
+  HcState  st;        // delta dentro do setor
+};
+
+// Posiciona no 1º registro com ts >= fromTs (0 = desde o início)
+bool     tsdb_seek(TsdbCursor& c, TsdbTier tier, uint32_t fromTs);
+bool     tsdb_next(TsdbCursor& c, TsdbRec& out);
+
+// Registro mais novo gravado no nível
+bool     tsdb_last(TsdbTier tier, TsdbRec& out);
+
+// TsdbRec <-> linha do codec (também usado na transmissão)
+void     tsdb_to_row(const TsdbRec& r, HcRow& out);
+void     tsdb_from_row(const HcRow& row, uint8_t tier, TsdbRec& out);
+
+void     tsdb_get_stats(TsdbStats& out);
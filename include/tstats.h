@@ -0,0 +1,35 @@
+#pragma once
+#include <Arduino.h>
+
+// ===== Estatística de janelas da telemetria (tópico stats) =====
+// Cada passo do controlador (1 Hz) entra em duas janelas, de 1 min e
+// 15 min, alinhadas ao relógio (epoch; sem NTP, ao uptime). Atualização O(1)
+// (Welford): min/max/média/desvio de temperatura, erro de
+// rastreamento (sp - T) e erro de predição do RLS (esses dois só ligado),
+// duty (u%);
+// fração do tempo na banda (|erro| <= TSTATS_BAND_C) e integrais de
+// aquecimento (s de SSR ligado e Wh, se TSTATS_HEATER_W > 0).
+// Janela fechada vira um resumo que a task de rede publica:
+//   {"w":60,"ts":..,"n":..,"t":[min,max,avg,sd],"e":[..],"u":[..],"pe":[..],
+//    "band":0.93,"on_s":12.3,"wh":0.68}
+// (campo sem amostra na janela = null; ts = início, 0 se sem NTP)
+
+struct TstatsSample {
+  uint32_t epoch;      // 0 = sem NTP
+  uint32_t ms;
+  float    dt;         // s desde a amostra anterior
+  bool     tempValid;
+  bool     systemOn;
+  float    tempC;
+  float    setpoint;
+  float    u_pct;
+  float    predErr;    // erro de predição a priori do RLS
+};
+
+void tstats_begin();
+
+// Só a task de controle
+void tstats_add(const TstatsSample& s);
+
+// Só a task de rede (publica os resumos prontos)
+void tstats_poll();
@@ -0,0 +1,763 @@
+#include "app.h"
+
+#include "sensor_ds18b20.h"
+#include "buttons.h"
+#include "display_lcd.h"
+#include "controlador_caap.h"
+
+#include "config.h"
+#include "wifi_link.h"
+#include "mqtt_link.h"
+
+#include <time.h>
+#include <esp_timer.h>
+
+#include "ota_service.h"
+
+#include "log_mirror.h"
+#include "tsdb.h"
+#include "hist_query.h"
+#include "journal.h"
+#include "ctrl_state.h"
+#include "diag.h"
+#include "json_out.h"
+#include "tstats.h"
+#include "sched_prog.h"
+#include "lan_link.h"
+#include "cmd_trace.h"
+#include "bench.h"
+#include "heap_guard.h"
+#include "fault.h"
+#include "hist24.h"
+
+// ======= PINOS =======
+static const uint8_t PIN_DS18B20   = 4;
+static const uint8_t PIN_SSR       = 26; // BC548 -> SSR
+
+static const uint8_t PIN_BTN_ONOFF = 32;
+static const uint8_t PIN_BTN_UP    = 33;
+static const uint8_t PIN_BTN_DOWN  = 25;
+
+// LCD I2C
+static const uint8_t LCD_ADDR = 0x27;
+static const uint8_t LCD_COLS = 16;
+static const uint8_t LCD_ROWS = 2;
+
+// ======= Ajustes UI / Processo =======
+static const float SP_MIN  = 20.0f;
+static const float SP_MAX  = 40.0f;
+static const float SP_STEP = 0.5f;
+static const float SP_STEP_FAST = 1.0f;   // repeat depois do long press
+static const float SP_DEFAULT = 30.0f;    // sem setpoint no journal
+
+// Controle / UI (períodos das tasks: app.h)
+static const uint32_t CONTROL_LATE_US   = 20000; // passo que rodou depois disso conta como atrasado
+static const uint32_t UI_PAGE_TIMEOUT_MS = 30000; // páginas extras voltam p/ a principal
+
+// ALERTAS LCD
+static bool g_alertReset = false;     // queda energia / reset
+static bool g_alertSensor = false;    // sensor falhando
+static uint32_t g_sensorFailSinceMs = 0;
+
+static const uint32_t SERIAL_LOG_MS     = 1000;
+
+// ======= Globais do controle =======
+static CAAP_Data meuControle;
+
+// Estado do sistema: dono é a task de controle. A rede lê pelo snapshot
+// (ctrl_state_read) e muda por comando (ctrl_cmd_post).
+static bool  g_systemOn = false;
+static float g_setpoint = SP_DEFAULT;
+
+// reseta/energia
+static bool g_pendingResetEvt = false;
+static char g_resetMsg[64] = {0};
+
+// ===== Forward declarations =====
+static bool time_is_valid();
+static uint32_t now_epoch_or_zero();
+
+static float clampf(float x, float lo, float hi) {
+  if (x < lo) return lo;
+  if (x > hi) return hi;
+  return x;
+}
+
+// ======= MQTT CMD HANDLER (roda na task de rede via mqtt.loop()) =======
+static bool cmd_fleet_ok(const char* cmd) {
+  static const char* const ok[] = {
+    "set_on", "set_sp", "inc_sp", "dec_sp", "req_state", "diag", "log_set", "log_level",
+    "sched_set", "bench", "faults"
+  };
+  for (const char* k : ok) if (strcmp(cmd, k) == 0) return true;
+  return false;
+}
+
+// Comando p/ a task de controle sem esperar (o callback do MQTT não trava
+// o PubSubClient): ack = na fila; o "eff" sai depois em app_net_step
+static bool ctrl_post_traced(CtrlCmd cc) {
+  cc.tag = cmd_trace_tag();
+  return ctrl_cmd_post(cc);
+}
+
+static void on_mqtt_cmd(const MqttCommand& c) {
+  cmd_trace_dispatch(c);
+
+  // NÃO zere potência/sistema por falta de internet.
+  // Só altera quando recebe comando válido.
+//===============================================================================
+  // buffer próprio: Serial.printf acima de 64 B aloca no heap
+  char line[LOG_MSG_MAX];
+  snprintf(line, sizeof(line), "[CMD] cmd=%s id=%s src=%s hasStr=%d hasNum=%d hasBool=%d",
+           c.cmd, c.msgId, c.src, c.hasStr, c.hasNum, c.hasBool);
+  Serial.println(line);
+
+  if (c.hasStr) {
+    snprintf(line, sizeof(line), "[CMD] url=%s", c.sVal);
+    Serial.println(line);
+  }
+  if (c.hasReboot) {
+    Serial.printf("[CMD] reboot=%d\n", (int)c.reboot);
+  }
+  //===============================================================================
+
+  // Via grupo/broadcast só o que faz sentido p/ a frota inteira (OTA, hist,
+  // journal e troca de grupos só pelo cmd do próprio controlador)
+  if ((c.scope == CMD_GROUP || c.scope == CMD_ALL) && !cmd_fleet_ok(c.cmd)) {
+    mqtt_publish_ack(c.msgId, false, "cmd nao permitido em grupo");
+    return;
+  }
+
+  // Estado do processo: a task de controle aplica no próximo tick (<= 10 ms)
+  if (strcmp(c.cmd, "set_on") == 0 && c.hasBool) {
+    CtrlCmd cc = { CC_SET_ON, c.bVal, 0.0f, 0 };
+    const bool ok = ctrl_post_traced(cc);
+    mqtt_publish_ack(c.msgId, ok, ok ? nullptr : "fila cheia");
+    return;
+  }
+
+  if (strcmp(c.cmd, "set_sp") == 0 && c.hasNum) {
+    CtrlCmd cc = { CC_SET_SP, false, c.fVal, 0 };
+    const bool ok = ctrl_post_traced(cc);
+    mqtt_publish_ack(c.msgId, ok, ok ? nullptr : "fila cheia");
+    return;
+  }
+
+  if (strcmp(c.cmd, "inc_sp") == 0 || strcmp(c.cmd, "dec_sp") == 0) {
+    float step = c.hasNum ? c.fVal : SP_STEP;
+    if (c.cmd[0] == 'd') step = -step;
+
+    CtrlCmd cc = { CC_ADD_SP, false, step, 0 };
+    const bool ok = ctrl_post_traced(cc);
+    mqtt_publish_ack(c.msgId, ok, ok ? nullptr : "fila cheia");
+    return;
+  }
+
+  if (strcmp(c.cmd, "req_state") == 0) {
+    // Só ACK; a task de rede publica periodicamente de qualquer forma
+    mqtt_publish_ack(c.msgId, true);
+    return;
+  }
+
+  if (strcmp(c.cmd, "req_hist") == 0) {
+    // ACK primeiro (opcional) e responde com histórico
+    if (strcmp(c.fmt, "bin") != 0) {
+      mqtt_publish_ack(c.msgId, true);
+      hist24_publish_all();
+      return;
+    }
+
+    // bin: últimas 24h em horas, via consulta (sem janela)
+    const uint32_t nowEpoch = now_epoch_or_zero();
+    HistQueryArgs a;
+    memset(&a, 0, sizeof(a));
+    a.from = (nowEpoch > 86400UL) ? nowEpoch - 86400UL : 0;
+    a.step = 3600;
+    a.bin  = true;
+
+    char err[48];
+    const bool ok = hist_query_start(a, err, sizeof(err));
+    mqtt_publish_ack(c.msgId, ok, ok ? nullptr : err);
+    return;
+  }
+
+  // ======= Consulta de histórico por intervalo (ver hist_query.h) =======
+  if (strcmp(c.cmd, "hist_query") == 0) {
+    HistQueryArgs a;
+    memset(&a, 0, sizeof(a));
+    a.qid    = c.qid;
+    a.from   = c.from;
+    a.to     = c.to;
+    a.step   = c.step;
+    a.bin    = (strcmp(c.fmt, "bin") == 0);
+    a.win    = c.win;
+    a.hasSeq = c.hasSeq;
+    a.seq    = c.seq;
+    strlcpy(a.agg, c.agg, sizeof(a.agg));
+
+    char err[48];
+    const bool ok = hist_query_start(a, err, sizeof(err));
+    mqtt_publish_ack(c.msgId, ok, ok ? nullptr : err);
+    return;
+  }
+
+  if (strcmp(c.cmd, "hist_ack") == 0 && c.hasSeq) {
+    // sem ACK de volta: é o controle de fluxo, chega a cada chunk
+    hist_query_ack(c.qid, c.seq);
+    return;
+  }
+
+  if (strcmp(c.cmd, "hist_cancel") == 0) {
+    mqtt_publish_ack(c.msgId, hist_query_cancel(c.qid), nullptr);
+    return;
+  }
+
+  // ======= OTA URL (ALTERAÇÃO MÍNIMA AQUI) =======
+  if (strcmp(c.cmd, "ota_url") == 0 && c.hasStr) {
+    log_mirror_printf(LOG_I, "[OTA] comando ota_url recebido, iniciando...");
+
+    bool reboot = true;
+    if (c.hasReboot) reboot = c.reboot;
+
+    // Inicia OTA em background.
+    // Só responde ACK OK se realmente conseguiu disparar a task do OTA.
+    if (ota_start_url(c.sVal, reboot, c.hasSha ? c.sha256 : nullptr)) {
+      mqtt_publish_ack(c.msgId, true);
+    } else {
+      mqtt_publish_ack(c.msgId, false, "falha ao iniciar OTA");
+    }
+    return;
+  }
+  // ==============================================
+
+  if (strcmp(c.cmd, "jrnl_stats") == 0) {
+    JrnlStats js;
+    jrnl_get_stats(js);
+
+    char out[320];
+    JsonOut j(out);
+    j.obj().s("type", "jrnl");
+    j.u("puts", js.puts).u("coal", js.coalesced).u("drop", js.dropped);
+    j.u("recs", js.records).u("reloc", js.relocated);
+    j.u("userB", js.userBytes).u("flashB", js.flashBytes);
+    j.f("wa", js.userBytes ? (float)js.flashBytes / js.userBytes : 0.0f);
+    j.u("erases", js.erases).u("wearMin", js.wearMin).u("wearMax", js.wearMax);
+    j.u("crcErr", js.crcErrors).u("live", js.live);
+    j.end();
+
+    mqtt_publish_ack(c.msgId, true);
+    mqtt_publish_evt(out, j.len());
+    return;
+  }
+
+  // diag: value = período em s (0/false = desliga); sem value = uma vez só
+  if (strcmp(c.cmd, "diag") == 0) {
+    if (c.hasNum)                 diag_set_period(c.fVal > 0 ? (uint32_t)(c.fVal * 1000.0f) : 0);
+    else if (c.hasBool && !c.bVal) diag_set_period(0);
+    diag_request();
+    mqtt_publish_ack(c.msgId, true);
+    return;
+  }
+
+  if (strcmp(c.cmd, "log_set") == 0 && c.hasBool) {
+  log_mirror_set_enabled(c.bVal);
+  mqtt_publish_ack(c.msgId, true);
+  return;
+}
+
+if (strcmp(c.cmd, "log_level") == 0 && c.hasStr) {
+  LogLvl lvl = log_parse_level_char(c.sVal); // aceita "D/I/W/E"
+  log_mirror_set_level(lvl);
+  mqtt_publish_ack(c.msgId, true);
+  return;
+}
+
+  // histogramas de latência dos comandos (evt "lat"); value true = zera depois
+  if (strcmp(c.cmd, "lat_hist") == 0) {
+    char out[640];
+    const size_t n = cmd_trace_hist_json(out, sizeof(out));
+    if (n) mqtt_publish_evt(out, n);
+    if (c.hasBool && c.bVal) cmd_trace_reset();
+    mqtt_publish_ack(c.msgId, n != 0);
+    return;
+  }
+
+  // microbenchmark (bench.h): value = repetições; resultado no evt "bench"
+  if (strcmp(c.cmd, "bench") == 0) {
+    const uint16_t n = c.hasNum ? (uint16_t)clampf(c.fVal, 0.0f, BENCH_ITERS_MAX) : 0;
+    const bool ok = bench_start(c.msgId, n);
+    mqtt_publish_ack(c.msgId, ok, ok ? nullptr : "bench em andamento");
+    return;
+  }
+
+  // faltas: estado e contadores (evt "faults")
+  if (strcmp(c.cmd, "faults") == 0) {
+    char out[256];
+    const size_t n = fault_json(out, sizeof(out), millis());
+    if (n) mqtt_publish_evt(out, n);
+    mqtt_publish_ack(c.msgId, n != 0);
+    return;
+  }
+
+  // programa de setpoint: value = texto compacto (sched_prog.h); sem value = desliga
+  if (strcmp(c.cmd, "sched_set") == 0) {
+    SchedProg p;
+    char err[32];
+    if (!sched_parse(c.hasStr ? c.sVal : "", SP_MIN, SP_MAX, p, err, sizeof(err))) {
+      mqtt_publish_ack(c.msgId, false, err);
+      return;
+    }
+    sched_post(p);
+    char txt[256];
+    sched_format(p, txt, sizeof(txt));
+    mqtt_publish_ack(c.msgId, true, txt);
+    return;
+  }
+
+  if (strcmp(c.cmd, "sched_get") == 0) {
+    CtrlSnapshot s;
+    ctrl_state_read(s);
+    char txt[256];
+    sched_format(sched_prog(), txt, sizeof(txt));
+
+    char out[384];
+    JsonOut j(out);
+    j.obj().s("type", "sched").s("prog", txt);
+    j.i("seg", s.schedSeg).b("ovr", s.schedOvr).u("start", s.schedStart);
+    j.end();
+    mqtt_publish_evt(out, j.len());
+    mqtt_publish_ack(c.msgId, true);
+    return;
+  }
+
+  // grupos: value = "a,b" (sem value = nenhum); persiste no journal
+  if (strcmp(c.cmd, "grp_set") == 0) {
+    char g[JRNL_VAL_MAX] = {0};
+    if (c.hasStr && strlen(c.sVal) >= sizeof(g)) {
+      mqtt_publish_ack(c.msgId, false, "grupos: lista longa");
+      return;
+    }
+    if (c.hasStr) strlcpy(g, c.sVal, sizeof(g));
+    if (!mqtt_set_groups(g)) {
+      mqtt_publish_ack(c.msgId, false, "grupos invalidos");
+      return;
+    }
+    jrnl_put(JK_GROUPS, g, sizeof(g));
+    mqtt_publish_ack(c.msgId, true, mqtt_groups());
+    return;
+  }
+
+  mqtt_publish_ack(c.msgId, false, "cmd invalido");
+}
+
+// ================= PASSO DA TASK CONTROLE (Core 1) =================
+// Estado que era local do loop da task: zerado no app_begin
+static uint32_t g_ctrlMissed   = 0;   // disparos sem passo (task atrasada)
+static uint32_t g_ctrlLate     = 0;   // passos com atraso > CONTROL_LATE_US
+
+static uint32_t lastLcd    = 0;
+static uint32_t lastSerial = 0;
+static float    savedSp    = 0.0f;
+
+static uint8_t  uiPage   = PAGE_MAIN;
+static uint32_t lastUiMs = 0;
+static bool     spFast   = false;
+
+// tempo de CPU por volta do loop (jitter do caminho de controle)
+static uint32_t loopUsMax = 0;
+
+static int64_t  lastStepUs = 0;
+
+void app_ctrl_step(uint32_t ctrlTicks, int64_t fireUs) {
+  const uint32_t now = millis();
+  const uint32_t loopT0 = micros();
+
+  // 1) Botões (controle local sempre funciona)
+  buttons_update(now);
+
+  BtnInput bi;
+  while (buttons_next(bi)) {
+    // UP+DOWN juntos: próxima página do LCD
+    if (bi.ev == EV_CHORD) {
+      uiPage = (uint8_t)((uiPage + 1) % PAGE_COUNT);
+      lastUiMs = now;
+      continue;
+    }
+
+    if (bi.btn == BTN_ONOFF) {
+      if (bi.ev == EV_PRESS) {
+        g_systemOn = !g_systemOn;
+        if (!g_systemOn) meuControle.u_calculado = 0.0f;
+      }
+      continue;
+    }
+
+    // UP/DOWN: segurou além de BTN_LONG_MS -> repeat com passo grande
+    if (bi.ev == EV_LONG)    { spFast = true;  continue; }
+    if (bi.ev == EV_RELEASE) { spFast = false; continue; }
+    if (bi.ev != EV_PRESS && bi.ev != EV_REPEAT) continue;
+
+    const float step = (spFast && bi.ev == EV_REPEAT) ? SP_STEP_FAST : SP_STEP;
+    g_setpoint = clampf(g_setpoint + (bi.btn == BTN_UP ? step : -step), SP_MIN, SP_MAX);
+    sched_override();     // vale até o próximo passo do programa
+    uiPage = PAGE_MAIN;   // mostra o setpoint mudando
+  }
+
+  // Comandos vindos da rede (MQTT)
+  CtrlCmd cc;
+  while (ctrl_cmd_take(cc)) {
+    switch (cc.type) {
+      case CC_SET_ON:
+        g_systemOn = cc.b;
+        if (!g_systemOn) meuControle.u_calculado = 0.0f; // desliga na hora se mandou OFF
+        break;
+      case CC_SET_SP:
+        g_setpoint = clampf(cc.f, SP_MIN, SP_MAX);
+        sched_override();
+        break;
+      case CC_ADD_SP:
+        g_setpoint = clampf(g_setpoint + cc.f, SP_MIN, SP_MAX);
+        if (cc.f != 0.0f) sched_override();   // inc_sp 0: só sonda a latência
+        break;
+    }
+    ctrl_cmd_applied(cc.tag);
+  }
+
+  // Se ligou, reconhece o alerta de reset
+  if (g_systemOn) g_alertReset = false;
+
+  if (uiPage != PAGE_MAIN && (now - lastUiMs) >= UI_PAGE_TIMEOUT_MS) uiPage = PAGE_MAIN;
+
+  // 2) Sensor
+  sensor_update(now);
+  const bool  tempValid = sensor_has_value();
+  const float tempC     = sensor_get_c();
+
+  // Falha de sensor: só considera erro se ficar inválido por > 3s
+  if (!tempValid) {
+    if (g_sensorFailSinceMs == 0) g_sensorFailSinceMs = now;
+    if ((now - g_sensorFailSinceMs) > 3000) g_alertSensor = true;
+  } else {
+    g_sensorFailSinceMs = 0;
+    g_alertSensor = false;
+  }
+  fault_set(FLT_SENSOR, !tempValid);   // evt só nas bordas (fault.h)
+
+  // Histórico 24h (1 ponto/hora)
+  hist24_maybe_store(now, tempValid, tempC);
+
+  // 3) Controlador 1 Hz (disparado pelo timer)
+  if (ctrlTicks) {
+    const int64_t stepUs = esp_timer_get_time();
+    const uint32_t late  = (uint32_t)(stepUs - fireUs);
+    const uint32_t missed = ctrlTicks - 1;
+    g_ctrlMissed += missed;
+    if (late > CONTROL_LATE_US) g_ctrlLate++;
+    diag_ctrl_step(late, missed);
+
+    // dt real desde o passo anterior (1º passo: nominal)
+    const float dt = lastStepUs ? (float)(stepUs - lastStepUs) * 1e-6f : CONTROL_UPDATE_MS / 1000.0f;
+    lastStepUs = stepUs;
+
+    // Programa de setpoint (agenda/rampa local, hora do NTP)
+    float schedSp;
+    if (sched_step(now_epoch_or_zero(), schedSp)) g_setpoint = clampf(schedSp, SP_MIN, SP_MAX);
+
+    const bool  localOn = g_systemOn;
+    const float localSp = g_setpoint;
+
+    if (localOn && tempValid) {
+      controlador_update(meuControle, tempC, localSp, dt);
+    } else {
+      // OFF local OU sensor inválido => potência zero
+      meuControle.u_calculado = 0.0f;
+    }
+
+    // Série temporal (1 amostra/s -> minuto -> hora -> dia)
+    tsdb_add(now, tempValid, tempC, localSp, meuControle.u_calculado, localOn);
+
+    // Resumos de 1/15 min (tópico stats)
+    TstatsSample ts;
+    ts.epoch     = now_epoch_or_zero();
+    ts.ms        = now;
+    ts.dt        = dt;
+    ts.tempValid = tempValid;
+    ts.systemOn  = localOn;
+    ts.tempC     = tempC;
+    ts.setpoint  = localSp;
+    ts.u_pct     = meuControle.u_calculado;
+    ts.predErr   = meuControle.erro_pred;
+    tstats_add(ts);
+
+    // Setpoint persistido (só RAM aqui; o journal grava em lote)
+    if (localSp != savedSp && jrnl_put(JK_SETPOINT, &localSp, sizeof(localSp))) savedSp = localSp;
+  }
+
+  // 4) SSR — chamada frequente evita “desligar” se a rede travar
+  controlador_apply_output(meuControle, PIN_SSR, 1000);
+
+  const bool heating = (meuControle.u_calculado > 0.5f);
+
+  // Atualiza snapshot para a task de rede publicar
+  {
+    CtrlSnapshot snap;
+    snap.sampleMs    = now;
+    snap.systemOn    = g_systemOn;
+    snap.tempValid   = tempValid;
+    snap.heating     = heating;
+    snap.alertReset  = g_alertReset;
+    snap.alertSensor = g_alertSensor;
+    snap.tempC       = tempC;
+    snap.setpoint    = g_setpoint;
+    snap.u_pct       = (g_systemOn && tempValid) ? meuControle.u_calculado : 0.0f;
+    snap.a1          = meuControle.a1;
+    snap.b0          = meuControle.b0;
+    snap.lambda      = meuControle.lambda;
+    snap.polo        = meuControle.polo_desejado;
+    snap.schedSeg    = sched_seg();
+    snap.schedOvr    = sched_overridden();
+    snap.schedStart  = sched_start();
+    ctrl_state_publish(snap);
+  }
+
+  // 5) LCD
+  if (now - lastLcd >= LCD_UPDATE_MS) {
+    lastLcd = now;
+
+    const bool  localOn = g_systemOn;
+    const float localSp = g_setpoint;
+
+    // Só publica o modelo da tela: o I2C roda na task do display
+    DisplayModel m;
+    m.page      = uiPage;
+    m.systemOn  = localOn;
+    m.tempValid = tempValid;
+    m.heaterOn  = heating;
+    m.tempC     = tempC;
+    m.setpoint  = localSp;
+    m.u_pct     = (localOn && tempValid) ? meuControle.u_calculado : 0.0f;
+    m.a1        = meuControle.a1;
+    m.b0        = meuControle.b0;
+
+    // PRIORIDADE: RESET > SENSOR > NORMAL
+    m.alert0 = nullptr;
+    m.alert1 = nullptr;
+    m.alertBlink = false;
+    if (g_alertReset) {
+      m.alert0 = "!! RESET/ENERGIA";
+      m.alert1 = "LIGUE NOVAMENTE!";
+      m.alertBlink = true;
+    } else if (g_alertSensor) {
+      m.alert0 = "ERRO SENSOR";
+      m.alert1 = "DS18B20 FALHA";
+    }
+
+    display_post(m);
+  }
+
+  // 6) Log serial (opcional)
+  if (now - lastSerial >= SERIAL_LOG_MS) {
+    lastSerial = now;
+
+    const bool  localOn = g_systemOn;
+    const float localSp = g_setpoint;
+
+    float u_pct = meuControle.u_calculado;
+    if (!localOn || !tempValid) u_pct = 0.0f;
+
+    DisplayStats ds;
+    display_get_stats(ds);
+
+    log_mirror_printf(LOG_I,
+    "ID=%s T=%.2fC SP=%.2f ON=%d u=%.2f%% a1=%.6f b0=%.6f lcd=%luB/s %luus loop=%luus tick=%lu/%lu",
+    CTRL_ID, tempC, localSp, localOn ? 1 : 0, u_pct, meuControle.a1, meuControle.b0,
+    (unsigned long)ds.i2cBytesPerSec, (unsigned long)ds.renderUsMax, (unsigned long)loopUsMax,
+    (unsigned long)g_ctrlLate, (unsigned long)g_ctrlMissed);
+    loopUsMax = 0;
+
+  }
+
+  const uint32_t loopUs = micros() - loopT0;
+  if (loopUs > loopUsMax) loopUsMax = loopUs;
+  diag_ctrl_tick(loopUs);
+}
+
+// ================= PASSO DA TASK REDE (Core 0) =================
+// State a partir do snapshot (cópia consistente do último tick do controle,
+// sem travar o core 1)
+static void state_fill(MqttState& s, uint32_t now) {
+  CtrlSnapshot snap;
+  ctrl_state_read(snap);
+
+  s.id        = CTRL_ID;
+  s.systemOn  = snap.systemOn;
+  s.heating   = snap.heating;
+  s.tempValid = snap.tempValid;
+  s.tempC     = snap.tempC;
+  s.setpoint  = snap.setpoint;
+  s.u_pct     = snap.u_pct;
+  s.a1        = snap.a1;
+  s.b0        = snap.b0;
+  s.rssi      = wifi_rssi(); // ok enviar; app pode ignorar
+  s.ms        = now;
+}
+
+static uint32_t lastPub = 0;
+static uint32_t lastNetUi = 0;
+
+// Detecta “borda de conexão” sem depender de mqtt_just_connected()
+static bool lastConn = false;
+static bool lastWifi = false;
+
+void app_net_step() {
+  const uint32_t now = millis();
+  const uint32_t loopT0 = micros();
+
+  wifi_update();
+  mqtt_update();
+
+  mqtt_update();
+  lan_update(now);   // comandos da LAN (mesmo handler do MQTT)
+
+  // Comandos que a task de controle já aplicou: evt "eff" (cmd_trace.h)
+  uint8_t  effTag;
+  uint32_t effUs;
+  while (ctrl_cmd_done(effTag, effUs)) {
+    char out[96];
+    const size_t n = cmd_trace_effect(effTag, effUs, out, sizeof(out));
+    if (n) mqtt_publish_evt(out, n);
+  }
+
+  log_mirror_poll(); // publica logs enfileirados via MQTT (somente aqui!)
+  ota_poll();        // idem para eventos do OTA
+  hist_query_poll(); // 1 chunk da consulta de histórico (se houver crédito)
+  diag_poll();       // diagnóstico (se ligado/pedido)
+  tstats_poll();     // resumos de janela prontos
+  bench_poll();      // resultado do bench
+  heap_guard_poll(now);  // tendência do heap / aviso de alocação
+  fault_poll(now);   // raise/clear/lembrete das faltas
+
+  // WiFi voltou: retoma OTA interrompido (queda de energia/rede)
+  const bool nowWifi = wifi_is_connected();
+  if (nowWifi && !lastWifi) ota_resume_pending();
+  lastWifi = nowWifi;
+
+  const bool nowConn = mqtt_is_connected();
+  if (nowConn && !lastConn) {
+    // Conectou agora: tenta NTP e publica RESET pendente
+    configTime(0, 0, "pool.ntp.org", "time.nist.gov");
+
+    if (g_pendingResetEvt) {
+      mqtt_publish_reset(g_resetMsg);
+      g_pendingResetEvt = false;
+    }
+  }
+  lastConn = nowConn;
+
+  // Página NET do LCD
+  if (now - lastNetUi >= 1000) {
+    lastNetUi = now;
+    display_set_net(nowWifi, nowConn, nowWifi ? wifi_rssi() : 0);
+  }
+
+  // Publica state periodicamente se MQTT estiver conectado
+  // Durante o OTA (MQTT mantido) publica state mais devagar
+  const uint32_t pubMs = ota_is_running() ? MQTT_STATE_PUB_OTA_MS : MQTT_STATE_PUB_MS;
+  if (nowConn && (now - lastPub >= pubMs)) {
+    lastPub = now;
+
+    MqttState s;
+    state_fill(s, now);
+    mqtt_publish_state(s);
+  }
+
+  // Stream do state p/ clientes da LAN (período de cada um)
+  if (lan_state_due(now)) {
+    MqttState s;
+    state_fill(s, now);
+    lan_publish_state(s, now);
+  }
+
+  diag_net_loop(micros() - loopT0);
+}
+
+void app_begin(const char* resetMsg) {
+  snprintf(g_resetMsg, sizeof(g_resetMsg), "%s", resetMsg);
+  g_pendingResetEvt = true;
+  // Mostra urgente no LCD até o usuário ligar novamente
+  g_alertReset = true;
+  g_alertSensor = false;
+  g_sensorFailSinceMs = 0;
+
+  // Garante que o sistema sempre inicia desligado após reboot
+  g_systemOn = false;
+  ctrl_state_begin();
+  diag_begin();
+  tstats_begin();
+
+  // Carrega estado persistido
+  jrnl_begin();
+  hist24_begin();
+  tsdb_begin();
+
+  uint32_t boots = 0;
+  jrnl_get(JK_BOOTS, &boots, sizeof(boots));
+  boots++;
+  jrnl_put(JK_BOOTS, &boots, sizeof(boots));
+
+  float sp;
+  g_setpoint = jrnl_get(JK_SETPOINT, &sp, sizeof(sp)) ? clampf(sp, SP_MIN, SP_MAX) : SP_DEFAULT;
+  sched_begin();
+  Serial.printf("[BOOT] #%lu setpoint=%.1f\n", (unsigned long)boots, (float)g_setpoint);
+
+  // SSR
+  pinMode(PIN_SSR, OUTPUT);
+  digitalWrite(PIN_SSR, LOW);
+
+  // Módulos do processo (sempre locais)
+  buttons_begin(PIN_BTN_ONOFF, PIN_BTN_UP, PIN_BTN_DOWN);
+
+  display_begin(LCD_ADDR, LCD_COLS, LCD_ROWS);
+  display_show_boot("PERFERRO CONTROL", CTRL_ID);
+
+  sensor_begin(PIN_DS18B20, 10);
+  delay(3000);
+  sensor_update(millis());
+
+  controlador_begin(meuControle, sensor_get_c());
+  meuControle.Ts = CONTROL_UPDATE_MS / 1000.0f;
+
+  // Rede
+  wifi_begin();
+  char grp[JRNL_VAL_MAX];
+  if (jrnl_get(JK_GROUPS, grp, sizeof(grp))) {
+    grp[sizeof(grp) - 1] = '\0';
+    if (!mqtt_set_groups(grp)) Serial.println("[BOOT] grupos invalidos no journal");
+  }
+  mqtt_begin();
+  mqtt_set_cmd_handler(on_mqtt_cmd);
+  lan_begin();
+
+  // locais das voltas das tasks
+  lastLcd = lastSerial = millis();
+  savedSp = g_setpoint;
+  uiPage = PAGE_MAIN;
+  lastUiMs = 0;
+  spFast = false;
+  loopUsMax = 0;
+  lastStepUs = 0;
+  g_ctrlMissed = g_ctrlLate = 0;
+  lastPub = lastNetUi = 0;
+  lastConn = lastWifi = false;
+}
+
+static bool time_is_valid() {
+  time_t now = time(nullptr);
+  // "válido" se já passou de 2020-01-01 (aprox)
+  return (now > 1577836800);
+}
+
+static uint32_t now_epoch_or_zero() {
+  if (!time_is_valid()) return 0;
+  return (uint32_t)time(nullptr);
+}
@@ -0,0 +1,179 @@
+#include "bench.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_arduino_version.h>
+#include <stdarg.h>
+
+#include "config.h"
+#include "controlador_caap.h"
+#include "display_lcd.h"
+#include "heap_guard.h"
+#include "json_out.h"
+#include "log_mirror.h"
+#include "mqtt_link.h"
+#include "msg_json.h"
+#include "sensor_ds18b20.h"
+
+enum BenchKernel : uint8_t { BK_CTRL = 0, BK_STATE, BK_PARSE, BK_LOG, BK_LCD, BK_DS, BK_COUNT };
+static const char* const BK_NAME[BK_COUNT] = { "ctrl", "state", "parse", "log", "lcd", "ds18b20" };
+
+struct BenchRes { bool ok; uint32_t min, med, max; };
+
+static volatile bool g_running = false;
+static volatile bool g_done    = false;
+static uint16_t g_iters = 0;
+static char     g_id[32];
+
+static BenchRes g_res[BK_COUNT];
+static uint32_t g_smp[BENCH_ITERS_MAX];
+static char     g_out[768];
+static size_t   g_len = 0;
+
+TASK_SLOT(g_task, 6144);
+
+// estáticos: fora da stack da task (MqttCommand ~ 500 B)
+static CAAP_Data   g_caap;
+static MqttCommand g_cmd;
+static char        g_buf[LOG_MSG_MAX];
+
+static void summarize(BenchRes& r, uint32_t* s, uint16_t n) {
+  for (uint16_t i = 1; i < n; i++) {
+    const uint32_t v = s[i];
+    uint16_t j = i;
+    for (; j > 0 && s[j - 1] > v; j--) s[j] = s[j - 1];
+    s[j] = v;
+  }
+  r.ok  = n > 0;
+  r.min = n ? s[0] : 0;
+  r.med = n ? s[n / 2] : 0;
+  r.max = n ? s[n - 1] : 0;
+}
+
+// ----- trechos (um por iteração; i varia a entrada) -----
+static void k_ctrl(uint16_t i) {
+  // dt com jitter de ms, como no tick real (passa pela discretização)
+  controlador_update(g_caap, 29.0f + (i & 7) * 0.05f, 30.0f, (i & 1) ? 1.002f : 0.998f);
+}
+
+static void k_state(uint16_t i) {
+  MqttState s = { CTRL_ID, true, (i & 1) != 0, true, 29.87f, 30.0f, 42.5f,
+                  0.987654f, 0.0012345f, -61, 123456789UL + i };
+  msg_state_json(s, g_out, sizeof(g_out));
+}
+
+static void k_parse(uint16_t i) {
+  (void)i;
+  mqtt_parse_cmd("{\"cmd\":\"set_sp\",\"value\":31.5,\"id\":\"bench-000001\",\"src\":\"app\"}", g_cmd);
+}
+
+static void log_fmt(const char* fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  vsnprintf(g_buf, sizeof(g_buf), fmt, ap);
+  va_end(ap);
+}
+
+static void k_log(uint16_t i) {
+  // mesma linha do log periódico da task de controle
+  log_fmt("ID=%s T=%.2fC SP=%.2f ON=%d u=%.2f%% a1=%.6f b0=%.6f lcd=%luB/s %luus loop=%luus tick=%lu/%lu",
+          CTRL_ID, 29.87f, 30.0f, 1, 42.5f, 0.987654f, 0.0012345f,
+          (unsigned long)180, (unsigned long)950, (unsigned long)(400 + i), 0UL, 0UL);
+}
+
+static void run_cpu(BenchKernel k, void (*fn)(uint16_t)) {
+  for (uint16_t i = 0; i < g_iters; i++) {
+    const uint32_t c0 = ESP.getCycleCount();
+    fn(i);
+    g_smp[i] = ESP.getCycleCount() - c0;
+  }
+  summarize(g_res[k], g_smp, g_iters);
+  vTaskDelay(1);
+}
+
+// lcd/ds18b20: amostras feitas pela task dona do barramento; aqui só espera
+static void run_lcd() {
+  DisplayStats ds;
+  uint16_t n = 0;
+  for (uint8_t i = 0; i < BENCH_HW_SAMPLES; i++) {
+    display_get_stats(ds);
+    const uint32_t prev = ds.fulls;
+    display_force_full();
+    for (uint8_t t = 0; t < 100 && ds.fulls == prev; t++) {
+      vTaskDelay(pdMS_TO_TICKS(10));
+      display_get_stats(ds);
+    }
+    if (ds.fulls == prev) break;   // sem LCD / task parada
+    g_smp[n++] = ds.fullCycLast;
+  }
+  summarize(g_res[BK_LCD], g_smp, n);
+}
+
+static void run_ds() {
+  uint32_t seq, cyc, prev;
+  uint16_t n = 0;
+  sensor_read_timing(prev, cyc);
+  for (uint16_t t = 0; t < 300 && n < BENCH_HW_SAMPLES; t++) {   // ~ 1 leitura a cada 200 ms
+    vTaskDelay(pdMS_TO_TICKS(10));
+    sensor_read_timing(seq, cyc);
+    if (seq == prev) continue;
+    prev = seq;
+    g_smp[n++] = cyc;
+  }
+  summarize(g_res[BK_DS], g_smp, n);
+}
+
+static void bench_task(void* pv) {
+  (void)pv;
+  memset(g_res, 0, sizeof(g_res));
+  controlador_begin(g_caap, 29.0f);
+
+  run_cpu(BK_CTRL,  k_ctrl);
+  run_cpu(BK_STATE, k_state);
+  run_cpu(BK_PARSE, k_parse);
+  run_cpu(BK_LOG,   k_log);
+  run_lcd();
+  run_ds();
+
+  JsonOut j(g_out);
+  j.obj().s("type", "bench").s("id", g_id);
+  j.s("chip", ESP.getChipModel()).u("rev", ESP.getChipRevision()).u("mhz", ESP.getCpuFreqMHz());
+  j.s("idf", ESP.getSdkVersion());
+  char ver[16];
+  snprintf(ver, sizeof(ver), "%d.%d.%d", ESP_ARDUINO_VERSION_MAJOR, ESP_ARDUINO_VERSION_MINOR,
+           ESP_ARDUINO_VERSION_PATCH);
+  j.s("arduino", ver).s("gcc", __VERSION__).s("build", __DATE__ " " __TIME__);
+  j.u("n", g_iters);
+  j.obj("k");
+  for (uint8_t k = 0; k < BK_COUNT; k++) {
+    if (!g_res[k].ok) { j.null(BK_NAME[k]); continue; }
+    j.arr(BK_NAME[k]).u(nullptr, g_res[k].min).u(nullptr, g_res[k].med).u(nullptr, g_res[k].max).end();
+  }
+  j.end().end();
+  g_len = j.len();
+
+  g_done = true;
+  task_slot_exit();
+}
+
+bool bench_start(const char* msgId, uint16_t iters) {
+  if (g_running) return false;
+  if (iters == 0) iters = BENCH_ITERS;
+  if (iters > BENCH_ITERS_MAX) iters = BENCH_ITERS_MAX;
+  g_iters = iters;
+  strlcpy(g_id, msgId ? msgId : "", sizeof(g_id));
+  g_done = false;
+  g_running = true;
+  if (!task_slot_start(g_task, bench_task, "bench", nullptr, BENCH_TASK_PRIO, 0)) {
+    g_running = false;
+    return false;
+  }
+  return true;
+}
+
+void bench_poll() {
+  if (!g_done) return;
+  if (!mqtt_is_connected()) return;   // guarda até reconectar
+  if (g_len) mqtt_publish_evt(g_out, g_len);
+  g_done = false;
+  g_running = false;
+}
@@ -0,0 +1,188 @@
+#include "btn_fsm.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// ---------------- acorde ----------------
+static bool in_chord(const BtnPad& p, uint8_t btn) {
+  return p.chordA != BTN_NO_CHORD && (btn == p.chordA || btn == p.chordB);
+}
+
+// PRESS que esperou a janela inteira sem o outro botão
+static void flush_pending(BtnPad& p, uint32_t now) {
+  if (p.pendA && (int32_t)(now - p.tA) >= (int32_t)p.chordMs) {
+    p.pendA = false;
+    p.sink(p.ctx, p.chordA, EV_PRESS, p.tA);
+  }
+  if (p.pendB && (int32_t)(now - p.tB) >= (int32_t)p.chordMs) {
+    p.pendB = false;
+    p.sink(p.ctx, p.chordB, EV_PRESS, p.tB);
+  }
+}
+
+// Filtro entre as máquinas e o sink
+static void pad_emit(BtnPad& p, uint8_t btn, BtnEvent ev, uint32_t t) {
+  if (!in_chord(p, btn)) {
+    p.sink(p.ctx, btn, ev, t);
+    return;
+  }
+
+  const bool isA = (btn == p.chordA);
+
+  // qualquer outro evento do botão: o PRESS pendente dele sai antes
+  // (toque mais curto que a janela, ou loop atrasado)
+  if (ev != EV_PRESS) {
+    if (isA && p.pendA)  { p.pendA = false; p.sink(p.ctx, btn, EV_PRESS, p.tA); }
+    if (!isA && p.pendB) { p.pendB = false; p.sink(p.ctx, btn, EV_PRESS, p.tB); }
+  }
+
+  switch (ev) {
+    case EV_PRESS:
+      if (p.chordActive) return;
+      // loop atrasado: os dois PRESS podem sair na mesma volta
+      flush_pending(p, t);
+      if (isA) { p.pendA = true; p.tA = t; }
+      else     { p.pendB = true; p.tB = t; }
+      if (p.pendA && p.pendB && (uint32_t)abs((int32_t)(p.tA - p.tB)) < p.chordMs) {
+        p.pendA = p.pendB = false;
+        p.chordActive = true;
+        p.sink(p.ctx, p.chordA, EV_CHORD, t);
+      }
+      return;
+
+    case EV_REPEAT:
+    case EV_LONG:
+      if (p.chordActive) return;
+      break;
+
+    case EV_RELEASE:
+      if (p.chordActive) {
+        if (!p.b[p.chordA].pressed && !p.b[p.chordB].pressed) p.chordActive = false;
+        return;
+      }
+      break;
+
+    default:
+      break;
+  }
+  p.sink(p.ctx, btn, ev, t);
+}
+
+// ---------------- máquina de um botão ----------------
+// Próximo instante em que o botão tem algo a fazer (false = nada agendado)
+static bool fsm_due(const BtnFsm& f, uint32_t& due) {
+  bool has = false;
+  auto take = [&](uint32_t t) {
+    if (!has || (int32_t)(t - due) < 0) { due = t; has = true; }
+  };
+  if (f.raw != f.stable) take(f.tChange + f.cfg.debounceMs);
+  if (f.pressed) {
+    if (f.cfg.longMs && !f.longDone) take(f.tPress + f.cfg.longMs);
+    if (f.cfg.repeatDelayMs)         take(f.tNextRep);
+  }
+  return has;
+}
+
+// Executa o que vence em 'at' (at <= now)
+static void fsm_fire(BtnPad& p, uint8_t id, uint32_t at, uint32_t now) {
+  BtnFsm& f = p.b[id];
+
+  // debounce: nível parado por debounceMs
+  if (f.raw != f.stable && f.tChange + f.cfg.debounceMs == at) {
+    f.stable = f.raw;
+    if (f.stable == 0) {
+      f.pressed  = true;
+      f.longDone = false;
+      f.tPress   = at;
+      f.tNextRep = at + f.cfg.repeatDelayMs;
+      pad_emit(p, id, EV_PRESS, at);
+    } else {
+      f.pressed = false;
+      pad_emit(p, id, EV_RELEASE, at);
+    }
+    return;
+  }
+
+  if (!f.pressed) return;
+
+  if (f.cfg.longMs && !f.longDone && f.tPress + f.cfg.longMs == at) {
+    f.longDone = true;
+    pad_emit(p, id, EV_LONG, at);
+    return;
+  }
+
+  if (f.cfg.repeatDelayMs && f.tNextRep == at) {
+    pad_emit(p, id, EV_REPEAT, at);
+    f.tNextRep += f.cfg.repeatRateMs;
+    // loop atrasado: não despeja repeats acumulados
+    if ((int32_t)(now - f.tNextRep) >= 0) f.tNextRep = now + f.cfg.repeatRateMs;
+  }
+}
+
+// ---------------- API ----------------
+void btn_pad_init(BtnPad& p, BtnSink sink, void* ctx) {
+  memset(&p, 0, sizeof(p));
+  p.chordA = p.chordB = BTN_NO_CHORD;
+  p.sink = sink;
+  p.ctx  = ctx;
+}
+
+void btn_pad_add(BtnPad& p, const BtnCfg& cfg, uint8_t level, uint32_t now) {
+  if (p.n >= BTN_MAX) return;
+  BtnFsm& f = p.b[p.n++];
+  memset(&f, 0, sizeof(f));
+  f.cfg     = cfg;
+  f.raw     = level ? 1 : 0;
+  f.stable  = f.raw;
+  f.tChange = now;
+  // apertado no boot: conta como segurando, sem gerar PRESS
+  f.pressed  = (f.stable == 0);
+  f.longDone = true;
+  f.tPress   = now;
+  f.tNextRep = now + cfg.repeatDelayMs;
+  if (p.n == 1) p.tNow = now;
+}
+
+void btn_pad_set_chord(BtnPad& p, uint8_t a, uint8_t b, uint16_t chordMs) {
+  if (a >= p.n || b >= p.n || a == b) return;
+  p.chordA  = a;
+  p.chordB  = b;
+  p.chordMs = chordMs;
+}
+
+// borda/relógio atrasado em relação ao que já foi avaliado: vale o atual
+static uint32_t pad_clock(BtnPad& p, uint32_t t) {
+  if ((int32_t)(t - p.tNow) > 0) p.tNow = t;
+  return p.tNow;
+}
+
+void btn_pad_edge(BtnPad& p, uint8_t btn, uint8_t level, uint32_t t) {
+  if (btn >= p.n) return;
+  t = pad_clock(p, t);
+  btn_pad_advance(p, t);
+
+  BtnFsm& f = p.b[btn];
+  level = level ? 1 : 0;
+  if (level == f.raw) return;
+  f.raw = level;
+  f.tChange = t;
+}
+
+// Em ordem de tempo entre todos os botões: o acorde depende da ordem
+void btn_pad_advance(BtnPad& p, uint32_t now) {
+  now = pad_clock(p, now);
+  for (;;) {
+    uint32_t best = 0;
+    int8_t   who  = -1;
+    for (uint8_t i = 0; i < p.n; i++) {
+      uint32_t due;
+      if (!fsm_due(p.b[i], due) || (int32_t)(now - due) < 0) continue;
+      if (who < 0 || (int32_t)(due - best) < 0) { best = due; who = (int8_t)i; }
+    }
+    if (who < 0) break;
+    // janela do acorde vencida antes do próximo evento
+    flush_pending(p, best);
+    fsm_fire(p, (uint8_t)who, best, now);
+  }
+  flush_pending(p, now);
+}
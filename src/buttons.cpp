@@ -1,98 +1,108 @@
 #include "buttons.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <esp_timer.h>
 
-// Botões: INPUT_PULLUP (pressionado = LOW)
+#include "config.h"
 
-struct Button {
-  uint8_t pin;
-  unsigned long debounceMs;
-  unsigned long repeatDelayMs;
-  unsigned long repeatRateMs;
+struct BtnEdge {
+  uint8_t  btn;
+  uint8_t  level;
+  uint32_t t;
+};
 
-  int rawLast;
-  int stable;
-  unsigned long tChange;
+static uint8_t       g_pins[BTN_COUNT];
+static QueueHandle_t g_edgeQ = nullptr;
+static volatile uint32_t g_lost = 0;
+static uint32_t      g_lostSeen = 0;
 
-  bool pressed;
-  unsigned long pressedTime;
-  unsigned long lastRepeat;
+static BtnPad g_pad;
 
-  void begin(uint8_t p, unsigned long deb=30, unsigned long repDelay=500, unsigned long repRate=150) {
-    pin = p;
-    debounceMs = deb;
-    repeatDelayMs = repDelay;
-    repeatRateMs = repRate;
+// Eventos prontos (produz e consome na task de controle)
+static const uint8_t EVQ_SIZE = 16;
+static BtnInput g_evq[EVQ_SIZE];
+static uint8_t  g_evHead = 0, g_evCount = 0;
 
-    pinMode(pin, INPUT_PULLUP);
-    rawLast = digitalRead(pin);
-    stable = rawLast;
-    tChange = millis();
+static void IRAM_ATTR btn_isr(void* arg) {
+  BtnEdge e;
+  e.btn   = (uint8_t)(uintptr_t)arg;
+  e.level = (uint8_t)digitalRead(g_pins[e.btn]);
+  e.t     = (uint32_t)(esp_timer_get_time() / 1000);   // mesma base do millis()
 
-    pressed = (stable == LOW);
-    pressedTime = 0;
-    lastRepeat = 0;
-  }
+  BaseType_t woken = pdFALSE;
+  if (xQueueSendFromISR(g_edgeQ, &e, &woken) != pdTRUE) g_lost++;
+  if (woken) portYIELD_FROM_ISR();
+}
 
-  BtnEvent update(unsigned long now, bool allowRepeat) {
-    int raw = digitalRead(pin);
+static void on_event(void* ctx, uint8_t btn, BtnEvent ev, uint32_t t) {
+  (void)ctx;
+  // ninguém leu: descarta o mais velho
+  if (g_evCount == EVQ_SIZE) {
+    g_evHead = (uint8_t)((g_evHead + 1) % EVQ_SIZE);
+    g_evCount--;
+  }
+  BtnInput& e = g_evq[(g_evHead + g_evCount) % EVQ_SIZE];
+  e.btn = btn;
+  e.ev  = ev;
+  e.t   = t;
+  g_evCount++;
+}
 
-    if (raw != rawLast) {
-      rawLast = raw;
-      tChange = now;
-    }
+void buttons_begin(uint8_t pinOnOff, uint8_t pinUp, uint8_t pinDown) {
+  g_pins[BTN_ONOFF] = pinOnOff;
+  g_pins[BTN_UP]    = pinUp;
+  g_pins[BTN_DOWN]  = pinDown;
 
-    // debounce: estabilizou
-    if ((now - tChange) >= debounceMs && raw != stable) {
-      stable = raw;
-
-      if (stable == LOW) { // pressionou
-        pressed = true;
-        pressedTime = now;
-        lastRepeat = now;
-        return EV_PRESS;
-      } else {             // soltou
-        pressed = false;
-      }
-    }
+  g_edgeQ = xQueueCreate(BTN_EDGE_QUEUE, sizeof(BtnEdge));
 
-    // auto-repeat
-    if (allowRepeat && pressed && stable == LOW) {
-      if ((now - pressedTime) >= repeatDelayMs) {
-        if ((now - lastRepeat) >= repeatRateMs) {
-          lastRepeat = now;
-          return EV_REPEAT;
-        }
-      }
-    }
+  // ON/OFF sem repeat; UP/DOWN com repeat e long press
+  const BtnCfg cfgOnOff = { 30, 0,   0,   0 };
+  const BtnCfg cfgStep  = { 30, 500, 150, BTN_LONG_MS };
 
-    return EV_NONE;
+  const uint32_t now = millis();
+  btn_pad_init(g_pad, on_event, nullptr);
+  for (uint8_t i = 0; i < BTN_COUNT; i++) {
+    pinMode(g_pins[i], INPUT_PULLUP);
+    btn_pad_add(g_pad, i == BTN_ONOFF ? cfgOnOff : cfgStep, (uint8_t)digitalRead(g_pins[i]), now);
   }
-};
+  btn_pad_set_chord(g_pad, BTN_UP, BTN_DOWN, BTN_CHORD_MS);
 
-static Button bOnOff, bUp, bDown;
-static BtnEvent evOnOff = EV_NONE;
-static BtnEvent evUp    = EV_NONE;
-static BtnEvent evDown  = EV_NONE;
-
-void buttons_begin(uint8_t pinOnOff, uint8_t pinUp, uint8_t pinDown) {
-  bOnOff.begin(pinOnOff, 30, 500, 150);
-  bUp.begin(pinUp, 30, 500, 150);
-  bDown.begin(pinDown, 30, 500, 150);
+  if (!g_edgeQ) return;   // sem fila: buttons_update cai no nível do pino
+  for (uint8_t i = 0; i < BTN_COUNT; i++) {
+    attachInterruptArg(digitalPinToInterrupt(g_pins[i]), btn_isr, (void*)(uintptr_t)i, CHANGE);
+  }
 }
 
 void buttons_update(unsigned long nowMs) {
-  // limpa eventos do ciclo anterior
-  evOnOff = EV_NONE;
-  evUp = EV_NONE;
-  evDown = EV_NONE;
+  const uint32_t now = (uint32_t)nowMs;
+
+  BtnEdge e;
+  while (g_edgeQ && xQueueReceive(g_edgeQ, &e, 0) == pdTRUE) {
+    // borda capturada depois do millis() do chamador
+    const uint32_t t = ((int32_t)(e.t - now) > 0) ? now : e.t;
+    btn_pad_edge(g_pad, e.btn, e.level, t);
+  }
 
-  // ON/OFF sem repeat
-  evOnOff = bOnOff.update(nowMs, false);
+  // fila estourou (ou não existe): o nível atual do pino vira uma borda agora
+  const uint32_t lost = g_lost;
+  if (!g_edgeQ || lost != g_lostSeen) {
+    g_lostSeen = lost;
+    for (uint8_t i = 0; i < BTN_COUNT; i++) {
+      btn_pad_edge(g_pad, i, (uint8_t)digitalRead(g_pins[i]), now);
+    }
+  }
 
-  // UP/DOWN com repeat
-  evUp   = bUp.update(nowMs, true);
-  evDown = bDown.update(nowMs, true);
+  btn_pad_advance(g_pad, now);
 }
 
-BtnEvent buttons_onoff_event() { return evOnOff; }
-BtnEvent buttons_up_event()    { return evUp; }
-BtnEvent buttons_down_event()  { return evDown; }
+bool buttons_next(BtnInput& out) {
+  if (g_evCount == 0) return false;
+  out = g_evq[g_evHead];
+  g_evHead = (uint8_t)((g_evHead + 1) % EVQ_SIZE);
+  g_evCount--;
+  return true;
+}
+
+uint32_t buttons_edges_lost() {
+  return g_lost;
+}
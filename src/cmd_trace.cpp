@@ -0,0 +1,130 @@
+#include "cmd_trace.h"
+#include <sys/time.h>
+
+struct Trace {
+  bool     active;
+  bool     hasAck;
+  uint8_t  scope;
+  uint32_t rxUs, netUs;
+  uint32_t disp, ack;            // us desde rx
+  char     msgId[32];
+};
+
+// ack já enviado, esperando a task de controle aplicar (tag 0 = livre)
+struct Pending {
+  uint8_t  tag;
+  uint8_t  scope;
+  uint32_t rxUs;
+  char     msgId[32];
+};
+
+static Trace    g_cur;
+static uint8_t  g_tag = 0;
+static Pending  g_pend[TRACE_PENDING];
+static uint8_t  g_pendNext = 0;
+
+static uint32_t g_hist[TS_COUNT][TRACE_BUCKETS];
+static uint32_t g_max[TS_COUNT];
+static uint32_t g_n = 0;
+
+static uint8_t bucket(uint32_t us) {
+  uint8_t b = 0;
+  for (uint32_t lim = TRACE_B0_US; b < TRACE_BUCKETS - 1 && us >= lim; lim <<= 1) b++;
+  return b;
+}
+
+static void hist_add(TraceStage s, uint32_t us) {
+  g_hist[s][bucket(us)]++;
+  if (us > g_max[s]) g_max[s] = us;
+}
+
+void cmd_trace_dispatch(const MqttCommand& c) {
+  memset(&g_cur, 0, sizeof(g_cur));
+  if (!c.rxUs) return;           // sem carimbo de chegada
+  g_cur.active = true;
+  g_cur.rxUs   = c.rxUs;
+  g_cur.netUs  = c.netUs;
+  g_cur.disp   = micros() - c.rxUs;
+  g_cur.scope  = c.scope;
+  strlcpy(g_cur.msgId, c.msgId, sizeof(g_cur.msgId));
+}
+
+// Comando sem carimbo: tag vale p/ o controle, mas não entra na tabela.
+// Post recusado (fila cheia) deixa a entrada até ser sobrescrita.
+uint8_t cmd_trace_tag() {
+  if (++g_tag == 0) g_tag = 1;
+  if (g_cur.active) {
+    Pending& p = g_pend[g_pendNext];
+    g_pendNext = (g_pendNext + 1) % TRACE_PENDING;
+    p.tag   = g_tag;
+    p.scope = g_cur.scope;
+    p.rxUs  = g_cur.rxUs;
+    strlcpy(p.msgId, g_cur.msgId, sizeof(p.msgId));
+  }
+  return g_tag;
+}
+
+size_t cmd_trace_effect(uint8_t tag, uint32_t atUs, char* out, size_t cap) {
+  for (uint8_t i = 0; i < TRACE_PENDING; i++) {
+    Pending& p = g_pend[i];
+    if (!tag || p.tag != tag) continue;
+    p.tag = 0;
+    const uint32_t eff = atUs - p.rxUs;
+    hist_add(TS_EFF, eff);
+    if (p.scope != CMD_DIRECT || !p.msgId[0]) return 0;
+
+    JsonOut j(out, cap);
+    j.obj().s("type", "eff").s("id", p.msgId).u("eff", eff).end();
+    return j.len();
+  }
+  return 0;   // sem carimbo ou já sobrescrito
+}
+
+void cmd_trace_ack_json(JsonOut& j) {
+  if (!g_cur.active) return;
+  const uint32_t nowUs = micros();
+  g_cur.hasAck = true;
+  g_cur.ack = nowUs - g_cur.rxUs;
+
+  j.obj("lat").u("net", g_cur.netUs).u("disp", g_cur.disp).u("ack", g_cur.ack).end();
+
+  // hora da chegada (relógio de parede agora - tempo desde rx)
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  if (tv.tv_sec > 1577836800) {
+    const int64_t rx = (int64_t)tv.tv_sec * 1000000 + tv.tv_usec - g_cur.ack;
+    j.u("rx_s", (uint32_t)(rx / 1000000)).u("rx_ms", (uint32_t)((rx / 1000) % 1000));
+  }
+}
+
+void cmd_trace_done() {
+  if (!g_cur.active) return;
+  g_n++;
+  hist_add(TS_NET, g_cur.netUs);
+  hist_add(TS_DISP, g_cur.disp);
+  if (g_cur.hasAck) hist_add(TS_ACK, g_cur.ack);
+  g_cur.active = false;
+}
+
+// {"type":"lat","n":..,"b0":64,"net":[..],"disp":[..],"eff":[..],"ack":[..],
+//  "max":[net,disp,eff,ack]}
+size_t cmd_trace_hist_json(char* out, size_t cap) {
+  static const char* const K[TS_COUNT] = { "net", "disp", "eff", "ack" };
+  JsonOut j(out, cap);
+  j.obj().s("type", "lat").u("n", g_n).u("b0", TRACE_B0_US);
+  for (uint8_t s = 0; s < TS_COUNT; s++) {
+    j.arr(K[s]);
+    for (uint8_t b = 0; b < TRACE_BUCKETS; b++) j.u(nullptr, g_hist[s][b]);
+    j.end();
+  }
+  j.arr("max");
+  for (uint8_t s = 0; s < TS_COUNT; s++) j.u(nullptr, g_max[s]);
+  j.end().end();
+  return j.len();
+}
+
+void cmd_trace_reset() {
+  memset(g_hist, 0, sizeof(g_hist));
+  memset(g_max, 0, sizeof(g_max));
+  g_n = 0;
+}
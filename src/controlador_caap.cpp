@@ -12,6 +12,10 @@
 // Zona morta: se o erro for menor que isso, não atualiza RLS (evita drift)
 #define DEAD_ZONE 0.15f 
 
+// Amostra com dt muito diferente de Ts não entra no RLS
+#define DT_RATIO_MIN 0.5f
+#define DT_RATIO_MAX 2.0f
+
 void controlador_begin(CAAP_Data &data, float temp_inicial) {
     // Valores iniciais conservadores
     data.a1 = 0.99f;
@@ -24,18 +28,33 @@ void controlador_begin(CAAP_Data &data, float temp_inicial) {
     data.temperatura_ant = temp_inicial;
     data.u_ant = 0.0f;
     data.u_calculado = 0.0f;
+    data.erro_pred = 0.0f;
     
     data.lambda = 0.992f;
     data.polo_desejado = -0.8187f;
+    data.Ts = 1.0f;
 }
 
-void controlador_update(CAAP_Data &data, float temp_atual, float setpoint) {
+void controlador_update(CAAP_Data &data, float temp_atual, float setpoint, float dt_s) {
+    // 0. Discretização com o dt medido
+    // Com u constante no intervalo (SSR), a temperatura anda para o regime
+    // com fator a1^(dt/Ts): y(dt) - y0 = (1 - a1^r)(y_ss - y0). O RLS
+    // identifica o modelo em Ts, então a amostra vira o equivalente em Ts.
+    const float r = dt_s / data.Ts;
+    const bool dt_ok = (r >= DT_RATIO_MIN) && (r <= DT_RATIO_MAX);
+    float y_eq = temp_atual;
+    if (dt_ok && fabsf(r - 1.0f) > 0.001f) {
+        const float ar = powf(data.a1, r);
+        y_eq = data.temperatura_ant + (temp_atual - data.temperatura_ant) * (1.0f - data.a1) / (1.0f - ar);
+    }
+
     // 1. Vetor de regressão
     float phi[2] = { data.temperatura_ant, data.u_ant };
 
     // 2. Predição a priori
     float y_hat = (data.a1 * phi[0]) + (data.b0 * phi[1]);
-    float erro_predicao = temp_atual - y_hat;
+    float erro_predicao = y_eq - y_hat;
+    data.erro_pred = erro_predicao;
     float erro_tracking = setpoint - temp_atual;
 
     // === LÓGICA DO SUPERVISOR (SEU PEDIDO) ===
@@ -58,7 +77,7 @@ void controlador_update(CAAP_Data &data, float temp_atual, float setpoint) {
     // === ZONA MORTA (ANTI-DRIFT) ===
     // Só roda o RLS se houver algo relevante para aprender.
     // Se o erro de predição for minúsculo (ruído), ignoramos.
-    bool deve_atualizar_rls = (fabsf(erro_predicao) > DEAD_ZONE);
+    bool deve_atualizar_rls = dt_ok && (fabsf(erro_predicao) > DEAD_ZONE);
 
     if (deve_atualizar_rls) {
         // 3. Ganho de Kalman
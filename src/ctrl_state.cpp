@@ -0,0 +1,70 @@
+#include "ctrl_state.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+
+#include "config.h"
+
+// Seqlock: ímpar = escrita em andamento
+static volatile uint32_t g_seq = 0;
+static CtrlSnapshot      g_snap;
+static uint32_t          g_version = 0;
+
+static QueueHandle_t g_cmdQ = nullptr;
+
+// controle -> rede: comando aplicado (só os com tag)
+struct CmdDone {
+  uint8_t  tag;
+  uint32_t atUs;
+};
+static QueueHandle_t g_doneQ = nullptr;
+
+void ctrl_state_begin() {
+  if (!g_cmdQ) g_cmdQ = xQueueCreate(CTRL_CMD_QUEUE, sizeof(CtrlCmd));
+  if (!g_doneQ) g_doneQ = xQueueCreate(CTRL_CMD_QUEUE, sizeof(CmdDone));
+  // boot de novo com as filas já criadas (SIL: a RAM não zera) = vazias
+  xQueueReset(g_cmdQ);
+  xQueueReset(g_doneQ);
+  memset(&g_snap, 0, sizeof(g_snap));
+}
+
+void ctrl_state_publish(CtrlSnapshot& s) {
+  s.version = ++g_version;
+
+  const uint32_t q = g_seq;
+  __atomic_store_n(&g_seq, q + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  memcpy(&g_snap, &s, sizeof(g_snap));
+  __atomic_store_n(&g_seq, q + 2, __ATOMIC_RELEASE);
+}
+
+void ctrl_state_read(CtrlSnapshot& out) {
+  for (;;) {
+    const uint32_t s0 = __atomic_load_n(&g_seq, __ATOMIC_ACQUIRE);
+    if (s0 & 1) continue;   // escritor (outro core, prio 3) termina em ~1 us
+    memcpy(&out, &g_snap, sizeof(out));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&g_seq, __ATOMIC_RELAXED) == s0) return;
+  }
+}
+
+bool ctrl_cmd_post(const CtrlCmd& c) {
+  return g_cmdQ && xQueueSend(g_cmdQ, &c, 0) == pdTRUE;
+}
+
+bool ctrl_cmd_take(CtrlCmd& out) {
+  return g_cmdQ && xQueueReceive(g_cmdQ, &out, 0) == pdTRUE;
+}
+
+void ctrl_cmd_applied(uint8_t tag) {
+  if (!tag || !g_doneQ) return;
+  const CmdDone d = { tag, (uint32_t)micros() };
+  xQueueSend(g_doneQ, &d, 0);
+}
+
+bool ctrl_cmd_done(uint8_t& tag, uint32_t& atUs) {
+  CmdDone d;
+  if (!g_doneQ || xQueueReceive(g_doneQ, &d, 0) != pdTRUE) return false;
+  tag  = d.tag;
+  atUs = d.atUs;
+  return true;
+}
@@ -0,0 +1,227 @@
+#include "diag.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_heap_caps.h>
+
+#include "config.h"
+#include "json_out.h"
+#include "mqtt_link.h"
+#include "heap_guard.h"
+
+// Bordas dos histogramas (us); o último balde é "acima da última borda"
+static const uint32_t DIAG_EDGES_US[] = { 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000 };
+static const uint8_t  DIAG_BUCKETS = sizeof(DIAG_EDGES_US) / sizeof(DIAG_EDGES_US[0]) + 1;
+
+// Escritor único por histograma; contadores só crescem e quem publica
+// guarda a cópia anterior (sem lock entre os cores). max/busy são
+// zerados pelo leitor a cada janela.
+struct DiagHist {
+  volatile uint32_t n[DIAG_BUCKETS];
+  volatile uint32_t max;
+  volatile uint32_t busyUs;
+};
+
+static DiagHist g_step, g_ctrl, g_net;
+static uint32_t g_stepPrev[DIAG_BUCKETS], g_ctrlPrev[DIAG_BUCKETS], g_netPrev[DIAG_BUCKETS];
+
+static volatile uint32_t g_missed = 0;
+static uint32_t g_missedPrev = 0;
+
+static uint32_t g_periodMs  = 0;
+static volatile bool g_req  = false;
+static uint32_t g_lastPubMs = 0;
+static uint32_t g_winStartMs = 0;
+
+static char g_buf[MQTT_BUF_SIZE - 128];
+
+#if configUSE_TRACE_FACILITY
+static TaskStatus_t g_ts[DIAG_MAX_TASKS];
+#if configGENERATE_RUN_TIME_STATS
+struct DiagPrevRt { TaskHandle_t h; uint32_t rt; };
+static DiagPrevRt g_prevRt[DIAG_MAX_TASKS];
+static uint8_t    g_nPrevRt   = 0;
+static uint32_t   g_prevTotal = 0;
+#endif
+#endif
+
+static void hist_add(DiagHist& h, uint32_t us) {
+  uint8_t b = 0;
+  while (b < DIAG_BUCKETS - 1 && us >= DIAG_EDGES_US[b]) b++;
+  h.n[b] = h.n[b] + 1;
+  if (us > h.max) h.max = us;
+}
+
+void diag_begin() {
+  g_winStartMs = millis();
+  diag_set_period(DIAG_PERIOD_MS);
+}
+
+void diag_ctrl_tick(uint32_t busyUs) {
+  hist_add(g_ctrl, busyUs);
+  g_ctrl.busyUs = g_ctrl.busyUs + busyUs;
+}
+
+void diag_ctrl_step(uint32_t lateUs, uint32_t missed) {
+  hist_add(g_step, lateUs);
+  if (missed) g_missed = g_missed + missed;
+}
+
+void diag_net_loop(uint32_t busyUs) {
+  hist_add(g_net, busyUs);
+  g_net.busyUs = g_net.busyUs + busyUs;
+}
+
+uint32_t diag_set_period(uint32_t ms) {
+  if (ms && ms < DIAG_PERIOD_MIN_MS) ms = DIAG_PERIOD_MIN_MS;
+  g_periodMs = ms;
+  return ms;
+}
+
+void diag_request() {
+  g_req = true;
+}
+
+// ---------------- publicação ----------------
+// "nome":{"n":..,"load":..,"max":..,"h":[..]}; janela = delta desde a anterior
+static void put_hist(JsonOut& j, const char* name, DiagHist& h, uint32_t* prev, uint32_t winMs) {
+  uint32_t cnt = 0;
+  uint32_t d[DIAG_BUCKETS];
+  for (uint8_t i = 0; i < DIAG_BUCKETS; i++) {
+    const uint32_t v = h.n[i];
+    d[i] = v - prev[i];
+    prev[i] = v;
+    cnt += d[i];
+  }
+  const uint32_t mx   = __atomic_exchange_n(&h.max, 0, __ATOMIC_RELAXED);
+  const uint32_t busy = __atomic_exchange_n(&h.busyUs, 0, __ATOMIC_RELAXED);
+  const float load = winMs ? busy / (winMs * 10.0f) : 0.0f;   // % de um core
+
+  j.obj(name).u("n", cnt).f("load", load, 1).u("max", mx);
+  j.arr("h");
+  for (uint8_t i = 0; i < DIAG_BUCKETS; i++) j.u(nullptr, d[i]);
+  j.end().end();
+}
+
+static bool publish_sys(uint32_t now, uint32_t winMs) {
+  JsonOut j(g_buf);
+  j.obj().s("type", "sys").u("up", now / 1000).u("win", winMs);
+  j.u("heap", heap_caps_get_free_size(MALLOC_CAP_8BIT));
+  j.u("heapMin", heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT));
+  j.u("blk", heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+  j.u("ntask", uxTaskGetNumberOfTasks());
+  j.arr("edges");
+  for (uint8_t i = 0; i < DIAG_BUCKETS - 1; i++) j.u(nullptr, DIAG_EDGES_US[i]);
+  j.end();
+  const uint32_t missed = g_missed;
+  j.u("miss", missed - g_missedPrev);
+  g_missedPrev = missed;
+  put_hist(j, "step", g_step, g_stepPrev, winMs);
+  put_hist(j, "ctrl", g_ctrl, g_ctrlPrev, winMs);
+  put_hist(j, "net", g_net, g_netPrev, winMs);
+  j.end();
+  if (!j.ok()) return false;   // não coube: não publica
+
+  return mqtt_publish_diag(g_buf, j.len());
+}
+
+#if configUSE_TRACE_FACILITY
+#if configGENERATE_RUN_TIME_STATS
+// CPU% da task na janela (100 = um core inteiro); <0 se é task nova
+static float task_cpu(const TaskStatus_t& t, uint32_t dTotal) {
+  for (uint8_t i = 0; i < g_nPrevRt; i++) {
+    if (g_prevRt[i].h != t.xHandle) continue;
+    if (!dTotal) return 0.0f;
+    return (float)(t.ulRunTimeCounter - g_prevRt[i].rt) * 100.0f / dTotal;
+  }
+  return -1.0f;
+}
+#endif
+
+// {"type":"tasks","part":..,"rt":..,"t":[[nome, cpu% (null = sem runtime
+// stats/nova), stack livre mínimo (bytes), prio],..]} com g_ts[from, to).
+// 0 = não coube
+static size_t tasks_json(uint8_t part, bool rt, uint32_t dTotal, UBaseType_t from, UBaseType_t to) {
+  (void)dTotal;
+  JsonOut j(g_buf);
+  j.obj().s("type", "tasks").u("part", part).b("rt", rt);
+  j.arr("t");
+  for (UBaseType_t i = from; i < to; i++) {
+    const TaskStatus_t& t = g_ts[i];
+    j.arr().s(nullptr, t.pcTaskName);
+#if configGENERATE_RUN_TIME_STATS
+    const float c = task_cpu(t, dTotal);
+    if (c >= 0.0f) j.f(nullptr, c, 1);
+    else           j.null(nullptr);
+#else
+    j.null(nullptr);
+#endif
+    j.u(nullptr, t.usStackHighWaterMark).u(nullptr, t.uxCurrentPriority).end();
+  }
+  j.end().end();
+  return j.len();
+}
+
+static bool publish_tasks() {
+  uint32_t total = 0;
+  const UBaseType_t cnt = uxTaskGetSystemState(g_ts, DIAG_MAX_TASKS, &total);
+  // 0 = mais tasks que DIAG_MAX_TASKS
+  if (cnt == 0) {
+    JsonOut j(g_buf);
+    j.obj().s("type", "tasks").s("err", "DIAG_MAX_TASKS").u("ntask", uxTaskGetNumberOfTasks()).end();
+    return j.ok() && mqtt_publish_diag(g_buf, j.len());
+  }
+
+#if configGENERATE_RUN_TIME_STATS
+  const uint32_t dTotal = total - g_prevTotal;
+  const bool rt = true;
+#else
+  (void)total;
+  const uint32_t dTotal = 0;
+  const bool rt = false;
+#endif
+
+  // não coube: menos tasks nesta parte, o resto vai na próxima
+  uint8_t part = 0;
+  bool ok = true;
+  for (UBaseType_t from = 0; from < cnt;) {
+    UBaseType_t to = cnt;
+    size_t n = tasks_json(part, rt, dTotal, from, to);
+    while (!n && to > from + 1) n = tasks_json(part, rt, dTotal, from, --to);
+    if (n) {
+      ok = mqtt_publish_diag(g_buf, n) && ok;
+      part++;
+    }
+    from = to;   // nem uma coube sozinha: fica de fora
+  }
+
+#if configGENERATE_RUN_TIME_STATS
+  g_prevTotal = total;
+  g_nPrevRt = (uint8_t)cnt;
+  for (UBaseType_t i = 0; i < cnt; i++) {
+    g_prevRt[i].h  = g_ts[i].xHandle;
+    g_prevRt[i].rt = g_ts[i].ulRunTimeCounter;
+  }
+#endif
+  return ok;
+}
+#endif
+
+void diag_poll() {
+  if (!mqtt_is_connected()) return;
+
+  const uint32_t now = millis();
+  const bool due = g_periodMs && (now - g_lastPubMs) >= g_periodMs;
+  if (!due && !g_req) return;
+  g_req = false;
+  g_lastPubMs = now;
+
+  const uint32_t winMs = now - g_winStartMs;
+  g_winStartMs = now;
+
+  publish_sys(now, winMs);
+  const size_t n = heap_guard_json(g_buf, sizeof(g_buf));
+  if (n) mqtt_publish_diag(g_buf, n);
+#if configUSE_TRACE_FACILITY
+  publish_tasks();
+#endif
+}
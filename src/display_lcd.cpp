@@ -1,66 +1,231 @@
 #include "display_lcd.h"
 #include <Wire.h>
 #include <LiquidCrystal_I2C.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include <new>
+
+#include "config.h"
 
 static LiquidCrystal_I2C* lcd = nullptr;
+alignas(LiquidCrystal_I2C) static uint8_t lcdMem[sizeof(LiquidCrystal_I2C)];   // sem heap
 static uint8_t gCols = 16;
 static uint8_t gRows = 2;
 
-// ====== NOVO: Estado de alerta ======
+// ====== Framebuffer ======
+// gFb = o que queremos mostrar; gGlass = o que já está no LCD.
+// Só as diferenças vão pelo I2C (setCursor + trecho alterado).
+static const uint8_t  FB_COLS_MAX = 20;
+static const uint8_t  FB_ROWS_MAX = 4;
+static const uint8_t  RUN_GAP     = 1;       // junta trechos separados por até N células iguais (setCursor custa ~1 char)
+static const uint32_t FULL_REFRESH_MS = 10000;  // reenvia tudo de vez em quando (ruído no barramento)
+static const uint8_t  I2C_PER_LCD_BYTE = 12; // PCF8574 4 bits: 2 nibbles x 3 escritas x (endereço + dado)
+
+static char gFb[FB_ROWS_MAX][FB_COLS_MAX];
+static char gGlass[FB_ROWS_MAX][FB_COLS_MAX];
+static uint32_t gLastFullMs = 0;
+static volatile bool gForceFull = false;
+
+static DisplayStats gStats;
+static uint32_t gWinStartMs = 0;
+static uint32_t gWinI2c = 0;
+
+// ====== Estado de alerta ======
 static bool   gAlertEnabled = false;
 static bool   gAlertBlink   = false;
-static String gAlertLine0   = "";
-static String gAlertLine1   = "";
+static char   gAlertLine0[FB_COLS_MAX + 1] = "";
+static char   gAlertLine1[FB_COLS_MAX + 1] = "";
 static uint32_t gLastBlinkMs = 0;
 static bool   gBlinkOn      = true;
 
-// Função auxiliar para garantir que a linha tenha exatamente 16 caracteres
-static void printLine(uint8_t row, String text) {
+// ====== Task ======
+static QueueHandle_t gModelQ   = nullptr;   // caixa de 1 modelo (sobrescreve)
+static uint32_t      gPeriodMs = 150;
+
+static volatile bool gNetWifi = false;
+static volatile bool gNetMqtt = false;
+static volatile int  gNetRssi = 0;
+
+// Linha do framebuffer: texto preenchido com espaços até gCols
+static void fb_line(uint8_t row, const char* text) {
+  if (row >= gRows) return;
+  uint8_t i = 0;
+  if (text) {
+    for (; i < gCols && text[i]; i++) gFb[row][i] = text[i];
+  }
+  for (; i < gCols; i++) gFb[row][i] = ' ';
+}
+
+// Linha com 'left' à esquerda e 'right' alinhado à direita
+static void fb_line_lr(uint8_t row, const char* left, const char* right) {
+  fb_line(row, left);
+  if (row >= gRows) return;
+  const size_t n = strlen(right);
+  const uint8_t start = (n >= gCols) ? 0 : (uint8_t)(gCols - n);
+  for (uint8_t i = start; i < gCols; i++) gFb[row][i] = right[i - start];
+}
+
+static void lcd_send_run(uint8_t row, uint8_t c0, uint8_t c1) {
+  lcd->setCursor(c0, row);
+  for (uint8_t c = c0; c <= c1; c++) {
+    lcd->write((uint8_t)gFb[row][c]);
+    gGlass[row][c] = gFb[row][c];
+  }
+  gStats.lcdBytes += 1 + (c1 - c0 + 1);
+  gStats.cellsSent += c1 - c0 + 1;
+  gWinI2c += (uint32_t)(1 + (c1 - c0 + 1)) * I2C_PER_LCD_BYTE;
+}
+
+// Envia só as células que mudaram
+static void fb_flush() {
   if (!lcd) return;
-  lcd->setCursor(0, row);
+  const uint32_t t0 = micros();
+  const uint32_t c0 = ESP.getCycleCount();
+  const uint32_t now = millis();
 
-  while (text.length() < gCols) {
-    text += " ";
+  const bool full = gForceFull || (now - gLastFullMs >= FULL_REFRESH_MS);
+  if (full) {
+    gForceFull = false;
+    gLastFullMs = now;
+    memset(gGlass, 0, sizeof(gGlass));   // força reenviar tudo
   }
-  if (text.length() > gCols) {
-    text = text.substring(0, gCols);
+
+  for (uint8_t r = 0; r < gRows; r++) {
+    int16_t runStart = -1, runEnd = -1;
+    for (uint8_t c = 0; c < gCols; c++) {
+      if (gFb[r][c] == gGlass[r][c]) continue;
+      if (runStart >= 0 && c - runEnd > RUN_GAP + 1) {
+        lcd_send_run(r, (uint8_t)runStart, (uint8_t)runEnd);
+        runStart = -1;
+      }
+      if (runStart < 0) runStart = c;
+      runEnd = c;
+    }
+    if (runStart >= 0) lcd_send_run(r, (uint8_t)runStart, (uint8_t)runEnd);
   }
 
-  lcd->print(text);
+  if (full) {
+    gStats.fullCycLast = ESP.getCycleCount() - c0;
+    gStats.fulls++;
+  }
+
+  gStats.renders++;
+  const uint32_t dt = micros() - t0;
+  gStats.renderUsLast = dt;
+  if (dt > gStats.renderUsMax) gStats.renderUsMax = dt;
+
+  if (now - gWinStartMs >= 1000) {
+    gStats.i2cBytesPerSec = (uint32_t)((uint64_t)gWinI2c * 1000 / (now - gWinStartMs));
+    gStats.i2cBytes += gWinI2c;
+    gWinI2c = 0;
+    gWinStartMs = now;
+  }
 }
 
-// ====== NOVO: API para setar alerta ======
-void display_set_alert(bool enabled, const char* line0, const char* line1, bool blink) {
+// ====== Alerta ======
+static void display_set_alert(bool enabled, const char* line0, const char* line1, bool blink) {
+  if (!line0) line0 = "";
+  if (!line1) line1 = "";
+
+  // chamado a cada atualização: só reinicia o pisca se o alerta mudou
+  const bool changed = (enabled != gAlertEnabled) || (blink != gAlertBlink) ||
+                       strncmp(line0, gAlertLine0, FB_COLS_MAX) != 0 ||
+                       strncmp(line1, gAlertLine1, FB_COLS_MAX) != 0;
+  if (!changed) return;
+
   gAlertEnabled = enabled;
   gAlertBlink   = blink;
-
-  gAlertLine0 = line0 ? String(line0) : String("");
-  gAlertLine1 = line1 ? String(line1) : String("");
+  strlcpy(gAlertLine0, line0, sizeof(gAlertLine0));
+  strlcpy(gAlertLine1, line1, sizeof(gAlertLine1));
 
   gLastBlinkMs = millis();
   gBlinkOn = true;
 }
 
 void display_begin(uint8_t addr, uint8_t cols, uint8_t rows) {
-  gCols = cols;
-  gRows = rows;
-  lcd = new LiquidCrystal_I2C(addr, cols, rows);
+  gCols = (cols > FB_COLS_MAX) ? FB_COLS_MAX : cols;
+  gRows = (rows > FB_ROWS_MAX) ? FB_ROWS_MAX : rows;
+  lcd = new (lcdMem) LiquidCrystal_I2C(addr, cols, rows);
   lcd->init();
   lcd->backlight();
   lcd->clear();
+
+  // clear() deixa tudo em branco
+  memset(gGlass, ' ', sizeof(gGlass));
+  memset(gFb, ' ', sizeof(gFb));
+  memset(&gStats, 0, sizeof(gStats));
+  gLastFullMs = gWinStartMs = millis();
 }
 
 void display_show_boot(const char* line1, const char* line2) {
   if (!lcd) return;
-  lcd->clear();
-  printLine(0, String(line1));
-  printLine(1, String(line2));
+  fb_line(0, line1);
+  fb_line(1, line2);
+  fb_flush();
+}
+
+static void render_main(const DisplayModel& m) {
+  char left[FB_COLS_MAX + 1];
+  char right[FB_COLS_MAX + 1];
+
+  // --- LINHA 0: [T:30.0] esquerdo | [LIGADO/DESLIGADO] direito ---
+  if (m.tempValid) snprintf(left, sizeof(left), "T:%.1f", m.tempC);
+  else             snprintf(left, sizeof(left), "T:--.-");
+  fb_line_lr(0, left, m.systemOn ? "LIGADO" : "DESLIGADO");
+
+  // --- LINHA 1: [SET:32.0] esquerdo | [AQ:ON/OFF] direito ---
+  snprintf(left,  sizeof(left),  "SET:%.1f", m.setpoint);
+  snprintf(right, sizeof(right), "AQ:%s", m.heaterOn ? "ON" : "OFF");
+  fb_line_lr(1, left, right);
+}
+
+static void render_model(const DisplayModel& m) {
+  char left[FB_COLS_MAX + 1];
+  char right[FB_COLS_MAX + 1];
+
+  snprintf(left,  sizeof(left),  "a1:%.4f", m.a1);
+  snprintf(right, sizeof(right), "U%3.0f%%", m.u_pct);
+  fb_line_lr(0, left, right);
+
+  snprintf(left, sizeof(left), "b0:%.5f", m.b0);
+  fb_line_lr(1, left, "2/4");
+}
+
+static void render_net(const DisplayModel& m) {
+  (void)m;
+  char left[FB_COLS_MAX + 1];
+  char right[FB_COLS_MAX + 1];
+
+  const bool wifi = gNetWifi;
+  snprintf(left, sizeof(left), "WIFI:%s", wifi ? "OK" : "--");
+  if (wifi) snprintf(right, sizeof(right), "%ddBm", (int)gNetRssi);
+  else      right[0] = '\0';
+  fb_line_lr(0, left, right);
+
+  snprintf(left, sizeof(left), "MQTT:%s", gNetMqtt ? "OK" : "--");
+  fb_line_lr(1, left, "3/4");
+}
+
+static void render_info(const DisplayModel& m) {
+  (void)m;
+  char left[FB_COLS_MAX + 1];
+
+  // controlador tem uma zona só: mostra o ID dela
+  fb_line(0, CTRL_ID);
+
+  const uint32_t s = millis() / 1000;
+  snprintf(left, sizeof(left), "UP %lud%02luh%02lum", (unsigned long)(s / 86400),
+           (unsigned long)((s / 3600) % 24), (unsigned long)((s / 60) % 60));
+  fb_line_lr(1, left, "4/4");
 }
 
-void display_update(bool systemOn, float setpoint, bool tempValid, float tempC, bool heaterOn) {
+static void render(const DisplayModel& m) {
   if (!lcd) return;
 
-  // ====== NOVO: se alerta estiver ativo, ele tem prioridade ======
+  display_set_alert(m.alert0 != nullptr, m.alert0, m.alert1, m.alertBlink);
+
+  // ====== se alerta estiver ativo, ele tem prioridade ======
   if (gAlertEnabled) {
     if (gAlertBlink) {
       const uint32_t now = millis();
@@ -69,46 +234,59 @@ void display_update(bool systemOn, float setpoint, bool tempValid, float tempC,
         gLastBlinkMs = now;
         gBlinkOn = !gBlinkOn;
       }
-
-      if (gBlinkOn) {
-        printLine(0, gAlertLine0);
-        printLine(1, gAlertLine1);
-      } else {
-        printLine(0, "");
-        printLine(1, "");
-      }
-    } else {
-      printLine(0, gAlertLine0);
-      printLine(1, gAlertLine1);
     }
+
+    const bool show = !gAlertBlink || gBlinkOn;
+    fb_line(0, show ? gAlertLine0 : "");
+    fb_line(1, show ? gAlertLine1 : "");
+    fb_flush();
     return; // não mostra tela normal
   }
 
-  // --- LINHA 0: [T:30.0] esquerdo | [LIG/DESL] direito ---
-  String tPart = "T:";
-  tPart += tempValid ? String(tempC, 1) : "--.-";
+  switch (m.page) {
+    case PAGE_MODEL: render_model(m); break;
+    case PAGE_NET:   render_net(m);   break;
+    case PAGE_INFO:  render_info(m);  break;
+    default:         render_main(m);  break;
+  }
+  fb_flush();
+}
 
-  String sPart = systemOn ? "LIGADO" : "DESLIGADO";
+static void display_task(void* pv) {
+  (void)pv;
+  DisplayModel m;
+  bool has = false;
+  for (;;) {
+    // modelo novo ou timeout (mantém o pisca/uptime andando)
+    if (xQueueReceive(gModelQ, &m, pdMS_TO_TICKS(gPeriodMs)) == pdTRUE) has = true;
+    if (has) render(m);
+  }
+}
 
-  // Monta a linha 0 com espaços calculados para alinhar à direita
-  String linha0 = tPart;
-  int spaces0 = gCols - tPart.length() - sPart.length();
-  for (int i = 0; i < spaces0; i++) linha0 += " ";
-  linha0 += sPart;
+void display_start_task(uint32_t periodMs) {
+  gPeriodMs = periodMs;
+  // fila criada uma vez só (SIL: o boot se repete sem zerar a RAM)
+  if (!gModelQ) gModelQ = xQueueCreate(1, sizeof(DisplayModel));
+  if (!gModelQ) return;
+  xQueueReset(gModelQ);
+  // abaixo da task de controle (3) no mesmo core: I2C só roda quando ela dorme
+  xTaskCreatePinnedToCore(display_task, "lcd", 3072, nullptr, 1, nullptr, 1);
+}
 
-  // --- LINHA 1: [SET:32.0] esquerdo | [AQ:ON/OFF] direito ---
-  String setPart = "SET:" + String(setpoint, 1);
+void display_post(const DisplayModel& m) {
+  if (gModelQ) xQueueOverwrite(gModelQ, &m);
+}
 
-  String aqPart = "AQ:";
-  aqPart += heaterOn ? "ON" : "OFF";
+void display_set_net(bool wifi, bool mqtt, int rssi) {
+  gNetWifi = wifi;
+  gNetMqtt = mqtt;
+  gNetRssi = rssi;
+}
 
-  // Monta a linha 1 com espaços calculados para alinhar à direita
-  String linha1 = setPart;
-  int spaces1 = gCols - setPart.length() - aqPart.length();
-  for (int i = 0; i < spaces1; i++) linha1 += " ";
-  linha1 += aqPart;
+void display_force_full() {
+  gForceFull = true;
+}
 
-  // Envia para o display
-  printLine(0, linha0);
-  printLine(1, linha1);
+void display_get_stats(DisplayStats& out) {
+  out = gStats;
 }
@@ -0,0 +1,108 @@
+#include "fault.h"
+
+#include "config.h"
+#include "json_out.h"
+#include "mqtt_link.h"
+
+struct FaultDef { const char* code; const char* msg; };
+static const FaultDef FLT_DEF[FLT_COUNT] = {
+  { "SENSOR", "ds18b20 fail" },   // mesmo code/msg do evt antigo
+  { "HEAP",   "maior bloco livre < TLS" },
+};
+
+struct Fault {
+  volatile bool level;   // escrito por quem detecta
+  bool     lastLevel;
+  bool     active;       // nível depois do debounce
+  bool     pub;          // raise publicado (falta clear)
+  bool     everPub;
+  bool     supNoted;     // ocorrência atual já contada em sup
+  bool     remind;       // lembrete já (reconectou)
+  uint32_t edgeMs;       // última troca de nível
+  uint32_t sinceMs;      // ativou
+  uint32_t clearMs;      // desativou
+  uint32_t raiseMs;      // último raise publicado
+  uint32_t lastPubMs;    // último raise/lembrete
+  uint32_t n, sup;
+};
+
+static Fault g_f[FLT_COUNT];
+static bool  g_lastConn = false;
+static char  g_out[192];
+
+void fault_set(FaultId id, bool active) {
+  if (id < FLT_COUNT) g_f[id].level = active;
+}
+
+static bool publish(uint8_t id, const char* state, uint32_t durMs) {
+  const Fault& f = g_f[id];
+  JsonOut j(g_out);
+  j.obj().s("type", "fault").s("code", FLT_DEF[id].code).s("msg", FLT_DEF[id].msg);
+  j.s("state", state).u("n", f.n).u("sup", f.sup).u("dur", durMs / 1000);
+  j.end();
+  return j.ok() && mqtt_publish_evt(g_out, j.len());
+}
+
+void fault_poll(uint32_t now) {
+  const bool conn = mqtt_is_connected() && !mqtt_is_paused();
+  if (conn && !g_lastConn) {
+    for (uint8_t i = 0; i < FLT_COUNT; i++) g_f[i].remind = g_f[i].pub;
+  }
+  g_lastConn = conn;
+
+  bool sent = false;
+  for (uint8_t i = 0; i < FLT_COUNT; i++) {
+    Fault& f = g_f[i];
+    const bool lv = f.level;
+    if (lv != f.lastLevel) { f.lastLevel = lv; f.edgeMs = now; }
+
+    if (!f.active && lv && now - f.edgeMs >= FAULT_RAISE_MS) {
+      f.active = true;
+      f.sinceMs = f.edgeMs;   // dur conta desde a borda
+      f.n++;
+      f.supNoted = false;
+    } else if (f.active && !lv && now - f.edgeMs >= FAULT_CLEAR_MS) {
+      f.active = false;
+      f.clearMs = f.edgeMs;
+    }
+
+    if (sent || !conn) continue;
+
+    if (f.active && !f.pub) {
+      if (f.everPub && now - f.raiseMs < FAULT_HOLDOFF_MS) {
+        if (!f.supNoted) { f.sup++; f.supNoted = true; }
+        continue;
+      }
+      if (publish(i, "raise", now - f.sinceMs)) {
+        f.pub = f.everPub = true;
+        f.raiseMs = f.lastPubMs = now;
+        f.remind = false;
+        sent = true;
+      }
+    } else if (!f.active && f.pub) {
+      if (publish(i, "clear", f.clearMs - f.sinceMs)) {
+        f.pub = false;
+        sent = true;
+      }
+    } else if (f.active && (f.remind || (FAULT_REMIND_MS && now - f.lastPubMs >= FAULT_REMIND_MS))) {
+      if (publish(i, "active", now - f.sinceMs)) {
+        f.lastPubMs = now;
+        f.remind = false;
+        sent = true;
+      }
+    }
+  }
+}
+
+size_t fault_json(char* out, size_t cap, uint32_t now) {
+  JsonOut j(out, cap);
+  j.obj().s("type", "faults").arr("f");
+  for (uint8_t i = 0; i < FLT_COUNT; i++) {
+    const Fault& f = g_f[i];
+    j.obj().s("code", FLT_DEF[i].code).b("on", f.active).u("n", f.n).u("sup", f.sup);
+    j.u("dur", f.active ? (now - f.sinceMs) / 1000 : 0);
+    j.end();
+  }
+  j.end().end();
+  return j.len();
+}
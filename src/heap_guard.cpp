@@ -0,0 +1,257 @@
+#include "heap_guard.h"
+#include <esp_heap_caps.h>
+#include <new>
+
+#include "fault.h"
+#include "json_out.h"
+#include "log_mirror.h"
+#include "ota_service.h"
+
+static const uint32_t LFB_SAMPLE_MS = 10000;   // mínimo do maior bloco
+
+static volatile bool g_sealed = false;
+static uint32_t g_sealMs  = 0;
+static uint32_t g_blkSeal = 0;
+
+// maior bloco livre: 1 amostra por HEAP_TREND_MS (anel, mais antiga em head)
+static uint32_t g_trend[HEAP_TREND_N];
+static uint16_t g_trendN = 0, g_trendHead = 0;
+static uint32_t g_lastTrendMs = 0, g_lastSampleMs = 0;
+static uint32_t g_lfbMin = 0;
+
+static void trend_push(uint32_t lfb) {
+  if (g_trendN < HEAP_TREND_N) {
+    g_trend[(g_trendHead + g_trendN++) % HEAP_TREND_N] = lfb;
+  } else {
+    g_trend[g_trendHead] = lfb;
+    g_trendHead = (g_trendHead + 1) % HEAP_TREND_N;
+  }
+}
+
+// mínimos quadrados sobre o anel, em B/dia
+static bool trend_slope(float& perDay) {
+  if (g_trendN < 3) return false;
+  float sx = 0, sy = 0, sxx = 0, sxy = 0;
+  for (uint16_t i = 0; i < g_trendN; i++) {
+    const float y = (float)g_trend[(g_trendHead + i) % HEAP_TREND_N];
+    sx += i; sy += y; sxx += (float)i * i; sxy += i * y;
+  }
+  const float den = g_trendN * sxx - sx * sx;
+  if (den == 0.0f) return false;
+  perDay = (g_trendN * sxy - sx * sy) / den * (86400000.0f / HEAP_TREND_MS);
+  return true;
+}
+
+// ================= Guarda (HEAP_STATIC) =================
+#if HEAP_STATIC
+struct HgSite {
+  uint32_t pc;
+  char     task[8];
+  uint32_t n, bytes;
+};
+
+static HgSite   g_sites[HEAP_GUARD_SITES];
+static uint32_t g_n = 0, g_bytes = 0, g_other = 0;   // other: sites fora da tabela
+static uint32_t g_lastPc = 0;
+static portMUX_TYPE g_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static uint32_t g_reported = 0;
+static uint32_t g_lastReportMs = 0;
+
+// Xtensa (janelas): os 2 bits de cima do endereço de retorno são o tamanho
+// da janela; -3 aponta p/ a instrução de call (addr2line)
+static inline uint32_t caller_pc(void* ra) {
+  return (((uint32_t)(uintptr_t)ra & 0x3fffffffU) | 0x40000000U) - 3;
+}
+
+static void note(size_t n, void* ra) {
+  if (!g_sealed) return;
+  const uint32_t pc = caller_pc(ra);
+  const char* t = xPortInIsrContext() ? "isr" : pcTaskGetName(nullptr);
+
+  portENTER_CRITICAL_SAFE(&g_mux);
+  g_n++;
+  g_bytes += n;
+  g_lastPc = pc;
+  HgSite* s = nullptr;
+  for (uint8_t i = 0; i < HEAP_GUARD_SITES; i++) {
+    if (g_sites[i].pc == pc) { s = &g_sites[i]; break; }
+    if (!g_sites[i].pc) {
+      s = &g_sites[i];
+      s->pc = pc;
+      strlcpy(s->task, t ? t : "?", sizeof(s->task));
+      break;
+    }
+  }
+  if (s) { s->n++; s->bytes += n; }
+  else   g_other++;
+  portEXIT_CRITICAL_SAFE(&g_mux);
+}
+
+// -Wl,--wrap=...: toda referência a estes símbolos (nosso código, libs,
+// IDF) cai aqui; __real_* é o original
+extern "C" {
+void* __real_malloc(size_t n);
+void* __real_calloc(size_t c, size_t n);
+void* __real_realloc(void* p, size_t n);
+void* __real_heap_caps_malloc(size_t n, uint32_t caps);
+void* __real_heap_caps_calloc(size_t c, size_t n, uint32_t caps);
+
+void* __wrap_malloc(size_t n) {
+  note(n, __builtin_return_address(0));
+  return __real_malloc(n);
+}
+
+void* __wrap_calloc(size_t c, size_t n) {
+  note(c * n, __builtin_return_address(0));
+  return __real_calloc(c, n);
+}
+
+void* __wrap_realloc(void* p, size_t n) {
+  note(n, __builtin_return_address(0));
+  return __real_realloc(p, n);
+}
+
+void* __wrap_heap_caps_malloc(size_t n, uint32_t caps) {
+  note(n, __builtin_return_address(0));
+  return __real_heap_caps_malloc(n, caps);
+}
+
+void* __wrap_heap_caps_calloc(size_t c, size_t n, uint32_t caps) {
+  note(c * n, __builtin_return_address(0));
+  return __real_heap_caps_calloc(c, n, caps);
+}
+}
+
+// new direto aqui: senão o pc anotado seria sempre o do operator new da libstdc++
+void* operator new(size_t n) {
+  note(n, __builtin_return_address(0));
+  void* p = __real_malloc(n);
+  if (!p) abort();
+  return p;
+}
+
+void* operator new[](size_t n) {
+  note(n, __builtin_return_address(0));
+  void* p = __real_malloc(n);
+  if (!p) abort();
+  return p;
+}
+
+void* operator new(size_t n, const std::nothrow_t&) noexcept {
+  note(n, __builtin_return_address(0));
+  return __real_malloc(n);
+}
+
+void* operator new[](size_t n, const std::nothrow_t&) noexcept {
+  note(n, __builtin_return_address(0));
+  return __real_malloc(n);
+}
+#endif
+
+// ================= API =================
+void heap_guard_seal() {
+  multi_heap_info_t hi;
+  heap_caps_get_info(&hi, MALLOC_CAP_8BIT);
+  g_blkSeal = hi.allocated_blocks;
+  g_lfbMin  = hi.largest_free_block;
+  g_sealMs  = millis();
+  g_lastTrendMs = g_lastSampleMs = g_sealMs;
+  trend_push(hi.largest_free_block);
+  g_sealed = true;
+}
+
+void heap_guard_poll(uint32_t nowMs) {
+  if (!g_sealed) return;
+
+  if (nowMs - g_lastSampleMs >= LFB_SAMPLE_MS) {
+    g_lastSampleMs = nowMs;
+    const uint32_t lfb = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    if (lfb < g_lfbMin) g_lfbMin = lfb;
+    // durante o OTA o heap baixo é esperado (buffers/TLS do download)
+    fault_set(FLT_HEAP, !ota_is_running() && lfb < OTA_TLS_BLOCK_MIN);
+    if (nowMs - g_lastTrendMs >= HEAP_TREND_MS) {
+      g_lastTrendMs = nowMs;
+      trend_push(lfb);
+    }
+  }
+
+#if HEAP_STATIC
+  const uint32_t n = g_n;
+  if (n != g_reported && nowMs - g_lastReportMs >= HEAP_GUARD_REPORT_MS) {
+    log_mirror_printf(LOG_W, "[HEAP] %lu alocacoes depois do boot (+%lu, %lu B), ultima pc=0x%08lx",
+                      (unsigned long)n, (unsigned long)(n - g_reported),
+                      (unsigned long)g_bytes, (unsigned long)g_lastPc);
+    g_reported = n;
+    g_lastReportMs = nowMs;
+  }
+#endif
+}
+
+// {"type":"heap","static":..,"free":..,"min":..,"lfb":..,"lfbMin":..,
+//  "blkFree":..,"blkUsed":..,"blkSeal":..,"slope":B/dia|null,"trendMs":..,
+//  "trend":[lfb, mais antiga primeiro][,"n":..,"b":..,"other":..,
+//  "sites":[["pc","task",n,bytes],..]]}
+size_t heap_guard_json(char* out, size_t cap) {
+  multi_heap_info_t hi;
+  heap_caps_get_info(&hi, MALLOC_CAP_8BIT);
+
+  JsonOut j(out, cap);
+  j.obj().s("type", "heap").b("static", HEAP_STATIC != 0);
+  j.u("free", hi.total_free_bytes).u("min", hi.minimum_free_bytes);
+  j.u("lfb", hi.largest_free_block).u("lfbMin", g_sealed ? g_lfbMin : hi.largest_free_block);
+  j.u("blkFree", hi.free_blocks).u("blkUsed", hi.allocated_blocks).u("blkSeal", g_blkSeal);
+  float slope;
+  if (trend_slope(slope)) j.f("slope", slope, 0);
+  else                    j.null("slope");
+  j.u("trendMs", HEAP_TREND_MS);
+  j.arr("trend");
+  for (uint16_t i = 0; i < g_trendN; i++) j.u(nullptr, g_trend[(g_trendHead + i) % HEAP_TREND_N]);
+  j.end();
+
+#if HEAP_STATIC
+  HgSite sites[HEAP_GUARD_SITES];
+  uint32_t n, bytes, other;
+  portENTER_CRITICAL(&g_mux);
+  memcpy(sites, g_sites, sizeof(sites));
+  n = g_n; bytes = g_bytes; other = g_other;
+  portEXIT_CRITICAL(&g_mux);
+
+  j.u("n", n).u("b", bytes).u("other", other);
+  j.arr("sites");
+  for (uint8_t i = 0; i < HEAP_GUARD_SITES && sites[i].pc; i++) {
+    char pc[12];
+    snprintf(pc, sizeof(pc), "0x%08lx", (unsigned long)sites[i].pc);
+    j.arr().s(nullptr, pc).s(nullptr, sites[i].task).u(nullptr, sites[i].n).u(nullptr, sites[i].bytes).end();
+  }
+  j.end();
+#endif
+  j.end();
+  return j.len();
+}
+
+// ================= Tasks em runtime =================
+bool task_slot_start(TaskSlot& s, TaskFunction_t fn, const char* name, void* arg,
+                     UBaseType_t prio, BaseType_t core) {
+#if HEAP_STATIC
+  if (s.h) {
+    // a anterior chama task_slot_exit() e se suspende; parada, o delete é imediato
+    for (uint8_t i = 0; i < 100 && eTaskGetState(s.h) != eSuspended; i++) vTaskDelay(1);
+    if (eTaskGetState(s.h) != eSuspended) return false;
+    vTaskDelete(s.h);
+    s.h = nullptr;
+  }
+  s.h = xTaskCreateStaticPinnedToCore(fn, name, s.stackBytes, arg, prio, s.stack, &s.tcb, core);
+  return s.h != nullptr;
+#else
+  return xTaskCreatePinnedToCore(fn, name, s.stackBytes, arg, prio, &s.h, core) == pdPASS;
+#endif
+}
+
+void task_slot_exit() {
+#if HEAP_STATIC
+  vTaskSuspend(nullptr);
+#else
+  vTaskDelete(nullptr);
+#endif
+}
@@ -0,0 +1,158 @@
+#include "hist24.h"
+
+#include <Preferences.h>
+#include <time.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include "config.h"
+#include "journal.h"
+#include "mqtt_link.h"
+#include "msg_json.h"
+
+static Preferences g_prefs;
+
+static HistPoint g_hist[24];
+static uint8_t   g_histHead  = 0;   // próxima posição de escrita
+static uint8_t   g_histCount = 0;   // 0..24
+static uint32_t  g_histLastStoreMs = 0;
+
+// Mutex do histórico (evita race entre tasks)
+static SemaphoreHandle_t g_histMutex = nullptr;
+
+// {head, count} do anel no journal
+struct HistMeta {
+  uint8_t head;
+  uint8_t count;
+};
+
+static uint32_t now_epoch_or_zero() {
+  const time_t now = time(nullptr);
+  // "válido" se já passou de 2020-01-01 (aprox)
+  return (now > 1577836800) ? (uint32_t)now : 0;
+}
+
+static void hist_load() {
+  HistMeta m;
+  if (jrnl_get(JK_HIST_META, &m, sizeof(m))) {
+    g_histHead  = m.head;
+    g_histCount = m.count;
+    for (uint8_t i = 0; i < 24; i++) {
+      if (!jrnl_get(JK_HIST0 + i, &g_hist[i], sizeof(HistPoint))) memset(&g_hist[i], 0, sizeof(HistPoint));
+    }
+  } else {
+    // 1º boot com journal: importa o anel antigo do NVS (h_head/h_cnt/h_blob)
+    g_prefs.begin("smarttemp", false);
+    g_histHead  = g_prefs.getUChar("h_head", 0);
+    g_histCount = g_prefs.getUChar("h_cnt",  0);
+    size_t n = g_prefs.getBytesLength("h_blob");
+
+    if (n == sizeof(g_hist)) {
+      g_prefs.getBytes("h_blob", g_hist, sizeof(g_hist));
+    } else {
+      memset(g_hist, 0, sizeof(g_hist));
+      g_histHead = 0;
+      g_histCount = 0;
+    }
+
+    if (g_histHead > 23) g_histHead = 0;
+    if (g_histCount > 24) g_histCount = 24;
+
+    bool ok = true;
+    for (uint8_t i = 0; i < 24 && ok; i++) ok = jrnl_put(JK_HIST0 + i, &g_hist[i], sizeof(HistPoint));
+    m.head  = g_histHead;
+    m.count = g_histCount;
+    // NVS só sai depois que o journal confirmou na flash: queda antes disso
+    // (pontos ainda só na RAM do journal) refaz a importação no próximo boot
+    if (ok && jrnl_put(JK_HIST_META, &m, sizeof(m)) && jrnl_sync()) {
+      g_prefs.remove("h_head");
+      g_prefs.remove("h_cnt");
+      g_prefs.remove("h_blob");
+    }
+    g_prefs.end();
+  }
+
+  if (g_histHead > 23) g_histHead = 0;
+  if (g_histCount > 24) g_histCount = 24;
+}
+
+void hist24_begin() {
+  if (!g_histMutex) g_histMutex = xSemaphoreCreateMutex();
+  g_histLastStoreMs = 0;
+
+  if (g_histMutex) xSemaphoreTake(g_histMutex, portMAX_DELAY);
+  hist_load();
+  if (g_histMutex) xSemaphoreGive(g_histMutex);
+}
+
+static void hist_add_point(float tempC) {
+  if (g_histMutex) xSemaphoreTake(g_histMutex, portMAX_DELAY);
+
+  HistPoint p;
+  p.ts   = now_epoch_or_zero();
+  p.temp = tempC;
+
+  const uint8_t slot = g_histHead;
+  g_hist[slot] = p;
+  g_histHead = (uint8_t)((g_histHead + 1) % 24);
+  if (g_histCount < 24) g_histCount++;
+
+  HistMeta m;
+  m.head  = g_histHead;
+  m.count = g_histCount;
+
+  if (g_histMutex) xSemaphoreGive(g_histMutex);
+
+  // só RAM: o journal grava em lote na task dele (nada de flash no controle)
+  jrnl_put(JK_HIST0 + slot, &p, sizeof(p));
+  jrnl_put(JK_HIST_META, &m, sizeof(m));
+}
+
+void hist24_maybe_store(uint32_t nowMs, bool tempValid, float tempC) {
+  if (!tempValid) return;
+
+  if (g_histLastStoreMs == 0) {
+    g_histLastStoreMs = nowMs;
+    hist_add_point(tempC);
+    return;
+  }
+
+  if ((nowMs - g_histLastStoreMs) >= 3600000UL) { // 1h
+    g_histLastStoreMs = nowMs;
+    hist_add_point(tempC);
+  }
+}
+
+uint8_t hist24_copy(HistPoint out[24]) {
+  // copia snapshot do ring com mutex (evita race)
+  if (g_histMutex) xSemaphoreTake(g_histMutex, portMAX_DELAY);
+
+  const uint8_t n = g_histCount;
+  const uint8_t start = (g_histCount < 24) ? 0 : g_histHead;
+  for (uint8_t i = 0; i < n; i++) {
+    out[i] = g_hist[(start + i) % 24];
+  }
+
+  if (g_histMutex) xSemaphoreGive(g_histMutex);
+  return n;
+}
+
+void hist24_publish_all() {
+  HistPoint ordered[24];
+  const uint8_t n = hist24_copy(ordered);
+
+  const uint8_t CHUNK_SZ = 8;
+  uint8_t total = (n + CHUNK_SZ - 1) / CHUNK_SZ;
+  if (total == 0) total = 1;
+
+  for (uint8_t seq = 0; seq < total; seq++) {
+    char out[384];
+    uint8_t from = seq * CHUNK_SZ;
+    uint8_t to   = min<uint8_t>(n, from + CHUNK_SZ);
+    const size_t len = msg_hist_json(out, sizeof(out), seq, total, ordered + from, to - from);
+    if (len) mqtt_publish_hist(out, len, false);
+
+    vTaskDelay(pdMS_TO_TICKS(30)); // evita burst muito rápido
+  }
+}
@@ -0,0 +1,151 @@
+#include "hist_codec.h"
+
+#include <string.h>
+
+// ---------------- bits ----------------
+static void put_bits(HcWriter& w, uint32_t v, uint8_t n) {
+  while (n) {
+    const size_t  byte = w.bits >> 3;
+    const uint8_t room = 8 - (w.bits & 7);
+    const uint8_t take = (n < room) ? n : room;
+    const uint8_t chunk = (uint8_t)((v >> (n - take)) & ((1u << take) - 1));
+    w.buf[byte] |= (uint8_t)(chunk << (room - take));
+    w.bits += take;
+    n -= take;
+  }
+}
+
+static bool get_bits(HcReader& r, uint8_t n, uint32_t& out) {
+  if (r.bit + n > r.len * 8) return false;
+  uint32_t v = 0;
+  while (n) {
+    const uint8_t cur  = r.buf[r.bit >> 3];
+    const uint8_t room = 8 - (r.bit & 7);
+    const uint8_t take = (n < room) ? n : room;
+    v = (v << take) | ((cur >> (room - take)) & ((1u << take) - 1));
+    r.bit += take;
+    n -= take;
+  }
+  out = v;
+  return true;
+}
+
+static uint32_t zigzag(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+static int32_t  unzigzag(uint32_t z) { return (int32_t)(z >> 1) ^ -(int32_t)(z & 1); }
+
+static void put_val(HcWriter& w, int32_t v) {
+  const uint32_t z = zigzag(v);
+  if (z == 0)            { put_bits(w, 0x0, 1); }
+  else if (z < (1u << 4))  { put_bits(w, 0x2, 2); put_bits(w, z, 4); }
+  else if (z < (1u << 8))  { put_bits(w, 0x6, 3); put_bits(w, z, 8); }
+  else if (z < (1u << 16)) { put_bits(w, 0xE, 4); put_bits(w, z, 16); }
+  else                     { put_bits(w, 0xF, 4); put_bits(w, z, 32); }
+}
+
+static bool get_val(HcReader& r, int32_t& v) {
+  // prefixo: até 4 bits '1' seguidos de '0'
+  uint8_t ones = 0;
+  uint32_t b;
+  while (ones < 4) {
+    if (!get_bits(r, 1, b)) return false;
+    if (!b) break;
+    ones++;
+  }
+  static const uint8_t WIDTH[5] = { 0, 4, 8, 16, 32 };
+  uint32_t z = 0;
+  if (WIDTH[ones] && !get_bits(r, WIDTH[ones], z)) return false;
+  v = unzigzag(z);
+  return true;
+}
+
+// ---------------- linhas ----------------
+void hc_state_reset(HcState& s) {
+  memset(&s, 0, sizeof(s));
+}
+
+void hc_writer_init(HcWriter& w, uint8_t* buf, size_t cap) {
+  w.buf  = buf;
+  w.cap  = cap;
+  w.bits = 0;
+  memset(buf, 0, cap);
+}
+
+size_t hc_writer_bytes(const HcWriter& w) {
+  return (w.bits + 7) >> 3;
+}
+
+bool hc_put_row(HcWriter& w, HcState& s, const HcRow& r) {
+  if (w.bits + HC_ROW_MAX_BITS > w.cap * 8) return false;
+
+  // aritmética mod 2^32 dos dois lados: round-trip exato mesmo com overflow
+  const int32_t dts = (int32_t)(r.ts - s.ts);
+  put_val(w, (int32_t)((uint32_t)dts - (uint32_t)s.dts));
+  s.dts = dts;
+  s.ts  = r.ts;
+
+  for (int i = 0; i < HC_FIELDS; i++) {
+    put_val(w, (int32_t)((uint32_t)r.v[i] - (uint32_t)s.v[i]));
+    s.v[i] = r.v[i];
+  }
+  return true;
+}
+
+void hc_reader_init(HcReader& r, const uint8_t* buf, size_t len) {
+  r.buf = buf;
+  r.len = len;
+  r.bit = 0;
+}
+
+bool hc_get_row(HcReader& r, HcState& s, HcRow& out) {
+  int32_t dod;
+  if (!get_val(r, dod)) return false;
+
+  HcState n = s;
+  n.dts = (int32_t)((uint32_t)s.dts + (uint32_t)dod);
+  n.ts  = s.ts + (uint32_t)n.dts;
+
+  for (int i = 0; i < HC_FIELDS; i++) {
+    int32_t d;
+    if (!get_val(r, d)) return false;
+    n.v[i] = (int32_t)((uint32_t)s.v[i] + (uint32_t)d);
+  }
+
+  s = n;
+  out.ts = n.ts;
+  memcpy(out.v, n.v, sizeof(out.v));
+  return true;
+}
+
+// ---------------- bloco ----------------
+bool hc_block_begin(HcBlock& b, uint8_t* buf, size_t cap, uint8_t tier, uint16_t seq, uint8_t qid) {
+  if (cap < HC_BLOCK_HDR + HC_ROW_MAX_BYTES) return false;
+
+  memset(buf, 0, HC_BLOCK_HDR);
+  buf[0] = 'H';
+  buf[1] = 'C';
+  buf[2] = HC_VER;
+  buf[3] = tier;
+  buf[4] = (uint8_t)(seq & 0xFF);
+  buf[5] = (uint8_t)(seq >> 8);
+  buf[7] = qid;
+
+  hc_writer_init(b.w, buf + HC_BLOCK_HDR, cap - HC_BLOCK_HDR);
+  hc_state_reset(b.st);
+  b.count = 0;
+  return true;
+}
+
+bool hc_block_add(HcBlock& b, const HcRow& r) {
+  if (b.count == 0xFFFF) return false;
+  if (!hc_put_row(b.w, b.st, r)) return false;
+  b.count++;
+  return true;
+}
+
+size_t hc_block_end(HcBlock& b, uint8_t flags) {
+  uint8_t* hdr = b.w.buf - HC_BLOCK_HDR;
+  hdr[6] = flags;
+  hdr[8] = (uint8_t)(b.count & 0xFF);
+  hdr[9] = (uint8_t)(b.count >> 8);
+  return HC_BLOCK_HDR + hc_writer_bytes(b.w);
+}
@@ -0,0 +1,365 @@
+#include "hist_query.h"
+
+#include <string.h>
+#include <stdio.h>
+
+#include "config.h"
+#include "tsdb.h"
+#include "hist_codec.h"
+#include "mqtt_link.h"
+#include "log_mirror.h"
+
+static const uint32_t TIER_PERIOD[TSDB_TIERS] = { 60, 3600, 86400 };
+static const char*    TIER_NAME[TSDB_TIERS]   = { "min", "hour", "day" };
+
+enum HqAgg : uint8_t { AGG_AVG = 0, AGG_MIN, AGG_MAX, AGG_ALL };
+static const char* AGG_NAME[] = { "avg", "min", "max", "all" };
+
+// JSON: maior ponto ("all" com tudo negativo) e fechamento do chunk
+static const size_t POINT_MAX = 80;
+static const size_t JSON_TAIL = 48;
+
+// Bucket em agregação (somas ponderadas pelo nº de amostras, como no tsdb)
+struct HqAcc {
+  uint32_t ts;        // início do bucket
+  uint32_t n, nT;
+  int32_t  tMin, tMax, spMin, spMax, uMin, uMax;
+  int64_t  tSum, spSum, uSum, onSum;
+};
+
+struct HqState {
+  bool     active;
+  HistQueryArgs a;    // to/step já normalizados
+  uint8_t  agg;
+  uint8_t  tier;
+
+  // fonte
+  TsdbCursor cur;
+  bool     hasPend;   // registro lido que ainda não entrou em bucket
+  TsdbRec  pend;
+  bool     srcDone;
+  bool     hasAcc;
+  HqAcc    acc;
+  uint32_t resumeTs;  // 1º bucket ainda não emitido
+
+  // chunks
+  uint32_t seq;       // em construção
+  uint32_t minSeq;    // 1º seq desta consulta
+  uint32_t ackNext;   // 1º seq sem hist_ack
+  uint32_t start[HISTQ_WINDOW_MAX];   // resumeTs no início de cada chunk
+
+  uint16_t rows;
+  size_t   len;
+  bool     ready;
+  bool     last;
+  HcBlock  blk;
+
+  uint32_t lastActMs;
+  uint32_t lastPubMs;
+};
+
+static HqState g;
+static uint8_t g_out[HISTQ_CHUNK_BYTES];
+
+static_assert(HISTQ_CHUNK_BYTES >= HC_BLOCK_HDR + HC_ROW_MAX_BYTES, "HISTQ_CHUNK_BYTES pequeno p/ bloco bin");
+static_assert(HISTQ_CHUNK_BYTES >= 128 + POINT_MAX + JSON_TAIL, "HISTQ_CHUNK_BYTES pequeno p/ JSON");
+
+// ---------------- agregação ----------------
+static int32_t avg_round(int64_t sum, uint32_t n) {
+  if (!n) return 0;
+  return (int32_t)((sum >= 0) ? (sum + n / 2) / (int64_t)n : (sum - n / 2) / (int64_t)n);
+}
+
+static void acc_reset(HqAcc& x, uint32_t ts) {
+  memset(&x, 0, sizeof(x));
+  x.ts = ts;
+}
+
+static void acc_add(HqAcc& x, const TsdbRec& r) {
+  if (r.nT) {
+    if (!x.nT || r.tMin < x.tMin) x.tMin = r.tMin;
+    if (!x.nT || r.tMax > x.tMax) x.tMax = r.tMax;
+    x.tSum += (int64_t)r.tAvg * r.nT;
+    x.nT   += r.nT;
+  }
+  if (!x.n || r.spMin < x.spMin) x.spMin = r.spMin;
+  if (!x.n || r.spMax > x.spMax) x.spMax = r.spMax;
+  if (!x.n || r.uMin  < x.uMin)  x.uMin  = r.uMin;
+  if (!x.n || r.uMax  > x.uMax)  x.uMax  = r.uMax;
+  x.spSum += (int64_t)r.spAvg * r.n;
+  x.uSum  += (int64_t)r.uAvg  * r.n;
+  x.onSum += (int64_t)r.onPct * r.n;
+  x.n     += r.n;
+}
+
+static void acc_to_rec(const HqAcc& x, uint8_t tier, TsdbRec& r) {
+  memset(&r, 0, sizeof(r));
+  r.ts    = x.ts;
+  r.n     = x.n;
+  r.nT    = x.nT;
+  r.tMin  = (int16_t)x.tMin;   r.tAvg  = (int16_t)avg_round(x.tSum, x.nT);   r.tMax  = (int16_t)x.tMax;
+  r.spMin = (int16_t)x.spMin;  r.spAvg = (int16_t)avg_round(x.spSum, x.n);   r.spMax = (int16_t)x.spMax;
+  r.uMin  = (uint16_t)x.uMin;  r.uAvg  = (uint16_t)avg_round(x.uSum, x.n);   r.uMax  = (uint16_t)x.uMax;
+  r.onPct = (uint8_t)avg_round(x.onSum, x.n);
+  r.tier  = tier;
+}
+
+// ---------------- chunk ----------------
+static void chunk_begin() {
+  g.rows  = 0;
+  g.ready = false;
+  g.last  = false;
+  g.start[g.seq % HISTQ_WINDOW_MAX] = g.hasAcc ? g.acc.ts : g.resumeTs;
+
+  if (g.a.bin) {
+    hc_block_begin(g.blk, g_out, sizeof(g_out), g.tier, (uint16_t)g.seq, (uint8_t)g.a.qid);
+    return;
+  }
+  const int n = snprintf((char*)g_out, sizeof(g_out),
+                         "{\"qid\":%lu,\"seq\":%lu,\"tier\":\"%s\",\"step\":%lu,\"agg\":\"%s\",\"p\":[",
+                         (unsigned long)g.a.qid, (unsigned long)g.seq, TIER_NAME[g.tier],
+                         (unsigned long)g.a.step, AGG_NAME[g.agg]);
+  g.len = (n > 0) ? (size_t)n : 0;
+}
+
+static int fmt_c(char* out, size_t n, bool valid, int32_t centi) {
+  if (!valid) return snprintf(out, n, "null");
+  return snprintf(out, n, "%.2f", centi / 100.0f);
+}
+
+// false = chunk cheio (nada escrito)
+static bool chunk_put(const HqAcc& x) {
+  TsdbRec r;
+  acc_to_rec(x, g.tier, r);
+
+  if (g.a.bin) {
+    HcRow row;
+    tsdb_to_row(r, row);
+    if (!hc_block_add(g.blk, row)) return false;
+    g.rows++;
+    return true;
+  }
+
+  if (g.len + POINT_MAX + JSON_TAIL > sizeof(g_out)) return false;
+
+  char* p = (char*)g_out + g.len;
+  const char* end = (const char*)g_out + sizeof(g_out) - JSON_TAIL;
+  const bool tv = (r.nT != 0);
+
+  p += snprintf(p, end - p, "%s[%lu,", g.rows ? "," : "", (unsigned long)r.ts);
+  switch (g.agg) {
+    case AGG_MIN:
+      p += fmt_c(p, end - p, tv, r.tMin);
+      p += snprintf(p, end - p, ",%.2f,%.2f]", r.spMin / 100.0f, r.uMin / 100.0f);
+      break;
+    case AGG_MAX:
+      p += fmt_c(p, end - p, tv, r.tMax);
+      p += snprintf(p, end - p, ",%.2f,%.2f]", r.spMax / 100.0f, r.uMax / 100.0f);
+      break;
+    case AGG_ALL:
+      p += fmt_c(p, end - p, tv, r.tMin);  *p++ = ',';
+      p += fmt_c(p, end - p, tv, r.tAvg);  *p++ = ',';
+      p += fmt_c(p, end - p, tv, r.tMax);
+      p += snprintf(p, end - p, ",%.2f,%.2f,%u]", r.spAvg / 100.0f, r.uAvg / 100.0f, (unsigned)r.onPct);
+      break;
+    default:
+      p += fmt_c(p, end - p, tv, r.tAvg);
+      p += snprintf(p, end - p, ",%.2f,%.2f]", r.spAvg / 100.0f, r.uAvg / 100.0f);
+      break;
+  }
+
+  g.len = p - (char*)g_out;
+  g.rows++;
+  return true;
+}
+
+static void chunk_finish(bool last) {
+  g.last  = last;
+  g.ready = true;
+
+  if (g.a.bin) {
+    g.len = hc_block_end(g.blk, last ? HC_FLAG_LAST : 0);
+    return;
+  }
+  const uint32_t next = g.hasAcc ? g.acc.ts : g.resumeTs;
+  const int n = snprintf((char*)g_out + g.len, sizeof(g_out) - g.len, "],\"next\":%lu,\"last\":%s}",
+                         (unsigned long)next, last ? "true" : "false");
+  if (n > 0) g.len += n;
+}
+
+// Emite o bucket acumulado; false = chunk cheio (bucket continua pendente)
+static bool flush_acc() {
+  if (!chunk_put(g.acc)) return false;
+  g.resumeTs = g.acc.ts + g.a.step;
+  g.hasAcc = false;
+  return true;
+}
+
+// Lê até HISTQ_SCAN_MAX registros; fecha o chunk se encheu ou a fonte acabou
+static void scan() {
+  for (uint16_t i = 0; i < HISTQ_SCAN_MAX; ) {
+    if (!g.hasPend && !g.srcDone) {
+      if (!tsdb_next(g.cur, g.pend) || g.pend.ts >= g.a.to) {
+        g.srcDone = true;
+      } else {
+        i++;
+        // sem NTP (ts 0) não tem lugar no intervalo
+        if (!g.pend.ts || g.pend.ts < g.a.from || !g.pend.n) continue;
+        g.hasPend = true;
+      }
+    }
+
+    if (g.srcDone) {
+      if (g.hasAcc && !flush_acc()) { chunk_finish(false); return; }
+      chunk_finish(true);
+      return;
+    }
+
+    // buckets alinhados ao epoch (step 3600 = horas cheias)
+    const uint32_t b = g.pend.ts - g.pend.ts % g.a.step;
+    if (g.hasAcc && b != g.acc.ts && !flush_acc()) { chunk_finish(false); return; }
+    if (!g.hasAcc) {
+      acc_reset(g.acc, b);
+      g.hasAcc = true;
+    }
+    acc_add(g.acc, g.pend);
+    g.hasPend = false;
+  }
+}
+
+// Posiciona a fonte no início do chunk 'seq' (precisa estar em g.start)
+static void rewind_to(uint32_t seq) {
+  const uint32_t ts = g.start[seq % HISTQ_WINDOW_MAX];
+  tsdb_seek(g.cur, (TsdbTier)g.tier, ts);
+  g.hasPend  = false;
+  g.hasAcc   = false;
+  g.srcDone  = false;
+  g.resumeTs = ts;
+  g.seq      = seq;
+  if (g.ackNext > seq) g.ackNext = seq;
+  chunk_begin();
+}
+
+// Nível mais grosso que ainda cabe em 'step', preferindo o mais fino que
+// alcança 'from' (anéis finos guardam menos tempo)
+static uint8_t pick_tier(uint32_t from, uint32_t step) {
+  uint8_t best = TSDB_MIN;
+  for (uint8_t t = 0; t < TSDB_TIERS && TIER_PERIOD[t] <= step; t++) {
+    best = t;
+    TsdbCursor c;
+    TsdbRec r;
+    if (tsdb_seek(c, (TsdbTier)t, 0) && tsdb_next(c, r) && r.ts && r.ts <= from) return t;
+  }
+  return best;
+}
+
+static bool set_err(char* err, size_t n, const char* msg) {
+  if (err && n) strlcpy(err, msg, n);
+  return false;
+}
+
+// ---------------- API ----------------
+bool hist_query_start(const HistQueryArgs& in, char* err, size_t errLen) {
+  const uint32_t now = millis();
+
+  // retomada da consulta ativa
+  if (g.active && in.hasSeq && in.qid == g.a.qid) {
+    if (in.seq < g.minSeq || in.seq > g.seq || g.seq - in.seq >= HISTQ_WINDOW_MAX) {
+      return set_err(err, errLen, "seq fora da janela");
+    }
+    rewind_to(in.seq);
+    g.lastActMs = now;
+    log_mirror_printf(LOG_I, "[HISTQ] qid=%lu retoma seq=%lu", (unsigned long)g.a.qid, (unsigned long)in.seq);
+    return true;
+  }
+
+  if (g.active && in.qid != g.a.qid && (now - g.lastActMs) <= HISTQ_IDLE_MS) {
+    return set_err(err, errLen, "consulta em andamento");
+  }
+
+  HistQueryArgs a = in;
+  if (!a.to)   a.to = 0xFFFFFFFFu;
+  if (a.step < 60) a.step = 60;
+  if (a.from >= a.to) return set_err(err, errLen, "intervalo invalido");
+  if (a.win > HISTQ_WINDOW_MAX) a.win = HISTQ_WINDOW_MAX;
+
+  uint8_t agg = 0xFF;
+  if (!a.agg[0]) agg = AGG_AVG;
+  for (uint8_t i = 0; i < sizeof(AGG_NAME) / sizeof(AGG_NAME[0]) && agg == 0xFF; i++) {
+    if (strcmp(a.agg, AGG_NAME[i]) == 0) agg = i;
+  }
+  if (agg == 0xFF) return set_err(err, errLen, "agg invalido");
+
+  memset(&g, 0, sizeof(g));
+  g.a    = a;
+  g.agg  = agg;
+  g.tier = pick_tier(a.from, a.step);
+  if (!tsdb_seek(g.cur, (TsdbTier)g.tier, a.from)) return set_err(err, errLen, "tsdb indisponivel");
+
+  g.resumeTs  = a.from - a.from % a.step;
+  g.seq       = a.hasSeq ? a.seq : 0;
+  g.minSeq    = g.seq;
+  g.ackNext   = g.seq;
+  g.lastActMs = now;
+  g.lastPubMs = now - HISTQ_GAP_MS;
+  g.active    = true;
+  chunk_begin();
+
+  log_mirror_printf(LOG_I, "[HISTQ] qid=%lu %lu..%lu step=%lu tier=%s %s win=%u",
+                    (unsigned long)a.qid, (unsigned long)a.from, (unsigned long)a.to,
+                    (unsigned long)a.step, TIER_NAME[g.tier], a.bin ? "bin" : AGG_NAME[agg], (unsigned)a.win);
+  return true;
+}
+
+bool hist_query_ack(uint32_t qid, uint32_t seq) {
+  if (!g.active || qid != g.a.qid) return false;
+  if (seq >= g.ackNext && seq < g.seq) g.ackNext = seq + 1;
+  g.lastActMs = millis();
+  return true;
+}
+
+bool hist_query_cancel(uint32_t qid) {
+  if (!g.active || qid != g.a.qid) return false;
+  g.active = false;
+  log_mirror_printf(LOG_I, "[HISTQ] qid=%lu cancelada no seq=%lu", (unsigned long)qid, (unsigned long)g.seq);
+  return true;
+}
+
+bool hist_query_active() {
+  return g.active;
+}
+
+void hist_query_poll() {
+  if (!g.active) return;
+
+  const uint32_t now = millis();
+  if (now - g.lastActMs > HISTQ_IDLE_MS) {
+    g.active = false;
+    log_mirror_printf(LOG_W, "[HISTQ] qid=%lu expirou no seq=%lu", (unsigned long)g.a.qid, (unsigned long)g.seq);
+    return;
+  }
+  if (!mqtt_is_connected()) return;
+
+  if (!g.ready) {
+    if (g.a.win && g.seq >= g.ackNext + g.a.win) return;           // sem crédito
+    if (!g.a.win && (now - g.lastPubMs) < HISTQ_GAP_MS) return;
+    scan();
+    if (!g.ready) return;    // orçamento de leitura acabou; segue no próximo poll
+  }
+
+  const bool ok = g.a.bin ? mqtt_publish_hist_bin(g_out, g.len)
+                          : mqtt_publish_hist((const char*)g_out, g.len, false);
+  if (!ok) return;           // chunk fica pronto; tenta de novo
+
+  g.lastPubMs = now;
+  if (!g.a.win) g.lastActMs = now;   // sem ack: progresso conta como atividade
+
+  if (g.last) {
+    g.active = false;
+    log_mirror_printf(LOG_I, "[HISTQ] qid=%lu fim, %lu chunks", (unsigned long)g.a.qid,
+                      (unsigned long)(g.seq - g.minSeq + 1));
+    return;
+  }
+  g.seq++;
+  chunk_begin();
+}
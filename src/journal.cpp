@@ -0,0 +1,405 @@
+#include "journal.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <esp_partition.h>
+#include <esp32/rom/crc.h>
+
+#include "config.h"
+
+// ---- Layout ----
+// JRNL_SECTORS setores logo após os do TSDB; cada setor:
+//   header (16 B) | registros...
+// registro = len u8 | key u8 | dados (len) | crc32 u32 (len+key+dados)
+// len 0xFF = flash apagada (fim do setor). Registro corrompido (queda no meio
+// da gravação) é pulado: a leitura ressincroniza no próximo CRC válido e a
+// escrita continua depois do último byte gravado.
+static const uint32_t JRNL_MAGIC = 0x4C4E524A;   // "JRNL"
+static const uint8_t  JRNL_VER   = 1;
+static const uint16_t HDR_SIZE   = 16;
+static const uint16_t REC_OVH    = 6;
+static const uint16_t REC_MAX    = REC_OVH + JRNL_VAL_MAX;
+static const uint32_t FIRST_SECT = TSDB_SECT_MIN + TSDB_SECT_HOUR + TSDB_SECT_DAY;
+
+static_assert(JRNL_SECTORS >= 3, "journal precisa de 3 setores");
+// compactação: tudo que está vivo num setor cabe num setor vazio
+static_assert((uint32_t)JK_MAX * REC_MAX <= SPI_FLASH_SEC_SIZE - HDR_SIZE, "JK_MAX grande demais");
+
+struct SectHdr {
+  uint32_t magic;
+  uint8_t  ver;
+  uint8_t  rsv[3];
+  uint32_t seq;       // cresce sempre; slot = seq % JRNL_SECTORS
+  uint32_t erases;    // apagamentos deste slot (vida toda)
+};
+
+struct JrnlSlot {
+  bool     has;
+  uint8_t  len;
+  uint32_t addr;      // offset do registro na partição
+};
+
+struct JrnlPend {
+  uint8_t  key;
+  uint8_t  len;
+  uint32_t gen;       // muda a cada put (flush só remove o que gravou)
+  uint8_t  data[JRNL_VAL_MAX];
+};
+
+// --- internos ---
+static const esp_partition_t* g_part = nullptr;
+static uint32_t          g_base = 0;
+static uint32_t          g_headSeq = 0;
+static uint16_t          g_headOff = 0;
+static uint32_t          g_wear[JRNL_SECTORS];
+static JrnlSlot          g_idx[JK_MAX];           // g_lock
+static SemaphoreHandle_t g_lock = nullptr;        // flash + índice
+static TaskHandle_t      g_task = nullptr;
+static JrnlStats         g_stats;
+
+static JrnlPend          g_pend[JRNL_PENDING];    // g_pendMux
+static uint8_t           g_nPend = 0;
+static uint32_t          g_gen = 0;
+static portMUX_TYPE      g_pendMux = portMUX_INITIALIZER_UNLOCKED;
+
+static uint32_t sect_addr(uint32_t seq) {
+  return g_base + (seq % JRNL_SECTORS) * SPI_FLASH_SEC_SIZE;
+}
+
+static uint32_t ring_first_seq() {
+  return (g_headSeq >= JRNL_SECTORS - 1) ? g_headSeq - (JRNL_SECTORS - 1) : 0;
+}
+
+static bool hdr_read(uint32_t slot, SectHdr& h) {
+  if (esp_partition_read(g_part, g_base + slot * SPI_FLASH_SEC_SIZE, &h, sizeof(h)) != ESP_OK) return false;
+  return h.magic == JRNL_MAGIC && h.ver == JRNL_VER && (h.seq % JRNL_SECTORS) == slot;
+}
+
+static void wear_update() {
+  g_stats.wearMin = g_stats.wearMax = g_wear[0];
+  for (int s = 1; s < JRNL_SECTORS; s++) {
+    if (g_wear[s] < g_stats.wearMin) g_stats.wearMin = g_wear[s];
+    if (g_wear[s] > g_stats.wearMax) g_stats.wearMax = g_wear[s];
+  }
+}
+
+// ---------------- setores ----------------
+static bool sect_start(uint32_t seq) {
+  const uint32_t slot = seq % JRNL_SECTORS;
+  const uint32_t addr = sect_addr(seq);
+  if (esp_partition_erase_range(g_part, addr, SPI_FLASH_SEC_SIZE) != ESP_OK) return false;
+  g_wear[slot]++;
+  g_stats.erases++;
+  wear_update();
+
+  SectHdr h;
+  memset(&h, 0xFF, sizeof(h));
+  h.magic  = JRNL_MAGIC;
+  h.ver    = JRNL_VER;
+  h.seq    = seq;
+  h.erases = g_wear[slot];
+  if (esp_partition_write(g_part, addr, &h, sizeof(h)) != ESP_OK) return false;
+
+  g_headSeq = seq;
+  g_headOff = HDR_SIZE;
+  g_stats.flashBytes += HDR_SIZE;
+  g_stats.headSeq = seq;
+  return true;
+}
+
+static bool rec_write(uint8_t key, const uint8_t* data, uint8_t len) {
+  uint8_t rec[REC_MAX];
+  rec[0] = len;
+  rec[1] = key;
+  memcpy(rec + 2, data, len);
+  const uint32_t crc = crc32_le(0, rec, 2 + len);
+  memcpy(rec + 2 + len, &crc, sizeof(crc));
+  const uint16_t size = REC_OVH + len;
+
+  const uint32_t addr = sect_addr(g_headSeq) + g_headOff;
+  if (esp_partition_write(g_part, addr, rec, size) != ESP_OK) {
+    g_headOff = SPI_FLASH_SEC_SIZE;   // próximo registro abre outro setor
+    return false;
+  }
+
+  g_idx[key].has  = true;
+  g_idx[key].len  = len;
+  g_idx[key].addr = addr;
+  g_headOff += size;
+  g_stats.records++;
+  g_stats.flashBytes += size;
+  return true;
+}
+
+// Copia p/ o head o que ainda está vivo no setor 'seq'
+static void sect_compact(uint32_t seq) {
+  const uint32_t lo = sect_addr(seq);
+  const uint32_t hi = lo + SPI_FLASH_SEC_SIZE;
+  for (uint16_t k = 0; k < JK_MAX; k++) {
+    JrnlSlot& s = g_idx[k];
+    if (!s.has || s.addr < lo || s.addr >= hi) continue;
+
+    uint8_t data[JRNL_VAL_MAX];
+    if (esp_partition_read(g_part, s.addr + 2, data, s.len) != ESP_OK) continue;
+    // cabe: o head acabou de abrir (ou, no boot, só tem cópias deste setor)
+    if (g_headOff + REC_OVH + s.len > SPI_FLASH_SEC_SIZE) break;
+    if (rec_write((uint8_t)k, data, s.len)) g_stats.relocated++;
+  }
+}
+
+// O setor mais antigo é o próximo a ser apagado: esvazia já
+static void compact_oldest() {
+  if (g_headSeq + 1 >= JRNL_SECTORS) sect_compact(g_headSeq + 1 - JRNL_SECTORS);
+}
+
+static bool ring_advance() {
+  if (!sect_start(g_headSeq + 1)) return false;
+  compact_oldest();
+  return true;
+}
+
+static bool rec_append(uint8_t key, const uint8_t* data, uint8_t len) {
+  if (g_headOff + REC_OVH + len > SPI_FLASH_SEC_SIZE && !ring_advance()) return false;
+  return rec_write(key, data, len);
+}
+
+// 1º byte depois do último byte gravado (!= 0xFF) do setor. Não é o fim
+// do último registro (o crc32_le pode terminar em 0xFF): só p/ passar de
+// um registro corrompido
+static uint16_t sect_tail(uint32_t seq) {
+  const uint32_t addr = sect_addr(seq);
+  uint8_t buf[64];
+  for (uint16_t end = SPI_FLASH_SEC_SIZE; end > HDR_SIZE; end -= sizeof(buf)) {
+    if (esp_partition_read(g_part, addr + end - sizeof(buf), buf, sizeof(buf)) != ESP_OK) return SPI_FLASH_SEC_SIZE;
+    for (int i = sizeof(buf) - 1; i >= 0; i--) {
+      if (buf[i] == 0xFF) continue;
+      const uint16_t tail = (uint16_t)(end - sizeof(buf) + i + 1);
+      return (tail < HDR_SIZE) ? HDR_SIZE : tail;
+    }
+  }
+  return HDR_SIZE;
+}
+
+// Registro íntegro em 'off' que termina até 'limit'
+static bool rec_parse(uint32_t addr, uint16_t off, uint16_t limit, uint8_t& key, uint8_t& len) {
+  if (off + REC_OVH > limit) return false;
+  uint8_t rec[REC_MAX];
+  if (esp_partition_read(g_part, addr + off, rec, 2) != ESP_OK) return false;
+  len = rec[0];
+  key = rec[1];
+  if (len > JRNL_VAL_MAX || key >= JK_MAX || off + REC_OVH + len > limit) return false;
+  if (esp_partition_read(g_part, addr + off + 2, rec + 2, len + 4) != ESP_OK) return false;
+
+  uint32_t crc;
+  memcpy(&crc, rec + 2 + len, sizeof(crc));
+  return crc == crc32_le(0, rec, 2 + len);
+}
+
+// Lê os registros do setor p/ o índice; devolve onde a escrita continua.
+// Anda pelos len até len 0xFF (como o frame_read do tsdb); num registro
+// corrompido procura o próximo íntegro antes do último byte gravado.
+static uint16_t sect_replay(uint32_t seq) {
+  const uint32_t addr = sect_addr(seq);
+  uint16_t off = HDR_SIZE;
+  while (off < SPI_FLASH_SEC_SIZE) {
+    uint8_t key, len;
+    if (esp_partition_read(g_part, addr + off, &len, 1) != ESP_OK) return SPI_FLASH_SEC_SIZE;
+    if (len == 0xFF) return off;
+    if (rec_parse(addr, off, SPI_FLASH_SEC_SIZE, key, len)) {
+      g_idx[key].has  = true;
+      g_idx[key].len  = len;
+      g_idx[key].addr = addr + off;
+      off += REC_OVH + len;
+      continue;
+    }
+    g_stats.crcErrors++;
+    const uint16_t tail = sect_tail(seq);
+    do { off++; } while (off < tail && !rec_parse(addr, off, SPI_FLASH_SEC_SIZE, key, len));
+    if (off >= tail) return tail;
+  }
+  return SPI_FLASH_SEC_SIZE;
+}
+
+static void ring_recover() {
+  bool found = false;
+  uint32_t best = 0;
+  for (uint32_t s = 0; s < JRNL_SECTORS; s++) {
+    SectHdr h;
+    if (!hdr_read(s, h)) { g_wear[s] = 0; continue; }
+    g_wear[s] = h.erases;
+    if (!found || h.seq > best) { best = h.seq; found = true; }
+  }
+  wear_update();
+
+  memset(g_idx, 0, sizeof(g_idx));
+  if (!found) {
+    sect_start(0);
+    return;
+  }
+
+  g_headSeq = best;
+  g_stats.headSeq = best;
+  for (uint32_t seq = ring_first_seq(); seq <= best; seq++) {
+    SectHdr h;
+    if (!hdr_read(seq % JRNL_SECTORS, h) || h.seq != seq) continue;
+    const uint16_t off = sect_replay(seq);
+    if (seq == best) g_headOff = off;
+  }
+
+  // queda no meio de uma compactação: termina agora
+  compact_oldest();
+}
+
+// ---------------- lote ----------------
+// true se tudo que estava pendente na cópia foi gravado
+static bool flush_pending() {
+  JrnlPend batch[JRNL_PENDING];
+  uint8_t n;
+
+  portENTER_CRITICAL(&g_pendMux);
+  n = g_nPend;
+  memcpy(batch, g_pend, n * sizeof(JrnlPend));
+  portEXIT_CRITICAL(&g_pendMux);
+  if (!n) return true;
+
+  bool done[JRNL_PENDING];
+  bool all = true;
+  xSemaphoreTake(g_lock, portMAX_DELAY);
+  for (uint8_t i = 0; i < n; i++) {
+    done[i] = rec_append(batch[i].key, batch[i].data, batch[i].len);
+    all = all && done[i];
+  }
+  xSemaphoreGive(g_lock);
+
+  // tira da fila só o que foi gravado e não mudou desde a cópia
+  portENTER_CRITICAL(&g_pendMux);
+  for (uint8_t i = 0; i < n; i++) {
+    if (!done[i]) continue;
+    for (uint8_t j = 0; j < g_nPend; j++) {
+      if (g_pend[j].key != batch[i].key) continue;
+      if (g_pend[j].gen == batch[i].gen) g_pend[j] = g_pend[--g_nPend];
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&g_pendMux);
+  return all;
+}
+
+static void jrnl_task(void* pv) {
+  (void)pv;
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(JRNL_FLUSH_MS));
+    flush_pending();
+  }
+}
+
+// ---------------- API ----------------
+bool jrnl_begin() {
+  g_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_SPIFFS, TSDB_PARTITION);
+  if (!g_part) {
+    Serial.println("[JRNL] particao nao encontrada");
+    return false;
+  }
+
+  g_base = FIRST_SECT * SPI_FLASH_SEC_SIZE;
+  if (g_base + JRNL_SECTORS * SPI_FLASH_SEC_SIZE > g_part->size) {
+    Serial.println("[JRNL] setores nao cabem na particao");
+    g_part = nullptr;
+    return false;
+  }
+
+  // boot de verdade já começa zerado; o SIL refaz o begin depois da "queda"
+  memset(&g_stats, 0, sizeof(g_stats));
+  g_nPend = 0;
+  g_lock = xSemaphoreCreateMutex();
+  if (!g_lock) {
+    g_part = nullptr;
+    return false;
+  }
+
+  ring_recover();
+
+  uint16_t live = 0;
+  for (uint16_t k = 0; k < JK_MAX; k++) if (g_idx[k].has) live++;
+  g_stats.live = live;
+  Serial.printf("[JRNL] head=%u/%u chaves=%u wear=%u..%u\n", (unsigned)g_headSeq, (unsigned)g_headOff,
+                (unsigned)live, (unsigned)g_stats.wearMin, (unsigned)g_stats.wearMax);
+
+  xTaskCreatePinnedToCore(jrnl_task, "jrnl", 4096, nullptr, 1, &g_task, 0);
+  return true;
+}
+
+bool jrnl_get(uint8_t key, void* out, size_t len) {
+  if (!g_part || key >= JK_MAX || len > JRNL_VAL_MAX) return false;
+
+  bool hit = false, ok = false;
+  portENTER_CRITICAL(&g_pendMux);
+  for (uint8_t i = 0; i < g_nPend; i++) {
+    if (g_pend[i].key != key) continue;
+    hit = true;
+    ok = (g_pend[i].len == len);
+    if (ok) memcpy(out, g_pend[i].data, len);
+    break;
+  }
+  portEXIT_CRITICAL(&g_pendMux);
+  if (hit) return ok;
+
+  xSemaphoreTake(g_lock, portMAX_DELAY);
+  const JrnlSlot s = g_idx[key];
+  ok = s.has && s.len == len && esp_partition_read(g_part, s.addr + 2, out, len) == ESP_OK;
+  xSemaphoreGive(g_lock);
+  return ok;
+}
+
+bool jrnl_put(uint8_t key, const void* data, size_t len) {
+  if (!g_part || key >= JK_MAX || len > JRNL_VAL_MAX) return false;
+
+  bool ok = true, full = false;
+  portENTER_CRITICAL(&g_pendMux);
+  uint8_t i = 0;
+  while (i < g_nPend && g_pend[i].key != key) i++;
+  if (i < g_nPend) {
+    g_stats.coalesced++;
+  } else if (g_nPend < JRNL_PENDING) {
+    g_nPend++;
+  } else {
+    ok = false;
+    g_stats.dropped++;
+  }
+  if (ok) {
+    g_pend[i].key = key;
+    g_pend[i].len = (uint8_t)len;
+    g_pend[i].gen = ++g_gen;
+    memcpy(g_pend[i].data, data, len);
+    g_stats.puts++;
+    g_stats.userBytes += len;
+  }
+  full = (g_nPend >= JRNL_PENDING * 3 / 4);
+  portEXIT_CRITICAL(&g_pendMux);
+
+  if (full) jrnl_flush();
+  return ok;
+}
+
+void jrnl_flush() {
+  if (g_task) xTaskNotifyGive(g_task);
+}
+
+bool jrnl_sync() {
+  if (!g_part) return false;
+  return flush_pending();
+}
+
+void jrnl_get_stats(JrnlStats& out) {
+  if (!g_lock) {
+    memset(&out, 0, sizeof(out));
+    return;
+  }
+  xSemaphoreTake(g_lock, portMAX_DELAY);
+  uint16_t live = 0;
+  for (uint16_t k = 0; k < JK_MAX; k++) if (g_idx[k].has) live++;
+  g_stats.live = live;
+  out = g_stats;
+  xSemaphoreGive(g_lock);
+}
@@ -0,0 +1,268 @@
+#include "json_out.h"
+
+#include <math.h>
+#include <string.h>
+
+static const uint32_t POW10[] = {
+  1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000,
+};
+
+JsonOut::JsonOut(char* buf, size_t cap)
+    : _buf(buf), _cap(cap), _n(0), _over(cap == 0), _depth(0), _empty(0) {
+  if (cap) buf[0] = '\0';
+}
+
+void JsonOut::put(char c) {
+  if (_n + 1 >= _cap) { _over = true; return; }
+  _buf[_n++] = c;
+  _buf[_n] = '\0';
+}
+
+void JsonOut::put(const char* s, size_t n) {
+  if (_n + n >= _cap) { _over = true; return; }
+  memcpy(_buf + _n, s, n);
+  _n += n;
+  _buf[_n] = '\0';
+}
+
+// vírgula entre itens + "key":
+void JsonOut::sep(const char* key) {
+  if (_depth) {
+    const uint8_t bit = (uint8_t)(1u << (_depth - 1));
+    if (_empty & bit) _empty &= (uint8_t)~bit;
+    else              put(',');
+  }
+  if (key) {
+    put('"');
+    put(key, strlen(key));
+    put("\":", 2);
+  }
+}
+
+void JsonOut::uint_dec(uint32_t v) {
+  char tmp[10];
+  uint8_t k = 0;
+  do { tmp[k++] = (char)('0' + v % 10); v /= 10; } while (v);
+  if (_n + k >= _cap) { _over = true; return; }
+  while (k) _buf[_n++] = tmp[--k];
+  _buf[_n] = '\0';
+}
+
+JsonOut& JsonOut::obj(const char* key) {
+  sep(key);
+  if (_depth >= JSON_OUT_DEPTH) { _over = true; return *this; }
+  put('{');
+  _close[_depth] = '}';
+  _empty |= (uint8_t)(1u << _depth);
+  _depth++;
+  return *this;
+}
+
+JsonOut& JsonOut::arr(const char* key) {
+  sep(key);
+  if (_depth >= JSON_OUT_DEPTH) { _over = true; return *this; }
+  put('[');
+  _close[_depth] = ']';
+  _empty |= (uint8_t)(1u << _depth);
+  _depth++;
+  return *this;
+}
+
+JsonOut& JsonOut::end() {
+  if (!_depth) { _over = true; return *this; }
+  _depth--;
+  put(_close[_depth]);
+  return *this;
+}
+
+JsonOut& JsonOut::s(const char* key, const char* v) {
+  sep(key);
+  put('"');
+  if (v) {
+    static const char HEX[] = "0123456789abcdef";
+    const char* run = v;   // trecho sem escape: copia de uma vez
+    for (; *v; v++) {
+      const uint8_t c = (uint8_t)*v;
+      char e = 0;
+      switch (c) {
+        case '"':  e = '"';  break;
+        case '\\': e = '\\'; break;
+        case '\b': e = 'b';  break;
+        case '\f': e = 'f';  break;
+        case '\n': e = 'n';  break;
+        case '\r': e = 'r';  break;
+        case '\t': e = 't';  break;
+        default:
+          if (c >= 0x20) continue;
+          break;
+      }
+      put(run, (size_t)(v - run));
+      run = v + 1;
+      if (e) {
+        const char esc[2] = { '\\', e };
+        put(esc, 2);
+      } else {
+        const char esc[6] = { '\\', 'u', '0', '0', HEX[c >> 4], HEX[c & 15] };
+        put(esc, 6);
+      }
+    }
+    put(run, (size_t)(v - run));
+  }
+  put('"');
+  return *this;
+}
+
+JsonOut& JsonOut::b(const char* key, bool v) {
+  sep(key);
+  if (v) put("true", 4);
+  else   put("false", 5);
+  return *this;
+}
+
+JsonOut& JsonOut::u(const char* key, uint32_t v) {
+  sep(key);
+  uint_dec(v);
+  return *this;
+}
+
+JsonOut& JsonOut::i(const char* key, int32_t v) {
+  sep(key);
+  if (v < 0) {
+    put('-');
+    uint_dec((uint32_t)0 - (uint32_t)v);
+  } else {
+    uint_dec((uint32_t)v);
+  }
+  return *this;
+}
+
+JsonOut& JsonOut::null(const char* key) {
+  sep(key);
+  put("null", 4);
+  return *this;
+}
+
+// |v| >= 9e15: 7 algarismos (o que um float tem), "1.844674e19"
+JsonOut& JsonOut::f_exp(bool neg, double a) {
+  int8_t e = 15;
+  a /= 1.0e15;
+  while (a >= 10.0) { a /= 10.0; e++; }
+  uint32_t m = (uint32_t)(a * 1.0e6 + 0.5);   // d.dddddd
+  if (m >= 10000000) { m /= 10; e++; }
+  uint8_t dec = 6;
+  while (dec && m % 10 == 0) { m /= 10; dec--; }
+
+  char num[16];
+  uint8_t n = 0;
+  if (neg) num[n++] = '-';
+  num[n++] = (char)('0' + m / POW10[dec]);
+  if (dec) {
+    num[n++] = '.';
+    for (int8_t d = (int8_t)dec - 1; d >= 0; d--) num[n++] = (char)('0' + (m / POW10[d]) % 10);
+  }
+  num[n++] = 'e';
+  num[n++] = (char)('0' + e / 10);
+  num[n++] = (char)('0' + e % 10);
+  put(num, n);
+  return *this;
+}
+
+// Como o ArduinoJson 6 (FloatParts): float guardado como double, 9 casas
+// menos os algarismos da parte inteira, arredonda no último, zeros caem;
+// fora de [1e-5, 1e7) normaliza p/ [1, 10) com expoente
+JsonOut& JsonOut::f(const char* key, float v) {
+  static const double POS[] = { 1e1, 1e2, 1e4, 1e8, 1e16, 1e32, 1e64, 1e128, 1e256 };
+  static const double NEG[] = { 1e-1, 1e-2, 1e-4, 1e-8, 1e-16, 1e-32, 1e-64, 1e-128, 1e-256 };
+  static const double NEG1[] = { 1e0, 1e-1, 1e-3, 1e-7, 1e-15, 1e-31, 1e-63, 1e-127, 1e-255 };
+
+  if (!isfinite(v)) return null(key);
+  sep(key);
+
+  char num[32];
+  uint8_t n = 0;
+  double a = v;
+  if (a < 0.0) {
+    num[n++] = '-';
+    a = -a;
+  }
+
+  int16_t e = 0;
+  int8_t  k = 8;
+  int16_t bit = 256;
+  if (a >= 1e7) {
+    for (; k >= 0; k--, bit >>= 1) {
+      if (a >= POS[k]) { a *= NEG[k]; e += bit; }
+    }
+  }
+  if (a > 0.0 && a <= 1e-5) {
+    for (; k >= 0; k--, bit >>= 1) {
+      if (a < NEG1[k]) { a *= POS[k]; e -= bit; }
+    }
+  }
+
+  uint32_t ip = (uint32_t)a;
+  uint32_t maxDec = 1000000000;
+  uint8_t  dec = 9;
+  for (uint32_t t = ip; t >= 10; t /= 10) { maxDec /= 10; dec--; }
+  double rem = (a - (double)ip) * (double)maxDec;
+  uint32_t fp = (uint32_t)rem;
+  rem -= (double)fp;
+  fp += (uint32_t)(rem * 2);
+  if (fp >= maxDec) {
+    fp = 0;
+    ip++;
+    if (e && ip >= 10) { e++; ip = 1; }
+  }
+  while (dec && fp % 10 == 0) { fp /= 10; dec--; }
+
+  char tmp[10];
+  uint8_t t = 0;
+  do { tmp[t++] = (char)('0' + ip % 10); ip /= 10; } while (ip);
+  while (t) num[n++] = tmp[--t];
+  if (dec) {
+    num[n++] = '.';
+    for (int8_t d = (int8_t)dec - 1; d >= 0; d--) num[n++] = (char)('0' + (fp / POW10[d]) % 10);
+  }
+  if (e) {
+    num[n++] = 'e';
+    if (e < 0) { num[n++] = '-'; e = (int16_t)-e; }
+    t = 0;
+    do { tmp[t++] = (char)('0' + e % 10); e /= 10; } while (e);
+    while (t) num[n++] = tmp[--t];
+  }
+  put(num, n);
+  return *this;
+}
+
+JsonOut& JsonOut::f(const char* key, float v, uint8_t dec) {
+  if (!isfinite(v)) return null(key);
+  sep(key);
+  if (dec > 9) dec = 9;
+
+  // inteiro escalado em 64 bits, exato até ~2^53: acima disso (não acontece
+  // na telemetria) sai em notação exponencial
+  double a = fabs((double)v);
+  if (a >= 9.0e15) return f_exp(v < 0, a);
+  while (dec && a * POW10[dec] >= 9.0e15) dec--;
+  const uint64_t scaled = (uint64_t)(a * POW10[dec] + 0.5);
+  uint64_t ip = scaled / POW10[dec];
+  uint32_t fp = (uint32_t)(scaled % POW10[dec]);
+
+  if (v < 0 && scaled) put('-');
+
+  char tmp[24];
+  uint8_t k = 0;
+  do { tmp[k++] = (char)('0' + ip % 10); ip /= 10; } while (ip);
+  char num[24];
+  uint8_t n = 0;
+  while (k) num[n++] = tmp[--k];
+
+  // zeros à direita caem
+  while (dec && fp % 10 == 0) { fp /= 10; dec--; }
+  if (dec) {
+    num[n++] = '.';
+    for (int8_t d = (int8_t)dec - 1; d >= 0; d--) num[n++] = (char)('0' + (fp / POW10[d]) % 10);
+  }
+  put(num, n);
+  return *this;
+}
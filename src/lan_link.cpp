@@ -0,0 +1,211 @@
+#include "lan_link.h"
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <ESPmDNS.h>
+#include <mbedtls/md.h>
+
+#include "config.h"
+#include "wifi_link.h"
+#include "log_mirror.h"
+#include "msg_json.h"
+
+static const uint8_t LAN_VER = 1;
+static const uint8_t LT_HELLO = 1, LT_WELCOME = 2, LT_CMD = 3, LT_MSG = 4;
+static const size_t  LAN_HDR = 12;
+static const size_t  LAN_TAG = 16;
+
+struct LanPeer {
+  bool      used;
+  IPAddress ip;
+  uint16_t  port;
+  uint32_t  session;
+  uint32_t  rxSeq;        // último seq aceito
+  uint32_t  txSeq;
+  uint32_t  lastMs;       // última atividade (LRU)
+  uint32_t  subMs;        // período do stream (0 = sem)
+  uint32_t  subUntil;     // assinatura expira
+  uint32_t  lastState;
+};
+
+static WiFiUDP  g_udp;
+static bool     g_up = false;
+static LanPeer  g_peer[LAN_MAX_PEERS];
+static LanPeer* g_cur = nullptr;     // peer do comando em execução
+
+static uint8_t  g_rx[LAN_HDR + 512 + LAN_TAG];
+static uint8_t  g_tx[LAN_HDR + MQTT_BUF_SIZE + LAN_TAG];
+static char     g_cmd[513];
+
+static uint32_t g_rejected = 0;      // tag/sessão/seq inválidos
+static uint32_t g_endUs = 0;         // fim do último lan_update (latência "net")
+
+static void rd32(const uint8_t* p, uint32_t& v) { memcpy(&v, p, 4); }
+static void wr32(uint8_t* p, uint32_t v)        { memcpy(p, &v, 4); }
+
+static void lan_tag(const uint8_t* data, size_t len, uint8_t out[32]) {
+  mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256),
+                  (const uint8_t*)LAN_PSK, strlen(LAN_PSK), data, len, out);
+}
+
+// tempo constante: não vaza quantos bytes batem
+static bool tag_ok(const uint8_t* pkt, size_t len) {
+  uint8_t h[32];
+  lan_tag(pkt, len - LAN_TAG, h);
+  uint8_t d = 0;
+  for (size_t i = 0; i < LAN_TAG; i++) d |= h[i] ^ pkt[len - LAN_TAG + i];
+  return d == 0;
+}
+
+static void lan_send(LanPeer& p, uint8_t type, const void* payload, size_t len) {
+  if (len > sizeof(g_tx) - LAN_HDR - LAN_TAG) return;
+  g_tx[0] = 'P';  g_tx[1] = 'L';  g_tx[2] = LAN_VER;  g_tx[3] = type;
+  wr32(g_tx + 4, p.session);
+  wr32(g_tx + 8, ++p.txSeq);
+  memcpy(g_tx + LAN_HDR, payload, len);
+  uint8_t h[32];
+  lan_tag(g_tx, LAN_HDR + len, h);
+  memcpy(g_tx + LAN_HDR + len, h, LAN_TAG);
+
+  g_udp.beginPacket(p.ip, p.port);
+  g_udp.write(g_tx, LAN_HDR + len + LAN_TAG);
+  g_udp.endPacket();
+}
+
+static LanPeer* peer_find(IPAddress ip, uint16_t port) {
+  for (LanPeer& p : g_peer) if (p.used && p.ip == ip && p.port == port) return &p;
+  return nullptr;
+}
+
+// livre ou o mais antigo
+static LanPeer& peer_slot(uint32_t now) {
+  LanPeer* old = &g_peer[0];
+  for (LanPeer& p : g_peer) {
+    if (!p.used) return p;
+    if (now - p.lastMs > now - old->lastMs) old = &p;
+  }
+  return *old;
+}
+
+// Resposta do handler (ack/evt) vai para quem mandou o comando
+static void lan_reply(const char* payload, size_t len, void* ctx) {
+  (void)ctx;
+  if (g_cur) lan_send(*g_cur, LT_MSG, payload, len);
+}
+
+static void lan_sub(LanPeer& p, const MqttCommand& c, uint32_t now) {
+  const uint32_t ms = c.hasNum && c.fVal > 0 ? (uint32_t)c.fVal : 0;
+  p.subMs     = ms ? (ms < LAN_STATE_MIN_MS ? LAN_STATE_MIN_MS : ms) : 0;
+  p.subUntil  = now + LAN_SUB_TTL_MS;
+  p.lastState = now - p.subMs;   // primeiro state já
+}
+
+// false = nada na fila
+static bool lan_rx(uint32_t now) {
+  const int n = g_udp.parsePacket();
+  if (n <= 0) return false;
+  const uint32_t rxUs = micros();
+  if ((size_t)n > sizeof(g_rx)) { g_rejected++; return true; }   // parsePacket seguinte descarta
+  const size_t len = (size_t)g_udp.read(g_rx, sizeof(g_rx));
+  const IPAddress ip = g_udp.remoteIP();
+  const uint16_t port = g_udp.remotePort();
+
+  if (len < LAN_HDR + LAN_TAG || g_rx[0] != 'P' || g_rx[1] != 'L' || g_rx[2] != LAN_VER) return true;
+  if (!tag_ok(g_rx, len)) { g_rejected++; return true; }
+
+  uint32_t session, seq;
+  rd32(g_rx + 4, session);
+  rd32(g_rx + 8, seq);
+  const uint8_t* payload = g_rx + LAN_HDR;
+  const size_t   plen    = len - LAN_HDR - LAN_TAG;
+
+  if (g_rx[3] == LT_HELLO) {
+    if (plen != 8) return true;
+    LanPeer* p = peer_find(ip, port);
+    if (!p) p = &peer_slot(now);
+    *p = LanPeer();
+    p->used    = true;
+    p->ip      = ip;
+    p->port    = port;
+    do { p->session = esp_random(); } while (p->session == 0);
+    p->lastMs  = now;
+    lan_send(*p, LT_WELCOME, payload, plen);
+    return true;
+  }
+
+  if (g_rx[3] != LT_CMD) return true;
+  LanPeer* p = peer_find(ip, port);
+  if (!p || session != p->session || seq <= p->rxSeq) { g_rejected++; return true; }
+  p->rxSeq  = seq;
+  p->lastMs = now;
+
+  const size_t m = plen < sizeof(g_cmd) - 1 ? plen : sizeof(g_cmd) - 1;
+  memcpy(g_cmd, payload, m);
+  g_cmd[m] = '\0';
+
+  MqttCommand c;
+  if (!mqtt_parse_cmd(g_cmd, c)) return true;
+  c.rxUs  = rxUs;
+  c.netUs = g_endUs ? rxUs - g_endUs : 0;
+
+  g_cur = p;
+  if (strcmp(c.cmd, "lan_sub") == 0) {
+    lan_sub(*p, c, now);
+    char a[96];
+    const size_t n = msg_ack_json(a, sizeof(a), c.msgId, true, nullptr);
+    if (n) lan_send(*p, LT_MSG, a, n);
+  } else {
+    mqtt_dispatch_local(c, lan_reply, nullptr);
+  }
+  g_cur = nullptr;
+  return true;
+}
+
+void lan_begin() {
+  for (LanPeer& p : g_peer) p = LanPeer();
+  g_up = false;
+}
+
+void lan_update(uint32_t now) {
+  if (!LAN_PSK[0]) return;
+
+  const bool wifi = wifi_is_connected();
+  if (wifi && !g_up) {
+    g_up = g_udp.begin(LAN_UDP_PORT);
+    if (g_up && MDNS.begin(CTRL_ID)) {
+      MDNS.addService("perferro", "udp", LAN_UDP_PORT);
+      MDNS.addServiceTxt("perferro", "udp", "id", CTRL_ID);
+    }
+    log_mirror_printf(LOG_I, "[LAN] udp:%u %s", (unsigned)LAN_UDP_PORT, g_up ? "ok" : "falhou");
+  } else if (!wifi && g_up) {
+    g_udp.stop();
+    MDNS.end();
+    for (LanPeer& p : g_peer) p = LanPeer();   // IP pode mudar: sessões novas
+    g_up = false;
+  }
+  if (!g_up) return;
+
+  // rajada curta por volta do loop (não segura o MQTT)
+  for (uint8_t i = 0; i < 4 && lan_rx(now); i++) {}
+  g_endUs = micros();
+}
+
+bool lan_state_due(uint32_t now) {
+  if (!g_up) return false;
+  for (const LanPeer& p : g_peer) {
+    if (p.used && p.subMs && (int32_t)(p.subUntil - now) > 0 && now - p.lastState >= p.subMs) return true;
+  }
+  return false;
+}
+
+void lan_publish_state(const MqttState& s, uint32_t now) {
+  char buf[384];
+  const size_t n = msg_state_json(s, buf, sizeof(buf));
+  if (!n) return;
+  for (LanPeer& p : g_peer) {
+    if (!p.used || !p.subMs) continue;
+    if ((int32_t)(p.subUntil - now) <= 0) { p.subMs = 0; continue; }   // não renovou
+    if (now - p.lastState < p.subMs) continue;
+    p.lastState = now;
+    lan_send(p, LT_MSG, buf, n);
+  }
+}
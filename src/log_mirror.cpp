@@ -1,16 +1,15 @@
 #include "log_mirror.h"
 
-#include <ArduinoJson.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/queue.h>
 #include <esp_log.h>
 
 #include "config.h"
 #include "mqtt_link.h"
+#include "msg_json.h"
 
 // ---- Config ----
 static const int LOGQ_LEN = 80;
-static const int LOG_MSG_MAX = 220;   // manter baixo p/ não estourar buffer MQTT
 
 struct LogItem {
   uint32_t ms;
@@ -19,10 +18,15 @@ struct LogItem {
 };
 
 static QueueHandle_t g_q = nullptr;
+static StaticQueue_t g_qs;                         // fila estática (~18 KB fora do heap)
+static uint8_t       g_qBuf[LOGQ_LEN * sizeof(LogItem)];
 
 static bool g_enabled = false;     // envio MQTT (Serial sempre)
 static uint8_t g_minLvl = LOG_I;
 
+static volatile uint32_t g_drop = 0;   // fila cheia (várias tasks: aproximado)
+static uint32_t g_tok = LOG_MQTT_BURST, g_tokMs = 0;
+
 // Hook do ESP-IDF logging (captura logs do core tipo ssl_client.cpp)
 static vprintf_like_t g_prev_vprintf = nullptr;
 
@@ -64,7 +68,7 @@ static void enqueue_line(uint8_t lvl, const char* line) {
   }
 
   // não bloquear: se lotar, dropa
-  xQueueSend(g_q, &it, 0);
+  if (xQueueSend(g_q, &it, 0) != pdTRUE) g_drop++;
 }
 
 // Hook captura o “texto final” que iria pro Serial em logs do core
@@ -100,7 +104,7 @@ static int my_vprintf(const char* fmt, va_list args) {
 
 void log_mirror_begin(bool hook_esp_log) {
   if (!g_q) {
-    g_q = xQueueCreate(LOGQ_LEN, sizeof(LogItem));
+    g_q = xQueueCreateStatic(LOGQ_LEN, sizeof(LogItem), g_qBuf, &g_qs);
   }
 
   if (hook_esp_log) {
@@ -143,20 +147,26 @@ void log_mirror_poll() {
     return;
   }
 
+  // fichas: LOG_MQTT_RATE/s até LOG_MQTT_BURST
+  const uint32_t now = millis();
+  uint32_t dt = now - g_tokMs;
+  if (dt > 60000) dt = 60000;
+  const uint32_t add = dt * LOG_MQTT_RATE / 1000;
+  if (add) {
+    g_tok = (g_tok + add > LOG_MQTT_BURST) ? LOG_MQTT_BURST : g_tok + add;
+    g_tokMs = (g_tok == LOG_MQTT_BURST) ? now : g_tokMs + add * 1000 / LOG_MQTT_RATE;
+  }
+
   // publica até N por ciclo para não travar loop
-  for (int i = 0; i < 10; i++) {
+  for (int i = 0; i < 10 && g_tok; i++) {
     LogItem it;
     if (xQueueReceive(g_q, &it, 0) != pdTRUE) break;
+    g_tok--;
 
-    StaticJsonDocument<384> doc;
-    doc["type"] = "LOG";
-    doc["id"]   = CTRL_ID;
-    doc["ms"]   = it.ms;
-    doc["lvl"]  = lvl_to_char(it.lvl);
-    doc["msg"]  = it.msg;
-
+    // msg escapado pode crescer até 6x (\u00XX); o que não couber é descartado
     char out[384];
-    size_t n = serializeJson(doc, out, sizeof(out));
-    mqtt_publish_evt(out, n);
+    const uint32_t drop = g_drop;
+    const size_t n = msg_log_json(out, sizeof(out), it.ms, lvl_to_char(it.lvl), it.msg, drop);
+    if (n && mqtt_publish_evt(out, n)) g_drop -= drop;
   }
 }
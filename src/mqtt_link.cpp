@@ -9,6 +9,8 @@
 #include "wifi_link.h"
 
 #include "log_mirror.h"
+#include "msg_json.h"
+#include "cmd_trace.h"
 
 
 static WiFiClientSecure net;
@@ -23,35 +25,71 @@ static bool justConnectedFlag = false;
 // Pausa MQTT/TLS durante OTA (evita conflito de duas conexões TLS simultâneas)
 static bool g_paused = false;
 
-static char t_state[128], t_cmd[128], t_evt[128], t_lwt[128], t_hist[128];
+static uint32_t g_tlsHeap = 0;   // heap da sessão TLS (medido no connect)
+
+static uint32_t g_loopEndUs = 0; // fim do último mqtt.loop() (latência "net")
+
+static char t_state[128], t_cmd[128], t_evt[128], t_lwt[128], t_hist[128], t_histBin[128], t_diag[128], t_stats[128], t_ack[128];
 static char clientId[64];
 
+// ===== Grupos / broadcast =====
+static char    t_all[128];
+static char    t_grp[GRP_MAX][128];
+static char    g_grpName[GRP_MAX][GRP_NAME_MAX + 1];
+static uint8_t g_nGrp = 0;
+static char    g_groups[GRP_MAX * (GRP_NAME_MAX + 1)];   // "a,b" como veio
+
+// acks de comando de grupo: agregados e com atraso aleatório
+static MsgAck   g_ack[GRP_ACK_BATCH];
+static uint8_t  g_nAck = 0;
+static uint32_t g_ackDueMs = 0;
+static uint8_t  g_cmdScope = CMD_DIRECT;   // escopo do comando em execução
+static uint32_t g_ackLost = 0;             // lote cheio
+
 static void build_topics() {
   topic_state(t_state, sizeof(t_state), CTRL_ID);
   topic_cmd  (t_cmd,   sizeof(t_cmd),   CTRL_ID);
   topic_evt  (t_evt,   sizeof(t_evt),   CTRL_ID);
   topic_lwt  (t_lwt,   sizeof(t_lwt),   CTRL_ID);
   topic_hist (t_hist,  sizeof(t_hist),  CTRL_ID);
+  topic_hist_bin(t_histBin, sizeof(t_histBin), CTRL_ID);
+  topic_diag (t_diag,  sizeof(t_diag),  CTRL_ID);
+  topic_stats(t_stats, sizeof(t_stats), CTRL_ID);
+  topic_ack  (t_ack,   sizeof(t_ack),   CTRL_ID);
+  topic_all_cmd(t_all, sizeof(t_all));
+  for (uint8_t i = 0; i < g_nGrp; i++) topic_grp_cmd(t_grp[i], sizeof(t_grp[i]), g_grpName[i]);
 }
 
-static void mqtt_callback(char* topic, byte* payload, unsigned int length) {
-  // só aceita comandos no tópico cmd
-  if (strcmp(topic, t_cmd) != 0) return;
-
-  // copia payload p/ buffer terminando em \0
-  static char buf[512];
-  if (length >= sizeof(buf)) length = sizeof(buf) - 1;
-  memcpy(buf, payload, length);
-  buf[length] = '\0';
+static void grp_subscribe() {
+  mqtt.subscribe(t_all, 1);
+  for (uint8_t i = 0; i < g_nGrp; i++) mqtt.subscribe(t_grp[i], 1);
+}
 
-log_mirror_printf(LOG_I, "[CMD RAW] %s", buf);
+static void grp_unsubscribe() {
+  for (uint8_t i = 0; i < g_nGrp; i++) mqtt.unsubscribe(t_grp[i]);
+}
 
+// Escopo pelo tópico; false = não é nosso
+static bool topic_scope(const char* topic, uint8_t& scope, const char*& grp) {
+  grp = "";
+  if (strcmp(topic, t_cmd) == 0) { scope = CMD_DIRECT; return true; }
+  if (strcmp(topic, t_all) == 0) { scope = CMD_ALL; return true; }
+  for (uint8_t i = 0; i < g_nGrp; i++) {
+    if (strcmp(topic, t_grp[i]) == 0) {
+      scope = CMD_GROUP;
+      grp = g_grpName[i];
+      return true;
+    }
+  }
+  return false;
+}
 
+// JSON do comando -> MqttCommand (escopo = CMD_DIRECT; quem chamou ajusta)
+bool mqtt_parse_cmd(const char* buf, MqttCommand& c) {
   StaticJsonDocument<512> doc;
   DeserializationError err = deserializeJson(doc, buf);
-  if (err) return;
+  if (err) return false;
 
-  MqttCommand c;
   memset(&c, 0, sizeof(c));
 
   const char* cmd = doc["cmd"] | "";
@@ -100,7 +138,72 @@ log_mirror_printf(LOG_I, "[CMD RAW] %s", buf);
     c.reboot = doc["reboot"].as<bool>();
   }
 
-  if (g_handler) g_handler(c);
+  // ===== sha256 (hex) opcional =====
+  const char* h = doc["sha256"] | "";
+  c.hasSha = (h[0] != '\0');
+  strlcpy(c.sha256, h, sizeof(c.sha256));
+
+  const char* f = doc["fmt"] | "";
+  strlcpy(c.fmt, f, sizeof(c.fmt));
+
+  // ===== consulta de histórico =====
+  c.qid  = doc["qid"]  | 0u;
+  c.from = doc["from"] | 0u;
+  c.to   = doc["to"]   | 0u;
+  c.step = doc["step"] | 0u;
+  c.win  = doc["win"]  | (uint8_t)HISTQ_WINDOW;
+  const char* ag = doc["agg"] | "";
+  strlcpy(c.agg, ag, sizeof(c.agg));
+  c.hasSeq = doc["seq"].is<uint32_t>();
+  c.seq    = doc["seq"] | 0u;
+  return true;
+}
+
+static void cmd_run(const MqttCommand& c) {
+  if (!g_handler) return;
+  g_cmdScope = c.scope;
+  g_handler(c);
+  g_cmdScope = CMD_DIRECT;
+  cmd_trace_done();
+}
+
+static void mqtt_callback(char* topic, byte* payload, unsigned int length) {
+  const uint32_t rxUs = micros();
+
+  // só aceita comandos nos tópicos cmd (próprio, all, grupos)
+  uint8_t scope;
+  const char* grp;
+  if (!topic_scope(topic, scope, grp)) return;
+
+  // copia payload p/ buffer terminando em \0
+  static char buf[512];
+  if (length >= sizeof(buf)) length = sizeof(buf) - 1;
+  memcpy(buf, payload, length);
+  buf[length] = '\0';
+
+log_mirror_printf(LOG_I, "[CMD RAW] %s", buf);
+
+
+  MqttCommand c;
+  if (!mqtt_parse_cmd(buf, c)) return;
+  c.scope = scope;
+  strlcpy(c.grp, grp, sizeof(c.grp));
+  c.rxUs  = rxUs;
+  c.netUs = g_loopEndUs ? rxUs - g_loopEndUs : 0;
+  cmd_run(c);
+}
+
+// Resposta dos comandos da LAN (só durante mqtt_dispatch_local)
+static CmdReplyFn g_reply = nullptr;
+static void*      g_replyCtx = nullptr;
+
+void mqtt_dispatch_local(MqttCommand& c, CmdReplyFn reply, void* ctx) {
+  c.scope = CMD_LAN;
+  g_reply = reply;
+  g_replyCtx = ctx;
+  cmd_run(c);
+  g_reply = nullptr;
+  g_replyCtx = nullptr;
 }
 
 void mqtt_set_cmd_handler(MqttCmdHandler h) {
@@ -108,19 +211,61 @@ void mqtt_set_cmd_handler(MqttCmdHandler h) {
 }
 
 void mqtt_pause(bool paused) {
+  // só sinaliza: quem mexe no cliente é a task de rede (mqtt_update)
   g_paused = paused;
-  if (paused) {
-    if (mqtt.connected()) mqtt.disconnect();
-    net.stop(); // fecha socket/TLS e libera recursos
-    lastConnected = false;
-    justConnectedFlag = false;
-  }
 }
 
 bool mqtt_is_paused() {
   return g_paused;
 }
 
+uint32_t mqtt_tls_heap() {
+  return g_tlsHeap;
+}
+
+static bool grp_name_ok(const char* s, size_t n) {
+  if (n == 0 || n > GRP_NAME_MAX) return false;
+  for (size_t i = 0; i < n; i++) {
+    const char ch = s[i];
+    if (!isalnum((unsigned char)ch) && ch != '_' && ch != '-') return false;
+  }
+  return true;
+}
+
+bool mqtt_set_groups(const char* csv) {
+  if (!csv) csv = "";
+  if (strlen(csv) >= sizeof(g_groups)) return false;
+
+  // valida tudo antes de mexer nas assinaturas
+  char    names[GRP_MAX][GRP_NAME_MAX + 1];
+  uint8_t n = 0;
+  for (const char* p = csv; *p; ) {
+    const char* e = strchr(p, ',');
+    const size_t len = e ? (size_t)(e - p) : strlen(p);
+    if (!grp_name_ok(p, len) || n >= GRP_MAX) return false;
+    memcpy(names[n], p, len);
+    names[n][len] = '\0';
+    n++;
+    if (!e) break;
+    p = e + 1;
+    if (!*p) return false;   // vírgula no fim
+  }
+
+  // chamado do handler (task de rede): pode reassinar na hora
+  const bool live = mqtt.connected();
+  if (live) grp_unsubscribe();
+  memcpy(g_grpName, names, sizeof(names));
+  g_nGrp = n;
+  strlcpy(g_groups, csv, sizeof(g_groups));
+  build_topics();
+  if (live) for (uint8_t i = 0; i < g_nGrp; i++) mqtt.subscribe(t_grp[i], 1);
+  return true;
+}
+
+const char* mqtt_groups() {
+  return g_groups;
+}
+
 static bool mqtt_connect_now() {
   if (g_paused) return false;
   if (!wifi_is_connected()) return false;
@@ -143,22 +288,30 @@ static bool mqtt_connect_now() {
   mqtt.setServer(MQTT_HOST, MQTT_PORT);
   mqtt.setCallback(mqtt_callback);
   mqtt.setKeepAlive(MQTT_KEEPALIVE_S);
-  mqtt.setBufferSize(1024);
+  mqtt.setBufferSize(MQTT_BUF_SIZE);
 
   // LWT offline retained
   const char* willMsg = "{\"online\":false}";
+  const uint32_t heap0 = ESP.getFreeHeap();
   bool ok = mqtt.connect(clientId, MQTT_USER, MQTT_PASS, t_lwt, 1, true, willMsg);
   if (!ok) return false;
 
+  // custo da sessão (buffers mbedtls + contexto): entra no orçamento do OTA
+  const uint32_t heap1 = ESP.getFreeHeap();
+  g_tlsHeap = (heap0 > heap1) ? (heap0 - heap1) : 0;
+
   // online retained
   mqtt.publish(t_lwt, "{\"online\":true}", true);
 
   // assina comandos
   mqtt.subscribe(t_cmd, 1);
+  grp_subscribe();
 
   return true;
 }
 
+static void grp_ack_poll();
+
 void mqtt_begin() {
   lastTry = 0;
   lastConnected = false;
@@ -170,11 +323,20 @@ void mqtt_begin() {
 void mqtt_update() {
   justConnectedFlag = false;
 
-  if (g_paused) return;
+  if (g_paused) {
+    if (lastConnected || mqtt.connected()) {
+      if (mqtt.connected()) mqtt.disconnect();
+      net.stop(); // fecha socket/TLS e libera recursos
+      lastConnected = false;
+    }
+    return;
+  }
 
   if (mqtt.connected()) {
     mqtt.loop();
+    g_loopEndUs = micros();
     lastConnected = true;
+    grp_ack_poll();
     return;
   }
 
@@ -198,78 +360,77 @@ bool mqtt_just_connected() {
   return justConnectedFlag;
 }
 
+// Só a task de rede publica: um buffer de saída para as mensagens daqui
+// (cabe o lote de acks: GRP_ACK_BATCH x ~100 B)
+static char g_out[160 + GRP_ACK_BATCH * 100];
+
 bool mqtt_publish_state(const MqttState& s) {
   if (!mqtt.connected()) return false;
+  const size_t n = msg_state_json(s, g_out, sizeof(g_out));
+  return n && mqtt.publish(t_state, (const uint8_t*)g_out, (unsigned int)n, true);
+}
 
-  StaticJsonDocument<512> doc;
-  doc["id"] = s.id;
-  doc["online"] = true;
-  doc["ms"] = s.ms;
-
-  doc["tempC"] = s.tempC;
-  doc["tempValid"] = s.tempValid;
-
-  doc["setpoint"] = s.setpoint;
-  doc["systemOn"] = s.systemOn;
-  doc["heating"] = s.heating;
-
-  doc["u_pct"] = s.u_pct;
-  doc["a1"] = s.a1;
-  doc["b0"] = s.b0;
-
-  doc["rssi"] = s.rssi;
-
-  char out[512];
-  size_t n = serializeJson(doc, out, sizeof(out));
+// Comando de grupo: um publish chega em N controladores, então os N acks
+// não saem juntos; entram no lote e saem depois de um atraso aleatório
+static bool grp_ack_add(const char* msgId, bool ok, const char* msg) {
+  if (g_nAck >= GRP_ACK_BATCH) { g_ackLost++; return false; }
+  MsgAck& a = g_ack[g_nAck++];
+  strlcpy(a.msgId, msgId ? msgId : "", sizeof(a.msgId));
+  a.ok = ok;
+  strlcpy(a.msg, msg ? msg : "", sizeof(a.msg));
+  if (g_nAck == 1) g_ackDueMs = millis() + (GRP_ACK_JITTER_MS ? esp_random() % GRP_ACK_JITTER_MS : 0);
+  return true;
+}
 
-  return mqtt.publish(t_state, (const uint8_t*)out, (unsigned int)n, true);
+static void grp_ack_poll() {
+  if (!g_nAck || (int32_t)(millis() - g_ackDueMs) < 0) return;
+  const size_t n = msg_acks_json(g_out, sizeof(g_out), g_ackLost, g_ack, g_nAck);
+  if (n && mqtt.publish(t_ack, (const uint8_t*)g_out, (unsigned int)n, false)) {
+    g_nAck = 0;
+    g_ackLost = 0;
+  }
 }
 
 bool mqtt_publish_ack(const char* msgId, bool ok, const char* msg) {
+  if (g_cmdScope == CMD_GROUP || g_cmdScope == CMD_ALL) return grp_ack_add(msgId, ok, msg);
+  if (g_reply) {
+    const size_t n = msg_ack_json(g_out, sizeof(g_out), msgId, ok, msg);
+    if (n) g_reply(g_out, n, g_replyCtx);
+    return n != 0;
+  }
   if (!mqtt.connected()) return false;
-
-  StaticJsonDocument<256> doc;
-  doc["type"] = "ack";
-  doc["id"] = msgId ? msgId : "";
-  doc["ok"] = ok;
-  if (msg) doc["msg"] = msg;
-
-  char out[256];
-  size_t n = serializeJson(doc, out, sizeof(out));
-  return mqtt.publish(t_evt, (const uint8_t*)out, (unsigned int)n, false);
+  const size_t n = msg_ack_json(g_out, sizeof(g_out), msgId, ok, msg);
+  return n && mqtt.publish(t_ack, (const uint8_t*)g_out, (unsigned int)n, false);
 }
 
-bool mqtt_publish_fault(const char* code, const char* msg) {
+bool mqtt_publish_hist(const char* payload, size_t len, bool retained) {
   if (!mqtt.connected()) return false;
+  return mqtt.publish(t_hist, (const uint8_t*)payload, (unsigned int)len, retained);
+}
 
-  StaticJsonDocument<256> doc;
-  doc["type"] = "fault";
-  doc["code"] = code ? code : "";
-  doc["msg"]  = msg ? msg : "";
+bool mqtt_publish_hist_bin(const uint8_t* payload, size_t len) {
+  if (!mqtt.connected()) return false;
+  return mqtt.publish(t_histBin, payload, (unsigned int)len, false);
+}
 
-  char out[256];
-  size_t n = serializeJson(doc, out, sizeof(out));
-  return mqtt.publish(t_evt, (const uint8_t*)out, (unsigned int)n, false);
+bool mqtt_publish_diag(const char* payload, size_t len) {
+  if (!mqtt.connected()) return false;
+  return mqtt.publish(t_diag, (const uint8_t*)payload, (unsigned int)len, false);
 }
 
-bool mqtt_publish_hist(const char* payload, size_t len, bool retained) {
+bool mqtt_publish_stats(const char* payload, size_t len) {
   if (!mqtt.connected()) return false;
-  return mqtt.publish(t_hist, (const uint8_t*)payload, (unsigned int)len, retained);
+  return mqtt.publish(t_stats, (const uint8_t*)payload, (unsigned int)len, false);
 }
 
 bool mqtt_publish_evt(const char* payload, size_t len) {
+  if (g_reply) { g_reply(payload, len, g_replyCtx); return true; }
   if (!mqtt.connected()) return false;
   return mqtt.publish(t_evt, (const uint8_t*)payload, (unsigned int)len, false);
 }
 
 bool mqtt_publish_reset(const char* msg) {
   if (!mqtt.connected()) return false;
-
-  StaticJsonDocument<256> doc;
-  doc["type"] = "RESET";
-  doc["msg"]  = msg ? msg : "";
-
-  char out[256];
-  size_t n = serializeJson(doc, out, sizeof(out));
-  return mqtt.publish(t_evt, (const uint8_t*)out, (unsigned int)n, false);
+  const size_t n = msg_reset_json(g_out, sizeof(g_out), msg);
+  return n && mqtt.publish(t_evt, (const uint8_t*)g_out, (unsigned int)n, false);
 }
@@ -0,0 +1,89 @@
+#include "msg_json.h"
+
+#include "config.h"
+#include "json_out.h"
+#include "cmd_trace.h"
+
+size_t msg_state_json(const MqttState& s, char* out, size_t cap) {
+  JsonOut j(out, cap);
+  j.obj();
+  j.s("id", s.id).b("online", true).u("ms", (uint32_t)s.ms);
+  j.f("tempC", s.tempC).b("tempValid", s.tempValid);
+  j.f("setpoint", s.setpoint).b("systemOn", s.systemOn).b("heating", s.heating);
+  j.f("u_pct", s.u_pct).f("a1", s.a1).f("b0", s.b0);
+  j.i("rssi", s.rssi);
+  j.end();
+  return j.len();
+}
+
+size_t msg_ack_json(char* out, size_t cap, const char* msgId, bool ok, const char* msg) {
+  JsonOut j(out, cap);
+  j.obj().s("type", "ack").s("id", msgId).b("ok", ok);
+  if (msg) j.s("msg", msg);
+  cmd_trace_ack_json(j);   // comando em execução: "lat"
+  j.end();
+  return j.len();
+}
+
+size_t msg_acks_json(char* out, size_t cap, uint32_t lost, const MsgAck* a, uint8_t n) {
+  JsonOut j(out, cap);
+  j.obj().s("type", "acks").u("lost", lost).arr("a");
+  for (uint8_t i = 0; i < n; i++) {
+    j.obj().s("id", a[i].msgId).b("ok", a[i].ok);
+    if (a[i].msg[0]) j.s("msg", a[i].msg);
+    j.end();
+  }
+  j.end().end();
+  return j.len();
+}
+
+size_t msg_reset_json(char* out, size_t cap, const char* msg) {
+  JsonOut j(out, cap);
+  j.obj().s("type", "RESET").s("msg", msg).end();
+  return j.len();
+}
+
+size_t msg_ota_json(char* out, size_t cap, const char* stage, int pct, const char* msg) {
+  JsonOut j(out, cap);
+  j.obj().s("type", "OTA").s("stage", stage);
+  if (pct >= 0) j.i("pct", pct);
+  if (msg && msg[0]) j.s("msg", msg);
+  j.end();
+  return j.len();
+}
+
+size_t msg_ota_stats_json(char* out, size_t cap, const MsgOtaStats& s) {
+  JsonOut j(out, cap);
+  j.obj();
+  j.s("type", "OTA").s("stage", "STATS");
+  j.s("fmt", s.fmt).b("gzip", s.gzip);
+  j.u("bytes", s.bytes).u("unz_bytes", s.unzBytes).u("out_bytes", s.outBytes).u("ms", s.ms);
+  j.f("kbps", s.kbps).f("unz_kbps", s.unzKbps);
+  j.u("net_stall_ms", s.netStallMs).u("flash_idle_ms", s.flashIdleMs);
+  j.u("write_max_us", s.writeMaxUs).u("write_avg_us", s.writeAvgUs);
+  j.u("bufs", s.bufs).u("buf_size", s.bufSize);
+  j.u("resumes", s.resumes).u("resumed_from", s.resumedFrom);
+  j.b("mqtt_kept", s.mqttKept).u("tls_mqtt", s.tlsMqtt).u("tls_http", s.tlsHttp);
+  j.u("heap_min", s.heapMin).u("blk_min", s.blkMin);
+  j.end();
+  return j.len();
+}
+
+size_t msg_log_json(char* out, size_t cap, uint32_t ms, const char* lvl, const char* msg, uint32_t drop) {
+  JsonOut j(out, cap);
+  j.obj().s("type", "LOG").s("id", CTRL_ID).u("ms", ms).s("lvl", lvl).s("msg", msg);
+  if (drop) j.u("drop", drop);
+  j.end();
+  return j.len();
+}
+
+size_t msg_hist_json(char* out, size_t cap, uint8_t seq, uint8_t total, const HistPoint* p, uint8_t n) {
+  JsonOut j(out, cap);
+  j.obj().s("id", CTRL_ID).u("seq", seq).u("total", total);
+  j.arr("points");
+  for (uint8_t i = 0; i < n; i++) {
+    j.arr().u(nullptr, p[i].ts).f(nullptr, p[i].temp).end();   // ts pode ser 0
+  }
+  j.end().end();
+  return j.len();
+}
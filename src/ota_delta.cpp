@@ -0,0 +1,178 @@
+#include "ota_delta.h"
+
+#include <string.h>
+
+enum DeltaState : uint8_t {
+  DS_HDR = 0,
+  DS_OP,
+  DS_ARGS,
+  DS_ADD,
+  DS_DIFF,
+  DS_END,
+  DS_ERR
+};
+
+static uint32_t rd_u32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static DeltaStatus fail(DeltaApply& d, DeltaStatus s) {
+  d.state = DS_ERR;
+  d.status = s;
+  return s;
+}
+
+static bool out_fits(const DeltaApply& d, uint32_t len) {
+  return len <= d.hdr.target_size - d.outPos;
+}
+
+static bool base_fits(const DeltaApply& d, uint32_t off, uint32_t len) {
+  return off <= d.hdr.base_size && len <= d.hdr.base_size - off;
+}
+
+void delta_begin(DeltaApply& d, DeltaHeaderFn on_header, DeltaReadFn read_base,
+                 DeltaWriteFn write_out, void* ctx) {
+  memset(&d.hdr, 0, sizeof(d.hdr));
+  d.on_header = on_header;
+  d.read_base = read_base;
+  d.write_out = write_out;
+  d.ctx       = ctx;
+  d.state     = DS_HDR;
+  d.op        = DOP_END;
+  d.pos       = 0;
+  d.srcOff    = 0;
+  d.remaining = 0;
+  d.status    = DELTA_OK;
+  d.outPos    = 0;
+}
+
+// COPY inteiro de uma vez (não depende de dados do patch)
+static DeltaStatus do_copy(DeltaApply& d, uint32_t off, uint32_t len) {
+  if (!base_fits(d, off, len)) return fail(d, DELTA_ERR_RANGE);
+  if (!out_fits(d, len))       return fail(d, DELTA_ERR_RANGE);
+
+  while (len) {
+    const size_t n = (len > DELTA_SCRATCH) ? DELTA_SCRATCH : len;
+    if (!d.read_base(d.ctx, off, d.scratch, n)) return fail(d, DELTA_ERR_READ);
+    if (!d.write_out(d.ctx, d.scratch, n))      return fail(d, DELTA_ERR_WRITE);
+    off += n;
+    len -= n;
+    d.outPos += n;
+  }
+  return DELTA_OK;
+}
+
+DeltaStatus delta_feed(DeltaApply& d, const uint8_t* data, size_t len) {
+  if (d.state == DS_ERR) return (DeltaStatus)d.status;
+
+  while (len) {
+    switch (d.state) {
+      case DS_HDR: {
+        size_t n = DELTA_HDR_SIZE - d.pos;
+        if (n > len) n = len;
+        memcpy(d.hdrBuf + d.pos, data, n);
+        d.pos += n; data += n; len -= n;
+        if (d.pos < DELTA_HDR_SIZE) break;
+
+        if (memcmp(d.hdrBuf, DELTA_MAGIC, 4) != 0) return fail(d, DELTA_ERR_MAGIC);
+        d.hdr.base_size = rd_u32(d.hdrBuf + 4);
+        memcpy(d.hdr.base_sha256, d.hdrBuf + 8, 32);
+        d.hdr.target_size = rd_u32(d.hdrBuf + 40);
+        memcpy(d.hdr.target_sha256, d.hdrBuf + 44, 32);
+
+        if (d.on_header && !d.on_header(d.ctx, d.hdr)) return fail(d, DELTA_ERR_HEADER);
+        d.pos = 0;
+        d.state = DS_OP;
+        break;
+      }
+
+      case DS_OP: {
+        d.op = *data++; len--;
+        d.pos = 0;
+        if (d.op == DOP_END) {
+          if (d.outPos != d.hdr.target_size) return fail(d, DELTA_ERR_RANGE);
+          d.state = DS_END;
+        } else if (d.op == DOP_COPY || d.op == DOP_ADD || d.op == DOP_DIFF) {
+          d.state = DS_ARGS;
+        } else {
+          return fail(d, DELTA_ERR_OP);
+        }
+        break;
+      }
+
+      case DS_ARGS: {
+        const uint8_t need = (d.op == DOP_ADD) ? 4 : 8;
+        size_t n = need - d.pos;
+        if (n > len) n = len;
+        memcpy(d.argBuf + d.pos, data, n);
+        d.pos += n; data += n; len -= n;
+        if (d.pos < need) break;
+
+        if (d.op == DOP_ADD) {
+          d.remaining = rd_u32(d.argBuf);
+          if (!out_fits(d, d.remaining)) return fail(d, DELTA_ERR_RANGE);
+          d.state = d.remaining ? DS_ADD : DS_OP;
+        } else {
+          const uint32_t off = rd_u32(d.argBuf);
+          const uint32_t cnt = rd_u32(d.argBuf + 4);
+          if (d.op == DOP_COPY) {
+            if (do_copy(d, off, cnt) != DELTA_OK) return (DeltaStatus)d.status;
+            d.state = DS_OP;
+          } else {
+            if (!base_fits(d, off, cnt) || !out_fits(d, cnt)) return fail(d, DELTA_ERR_RANGE);
+            d.srcOff = off;
+            d.remaining = cnt;
+            d.state = cnt ? DS_DIFF : DS_OP;
+          }
+        }
+        break;
+      }
+
+      case DS_ADD: {
+        size_t n = (d.remaining < len) ? d.remaining : len;
+        if (!d.write_out(d.ctx, data, n)) return fail(d, DELTA_ERR_WRITE);
+        d.outPos += n; d.remaining -= n; data += n; len -= n;
+        if (!d.remaining) d.state = DS_OP;
+        break;
+      }
+
+      case DS_DIFF: {
+        size_t n = (d.remaining < len) ? d.remaining : len;
+        if (n > DELTA_SCRATCH) n = DELTA_SCRATCH;
+        if (!d.read_base(d.ctx, d.srcOff, d.scratch, n)) return fail(d, DELTA_ERR_READ);
+        for (size_t i = 0; i < n; i++) d.scratch[i] = (uint8_t)(d.scratch[i] + data[i]);
+        if (!d.write_out(d.ctx, d.scratch, n)) return fail(d, DELTA_ERR_WRITE);
+        d.srcOff += n; d.outPos += n; d.remaining -= n; data += n; len -= n;
+        if (!d.remaining) d.state = DS_OP;
+        break;
+      }
+
+      case DS_END:
+        return fail(d, DELTA_ERR_TRAILING);
+
+      default:
+        return (DeltaStatus)d.status;
+    }
+  }
+
+  return (d.state == DS_END) ? DELTA_DONE : DELTA_OK;
+}
+
+bool delta_done(const DeltaApply& d) {
+  return d.state == DS_END;
+}
+
+const char* delta_status_str(DeltaStatus s) {
+  switch (s) {
+    case DELTA_OK:           return "ok";
+    case DELTA_DONE:         return "done";
+    case DELTA_ERR_MAGIC:    return "magic invalido";
+    case DELTA_ERR_HEADER:   return "base incompativel";
+    case DELTA_ERR_OP:       return "op invalida";
+    case DELTA_ERR_RANGE:    return "fora de faixa";
+    case DELTA_ERR_READ:     return "erro leitura base";
+    case DELTA_ERR_WRITE:    return "erro escrita";
+    case DELTA_ERR_TRAILING: return "dados apos END";
+    default:                 return "?";
+  }
+}
@@ -0,0 +1,107 @@
+#include "ota_flash.h"
+
+#include <esp_ota_ops.h>
+#include <mbedtls/sha256.h>
+
+// --- internos ---
+static const esp_partition_t* g_part = nullptr;
+static uint32_t g_written = 0;
+static uint32_t g_erasedTo = 0;   // [0, g_erasedTo) já apagado nesta sessão
+static char     g_err[48] = {0};
+
+static bool set_err(const char* what, esp_err_t e) {
+  snprintf(g_err, sizeof(g_err), "%s: %s", what, esp_err_to_name(e));
+  return false;
+}
+
+bool ota_flash_begin(uint32_t offset) {
+  g_err[0] = '\0';
+  g_part = esp_ota_get_next_update_partition(nullptr);
+  if (!g_part) {
+    snprintf(g_err, sizeof(g_err), "sem particao OTA");
+    return false;
+  }
+  if ((offset % SPI_FLASH_SEC_SIZE) != 0 || offset > g_part->size) {
+    snprintf(g_err, sizeof(g_err), "offset invalido %u", (unsigned)offset);
+    return false;
+  }
+
+  // [0, offset) veio de uma sessão anterior e já está gravado
+  g_written  = offset;
+  g_erasedTo = offset;
+  return true;
+}
+
+bool ota_flash_write(const uint8_t* buf, size_t len) {
+  if (!g_part) return false;
+  if (len > g_part->size - g_written) {
+    snprintf(g_err, sizeof(g_err), "imagem maior que %s", g_part->label);
+    return false;
+  }
+
+  // apaga sob demanda (setor a setor) antes de escrever
+  while (g_written + len > g_erasedTo) {
+    esp_err_t e = esp_partition_erase_range(g_part, g_erasedTo, SPI_FLASH_SEC_SIZE);
+    if (e != ESP_OK) return set_err("erase", e);
+    g_erasedTo += SPI_FLASH_SEC_SIZE;
+  }
+
+  esp_err_t e = esp_partition_write(g_part, g_written, buf, len);
+  if (e != ESP_OK) return set_err("write", e);
+
+  g_written += len;
+  return true;
+}
+
+uint32_t ota_flash_written() {
+  return g_written;
+}
+
+uint32_t ota_flash_committed() {
+  return g_written - (g_written % SPI_FLASH_SEC_SIZE);
+}
+
+const esp_partition_t* ota_flash_partition() {
+  return g_part;
+}
+
+bool ota_flash_sha256(uint32_t len, uint8_t out[32]) {
+  if (!g_part || len > g_part->size) return false;
+
+  mbedtls_sha256_context sha;
+  mbedtls_sha256_init(&sha);
+  mbedtls_sha256_starts_ret(&sha, 0);
+
+  uint8_t buf[512];
+  uint32_t off = 0;
+  bool ok = true;
+  while (off < len) {
+    const size_t n = (len - off > sizeof(buf)) ? sizeof(buf) : (len - off);
+    esp_err_t e = esp_partition_read(g_part, off, buf, n);
+    if (e != ESP_OK) { ok = set_err("read", e); break; }
+    mbedtls_sha256_update_ret(&sha, buf, n);
+    off += n;
+  }
+
+  if (ok) mbedtls_sha256_finish_ret(&sha, out);
+  mbedtls_sha256_free(&sha);
+  return ok;
+}
+
+bool ota_flash_finish() {
+  if (!g_part) return false;
+
+  // esp_ota_set_boot_partition roda esp_image_verify (checksum + SHA anexado)
+  esp_err_t e = esp_ota_set_boot_partition(g_part);
+  if (e != ESP_OK) return set_err("boot", e);
+  return true;
+}
+
+void ota_flash_abort() {
+  // nada a desfazer: a partição de boot só muda em ota_flash_finish()
+  g_part = nullptr;
+}
+
+const char* ota_flash_error() {
+  return g_err;
+}
@@ -0,0 +1,238 @@
+#include "ota_gzip.h"
+
+#include <esp32/rom/miniz.h>
+#include <esp32/rom/crc.h>
+
+// RFC 1952
+static const uint8_t GZ_FHCRC    = 0x02;
+static const uint8_t GZ_FEXTRA   = 0x04;
+static const uint8_t GZ_FNAME    = 0x08;
+static const uint8_t GZ_FCOMMENT = 0x10;
+
+enum GzState : uint8_t {
+  ST_HDR = 0,
+  ST_XLEN,
+  ST_EXTRA,
+  ST_NAME,
+  ST_COMMENT,
+  ST_HCRC,
+  ST_DATA,
+  ST_TRAILER,
+  ST_END,
+  ST_ERR
+};
+
+// --- internos ---
+static tinfl_decompressor* g_inf  = nullptr;
+static uint8_t*            g_dict = nullptr;   // janela circular TINFL_LZ_DICT_SIZE
+static size_t              g_dictOfs = 0;
+
+static GzWriteFn g_out = nullptr;
+static void*     g_ctx = nullptr;
+
+static uint8_t  g_state = ST_ERR;
+static uint8_t  g_status = GZ_OK;
+static uint8_t  g_flg = 0;
+static uint8_t  g_buf[10];        // header / xlen / hcrc / trailer
+static uint8_t  g_pos = 0;
+static uint16_t g_skip = 0;       // bytes restantes de FEXTRA
+
+static uint32_t g_crc = 0;
+static uint32_t g_in = 0;
+static uint32_t g_outBytes = 0;
+
+static GzStatus fail(GzStatus s) {
+  g_state = ST_ERR;
+  g_status = s;
+  return s;
+}
+
+// próximo campo opcional do header depois de 'from'
+static uint8_t next_hdr_state(uint8_t from) {
+  if (from < ST_XLEN    && (g_flg & GZ_FEXTRA))   return ST_XLEN;
+  if (from < ST_NAME    && (g_flg & GZ_FNAME))    return ST_NAME;
+  if (from < ST_COMMENT && (g_flg & GZ_FCOMMENT)) return ST_COMMENT;
+  if (from < ST_HCRC    && (g_flg & GZ_FHCRC))    return ST_HCRC;
+  return ST_DATA;
+}
+
+// acumula 'need' bytes em g_buf; true quando completou
+static bool take(const uint8_t*& data, size_t& len, uint8_t need) {
+  size_t n = need - g_pos;
+  if (n > len) n = len;
+  memcpy(g_buf + g_pos, data, n);
+  g_pos += n; data += n; len -= n;
+  return g_pos == need;
+}
+
+static GzStatus inflate_some(const uint8_t*& data, size_t& len) {
+  for (;;) {
+    size_t inSz  = len;
+    size_t outSz = TINFL_LZ_DICT_SIZE - g_dictOfs;
+
+    tinfl_status st = tinfl_decompress(g_inf, data, &inSz, g_dict, g_dict + g_dictOfs, &outSz,
+                                       TINFL_FLAG_HAS_MORE_INPUT);
+    data += inSz;
+    len  -= inSz;
+
+    if (outSz) {
+      const uint8_t* p = g_dict + g_dictOfs;
+      g_crc = crc32_le(g_crc, p, outSz);
+      g_outBytes += outSz;
+      if (!g_out(g_ctx, p, outSz)) return fail(GZ_ERR_WRITE);
+      g_dictOfs = (g_dictOfs + outSz) & (TINFL_LZ_DICT_SIZE - 1);
+    }
+
+    if (st < TINFL_STATUS_DONE) return fail(GZ_ERR_DATA);
+    if (st == TINFL_STATUS_DONE) {
+      // O tinfl da ROM (miniz 1.x) não devolve bytes inteiros que já puxou
+      // para o bit buffer além do fim do deflate: eles são o começo do trailer.
+      uint64_t bb = g_inf->m_bit_buf;
+      uint32_t nb = g_inf->m_num_bits;
+      bb >>= (nb & 7);
+      nb -= (nb & 7);
+      g_pos = 0;
+      while (nb >= 8 && g_pos < 8) {
+        g_buf[g_pos++] = (uint8_t)(bb & 0xFF);
+        bb >>= 8;
+        nb -= 8;
+      }
+      g_state = ST_TRAILER;
+      return GZ_OK;
+    }
+    // precisa de mais entrada e não tem: espera o próximo chunk
+    if (st == TINFL_STATUS_NEEDS_MORE_INPUT && len == 0) return GZ_OK;
+  }
+}
+
+bool gz_begin(GzWriteFn out, void* ctx) {
+  gz_end();
+
+#if HEAP_STATIC
+  static tinfl_decompressor inf;
+  static uint8_t dict[TINFL_LZ_DICT_SIZE];
+  g_inf  = &inf;
+  g_dict = dict;
+#else
+  g_inf  = (tinfl_decompressor*)malloc(sizeof(tinfl_decompressor));
+  g_dict = (uint8_t*)malloc(TINFL_LZ_DICT_SIZE);
+#endif
+  if (!g_inf || !g_dict) {
+    gz_end();
+    return false;
+  }
+  tinfl_init(g_inf);
+
+  g_out = out;
+  g_ctx = ctx;
+  g_dictOfs = 0;
+  g_state = ST_HDR;
+  g_status = GZ_OK;
+  g_flg = 0;
+  g_pos = 0;
+  g_skip = 0;
+  g_crc = 0;
+  g_in = 0;
+  g_outBytes = 0;
+  return true;
+}
+
+GzStatus gz_feed(const uint8_t* data, size_t len) {
+  if (g_state == ST_ERR) return (GzStatus)g_status;
+  g_in += len;
+
+  while (len) {
+    switch (g_state) {
+      case ST_HDR:
+        if (!take(data, len, 10)) break;
+        if (g_buf[0] != 0x1f || g_buf[1] != 0x8b || g_buf[2] != 8) return fail(GZ_ERR_HEADER);
+        g_flg = g_buf[3];
+        g_pos = 0;
+        g_state = next_hdr_state(ST_HDR);
+        break;
+
+      case ST_XLEN:
+        if (!take(data, len, 2)) break;
+        g_skip = (uint16_t)(g_buf[0] | (g_buf[1] << 8));
+        g_pos = 0;
+        g_state = g_skip ? (uint8_t)ST_EXTRA : next_hdr_state(ST_EXTRA);
+        break;
+
+      case ST_EXTRA: {
+        size_t n = (g_skip < len) ? g_skip : len;
+        data += n; len -= n; g_skip -= n;
+        if (!g_skip) g_state = next_hdr_state(ST_EXTRA);
+        break;
+      }
+
+      case ST_NAME:
+      case ST_COMMENT: {
+        // string terminada em zero
+        const uint8_t cur = g_state;
+        while (len) {
+          const uint8_t c = *data++; len--;
+          if (c == 0) { g_state = next_hdr_state(cur); break; }
+        }
+        break;
+      }
+
+      case ST_HCRC:
+        if (!take(data, len, 2)) break;
+        g_pos = 0;
+        g_state = ST_DATA;
+        break;
+
+      case ST_DATA:
+        if (inflate_some(data, len) != GZ_OK) return (GzStatus)g_status;
+        break;
+
+      case ST_TRAILER: {
+        if (!take(data, len, 8)) break;
+        const uint32_t crc   = (uint32_t)g_buf[0] | ((uint32_t)g_buf[1] << 8) |
+                               ((uint32_t)g_buf[2] << 16) | ((uint32_t)g_buf[3] << 24);
+        const uint32_t isize = (uint32_t)g_buf[4] | ((uint32_t)g_buf[5] << 8) |
+                               ((uint32_t)g_buf[6] << 16) | ((uint32_t)g_buf[7] << 24);
+        if (crc != g_crc || isize != g_outBytes) return fail(GZ_ERR_CRC);
+        g_state = ST_END;
+        break;
+      }
+
+      case ST_END:
+        return fail(GZ_ERR_TRAILING);
+
+      default:
+        return (GzStatus)g_status;
+    }
+  }
+
+  return (g_state == ST_END) ? GZ_DONE : GZ_OK;
+}
+
+bool gz_done() {
+  return g_state == ST_END;
+}
+
+void gz_end() {
+#if !HEAP_STATIC
+  free(g_inf);
+  free(g_dict);
+#endif
+  g_inf = nullptr;
+  g_dict = nullptr;
+}
+
+uint32_t gz_bytes_in()  { return g_in; }
+uint32_t gz_bytes_out() { return g_outBytes; }
+
+const char* gz_status_str(GzStatus s) {
+  switch (s) {
+    case GZ_OK:           return "ok";
+    case GZ_DONE:         return "done";
+    case GZ_ERR_HEADER:   return "header gzip invalido";
+    case GZ_ERR_DATA:     return "deflate invalido";
+    case GZ_ERR_CRC:      return "crc32 nao confere";
+    case GZ_ERR_WRITE:    return "erro escrita";
+    case GZ_ERR_TRAILING: return "dados apos trailer";
+    default:              return "?";
+  }
+}
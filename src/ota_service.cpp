@@ -3,18 +3,157 @@
 #include <WiFi.h>
 #include <WiFiClientSecure.h>
 #include <HTTPClient.h>
-#include <Update.h>
-#include <ArduinoJson.h>
-
+#include <Preferences.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <esp_image_format.h>
+#include <esp_heap_caps.h>
+
+#include "config.h"
 #include "mqtt_link.h"
+#include "msg_json.h"
+#include "ota_delta.h"
+#include "ota_flash.h"
+#include "ota_gzip.h"
+#include "heap_guard.h"
 
 struct OtaArgs {
-  String url;
-  bool reboot;
+  char    url[256];
+  bool    reboot;
+  bool    hasSha;
+  uint8_t sha[32];   // SHA-256 esperado da imagem final (opcional)
 };
 
+static OtaArgs g_args;   // um OTA por vez (g_otaRunning)
 static volatile bool g_otaRunning = false;
 static bool g_pausedMqttForOta = false;
+static volatile bool g_mqttKept = false;   // MQTT ficou no ar durante o OTA
+
+// Eventos vão por fila e são publicados pela task de rede (ota_poll):
+// com MQTT mantido, publicar da task do OTA disputaria o PubSubClient.
+struct OtaEvtItem {
+  uint16_t len;
+  char     json[600];
+};
+
+static const int OTA_EVTQ_LEN = 4;
+static QueueHandle_t g_evtQ = nullptr;
+
+TASK_SLOT(g_otaSlot, 8192);
+TASK_SLOT(g_netSlot, 4096);
+
+// ===== Pipeline rede -> flash =====
+// A task de rede enche buffers do pool (fila "free" -> fila "full") e a task
+// do OTA drena a fila "full" para a flash. Assim a latência de erase/write
+// da flash não segura o socket TLS e vice-versa.
+struct OtaChunk {
+  int8_t   idx;   // -1 = fim do stream
+  uint32_t len;
+};
+
+enum OtaNetResult : uint8_t {
+  OTA_NET_RUNNING = 0,
+  OTA_NET_DONE,       // recebeu tudo (ou servidor fechou sem Content-Length)
+  OTA_NET_SHORT,      // conexão caiu antes de Content-Length
+  OTA_NET_TIMEOUT,    // sem dados por OTA_STREAM_TIMEOUT_MS
+  OTA_NET_ABORTED     // writer pediu para parar
+};
+
+// Resultado de uma tentativa de download
+enum OtaRunResult : uint8_t {
+  OTA_RUN_OK = 0,
+  OTA_RUN_NET,        // falha de rede: dá para retomar com Range
+  OTA_RUN_FAIL        // erro definitivo (imagem/flash/servidor)
+};
+
+struct OtaNetCtx {
+  HTTPClient*  http;
+  WiFiClient*  stream;
+  int          contentLength;
+  TaskHandle_t writer;
+  volatile bool abort;
+  volatile uint8_t result;
+};
+
+struct OtaStats {
+  uint32_t tStart;
+  uint32_t bytesNet;
+  uint32_t bytesFlash;
+  uint32_t netStallMs;    // rede esperando buffer livre (flash é o gargalo)
+  uint32_t flashIdleMs;   // flash esperando dados (rede é o gargalo)
+  uint32_t writeMaxUs;
+  uint32_t writeTotalUs;
+  uint32_t chunks;
+  uint32_t resumes;       // retomadas com Range nesta execução
+  uint32_t resumedFrom;   // offset persistido usado no início (pós-reboot)
+  uint32_t heapMin;       // menor heap livre visto durante o download
+  uint32_t blockMin;      // menor maior-bloco livre
+  uint32_t tlsHttp;       // heap da sessão TLS do download (maior medida)
+};
+
+static uint8_t*      g_bufs[OTA_BUF_COUNT] = {nullptr};
+static QueueHandle_t g_qFree = nullptr;
+static QueueHandle_t g_qFull = nullptr;
+static OtaStats      g_stats;
+
+// ===== Sink: decide o formato pelos primeiros bytes e grava na flash =====
+// GZIP  = (opcional, 1f 8b) descomprime em streaming antes do resto
+// RAW   = imagem .bin completa (0xE9)
+// DELTA = patch EDP1 aplicado contra a partição que está rodando
+enum OtaFormat : uint8_t { OTA_FMT_NONE = 0, OTA_FMT_RAW, OTA_FMT_DELTA };
+
+struct OtaSink {
+  bool     sniffed;
+  bool     gzip;
+  uint8_t  format;
+  uint32_t streamPos;       // bytes do stream HTTP já consumidos pelo sink
+  uint32_t streamTotal;     // tamanho total do stream (0 se desconhecido)
+  uint32_t bytesOut;        // bytes gravados na flash nesta execução
+  const esp_partition_t* base;
+  char     err[48];         // erro do estágio interno (callback do gzip)
+};
+
+static OtaSink    g_sink;
+static DeltaApply g_delta;   // ~1.2 KB (scratch do apply), estático p/ não fragmentar heap
+
+// ===== Progresso persistido (NVS) p/ retomar depois de reboot =====
+// Só vale para imagem RAW sem gzip: aí offset do stream == offset na flash e
+// não há estado de descompressão a recuperar. Identidade = URL + ETag/SHA.
+struct OtaResume {
+  char     url[256];
+  char     etag[72];
+  bool     hasSha;
+  uint8_t  sha[32];
+  bool     reboot;
+  uint32_t total;     // tamanho total da imagem
+  uint32_t offset;    // bytes já na flash (múltiplo de setor)
+  uint32_t part;      // endereço da partição destino
+};
+
+static Preferences g_otaPrefs;
+static OtaResume   g_res;
+static uint32_t    g_resSavedOffset = 0;
+
+static const char* ota_fmt_str(uint8_t f) {
+  switch (f) {
+    case OTA_FMT_RAW:   return "raw";
+    case OTA_FMT_DELTA: return "delta";
+    default:            return "?";
+  }
+}
+
+// fila cheia: descarta o mais antigo (o último estado é o que interessa)
+static void ota_evt_push(OtaEvtItem& it, size_t len) {
+  if (!g_evtQ || len == 0) return;
+  it.len = (uint16_t)len;
+  if (xQueueSend(g_evtQ, &it, 0) != pdTRUE) {
+    OtaEvtItem old;
+    xQueueReceive(g_evtQ, &old, 0);
+    xQueueSend(g_evtQ, &it, 0);
+  }
+}
 
 static void ota_evt(const char* stage, int pct = -1, const char* msg = nullptr) {
   // Serial sempre (importante quando MQTT estiver pausado)
@@ -24,47 +163,494 @@ static void ota_evt(const char* stage, int pct = -1, const char* msg = nullptr)
   if (msg && msg[0]) { Serial.print(" - "); Serial.print(msg); }
   Serial.println();
 
-  // Publica EVT só se MQTT estiver conectado
-  if (!mqtt_is_connected()) return;
+  OtaEvtItem it;
+  ota_evt_push(it, msg_ota_json(it.json, sizeof(it.json), stage, pct, msg));
+}
 
-  StaticJsonDocument<256> doc;
-  doc["type"]  = "OTA";
-  doc["stage"] = stage;
-  if (pct >= 0) doc["pct"] = pct;
-  if (msg && msg[0]) doc["msg"] = msg;
+// Resumo do pipeline (vazão + onde ficou esperando)
+static void ota_evt_stats() {
+  const uint32_t ms = millis() - g_stats.tStart;
+  const float kbps = ms ? (g_stats.bytesFlash / 1024.0f) / (ms / 1000.0f) : 0.0f;
+  // vazão do lado descomprimido (só difere com gzip)
+  const uint32_t unz = g_sink.gzip ? gz_bytes_out() : g_stats.bytesFlash;
+  const float unzKbps = ms ? (unz / 1024.0f) / (ms / 1000.0f) : 0.0f;
+
+  Serial.printf("[OTA] STATS fmt=%s%s bytes=%u unz=%u out=%u ms=%u %.1fkB/s (unz %.1fkB/s) net_stall=%ums flash_idle=%ums wmax=%uus bufs=%ux%u resumes=%u from=%u mqtt=%d tls_mqtt=%u tls_http=%u heap_min=%u blk_min=%u\n",
+                ota_fmt_str(g_sink.format), g_sink.gzip ? "+gz" : "",
+                (unsigned)g_stats.bytesFlash, (unsigned)unz, (unsigned)g_sink.bytesOut, (unsigned)ms, kbps, unzKbps,
+                (unsigned)g_stats.netStallMs, (unsigned)g_stats.flashIdleMs,
+                (unsigned)g_stats.writeMaxUs, (unsigned)OTA_BUF_COUNT, (unsigned)OTA_BUF_SIZE,
+                (unsigned)g_stats.resumes, (unsigned)g_stats.resumedFrom,
+                (int)g_mqttKept, (unsigned)mqtt_tls_heap(), (unsigned)g_stats.tlsHttp,
+                (unsigned)g_stats.heapMin, (unsigned)g_stats.blockMin);
+
+  MsgOtaStats st;
+  st.fmt         = ota_fmt_str(g_sink.format);
+  st.gzip        = g_sink.gzip;
+  st.bytes       = g_stats.bytesFlash;
+  st.unzBytes    = unz;
+  st.outBytes    = g_sink.bytesOut;
+  st.ms          = ms;
+  st.kbps        = kbps;
+  st.unzKbps     = unzKbps;
+  st.netStallMs  = g_stats.netStallMs;
+  st.flashIdleMs = g_stats.flashIdleMs;
+  st.writeMaxUs  = g_stats.writeMaxUs;
+  st.writeAvgUs  = g_stats.chunks ? (uint32_t)(g_stats.writeTotalUs / g_stats.chunks) : 0;
+  st.bufs        = OTA_BUF_COUNT;
+  st.bufSize     = OTA_BUF_SIZE;
+  st.resumes     = g_stats.resumes;
+  st.resumedFrom = g_stats.resumedFrom;
+  st.mqttKept    = g_mqttKept;
+  st.tlsMqtt     = mqtt_tls_heap();
+  st.tlsHttp     = g_stats.tlsHttp;
+  st.heapMin     = g_stats.heapMin;
+  st.blkMin      = g_stats.blockMin;
+
+  OtaEvtItem it;
+  ota_evt_push(it, msg_ota_stats_json(it.json, sizeof(it.json), st));
+}
 
-  char out[256];
-  size_t n = serializeJson(doc, out, sizeof(out));
-  mqtt_publish_evt(out, n);
+static void ota_heap_sample() {
+  const uint32_t h = ESP.getFreeHeap();
+  const uint32_t b = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+  if (h < g_stats.heapMin) g_stats.heapMin = h;
+  if (b < g_stats.blockMin) g_stats.blockMin = b;
 }
 
-static void ota_task(void* pv) {
-  OtaArgs* a = reinterpret_cast<OtaArgs*>(pv);
-  g_otaRunning = true;
+// ---------------- MQTT durante o OTA ----------------
+// Mantém o MQTT se a 2ª sessão TLS + buffers do pipeline cabem no heap
+static bool ota_mqtt_admit() {
+#if OTA_KEEP_MQTT
+  if (!mqtt_is_connected()) return false;
+  const uint32_t bufHeap = HEAP_STATIC ? 0 : OTA_BUF_COUNT * OTA_BUF_SIZE;
+  const uint32_t need = OTA_TLS_SESSION_BYTES + bufHeap + OTA_HEAP_RESERVE;
+  const uint32_t heap = ESP.getFreeHeap();
+  const uint32_t blk  = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+  Serial.printf("[OTA] heap=%u blk=%u need=%u tls_mqtt=%u\n",
+                (unsigned)heap, (unsigned)blk, (unsigned)need, (unsigned)mqtt_tls_heap());
+  return heap >= need && blk >= OTA_TLS_BLOCK_MIN;
+#else
+  return false;
+#endif
+}
 
-  ota_evt("START", 0);
+static void ota_mqtt_pause() {
+  mqtt_pause(true);
+  g_pausedMqttForOta = true;
+  // desconecta na task de rede; espera liberar o heap da sessão
+  for (int i = 0; i < 100 && mqtt_is_connected(); i++) delay(10);
+  delay(50);
+}
 
-  if (WiFi.status() != WL_CONNECTED) {
-    ota_evt("FAIL", -1, "WiFi desconectado");
-    g_otaRunning = false;
-    delete a;
-    vTaskDelete(nullptr);
-    return;
+// Degrada para o comportamento antigo (pausa) quando o heap aperta
+static void ota_mqtt_release(const char* why) {
+  if (!g_mqttKept) return;
+  g_mqttKept = false;
+  Serial.printf("[OTA] pausando MQTT (%s)\n", why);
+  ota_mqtt_pause();
+}
+
+static int ota_pct() {
+  if (!g_sink.streamTotal) return -1;
+  return (int)((g_sink.streamPos * 100ULL) / g_sink.streamTotal);
+}
+
+// ---------------- progresso persistido ----------------
+static bool ota_resume_load(OtaResume& r) {
+  memset(&r, 0, sizeof(r));
+  g_otaPrefs.begin("ota", true);
+  const bool ok = (g_otaPrefs.getBytesLength("res") == sizeof(r)) &&
+                  (g_otaPrefs.getBytes("res", &r, sizeof(r)) == sizeof(r));
+  g_otaPrefs.end();
+  return ok && r.url[0] && r.offset > 0;
+}
+
+static void ota_resume_save() {
+  g_otaPrefs.begin("ota", false);
+  g_otaPrefs.putBytes("res", &g_res, sizeof(g_res));
+  g_otaPrefs.end();
+  g_resSavedOffset = g_res.offset;
+}
+
+static void ota_resume_clear() {
+  g_otaPrefs.begin("ota", false);
+  g_otaPrefs.remove("res");
+  g_otaPrefs.end();
+  g_resSavedOffset = 0;
+}
+
+static bool ota_resume_allowed() {
+  // sem ETag nem SHA não dá para garantir que é a mesma imagem depois do reboot
+  return g_sink.format == OTA_FMT_RAW && !g_sink.gzip && (g_res.etag[0] || g_res.hasSha);
+}
+
+// force=false: só grava a cada OTA_RESUME_SAVE_BYTES (poupa a NVS)
+static void ota_resume_checkpoint(bool force) {
+  if (!ota_resume_allowed()) return;
+  const uint32_t c = ota_flash_committed();
+  if (c <= g_resSavedOffset) return;
+  if (!force && c - g_resSavedOffset < OTA_RESUME_SAVE_BYTES) return;
+  g_res.offset = c;
+  g_res.total  = g_sink.streamTotal;
+  ota_resume_save();
+}
+
+// ---------------- sink ----------------
+static bool ota_out_write(void* ctx, const uint8_t* buf, size_t len) {
+  (void)ctx;
+  if (!ota_flash_write(buf, len)) return false;
+  g_sink.bytesOut += len;
+  return true;
+}
+
+// Header do patch: só aceita se a base for exatamente a imagem que está rodando
+static bool ota_delta_header(void* ctx, const DeltaHeader& h) {
+  (void)ctx;
+  const esp_partition_t* run = esp_ota_get_running_partition();
+  uint8_t sha[32];
+  if (!run || esp_partition_get_sha256(run, sha) != ESP_OK) return false;
+
+  if (memcmp(sha, h.base_sha256, sizeof(sha)) != 0) {
+    Serial.println("[OTA] delta: base nao e a imagem rodando");
+    return false;
   }
+  if (h.base_size > run->size) return false;
 
-  // ===== FIX PRINCIPAL =====
-  // Pausa MQTT/TLS durante o OTA para evitar conflito de duas conexões TLS
-  // (MQTT 8883 + HTTPS GitHub) que causa SSL internal error (-27648).
-  g_pausedMqttForOta = false;
-  if (!mqtt_is_paused()) {
-    mqtt_pause(true);
-    g_pausedMqttForOta = true;
-    delay(200);
+  const esp_partition_t* dst = ota_flash_partition();
+  if (!dst || h.target_size > dst->size) return false;
+
+  g_sink.base = run;
+  Serial.printf("[OTA] delta: base=%s %u -> %s %u bytes\n",
+                run->label, (unsigned)h.base_size, dst->label, (unsigned)h.target_size);
+  return true;
+}
+
+static bool ota_delta_read(void* ctx, uint32_t off, uint8_t* buf, size_t len) {
+  (void)ctx;
+  return esp_partition_read(g_sink.base, off, buf, len) == ESP_OK;
+}
+
+static void ota_sink_begin() {
+  memset(&g_sink, 0, sizeof(g_sink));
+}
+
+// Estágio de imagem (depois do gzip, se houver): RAW ou DELTA
+static bool ota_image_write(void* ctx, const uint8_t* buf, size_t len) {
+  (void)ctx;
+  if (g_sink.format == OTA_FMT_NONE) {
+    // primeiro chunk: buffer cheio do pipeline ou saída do inflate
+    if (len >= 4 && memcmp(buf, DELTA_MAGIC, 4) == 0) {
+      g_sink.format = OTA_FMT_DELTA;
+      delta_begin(g_delta, ota_delta_header, ota_delta_read, ota_out_write, nullptr);
+    } else if (len >= 1 && buf[0] == ESP_IMAGE_HEADER_MAGIC) {
+      g_sink.format = OTA_FMT_RAW;
+    } else {
+      snprintf(g_sink.err, sizeof(g_sink.err), "formato desconhecido (0x%02X)", buf[0]);
+      return false;
+    }
   }
 
-  Serial.printf("[OTA] free heap=%u\n", (unsigned)ESP.getFreeHeap());
-  Serial.print("[OTA] URL: ");
-  Serial.println(a->url);
+  if (g_sink.format == OTA_FMT_DELTA) {
+    DeltaStatus st = delta_feed(g_delta, buf, len);
+    if (st != DELTA_OK && st != DELTA_DONE) {
+      snprintf(g_sink.err, sizeof(g_sink.err), "delta: %s", delta_status_str(st));
+      return false;
+    }
+    return true;
+  }
+
+  if (!ota_out_write(nullptr, buf, len)) {
+    snprintf(g_sink.err, sizeof(g_sink.err), "%s", ota_flash_error());
+    return false;
+  }
+  return true;
+}
+
+static bool ota_sink_write(const uint8_t* buf, size_t len, char* err, size_t errLen) {
+  if (!g_sink.sniffed) {
+    g_sink.sniffed = true;
+    if (len >= 2 && buf[0] == 0x1f && buf[1] == 0x8b) {
+      if (g_mqttKept && ESP.getFreeHeap() < GZ_HEAP_BYTES + OTA_HEAP_RESERVE) {
+        ota_mqtt_release("heap gzip");
+      }
+      if (!gz_begin(ota_image_write, nullptr)) {
+        snprintf(err, errLen, "sem heap p/ gzip");
+        return false;
+      }
+      g_sink.gzip = true;
+    }
+  }
+
+  if (g_sink.gzip) {
+    GzStatus st = gz_feed(buf, len);
+    if (st != GZ_OK && st != GZ_DONE) {
+      if (st == GZ_ERR_WRITE) snprintf(err, errLen, "%s", g_sink.err);
+      else                    snprintf(err, errLen, "gzip: %s", gz_status_str(st));
+      return false;
+    }
+  } else if (!ota_image_write(nullptr, buf, len)) {
+    snprintf(err, errLen, "%s", g_sink.err);
+    return false;
+  }
+
+  g_sink.streamPos += len;
+  return true;
+}
+
+static void ota_sink_abort() {
+  ota_flash_abort();
+  if (g_sink.gzip) gz_end();
+  g_sink.gzip = false;
+}
+
+// Fecha a imagem: confere o SHA-256 lido de volta da flash (alvo do patch e/ou
+// "sha256" do comando) antes de trocar a partição de boot
+static bool ota_sink_end(const OtaArgs* a, char* err, size_t errLen) {
+  if (g_sink.gzip) {
+    const bool complete = gz_done();
+    gz_end();
+    g_sink.gzip = false;
+    if (!complete) {
+      snprintf(err, errLen, "gzip incompleto");
+      ota_sink_abort();
+      return false;
+    }
+  }
+
+  if (g_sink.format == OTA_FMT_DELTA && !delta_done(g_delta)) {
+    snprintf(err, errLen, "patch incompleto");
+    ota_sink_abort();
+    return false;
+  }
+
+  const uint8_t* expect[2] = { nullptr, nullptr };
+  if (g_sink.format == OTA_FMT_DELTA) expect[0] = g_delta.hdr.target_sha256;
+  if (a->hasSha) expect[1] = a->sha;
+
+  if (expect[0] || expect[1]) {
+    uint8_t sha[32];
+    if (!ota_flash_sha256(ota_flash_written(), sha)) {
+      snprintf(err, errLen, "%s", ota_flash_error());
+      ota_sink_abort();
+      return false;
+    }
+    for (int i = 0; i < 2; i++) {
+      if (expect[i] && memcmp(sha, expect[i], sizeof(sha)) != 0) {
+        snprintf(err, errLen, "sha256 nao confere");
+        ota_sink_abort();
+        return false;
+      }
+    }
+  }
+
+  if (!ota_flash_finish()) {
+    snprintf(err, errLen, "%s", ota_flash_error());
+    return false;
+  }
+  return true;
+}
+
+static void ota_pipeline_free() {
+  for (int i = 0; i < OTA_BUF_COUNT; i++) {
+#if !HEAP_STATIC
+    free(g_bufs[i]);
+#endif
+    g_bufs[i] = nullptr;
+  }
+  if (g_qFree) { vQueueDelete(g_qFree); g_qFree = nullptr; }
+  if (g_qFull) { vQueueDelete(g_qFull); g_qFull = nullptr; }
+}
+
+static bool ota_pipeline_alloc() {
+#if HEAP_STATIC
+  static StaticQueue_t qsFree, qsFull;
+  static uint8_t qbFree[OTA_BUF_COUNT * sizeof(int8_t)];
+  static uint8_t qbFull[(OTA_BUF_COUNT + 1) * sizeof(OtaChunk)];
+  static uint8_t pool[OTA_BUF_COUNT][OTA_BUF_SIZE];
+  g_qFree = xQueueCreateStatic(OTA_BUF_COUNT, sizeof(int8_t), qbFree, &qsFree);
+  g_qFull = xQueueCreateStatic(OTA_BUF_COUNT + 1, sizeof(OtaChunk), qbFull, &qsFull);
+  for (int i = 0; i < OTA_BUF_COUNT; i++) g_bufs[i] = pool[i];
+  return true;
+#else
+  g_qFree = xQueueCreate(OTA_BUF_COUNT, sizeof(int8_t));
+  g_qFull = xQueueCreate(OTA_BUF_COUNT + 1, sizeof(OtaChunk)); // +1 p/ sentinela
+  if (!g_qFree || !g_qFull) {
+    ota_pipeline_free();
+    return false;
+  }
+
+  for (int i = 0; i < OTA_BUF_COUNT; i++) {
+    g_bufs[i] = (uint8_t*)malloc(OTA_BUF_SIZE);
+    if (!g_bufs[i]) {
+      ota_pipeline_free();
+      return false;
+    }
+  }
+  return true;
+#endif
+}
+
+// todos os buffers de volta na fila livre (início de cada tentativa)
+static void ota_pipeline_reset() {
+  xQueueReset(g_qFree);
+  xQueueReset(g_qFull);
+  for (int8_t i = 0; i < OTA_BUF_COUNT; i++) xQueueSend(g_qFree, &i, 0);
+}
+
+// ===== Estágio 1: rede -> buffers =====
+static void ota_net_task(void* pv) {
+  OtaNetCtx* c = reinterpret_cast<OtaNetCtx*>(pv);
+
+  OtaChunk cur = { -1, 0 };
+  uint32_t total = 0;
+  uint32_t lastActivity = millis();
+  uint8_t result = OTA_NET_RUNNING;
+
+  while (result == OTA_NET_RUNNING) {
+    if (c->abort) { result = OTA_NET_ABORTED; break; }
+
+    // pega buffer livre (se não houver, a flash está atrasada)
+    if (cur.idx < 0) {
+      const uint32_t t0 = millis();
+      int8_t idx;
+      const bool got = (xQueueReceive(g_qFree, &idx, pdMS_TO_TICKS(100)) == pdTRUE);
+      g_stats.netStallMs += millis() - t0;
+      if (!got) continue;
+      cur.idx = idx;
+      cur.len = 0;
+    }
+
+    size_t avail = c->stream->available();
+    if (avail) {
+      const size_t room = OTA_BUF_SIZE - cur.len;
+      int n = c->stream->read(g_bufs[cur.idx] + cur.len, (avail > room) ? room : avail);
+      if (n > 0) {
+        cur.len += (uint32_t)n;
+        total += (uint32_t)n;
+        g_stats.bytesNet += (uint32_t)n;
+        lastActivity = millis();
+      }
+      if (c->contentLength > 0 && total >= (uint32_t)c->contentLength) result = OTA_NET_DONE;
+    } else if (!c->http->connected()) {
+      result = (c->contentLength > 0) ? OTA_NET_SHORT : OTA_NET_DONE;
+    } else if (millis() - lastActivity > OTA_STREAM_TIMEOUT_MS) {
+      // timeout de stream (evita loop infinito em conexão ruim)
+      result = OTA_NET_TIMEOUT;
+    } else {
+      vTaskDelay(pdMS_TO_TICKS(2));
+    }
+
+    // entrega buffer cheio (ou o último parcial)
+    if (cur.idx >= 0 && (cur.len == OTA_BUF_SIZE || (result != OTA_NET_RUNNING && cur.len > 0))) {
+      xQueueSend(g_qFull, &cur, portMAX_DELAY);
+      cur.idx = -1;
+    }
+  }
+
+  c->result = result;
+
+  OtaChunk end = { -1, 0 };
+  xQueueSend(g_qFull, &end, portMAX_DELAY);
+
+  xTaskNotifyGive(c->writer);
+  task_slot_exit();
+}
+
+// ===== Estágio 2: buffers -> flash (roda na task do OTA) =====
+// OTA_RUN_NET = rede falhou mas o que chegou foi gravado (dá para retomar).
+static OtaRunResult ota_pipeline_run(HTTPClient& http, int contentLength, char* err, size_t errLen) {
+  ota_pipeline_reset();
+
+  OtaNetCtx ctx;
+  ctx.http          = &http;
+  ctx.stream        = http.getStreamPtr();
+  ctx.contentLength = contentLength;
+  ctx.writer        = xTaskGetCurrentTaskHandle();
+  ctx.abort         = false;
+  ctx.result        = OTA_NET_RUNNING;
+
+  if (!task_slot_start(g_netSlot, ota_net_task, "ota_net", &ctx, 2, tskNO_AFFINITY)) {
+    snprintf(err, errLen, "falha task rede");
+    return OTA_RUN_FAIL;
+  }
+
+  bool writeOk = true;
+  uint32_t lastEvtMs = 0;
+
+  for (;;) {
+    OtaChunk ck;
+    const uint32_t t0 = millis();
+    const bool got = (xQueueReceive(g_qFull, &ck, pdMS_TO_TICKS(1000)) == pdTRUE);
+    g_stats.flashIdleMs += millis() - t0;
+    if (!got) continue;
+    if (ck.idx < 0) break;  // sentinela: rede terminou
+
+    if (writeOk) {
+      const uint32_t w0 = micros();
+      const bool w = ota_sink_write(g_bufs[ck.idx], ck.len, err, errLen);
+      const uint32_t dt = micros() - w0;
+
+      g_stats.writeTotalUs += dt;
+      if (dt > g_stats.writeMaxUs) g_stats.writeMaxUs = dt;
+      g_stats.chunks++;
+
+      if (!w) {
+        writeOk = false;
+        ctx.abort = true;  // rede para e manda sentinela
+      } else {
+        g_stats.bytesFlash += ck.len;
+        ota_resume_checkpoint(false);
+        ota_heap_sample();
+      }
+    }
+
+    xQueueSend(g_qFree, &ck.idx, 0);
+
+    // progresso por tempo (não por %)
+    const uint32_t now = millis();
+    if (writeOk && now - lastEvtMs >= OTA_PROGRESS_MS) {
+      lastEvtMs = now;
+      const int pct = ota_pct();
+      if (pct >= 0) {
+        ota_evt("DOWNLOADING", pct);
+      } else {
+        char msg[24];
+        snprintf(msg, sizeof(msg), "%u kB", (unsigned)(g_sink.streamPos / 1024));
+        ota_evt("DOWNLOADING", -1, msg);
+      }
+    }
+  }
+
+  // garante que a task de rede já saiu antes de liberar buffers/HTTP
+  ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+  if (!writeOk) return OTA_RUN_FAIL;
+
+  switch (ctx.result) {
+    case OTA_NET_DONE:    return OTA_RUN_OK;
+    case OTA_NET_TIMEOUT: snprintf(err, errLen, "timeout stream"); return OTA_RUN_NET;
+    case OTA_NET_SHORT:   snprintf(err, errLen, "conexao caiu (%u/%u)",
+                                   (unsigned)g_sink.streamPos, (unsigned)g_sink.streamTotal); return OTA_RUN_NET;
+    default:              snprintf(err, errLen, "rede abortada"); return OTA_RUN_FAIL;
+  }
+}
+
+// "bytes 1000-1999/5000" -> start=1000 total=5000
+static bool parse_content_range(const String& cr, uint32_t& start, uint32_t& total) {
+  const char* s = cr.c_str();
+  if (strncmp(s, "bytes ", 6) != 0) return false;
+  char* end = nullptr;
+  start = strtoul(s + 6, &end, 10);
+  const char* slash = strchr(s, '/');
+  if (!end || *end != '-' || !slash || slash[1] == '*') return false;
+  total = strtoul(slash + 1, nullptr, 10);
+  return total > start;
+}
+
+// Uma tentativa: GET a partir de g_sink.streamPos (Range) e roda o pipeline
+static OtaRunResult ota_fetch(const OtaArgs* a, char* err, size_t errLen) {
+  const uint32_t from = g_sink.streamPos;
 
   WiFiClientSecure client;
   client.setInsecure();
@@ -76,116 +662,200 @@ static void ota_task(void* pv) {
   http.setTimeout(15000);
 
   if (!http.begin(client, a->url)) {
-    ota_evt("FAIL", -1, "http.begin falhou");
-    if (g_pausedMqttForOta) mqtt_pause(false);
-    g_pausedMqttForOta = false;
-    g_otaRunning = false;
-    delete a;
-    vTaskDelete(nullptr);
-    return;
+    snprintf(err, errLen, "http.begin falhou");
+    return OTA_RUN_NET;
   }
 
+  const char* keys[] = { "ETag", "Content-Range" };
+  http.collectHeaders(keys, 2);
+
+  if (from > 0) {
+    char range[24];
+    snprintf(range, sizeof(range), "bytes=%u-", (unsigned)from);
+    http.addHeader("Range", range);
+    // se a imagem mudou no servidor ele responde 200 com o arquivo inteiro
+    if (g_res.etag[0]) http.addHeader("If-Range", g_res.etag);
+  }
+
+  const uint32_t heap0 = ESP.getFreeHeap();
   int httpCode = http.GET();
+  const uint32_t heap1 = ESP.getFreeHeap();
+  if (heap0 > heap1 && heap0 - heap1 > g_stats.tlsHttp) g_stats.tlsHttp = heap0 - heap1;
 
   // Quando TLS falha, httpCode pode ser <= 0
   if (httpCode <= 0) {
-    char msg[64];
-    snprintf(msg, sizeof(msg), "GET falhou (%d)", httpCode);
-    ota_evt("FAIL", -1, msg);
+    snprintf(err, errLen, "GET falhou (%d)", httpCode);
     http.end();
-    if (g_pausedMqttForOta) mqtt_pause(false);
-    g_pausedMqttForOta = false;
-    g_otaRunning = false;
-    delete a;
-    vTaskDelete(nullptr);
-    return;
+    return OTA_RUN_NET;
   }
 
-  if (httpCode != HTTP_CODE_OK) {
-    char msg[32];
-    snprintf(msg, sizeof(msg), "HTTP %d", httpCode);
-    ota_evt("FAIL", -1, msg);
+  if (from > 0 && httpCode == HTTP_CODE_OK) {
+    snprintf(err, errLen, "sem suporte a Range ou imagem mudou");
     http.end();
-    if (g_pausedMqttForOta) mqtt_pause(false);
-    g_pausedMqttForOta = false;
-    g_otaRunning = false;
-    delete a;
-    vTaskDelete(nullptr);
-    return;
+    return OTA_RUN_FAIL;
   }
 
-  int contentLength = http.getSize();
-
-  if (!Update.begin(contentLength > 0 ? contentLength : UPDATE_SIZE_UNKNOWN)) {
-    ota_evt("FAIL", -1, "Update.begin erro");
+  if (httpCode != HTTP_CODE_OK && httpCode != HTTP_CODE_PARTIAL_CONTENT) {
+    snprintf(err, errLen, "HTTP %d", httpCode);
     http.end();
-    if (g_pausedMqttForOta) mqtt_pause(false);
-    g_pausedMqttForOta = false;
-    g_otaRunning = false;
-    delete a;
-    vTaskDelete(nullptr);
-    return;
+    return (httpCode >= 500) ? OTA_RUN_NET : OTA_RUN_FAIL;
   }
 
-  WiFiClient* stream = http.getStreamPtr();
+  const int contentLength = http.getSize();
+  const String etag = http.header("ETag");
 
-  uint8_t buffer[1024];
-  size_t written = 0;
-  int lastPct = -1;
-  uint32_t lastActivity = millis();
+  if (httpCode == HTTP_CODE_PARTIAL_CONTENT) {
+    uint32_t start = 0, total = 0;
+    if (!parse_content_range(http.header("Content-Range"), start, total) || start != from ||
+        (g_sink.streamTotal && total != g_sink.streamTotal)) {
+      snprintf(err, errLen, "Content-Range invalido");
+      http.end();
+      return OTA_RUN_FAIL;
+    }
+    if (g_res.etag[0] && etag.length() && strcmp(etag.c_str(), g_res.etag) != 0) {
+      snprintf(err, errLen, "ETag mudou");
+      http.end();
+      return OTA_RUN_FAIL;
+    }
+    g_sink.streamTotal = total;
+  } else {
+    g_sink.streamTotal = (contentLength > 0) ? (uint32_t)contentLength : 0;
+    strlcpy(g_res.etag, etag.c_str(), sizeof(g_res.etag));
+  }
 
-  while (http.connected()) {
-    size_t avail = stream->available();
+  const OtaRunResult r = ota_pipeline_run(http, contentLength, err, errLen);
+  http.end();
+  return r;
+}
 
-    if (avail) {
-      int n = stream->readBytes(buffer, (avail > sizeof(buffer)) ? sizeof(buffer) : avail);
-      if (n > 0) {
-        Update.write(buffer, n);
-        written += (size_t)n;
-        lastActivity = millis();
+// Progresso salvo serve para este pedido? (mesma URL, identidade e partição)
+static bool ota_resume_match(const OtaResume& r, const OtaArgs* a, const esp_partition_t* next) {
+  if (!next || strcmp(r.url, a->url) != 0) return false;
+  if (r.part != next->address || r.offset > next->size) return false;
+  if (!r.etag[0] && !r.hasSha) return false;
+  if (a->hasSha && (!r.hasSha || memcmp(r.sha, a->sha, sizeof(r.sha)) != 0)) return false;
+  return true;
+}
 
-        if (contentLength > 0) {
-          int pct = (int)((written * 100UL) / (unsigned long)contentLength);
-          if (pct != lastPct) {
-            lastPct = pct;
-            ota_evt("DOWNLOADING", pct);
-          }
-          if ((int)written >= contentLength) break;
-        }
-      }
-    } else {
-      // timeout de stream (evita loop infinito em conexão ruim)
-      if (millis() - lastActivity > 20000) {
-        ota_evt("FAIL", -1, "timeout stream");
-        Update.abort();
-        http.end();
-        if (g_pausedMqttForOta) mqtt_pause(false);
-        g_pausedMqttForOta = false;
-        g_otaRunning = false;
-        delete a;
-        vTaskDelete(nullptr);
-        return;
-      }
-      vTaskDelay(5);
-    }
+// Download + gravação com retomada. Retorna true se a imagem foi validada e
+// a partição de boot trocada.
+static bool ota_run(const OtaArgs* a, char* err, size_t errLen) {
+  Serial.printf("[OTA] free heap=%u\n", (unsigned)ESP.getFreeHeap());
+  Serial.print("[OTA] URL: ");
+  Serial.println(a->url);
+
+  memset(&g_stats, 0, sizeof(g_stats));
+  g_stats.tStart = millis();
+  g_stats.heapMin = g_stats.blockMin = UINT32_MAX;
+  ota_sink_begin();
+
+  const esp_partition_t* next = esp_ota_get_next_update_partition(nullptr);
+  OtaResume saved;
+  uint32_t offset = 0;
+  if (ota_resume_load(saved) && ota_resume_match(saved, a, next)) {
+    g_res = saved;
+    offset = saved.offset;
+  } else {
+    memset(&g_res, 0, sizeof(g_res));
+    strlcpy(g_res.url, a->url, sizeof(g_res.url));
+    g_res.hasSha = a->hasSha;
+    memcpy(g_res.sha, a->sha, sizeof(g_res.sha));
+    g_res.part = next ? next->address : 0;
+    ota_resume_clear();
   }
+  g_res.reboot = a->reboot;
+  g_resSavedOffset = offset;
 
-  if (!Update.end(true)) {
-    ota_evt("FAIL", -1, Update.errorString());
-    http.end();
-    if (g_pausedMqttForOta) mqtt_pause(false);
-    g_pausedMqttForOta = false;
+  if (!ota_flash_begin(offset)) {
+    snprintf(err, errLen, "%s", ota_flash_error());
+    return false;
+  }
+
+  if (offset) {
+    // só RAW sem gzip é persistido (ota_resume_allowed): pula o sniff
+    g_sink.sniffed      = true;
+    g_sink.format       = OTA_FMT_RAW;
+    g_sink.streamPos    = offset;
+    g_sink.streamTotal  = g_res.total;
+    g_stats.resumedFrom = offset;
+
+    char msg[32];
+    snprintf(msg, sizeof(msg), "retomando de %u", (unsigned)offset);
+    ota_evt("RESUME", ota_pct(), msg);
+  }
+
+  if (!ota_pipeline_alloc()) {
+    snprintf(err, errLen, "sem heap p/ buffers");
+    ota_sink_abort();
+    return false;
+  }
+
+  // Falha de rede: sink (gzip/delta/flash) continua onde parou, só pede o
+  // resto do stream com Range
+  OtaRunResult r = ota_fetch(a, err, errLen);
+  for (uint8_t t = 1; r == OTA_RUN_NET && t <= OTA_RESUME_TRIES; t++) {
+    g_stats.resumes++;
+    // handshake/stream falhou com 2 sessões TLS: tenta de novo sozinho
+    ota_mqtt_release("falha rede");
+    ota_resume_checkpoint(true);
+    ota_evt("RESUME", ota_pct(), err);
+    vTaskDelay(pdMS_TO_TICKS(OTA_RESUME_BACKOFF_MS * t));
+    r = ota_fetch(a, err, errLen);
+  }
+
+  ota_pipeline_free();
+  ota_heap_sample();
+
+  if (r != OTA_RUN_OK) {
+    // rede: mantém progresso salvo, o próximo ota_url (ou reconexão) retoma daqui
+    if (r == OTA_RUN_NET) ota_resume_checkpoint(true);
+    else                  ota_resume_clear();
+    ota_sink_abort();
+    ota_evt_stats();
+    return false;
+  }
+
+  ota_evt_stats();
+  const bool ok = ota_sink_end(a, err, errLen);
+
+  // imagem boa já terminou; imagem ruim não deve ser retomada
+  ota_resume_clear();
+  return ok;
+}
+
+static void ota_task(void* pv) {
+  OtaArgs* a = reinterpret_cast<OtaArgs*>(pv);
+  g_otaRunning = true;
+
+  ota_evt("START", 0);
+
+  if (WiFi.status() != WL_CONNECTED) {
+    ota_evt("FAIL", -1, "WiFi desconectado");
     g_otaRunning = false;
-    delete a;
-    vTaskDelete(nullptr);
+    task_slot_exit();
     return;
   }
 
-  http.end();
-  ota_evt("DONE", 100);
+  // Duas sessões TLS (MQTT 8883 + HTTPS) sem heap suficiente dão
+  // SSL internal error (-27648). Mantém o MQTT só se couber no orçamento;
+  // senão pausa MQTT/TLS durante o OTA como antes.
+  g_pausedMqttForOta = false;
+  g_mqttKept = false;
+  if (!mqtt_is_paused()) {
+    if (ota_mqtt_admit()) {
+      g_mqttKept = true;
+      ota_evt("MQTT", -1, "mantido");
+    } else {
+      ota_mqtt_pause();
+    }
+  }
+
+  char err[64] = {0};
+  const bool ok = ota_run(a, err, sizeof(err));
+  const bool reboot = ok && a->reboot;
 
-  bool reboot = a->reboot;
-  delete a;
+  if (ok) ota_evt("DONE", 100);
+  else    ota_evt("FAIL", -1, err);
 
   g_otaRunning = false;
 
@@ -196,46 +866,106 @@ static void ota_task(void* pv) {
   g_pausedMqttForOta = false;
 
   if (reboot) {
+    // MQTT no ar: dá tempo da task de rede publicar STATS/DONE
+    for (int i = 0; i < 200 && g_mqttKept && uxQueueMessagesWaiting(g_evtQ); i++) delay(10);
     delay(500);
     ESP.restart();
   }
+  g_mqttKept = false;
 
-  vTaskDelete(nullptr);
+  task_slot_exit();
 }
 
-bool ota_start_url(const char* url, bool reboot_after) {
+static bool parse_sha256_hex(const char* hex, uint8_t out[32]) {
+  if (!hex || strlen(hex) != 64) return false;
+  for (int i = 0; i < 32; i++) {
+    char b[3] = { hex[2 * i], hex[2 * i + 1], 0 };
+    char* end = nullptr;
+    out[i] = (uint8_t)strtoul(b, &end, 16);
+    if (!end || *end) return false;
+  }
+  return true;
+}
+
+static bool ends_with(const char* s, const char* suf) {
+  const size_t n = strlen(s), m = strlen(suf);
+  return n >= m && strcmp(s + n - m, suf) == 0;
+}
+
+bool ota_start_url(const char* url, bool reboot_after, const char* sha256_hex) {
   if (!url || !url[0]) return false;
   if (g_otaRunning) return false;
 
-  String u(url);
+  if (!g_evtQ) {
+#if HEAP_STATIC
+    static StaticQueue_t qs;
+    static uint8_t qb[OTA_EVTQ_LEN * sizeof(OtaEvtItem)];
+    g_evtQ = xQueueCreateStatic(OTA_EVTQ_LEN, sizeof(OtaEvtItem), qb, &qs);
+#else
+    g_evtQ = xQueueCreate(OTA_EVTQ_LEN, sizeof(OtaEvtItem));
+#endif
+  }
 
-  if (!u.startsWith("http")) {
+  if (strncmp(url, "http", 4) != 0 || strlen(url) >= sizeof(g_args.url)) {
     ota_evt("FAIL", -1, "URL invalida");
     return false;
   }
 
-  if (!u.endsWith(".bin")) {
-    ota_evt("FAIL", -1, "Nao termina .bin");
+  // .bin = imagem completa, .patch = delta (tools/ota_delta.py), .gz = qualquer
+  // um dos dois comprimido; formato real é confirmado pelos bytes mágicos
+  if (!ends_with(url, ".bin") && !ends_with(url, ".patch") && !ends_with(url, ".gz")) {
+    ota_evt("FAIL", -1, "Nao termina .bin/.patch/.gz");
     return false;
   }
 
-  auto* a = new OtaArgs{u, reboot_after};
+  OtaArgs& a = g_args;
+  memset(&a, 0, sizeof(a));
+  strlcpy(a.url, url, sizeof(a.url));
+  a.reboot = reboot_after;
 
-  if (xTaskCreate(
-        ota_task,
-        "ota",
-        8192,
-        a,
-        1,
-        nullptr
-      ) != pdPASS) {
-    delete a;
+  if (sha256_hex && sha256_hex[0]) {
+    if (!parse_sha256_hex(sha256_hex, a.sha)) {
+      ota_evt("FAIL", -1, "sha256 invalido");
+      return false;
+    }
+    a.hasSha = true;
+  }
+
+  // marca já aqui: g_args fica reservado até a task terminar
+  g_otaRunning = true;
+  if (!task_slot_start(g_otaSlot, ota_task, "ota", &a, 1, tskNO_AFFINITY)) {
+    g_otaRunning = false;
     return false;
   }
 
   return true;
 }
 
+bool ota_resume_pending() {
+  if (g_otaRunning) return false;
+
+  OtaResume r;
+  if (!ota_resume_load(r)) return false;
+
+  char hex[65] = {0};
+  if (r.hasSha) {
+    for (int i = 0; i < 32; i++) snprintf(hex + 2 * i, 3, "%02x", r.sha[i]);
+  }
+
+  Serial.printf("[OTA] retomada pendente: %u/%u\n", (unsigned)r.offset, (unsigned)r.total);
+  return ota_start_url(r.url, r.reboot, r.hasSha ? hex : nullptr);
+}
+
+void ota_poll() {
+  if (!g_evtQ) return;
+  if (!mqtt_is_connected() || mqtt_is_paused()) return;
+
+  OtaEvtItem it;
+  while (xQueueReceive(g_evtQ, &it, 0) == pdTRUE) {
+    mqtt_publish_evt(it.json, it.len);
+  }
+}
+
 bool ota_is_running() {
   return g_otaRunning;
 }
@@ -0,0 +1,265 @@
+#include "sched_prog.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <esp32/rom/crc.h>
+#include <math.h>
+
+#include "journal.h"
+
+// ---------------- texto -> programa ----------------
+static bool fail(char* err, size_t n, const char* msg) {
+  if (err && n) strlcpy(err, msg, n);
+  return false;
+}
+
+bool sched_parse(const char* s, float spMin, float spMax, SchedProg& p, char* err, size_t errLen) {
+  memset(&p, 0, sizeof(p));
+  p.tzMin = SCHED_TZ_MIN;
+  if (!s || !*s) return true;   // sem programa
+
+  switch (*s++) {
+    case 'D': case 'd': p.kind = SK_DAILY; break;
+    case 'R': case 'r': p.kind = SK_ONCE;  break;
+    case 'L': case 'l': p.kind = SK_LOOP;  break;
+    default: return fail(err, errLen, "tipo (D/R/L)");
+  }
+
+  if (*s == '@') {
+    char* e;
+    const long tz = strtol(s + 1, &e, 10);
+    if (e == s + 1 || tz < -840 || tz > 840) return fail(err, errLen, "tz");
+    p.tzMin = (int16_t)tz;
+    s = e;
+  }
+  if (*s++ != ':') return fail(err, errLen, "falta ':'");
+
+  // D: minuto do dia; R/L: até 60 dias
+  const uint32_t maxMin = (p.kind == SK_DAILY) ? 1439 : 60u * 1440;
+  for (;;) {
+    if (p.n >= SCHED_MAX_STEPS) return fail(err, errLen, "passos demais");
+    const bool ramp = (*s == '~');
+    if (ramp) s++;
+
+    char* e;
+    const unsigned long m = strtoul(s, &e, 10);
+    if (e == s || *e != '=' || m > maxMin) return fail(err, errLen, "minuto");
+    s = e + 1;
+    const float v = strtof(s, &e);
+    if (e == s || !isfinite(v) || v < spMin || v > spMax) return fail(err, errLen, "sp fora da faixa");
+    s = e;
+
+    const uint32_t t = (uint32_t)m * 60;
+    if (p.n && t <= p.t[p.n - 1]) return fail(err, errLen, "minutos fora de ordem");
+    p.t[p.n]  = t;
+    p.sp[p.n] = v;
+    if (ramp) p.rampMask |= (uint16_t)(1u << p.n);
+    p.n++;
+
+    if (*s == '\0') break;
+    if (*s++ != ',') return fail(err, errLen, "separador");
+  }
+
+  if (p.kind != SK_DAILY) {
+    if (p.t[0] != 0)        return fail(err, errLen, "1o passo em 0");
+    if (p.rampMask & 1u)    return fail(err, errLen, "rampa no 1o passo");
+    if (p.kind == SK_LOOP && p.n < 2) return fail(err, errLen, "loop precisa de 2 passos");
+  }
+  return true;
+}
+
+// sp sem zeros sobrando: 30, 30.5, 30.25
+static int fmt_sp(char* out, size_t cap, float v) {
+  int n = snprintf(out, cap, "%.2f", v);
+  if (n <= 0 || (size_t)n >= cap) return n;
+  while (n > 0 && out[n - 1] == '0') out[--n] = '\0';
+  if (n > 0 && out[n - 1] == '.') out[--n] = '\0';
+  return n;
+}
+
+size_t sched_format(const SchedProg& p, char* out, size_t cap) {
+  if (!cap) return 0;
+  out[0] = '\0';
+  if (p.kind == SK_NONE) return 0;
+
+  static const char K[] = { '-', 'D', 'R', 'L' };
+  size_t len = (size_t)snprintf(out, cap, "%c@%d:", K[p.kind & 3], (int)p.tzMin);
+  for (uint8_t i = 0; i < p.n && len < cap; i++) {
+    int w = snprintf(out + len, cap - len, "%s%s%lu=", i ? "," : "",
+                     (p.rampMask & (1u << i)) ? "~" : "", (unsigned long)(p.t[i] / 60));
+    if (w < 0) break;
+    len += (size_t)w;
+    if (len >= cap) break;
+    w = fmt_sp(out + len, cap - len, p.sp[i]);
+    if (w < 0) break;
+    len += (size_t)w;
+  }
+  if (len >= cap) { out[0] = '\0'; return 0; }   // não cabe: melhor nada que metade
+  return len;
+}
+
+// ---------------- avaliação ----------------
+// Valor el s depois do início do trecho i -> j (rampa se j chega em rampa)
+static float seg_value(const SchedProg& p, uint8_t i, uint8_t j, uint32_t el, uint32_t dur) {
+  if (i == j || !(p.rampMask & (1u << j)) || dur == 0) return p.sp[i];
+  if (el >= dur) return p.sp[j];
+  return p.sp[i] + (p.sp[j] - p.sp[i]) * ((float)el / (float)dur);
+}
+
+// último passo com t <= x (-1 = nenhum)
+static int last_le(const SchedProg& p, uint32_t x) {
+  int i = -1;
+  while (i + 1 < p.n && p.t[i + 1] <= x) i++;
+  return i;
+}
+
+bool sched_eval(const SchedProg& p, uint32_t epoch, SchedOut& o) {
+  if (p.kind == SK_NONE || p.n == 0 || epoch == 0) return false;
+  o.done = false;
+
+  if (p.kind == SK_DAILY) {
+    const int64_t loc = (int64_t)epoch + (int64_t)p.tzMin * 60;
+    const uint32_t x  = (uint32_t)(((loc % 86400) + 86400) % 86400);
+    const uint32_t midnight = epoch - x;   // meia-noite local em epoch
+
+    int i = last_le(p, x);
+    if (i < 0) {                           // antes do 1º passo: vale o último de ontem
+      i = p.n - 1;
+      o.segStart = midnight - 86400 + p.t[i];
+    } else {
+      o.segStart = midnight + p.t[i];
+    }
+    const uint8_t j = (uint8_t)((i + 1) % p.n);
+    const uint32_t dur = (p.t[j] + 86400 - p.t[i]) % 86400;
+    o.seg = (uint8_t)i;
+    o.sp  = seg_value(p, (uint8_t)i, j, epoch - o.segStart, dur ? dur : 86400);
+    return true;
+  }
+
+  // R / L: tempo desde o início
+  if (p.start == 0 || epoch < p.start) return false;
+  uint32_t e = epoch - p.start;
+  uint32_t base = p.start;
+  const uint32_t end = p.t[p.n - 1];
+
+  if (p.kind == SK_LOOP) {
+    base += e - e % end;
+    e %= end;
+  } else if (e >= end) {
+    o.done = true;
+    o.seg = (uint8_t)(p.n - 1);
+    o.segStart = p.start + end;
+    o.sp = p.sp[p.n - 1];
+    return true;
+  }
+
+  const int i = last_le(p, e);             // t[0] = 0: sempre acha
+  o.seg = (uint8_t)i;
+  o.segStart = base + p.t[i];
+  o.sp = seg_value(p, (uint8_t)i, (uint8_t)(i + 1), e - p.t[i], p.t[i + 1] - p.t[i]);
+  return true;
+}
+
+// ---------------- runtime ----------------
+// Programa em pedaços de JRNL_VAL_MAX no journal + CRC do todo numa chave
+// própria (queda no meio da gravação = descarta, não roda metade)
+static const uint8_t SCHED_CHUNKS = (sizeof(SchedProg) + JRNL_VAL_MAX - 1) / JRNL_VAL_MAX;
+static_assert(JK_SCHED0 + SCHED_CHUNKS <= JK_HIST0, "SchedProg nao cabe nas chaves do journal");
+
+static QueueHandle_t g_q = nullptr;   // rede -> controle (1 programa, sobrescreve)
+static SchedProg g_posted;            // lado da rede
+
+// lado do controle
+static SchedProg g_run;
+static bool      g_ovr = false;
+static uint32_t  g_ovrSeg = 0;
+static uint32_t  g_curSeg = 0;
+static int8_t    g_seg = -1;
+static uint32_t  g_start = 0;
+
+static void sched_save(const SchedProg& p) {
+  uint8_t buf[SCHED_CHUNKS * JRNL_VAL_MAX];
+  memset(buf, 0, sizeof(buf));
+  memcpy(buf, &p, sizeof(p));
+  for (uint8_t i = 0; i < SCHED_CHUNKS; i++) jrnl_put(JK_SCHED0 + i, buf + i * JRNL_VAL_MAX, JRNL_VAL_MAX);
+  const uint32_t crc = crc32_le(0, buf, sizeof(buf));
+  jrnl_put(JK_SCHED, &crc, sizeof(crc));
+}
+
+static bool sched_load(SchedProg& p) {
+  uint8_t buf[SCHED_CHUNKS * JRNL_VAL_MAX];
+  uint32_t crc;
+  if (!jrnl_get(JK_SCHED, &crc, sizeof(crc))) return false;
+  for (uint8_t i = 0; i < SCHED_CHUNKS; i++) {
+    if (!jrnl_get(JK_SCHED0 + i, buf + i * JRNL_VAL_MAX, JRNL_VAL_MAX)) return false;
+  }
+  if (crc32_le(0, buf, sizeof(buf)) != crc) return false;
+  memcpy(&p, buf, sizeof(p));
+  return p.kind <= SK_LOOP && p.n <= SCHED_MAX_STEPS;
+}
+
+void sched_begin() {
+  if (!g_q) g_q = xQueueCreate(1, sizeof(SchedProg));
+  memset(&g_run, 0, sizeof(g_run));
+  if (!sched_load(g_run)) memset(&g_run, 0, sizeof(g_run));
+  g_posted = g_run;
+  g_start  = g_run.start;
+  g_ovr    = false;
+  g_seg    = -1;
+}
+
+void sched_post(const SchedProg& p) {
+  g_posted = p;
+  if (g_q) xQueueOverwrite(g_q, &p);
+}
+
+const SchedProg& sched_prog() {
+  return g_posted;
+}
+
+bool sched_step(uint32_t epoch, float& sp) {
+  SchedProg np;
+  if (g_q && xQueueReceive(g_q, &np, 0) == pdTRUE) {
+    g_run = np;
+    g_ovr = false;
+    sched_save(g_run);
+  }
+
+  if (g_run.kind == SK_NONE) { g_seg = -1; g_start = 0; return false; }
+
+  // rampa: começa no primeiro passo com hora válida (e sobrevive ao reboot)
+  if (g_run.kind != SK_DAILY && g_run.start == 0 && epoch) {
+    g_run.start = epoch;
+    sched_save(g_run);
+  }
+  g_start = g_run.start;
+
+  SchedOut o;
+  if (!sched_eval(g_run, epoch, o)) { g_seg = -1; return false; }
+  g_seg    = (int8_t)o.seg;
+  g_curSeg = o.segStart;
+
+  if (g_ovr) {
+    if (o.segStart == g_ovrSeg) return false;
+    g_ovr = false;   // passo novo: programa volta a mandar
+  }
+  sp = o.sp;
+  return true;
+}
+
+void sched_override() {
+  if (g_run.kind == SK_NONE || g_seg < 0) return;
+  g_ovr = true;
+  g_ovrSeg = g_curSeg;
+}
+
+bool sched_overridden() {
+  return g_ovr;
+}
+
+int8_t sched_seg() {
+  return g_seg;
+}
+
+uint32_t sched_start() {
+  return g_start;
+}
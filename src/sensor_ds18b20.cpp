@@ -2,10 +2,14 @@
 
 #include <OneWire.h>
 #include <DallasTemperature.h>
+#include <new>
 
 // --- internos ---
 static OneWire* oneWire = nullptr;
 static DallasTemperature* sensors = nullptr;
+// objetos no armazenamento estático (placement new), não no heap
+alignas(OneWire) static uint8_t oneWireMem[sizeof(OneWire)];
+alignas(DallasTemperature) static uint8_t sensorsMem[sizeof(DallasTemperature)];
 
 static bool found = false;
 
@@ -17,6 +21,10 @@ static unsigned long tLastReq = 0;
 static unsigned long tConvStart = 0;
 
 static uint8_t resBits = 10;
+
+// custo da última leitura (bench)
+static volatile uint32_t readSeq = 0;
+static volatile uint32_t readCycles = 0;
 static const unsigned long TEMP_PERIOD_MS = 200; // pede conversão periodicamente
 
 static unsigned long conversionTimeMs(uint8_t bits) {
@@ -37,8 +45,8 @@ static bool find_first_sensor() {
 void sensor_begin(uint8_t pinDQ, uint8_t resolutionBits) {
   resBits = resolutionBits;
 
-  oneWire = new OneWire(pinDQ);
-  sensors = new DallasTemperature(oneWire);
+  oneWire = new (oneWireMem) OneWire(pinDQ);
+  sensors = new (sensorsMem) DallasTemperature(oneWire);
 
   sensors->begin();
   sensors->setWaitForConversion(false); // chave para não travar
@@ -78,7 +86,10 @@ void sensor_update(unsigned long nowMs) {
   if (convPending && (nowMs - tConvStart) >= waitMs) {
     convPending = false;
 
+    const uint32_t c0 = ESP.getCycleCount();
     float t = sensors->getTempCByIndex(0);
+    readCycles = ESP.getCycleCount() - c0;
+    readSeq = readSeq + 1;
     if (t == DEVICE_DISCONNECTED_C) {
       tempValid = false;
       found = false; // força re-detecção
@@ -101,3 +112,8 @@ bool sensor_has_value() {
 float sensor_get_c() {
   return lastTempC;
 }
+
+void sensor_read_timing(uint32_t& seq, uint32_t& cycles) {
+  seq = readSeq;
+  cycles = readCycles;
+}
@@ -0,0 +1,557 @@
+#include "tsdb.h"
+
+#include <stddef.h>
+#include <time.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <esp_partition.h>
+#include <esp32/rom/crc.h>
+
+#include "config.h"
+
+// ---- Layout ----
+// [MIN: TSDB_SECT_MIN setores][HOUR][DAY]; cada setor:
+//   header (32 B) | frames...
+// frame = len u8 | linha hist_codec (delta contra o frame anterior do setor) | crc8
+// len 0xFF = flash apagada (fim do setor)
+static const uint32_t TSDB_MAGIC   = 0x42445354;   // "TSDB"
+static const uint8_t  TSDB_VER     = 2;
+static const uint16_t HDR_SIZE     = 32;
+static const uint16_t FRAME_MAX    = 2 + HC_ROW_MAX_BYTES;
+static const uint32_t NO_TS        = 0xFFFFFFFF;
+
+struct SectHdr {
+  uint32_t magic;
+  uint8_t  tier;
+  uint8_t  ver;
+  uint16_t rsv;
+  uint32_t seq;       // nº do setor no anel (cresce sempre)
+  uint32_t firstTs;   // ts do 1º registro (gravado junto com ele) p/ seek
+};
+
+struct TsdbRing {
+  uint32_t base;      // offset na partição
+  uint16_t sectors;
+  uint32_t headSeq;   // setor sendo escrito
+  uint16_t headOff;   // próximo byte livre nele
+  HcState  st;        // última linha gravada no setor (base do delta)
+  bool     hasLast;
+  TsdbRec  last;
+};
+
+// Acumulador de um intervalo (minuto a partir de amostras, hora/dia a partir
+// de registros do nível de baixo). Somas ponderadas pelo nº de amostras.
+struct TsdbAcc {
+  uint32_t key;       // intervalo (ts / período) ou marcador "sem NTP"
+  uint32_t ts;
+  uint32_t n, nT, nOn;
+  uint16_t parts;     // registros-filho já somados
+  int32_t  tMin, tMax, spMin, spMax;
+  int32_t  uMin, uMax;
+  int64_t  tSum, spSum, uSum;
+};
+
+static const uint32_t KEY_NO_TIME = 0x80000000u;
+static const uint32_t PERIOD[TSDB_TIERS]   = { 60, 3600, 86400 };
+static const uint16_t CHILDREN[TSDB_TIERS] = { 60, 60, 24 };    // p/ rollup sem NTP
+
+// --- internos ---
+static const esp_partition_t* g_part = nullptr;
+static TsdbRing          g_ring[TSDB_TIERS];
+static TsdbAcc           g_minAcc;                // só a task de controle mexe
+static TsdbAcc           g_roll[TSDB_TIERS];      // HOUR/DAY: só a task tsdb mexe
+static TsdbAcc           g_rollNt[TSDB_TIERS];    // idem, registros sem NTP (ts 0)
+static QueueHandle_t     g_q = nullptr;
+static SemaphoreHandle_t g_lock = nullptr;        // anéis (escrita x leitura)
+static TsdbStats         g_stats;
+
+static uint32_t epoch_or_zero() {
+  const time_t now = time(nullptr);
+  return (now > 1577836800) ? (uint32_t)now : 0;   // > 2020-01-01
+}
+
+static uint8_t frame_crc(const uint8_t* p, size_t len) {
+  return (uint8_t)crc32_le(0, p, len);
+}
+
+static int16_t clamp16(int32_t v) {
+  if (v < INT16_MIN) return INT16_MIN;
+  if (v > INT16_MAX) return INT16_MAX;
+  return (int16_t)v;
+}
+
+// ---------------- acumuladores ----------------
+static void acc_reset(TsdbAcc& a, uint32_t key, uint32_t ts) {
+  memset(&a, 0, sizeof(a));
+  a.key = key;
+  a.ts  = ts;
+  a.tMin = a.spMin = a.uMin = INT32_MAX;
+  a.tMax = a.spMax = a.uMax = INT32_MIN;
+}
+
+static void acc_add_sample(TsdbAcc& a, bool tValid, int32_t t, int32_t sp, int32_t u, bool on) {
+  a.n++;
+  if (on) a.nOn++;
+  if (tValid) {
+    a.nT++;
+    a.tSum += t;
+    if (t < a.tMin) a.tMin = t;
+    if (t > a.tMax) a.tMax = t;
+  }
+  a.spSum += sp;
+  if (sp < a.spMin) a.spMin = sp;
+  if (sp > a.spMax) a.spMax = sp;
+  a.uSum += u;
+  if (u < a.uMin) a.uMin = u;
+  if (u > a.uMax) a.uMax = u;
+}
+
+static void acc_add_rec(TsdbAcc& a, const TsdbRec& r) {
+  a.parts++;
+  a.n   += r.n;
+  a.nOn += (uint32_t)(((uint64_t)r.onPct * r.n + 50) / 100);
+  if (r.nT) {
+    a.nT   += r.nT;
+    a.tSum += (int64_t)r.tAvg * r.nT;
+    if (r.tMin < a.tMin) a.tMin = r.tMin;
+    if (r.tMax > a.tMax) a.tMax = r.tMax;
+  }
+  a.spSum += (int64_t)r.spAvg * r.n;
+  if (r.spMin < a.spMin) a.spMin = r.spMin;
+  if (r.spMax > a.spMax) a.spMax = r.spMax;
+  a.uSum += (int64_t)r.uAvg * r.n;
+  if (r.uMin < a.uMin) a.uMin = r.uMin;
+  if (r.uMax > a.uMax) a.uMax = r.uMax;
+}
+
+static void acc_to_rec(const TsdbAcc& a, uint8_t tier, TsdbRec& r) {
+  memset(&r, 0, sizeof(r));
+  r.ts   = a.ts;
+  r.n    = a.n;
+  r.nT   = a.nT;
+  r.tier = tier;
+  if (a.nT) {
+    r.tMin = clamp16(a.tMin);
+    r.tAvg = clamp16((int32_t)(a.tSum / (int64_t)a.nT));
+    r.tMax = clamp16(a.tMax);
+  }
+  if (a.n) {
+    r.spMin = clamp16(a.spMin);
+    r.spAvg = clamp16((int32_t)(a.spSum / (int64_t)a.n));
+    r.spMax = clamp16(a.spMax);
+    r.uMin  = (uint16_t)a.uMin;
+    r.uAvg  = (uint16_t)(a.uSum / (int64_t)a.n);
+    r.uMax  = (uint16_t)a.uMax;
+    r.onPct = (uint8_t)(((uint64_t)a.nOn * 100 + a.n / 2) / a.n);
+  }
+}
+
+// ---------------- linha do codec ----------------
+void tsdb_to_row(const TsdbRec& r, HcRow& out) {
+  out.ts = r.ts;
+  int32_t* v = out.v;
+  v[0]  = (int32_t)r.n;    v[1]  = (int32_t)r.nT;
+  v[2]  = r.tMin;          v[3]  = r.tAvg;   v[4]  = r.tMax;
+  v[5]  = r.spMin;         v[6]  = r.spAvg;  v[7]  = r.spMax;
+  v[8]  = r.uMin;          v[9]  = r.uAvg;   v[10] = r.uMax;
+  v[11] = r.onPct;
+}
+
+void tsdb_from_row(const HcRow& row, uint8_t tier, TsdbRec& out) {
+  const int32_t* v = row.v;
+  memset(&out, 0, sizeof(out));
+  out.ts    = row.ts;
+  out.n     = (uint32_t)v[0];  out.nT    = (uint32_t)v[1];
+  out.tMin  = (int16_t)v[2];   out.tAvg  = (int16_t)v[3];   out.tMax  = (int16_t)v[4];
+  out.spMin = (int16_t)v[5];   out.spAvg = (int16_t)v[6];   out.spMax = (int16_t)v[7];
+  out.uMin  = (uint16_t)v[8];  out.uAvg  = (uint16_t)v[9];  out.uMax  = (uint16_t)v[10];
+  out.onPct = (uint8_t)v[11];
+  out.tier  = tier;
+}
+
+// ---------------- anel de setores ----------------
+static uint32_t sect_addr(const TsdbRing& g, uint32_t seq) {
+  return g.base + (seq % g.sectors) * SPI_FLASH_SEC_SIZE;
+}
+
+static uint32_t ring_first_seq(const TsdbRing& g) {
+  // setor seguinte ao head é apagado quando o anel avança
+  return (g.headSeq >= (uint32_t)(g.sectors - 1)) ? g.headSeq - (g.sectors - 1) : 0;
+}
+
+static bool sect_start(TsdbRing& g, uint8_t tier, uint32_t seq) {
+  const uint32_t addr = sect_addr(g, seq);
+
+  // head avança mesmo se falhar: o setor fica sem header e a leitura pula
+  g.headSeq = seq;
+  g.headOff = HDR_SIZE;
+  hc_state_reset(g.st);
+
+  if (esp_partition_erase_range(g_part, addr, SPI_FLASH_SEC_SIZE) != ESP_OK) return false;
+  g_stats.erases++;
+
+  SectHdr h;
+  memset(&h, 0xFF, sizeof(h));
+  h.magic = TSDB_MAGIC;
+  h.tier  = tier;
+  h.ver   = TSDB_VER;
+  h.seq   = seq;
+  return esp_partition_write(g_part, addr, &h, sizeof(h)) == ESP_OK;
+}
+
+static bool sect_hdr_read(const TsdbRing& g, uint8_t tier, uint32_t seq, SectHdr& h) {
+  if (esp_partition_read(g_part, sect_addr(g, seq), &h, sizeof(h)) != ESP_OK) return false;
+  return h.magic == TSDB_MAGIC && h.tier == tier && h.ver == TSDB_VER && h.seq == seq;
+}
+
+enum FrameRes : uint8_t { FR_OK = 0, FR_END, FR_BAD };
+
+// Lê/decodifica o frame em 'off' do setor; avança st e off
+static FrameRes frame_read(const TsdbRing& g, uint32_t seq, uint16_t& off, HcState& st, HcRow& row) {
+  if (off + 2 > SPI_FLASH_SEC_SIZE) return FR_END;
+
+  uint8_t buf[FRAME_MAX];
+  const uint16_t n = (SPI_FLASH_SEC_SIZE - off < FRAME_MAX) ? (SPI_FLASH_SEC_SIZE - off) : FRAME_MAX;
+  if (esp_partition_read(g_part, sect_addr(g, seq) + off, buf, n) != ESP_OK) return FR_BAD;
+
+  const uint8_t len = buf[0];
+  if (len == 0xFF) return FR_END;
+  if (len == 0 || len + 2 > n) return FR_BAD;
+  if (frame_crc(buf, 1 + len) != buf[1 + len]) return FR_BAD;
+
+  HcReader r;
+  hc_reader_init(r, buf + 1, len);
+  if (!hc_get_row(r, st, row)) return FR_BAD;
+
+  off += len + 2;
+  return FR_OK;
+}
+
+// Percorre os frames do setor: deixa st/off no fim e o último registro em last
+static bool sect_scan(const TsdbRing& g, uint8_t tier, uint32_t seq, HcState& st, uint16_t& off,
+                      TsdbRec* last, bool* hasLast) {
+  hc_state_reset(st);
+  off = HDR_SIZE;
+  for (;;) {
+    HcRow row;
+    const FrameRes fr = frame_read(g, seq, off, st, row);
+    if (fr == FR_END) return true;
+    if (fr == FR_BAD) return false;
+    if (last) tsdb_from_row(row, tier, *last);
+    if (hasLast) *hasLast = true;
+  }
+}
+
+// Acha o setor com maior seq e o fim dos frames nele
+static void ring_recover(TsdbRing& g, uint8_t tier) {
+  bool found = false;
+  uint32_t best = 0;
+  for (uint16_t s = 0; s < g.sectors; s++) {
+    SectHdr h;
+    if (esp_partition_read(g_part, g.base + s * SPI_FLASH_SEC_SIZE, &h, sizeof(h)) != ESP_OK) continue;
+    if (h.magic != TSDB_MAGIC || h.tier != tier || h.ver != TSDB_VER) continue;
+    if ((h.seq % g.sectors) != s) continue;
+    if (!found || h.seq > best) { best = h.seq; found = true; }
+  }
+
+  g.hasLast = false;
+  if (!found) {
+    sect_start(g, tier, 0);
+    return;
+  }
+
+  g.headSeq = best;
+  if (!sect_scan(g, tier, best, g.st, g.headOff, &g.last, &g.hasLast)) {
+    // frame corrompido (queda no meio da escrita): continua no próximo setor
+    g.headOff = SPI_FLASH_SEC_SIZE;
+  }
+
+  // setor novo ainda vazio: último registro está no anterior
+  if (!g.hasLast && best > ring_first_seq(g)) {
+    SectHdr h;
+    HcState st;
+    uint16_t off;
+    if (sect_hdr_read(g, tier, best - 1, h)) sect_scan(g, tier, best - 1, st, off, &g.last, &g.hasLast);
+  }
+}
+
+static bool ring_append(TsdbTier tier, const TsdbRec& r) {
+  TsdbRing& g = g_ring[tier];
+
+  HcRow row;
+  tsdb_to_row(r, row);
+
+  const uint32_t t0 = micros();
+  xSemaphoreTake(g_lock, portMAX_DELAY);
+
+  uint8_t  frame[FRAME_MAX];
+  HcState  st;
+  uint16_t size = 0;
+  bool ok = true;
+
+  for (int pass = 0; pass < 2; pass++) {
+    st = g.st;
+    HcWriter w;
+    hc_writer_init(w, frame + 1, HC_ROW_MAX_BYTES);
+    hc_put_row(w, st, row);
+    const uint8_t len = (uint8_t)hc_writer_bytes(w);
+    frame[0] = len;
+    frame[1 + len] = frame_crc(frame, 1 + len);
+    size = len + 2;
+
+    if (g.headOff + size <= SPI_FLASH_SEC_SIZE) break;
+    // não cabe: setor novo, delta recomeça do zero
+    ok = sect_start(g, tier, g.headSeq + 1);
+  }
+
+  if (ok) {
+    const uint32_t addr = sect_addr(g, g.headSeq);
+    const bool first = (g.headOff == HDR_SIZE);
+    ok = (esp_partition_write(g_part, addr + g.headOff, frame, size) == ESP_OK);
+    if (ok && first) {
+      esp_partition_write(g_part, addr + offsetof(SectHdr, firstTs), &r.ts, sizeof(r.ts));
+    }
+  }
+
+  if (ok) {
+    g.headOff += size;
+    g.st = st;
+    g.last = r;
+    g.last.tier = tier;
+    g.hasLast = true;
+  } else {
+    // cadeia de deltas do setor quebrou: o próximo registro abre outro setor
+    g.headOff = SPI_FLASH_SEC_SIZE;
+  }
+
+  xSemaphoreGive(g_lock);
+
+  const uint32_t dt = micros() - t0;
+  if (dt > g_stats.writeMaxUs) g_stats.writeMaxUs = dt;
+  if (ok) {
+    g_stats.written[tier]++;
+    g_stats.bytes[tier] += size;
+  }
+  return ok;
+}
+
+// ---------------- rollup incremental ----------------
+static void roll_feed(TsdbTier tier, const TsdbRec& r);
+
+static void roll_close(TsdbTier tier, TsdbAcc& a) {
+  TsdbRec out;
+  acc_to_rec(a, tier, out);
+  ring_append(tier, out);
+  if (tier + 1 < TSDB_TIERS) roll_feed((TsdbTier)(tier + 1), out);
+  a.parts = 0;
+}
+
+// r (nível de baixo) entra no acumulador de 'tier'; fecha o intervalo quando
+// r pertence ao próximo. Sem NTP (ts 0) vai p/ outro acumulador, que fecha
+// a cada CHILDREN registros ou quando a hora chega: nunca fecha o intervalo
+// com hora (no boot o roll_rebuild já reabriu ele com a chave de verdade).
+static void roll_feed(TsdbTier tier, const TsdbRec& r) {
+  TsdbAcc& nt = g_rollNt[tier];
+  if (!r.ts) {
+    if (nt.parts >= CHILDREN[tier]) roll_close(tier, nt);
+    if (!nt.parts) acc_reset(nt, KEY_NO_TIME, 0);
+    acc_add_rec(nt, r);
+    return;
+  }
+  if (nt.parts) roll_close(tier, nt);
+
+  TsdbAcc& a = g_roll[tier];
+  const uint32_t key = r.ts / PERIOD[tier];
+  if (a.parts && key != a.key) roll_close(tier, a);
+  if (!a.parts) acc_reset(a, key, key * PERIOD[tier]);
+  acc_add_rec(a, r);
+}
+
+// Depois do boot: refaz o acumulador do intervalo em aberto relendo os
+// registros-filho dele (no máx. CHILDREN registros)
+static void roll_rebuild(TsdbTier tier) {
+  const TsdbTier child = (TsdbTier)(tier - 1);
+
+  TsdbRec r;
+  if (!tsdb_last(child, r) || !r.ts) return;
+
+  TsdbAcc& a = g_roll[tier];
+  const uint32_t key = r.ts / PERIOD[tier];
+  acc_reset(a, key, key * PERIOD[tier]);
+
+  TsdbCursor c;
+  tsdb_seek(c, child, key * PERIOD[tier]);
+  while (tsdb_next(c, r)) {
+    if (r.ts && r.ts / PERIOD[tier] == key) acc_add_rec(a, r);
+  }
+}
+
+static void tsdb_task(void* pv) {
+  (void)pv;
+  for (;;) {
+    TsdbRec r;
+    if (xQueueReceive(g_q, &r, portMAX_DELAY) != pdTRUE) continue;
+    ring_append(TSDB_MIN, r);
+    roll_feed(TSDB_HOUR, r);
+  }
+}
+
+// ---------------- API ----------------
+bool tsdb_begin() {
+  g_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_SPIFFS, TSDB_PARTITION);
+  if (!g_part) {
+    Serial.println("[TSDB] particao nao encontrada");
+    return false;
+  }
+
+  const uint16_t sect[TSDB_TIERS] = { TSDB_SECT_MIN, TSDB_SECT_HOUR, TSDB_SECT_DAY };
+  uint32_t base = 0;
+  for (int t = 0; t < TSDB_TIERS; t++) {
+    g_ring[t].base    = base;
+    g_ring[t].sectors = (sect[t] < 2) ? 2 : sect[t];
+    base += g_ring[t].sectors * SPI_FLASH_SEC_SIZE;
+  }
+  if (base > g_part->size) {
+    Serial.println("[TSDB] setores nao cabem na particao");
+    g_part = nullptr;
+    return false;
+  }
+
+  // boot de verdade já começa zerado; o SIL refaz o begin depois da "queda"
+  memset(&g_stats, 0, sizeof(g_stats));
+  memset(&g_minAcc, 0, sizeof(g_minAcc));
+  memset(g_roll, 0, sizeof(g_roll));
+  memset(g_rollNt, 0, sizeof(g_rollNt));
+  g_lock = xSemaphoreCreateMutex();
+  g_q    = xQueueCreate(TSDB_QUEUE_LEN, sizeof(TsdbRec));
+  if (!g_lock || !g_q) {
+    g_part = nullptr;
+    return false;
+  }
+
+  for (int t = 0; t < TSDB_TIERS; t++) ring_recover(g_ring[t], (uint8_t)t);
+  roll_rebuild(TSDB_HOUR);
+  roll_rebuild(TSDB_DAY);
+
+  Serial.printf("[TSDB] head min=%u/%u hour=%u/%u day=%u/%u\n",
+                (unsigned)g_ring[TSDB_MIN].headSeq,  (unsigned)g_ring[TSDB_MIN].headOff,
+                (unsigned)g_ring[TSDB_HOUR].headSeq, (unsigned)g_ring[TSDB_HOUR].headOff,
+                (unsigned)g_ring[TSDB_DAY].headSeq,  (unsigned)g_ring[TSDB_DAY].headOff);
+
+  xTaskCreatePinnedToCore(tsdb_task, "tsdb", 3072, nullptr, 1, nullptr, 0);
+  return true;
+}
+
+void tsdb_add(uint32_t nowMs, bool tempValid, float tempC, float setpoint, float u_pct, bool on) {
+  if (!g_q) return;
+
+  // minuto do relógio quando há NTP; senão janelas de 60 s desde o boot
+  const uint32_t ep  = epoch_or_zero();
+  const uint32_t key = ep ? (ep / 60) : (KEY_NO_TIME | (nowMs / 60000));
+
+  if (g_minAcc.n && key != g_minAcc.key) {
+    TsdbRec r;
+    acc_to_rec(g_minAcc, TSDB_MIN, r);
+    if (xQueueSend(g_q, &r, 0) != pdTRUE) g_stats.dropped++;
+    g_minAcc.n = 0;
+  }
+  if (!g_minAcc.n) acc_reset(g_minAcc, key, ep ? key * 60 : 0);
+
+  if (u_pct < 0.0f)   u_pct = 0.0f;
+  if (u_pct > 100.0f) u_pct = 100.0f;
+  // NaN/inf no lroundf vira lixo em t*: conta como amostra sem sensor
+  if (!isfinite(tempC)) tempValid = false;
+
+  acc_add_sample(g_minAcc, tempValid,
+                 tempValid ? (int32_t)lroundf(tempC * 100.0f) : 0,
+                 (int32_t)lroundf(setpoint * 100.0f),
+                 (int32_t)lroundf(u_pct * 100.0f),
+                 on);
+}
+
+bool tsdb_seek(TsdbCursor& c, TsdbTier tier, uint32_t fromTs) {
+  memset(&c, 0, sizeof(c));
+  c.tier = tier;
+  c.off  = HDR_SIZE;
+  if (!g_part || tier >= TSDB_TIERS) return false;
+
+  const TsdbRing& g = g_ring[tier];
+
+  xSemaphoreTake(g_lock, portMAX_DELAY);
+  const uint32_t first = ring_first_seq(g);
+  c.seq = first;
+  if (fromTs) {
+    // setor mais novo que começa antes de fromTs
+    for (uint32_t s = g.headSeq + 1; s-- > first; ) {
+      SectHdr h;
+      if (!sect_hdr_read(g, tier, s, h)) continue;
+      if (h.firstTs != NO_TS && h.firstTs && h.firstTs <= fromTs) { c.seq = s; break; }
+    }
+  }
+  xSemaphoreGive(g_lock);
+
+  // avança dentro do setor até o 1º ts >= fromTs
+  if (fromTs) {
+    TsdbRec r;
+    for (;;) {
+      const TsdbCursor save = c;
+      if (!tsdb_next(c, r)) { c = save; break; }
+      if (r.ts >= fromTs)    { c = save; break; }
+    }
+  }
+  return true;
+}
+
+bool tsdb_next(TsdbCursor& c, TsdbRec& out) {
+  if (!g_part || c.tier >= TSDB_TIERS) return false;
+  const TsdbRing& g = g_ring[c.tier];
+
+  bool ok = false;
+  xSemaphoreTake(g_lock, portMAX_DELAY);
+
+  for (;;) {
+    const uint32_t first = ring_first_seq(g);
+    if (c.seq < first) {
+      // setor do cursor foi reciclado
+      c.seq = first;
+      c.off = HDR_SIZE;
+      hc_state_reset(c.st);
+    }
+    if (c.seq > g.headSeq) break;
+    if (c.seq == g.headSeq && c.off >= g.headOff) break;
+
+    FrameRes fr = FR_BAD;
+    HcRow row;
+    SectHdr h;
+    if (c.off != HDR_SIZE || sect_hdr_read(g, c.tier, c.seq, h)) {
+      fr = frame_read(g, c.seq, c.off, c.st, row);
+    }
+    if (fr == FR_OK) {
+      tsdb_from_row(row, c.tier, out);
+      ok = true;
+      break;
+    }
+    if (fr == FR_BAD) g_stats.crcErrors++;
+
+    c.seq++;
+    c.off = HDR_SIZE;
+    hc_state_reset(c.st);
+  }
+
+  xSemaphoreGive(g_lock);
+  return ok;
+}
+
+bool tsdb_last(TsdbTier tier, TsdbRec& out) {
+  if (!g_part || tier >= TSDB_TIERS) return false;
+  xSemaphoreTake(g_lock, portMAX_DELAY);
+  const bool ok = g_ring[tier].hasLast;
+  if (ok) out = g_ring[tier].last;
+  xSemaphoreGive(g_lock);
+  return ok;
+}
+
+void tsdb_get_stats(TsdbStats& out) {
+  out = g_stats;
+}
@@ -0,0 +1,140 @@
+#include "tstats.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <math.h>
+
+#include "config.h"
+#include "mqtt_link.h"
+#include "json_out.h"
+
+// Welford: média/variância em uma passada, sem guardar amostras
+struct Acc {
+  uint32_t n;
+  float    min, max;
+  double   mean, m2;
+};
+
+static void acc_reset(Acc& a) {
+  a.n = 0;
+  a.min = a.max = 0.0f;
+  a.mean = a.m2 = 0.0;
+}
+
+static void acc_add(Acc& a, float x) {
+  if (a.n == 0) { a.min = a.max = x; }
+  else {
+    if (x < a.min) a.min = x;
+    if (x > a.max) a.max = x;
+  }
+  a.n++;
+  const double d = x - a.mean;
+  a.mean += d / a.n;
+  a.m2   += d * (x - a.mean);
+}
+
+struct Win {
+  uint32_t lenS;
+  uint32_t slot;       // (epoch ou uptime s) / lenS da janela aberta
+  uint32_t ts;         // início (epoch) ou 0
+  uint32_t n;
+  Acc      t, e, u, pe;
+  uint32_t nBand, inBand;
+  float    onS;
+};
+
+// Resumo pronto p/ publicar (cópia compacta da janela)
+struct Summary {
+  uint32_t lenS, ts, n;
+  Acc      t, e, u, pe;
+  uint32_t nBand, inBand;
+  float    onS;
+};
+
+static Win g_win[2];
+static QueueHandle_t g_q = nullptr;
+static uint32_t g_dropped = 0;
+
+static void win_open(Win& w, uint32_t slot, uint32_t epoch) {
+  w.slot = slot;
+  w.ts   = epoch ? slot * w.lenS : 0;
+  w.n = 0;
+  acc_reset(w.t);  acc_reset(w.e);  acc_reset(w.u);  acc_reset(w.pe);
+  w.nBand = w.inBand = 0;
+  w.onS = 0.0f;
+}
+
+static void win_close(const Win& w) {
+  if (!g_q || w.n == 0) return;
+  Summary s;
+  s.lenS = w.lenS;  s.ts = w.ts;  s.n = w.n;
+  s.t = w.t;  s.e = w.e;  s.u = w.u;  s.pe = w.pe;
+  s.nBand = w.nBand;  s.inBand = w.inBand;
+  s.onS = w.onS;
+  if (xQueueSend(g_q, &s, 0) != pdTRUE) g_dropped++;
+}
+
+void tstats_begin() {
+  if (!g_q) g_q = xQueueCreate(4, sizeof(Summary));
+  g_win[0].lenS = 60;
+  g_win[1].lenS = 900;
+  for (Win& w : g_win) win_open(w, 0xFFFFFFFF, 0);
+}
+
+void tstats_add(const TstatsSample& s) {
+  const uint32_t sec = s.epoch ? s.epoch : s.ms / 1000;
+
+  for (Win& w : g_win) {
+    const uint32_t slot = sec / w.lenS;
+    if (slot != w.slot) {
+      win_close(w);
+      win_open(w, slot, s.epoch);
+    }
+
+    w.n++;
+    acc_add(w.u, s.u_pct);
+    w.onS += s.u_pct * 0.01f * s.dt;
+
+    if (!s.tempValid) continue;
+    acc_add(w.t, s.tempC);
+    if (s.systemOn) {
+      acc_add(w.pe, s.predErr);   // controlador só roda ligado
+      const float err = s.setpoint - s.tempC;
+      acc_add(w.e, err);
+      w.nBand++;
+      if (fabsf(err) <= TSTATS_BAND_C) w.inBand++;
+    }
+  }
+}
+
+// [min,max,avg,sd] ou null
+static void put_acc(JsonOut& j, const char* key, const Acc& a, uint8_t dec) {
+  if (a.n == 0) { j.null(key); return; }
+  const float sd = a.n > 1 ? (float)sqrt(a.m2 / (a.n - 1)) : 0.0f;
+  j.arr(key).f(nullptr, a.min, dec).f(nullptr, a.max, dec).f(nullptr, (float)a.mean, dec).f(nullptr, sd, dec + 1).end();
+}
+
+void tstats_poll() {
+  if (!g_q || !mqtt_is_connected()) return;
+
+  Summary s;
+  if (xQueuePeek(g_q, &s, 0) != pdTRUE) return;
+
+  char out[320];
+  JsonOut j(out);
+  j.obj().u("w", s.lenS).u("ts", s.ts).u("n", s.n);
+  put_acc(j, "t", s.t, 2);
+  put_acc(j, "e", s.e, 2);
+  put_acc(j, "u", s.u, 1);
+  put_acc(j, "pe", s.pe, 3);
+  if (s.nBand) j.f("band", (float)s.inBand / s.nBand, 3);
+  else         j.null("band");
+  j.f("on_s", s.onS, 1);
+#if TSTATS_HEATER_W > 0
+  j.f("wh", s.onS * TSTATS_HEATER_W / 3600.0f, 2);
+#endif
+  if (g_dropped) j.u("drop", g_dropped);
+  j.end();
+
+  // só tira da fila se publicou (queda do MQTT não perde o resumo)
+  if (!j.ok() || mqtt_publish_stats(out, j.len())) xQueueReceive(g_q, &s, 0);
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include <ArduinoJson.h>
+
+#include "config.h"
+#include "hist24.h"
+#include "mqtt_link.h"
+#include "msg_json.h"
+
+// ===== Referência: mensagens como o firmware gerava antes do JsonOut =====
+// StaticJsonDocument + serializeJson, copiados sem mudança (só out/cap viram
+// parâmetros). test_msg_json exige os mesmos bytes do msg_json;
+// test_json_bench compara tempo e stack.
+
+// tamanho de cada documento (o buffer de saída tinha o mesmo tamanho)
+enum : size_t {
+  AJ_DOC_STATE     = 512,
+  AJ_DOC_EVT       = 256,   // ack, RESET, OTA
+  AJ_DOC_OTA_STATS = 640,
+  AJ_DOC_LOG       = 384,
+  AJ_DOC_HIST      = 768,
+};
+
+static inline size_t aj_state(char* out, size_t cap, const MqttState& s) {
+  StaticJsonDocument<AJ_DOC_STATE> doc;
+  doc["id"] = s.id;
+  doc["online"] = true;
+  doc["ms"] = s.ms;
+  doc["tempC"] = s.tempC;
+  doc["tempValid"] = s.tempValid;
+  doc["setpoint"] = s.setpoint;
+  doc["systemOn"] = s.systemOn;
+  doc["heating"] = s.heating;
+  doc["u_pct"] = s.u_pct;
+  doc["a1"] = s.a1;
+  doc["b0"] = s.b0;
+  doc["rssi"] = s.rssi;
+  return serializeJson(doc, out, cap);
+}
+
+static inline size_t aj_ack(char* out, size_t cap, const char* msgId, bool ok, const char* msg) {
+  StaticJsonDocument<AJ_DOC_EVT> doc;
+  doc["type"] = "ack";
+  doc["id"] = msgId ? msgId : "";
+  doc["ok"] = ok;
+  if (msg) doc["msg"] = msg;
+  return serializeJson(doc, out, cap);
+}
+
+static inline size_t aj_reset(char* out, size_t cap, const char* msg) {
+  StaticJsonDocument<AJ_DOC_EVT> doc;
+  doc["type"] = "RESET";
+  doc["msg"]  = msg ? msg : "";
+  return serializeJson(doc, out, cap);
+}
+
+static inline size_t aj_ota(char* out, size_t cap, const char* stage, int pct, const char* msg) {
+  StaticJsonDocument<AJ_DOC_EVT> doc;
+  doc["type"]  = "OTA";
+  doc["stage"] = stage;
+  if (pct >= 0) doc["pct"] = pct;
+  if (msg && msg[0]) doc["msg"] = msg;
+  return serializeJson(doc, out, cap);
+}
+
+static inline size_t aj_ota_stats(char* out, size_t cap, const MsgOtaStats& s) {
+  StaticJsonDocument<AJ_DOC_OTA_STATS> doc;
+  doc["type"]          = "OTA";
+  doc["stage"]         = "STATS";
+  doc["fmt"]           = s.fmt;
+  doc["gzip"]          = s.gzip;
+  doc["bytes"]         = s.bytes;
+  doc["unz_bytes"]     = s.unzBytes;
+  doc["out_bytes"]     = s.outBytes;
+  doc["ms"]            = s.ms;
+  doc["kbps"]          = s.kbps;
+  doc["unz_kbps"]      = s.unzKbps;
+  doc["net_stall_ms"]  = s.netStallMs;
+  doc["flash_idle_ms"] = s.flashIdleMs;
+  doc["write_max_us"]  = s.writeMaxUs;
+  doc["write_avg_us"]  = s.writeAvgUs;
+  doc["bufs"]          = s.bufs;
+  doc["buf_size"]      = s.bufSize;
+  doc["resumes"]       = s.resumes;
+  doc["resumed_from"]  = s.resumedFrom;
+  doc["mqtt_kept"]     = s.mqttKept;
+  doc["tls_mqtt"]      = s.tlsMqtt;
+  doc["tls_http"]      = s.tlsHttp;
+  doc["heap_min"]      = s.heapMin;
+  doc["blk_min"]       = s.blkMin;
+  return serializeJson(doc, out, cap);
+}
+
+static inline size_t aj_log(char* out, size_t cap, uint32_t ms, const char* lvl, const char* msg) {
+  StaticJsonDocument<AJ_DOC_LOG> doc;
+  doc["type"] = "LOG";
+  doc["id"]   = CTRL_ID;
+  doc["ms"]   = ms;
+  doc["lvl"]  = lvl;
+  doc["msg"]  = msg;
+  return serializeJson(doc, out, cap);
+}
+
+static inline size_t aj_hist(char* out, size_t cap, uint8_t seq, uint8_t total, const HistPoint* p, uint8_t n) {
+  StaticJsonDocument<AJ_DOC_HIST> doc;
+  doc["id"] = CTRL_ID;
+  doc["seq"] = seq;
+  doc["total"] = total;
+  JsonArray points = doc.createNestedArray("points");
+  for (uint8_t i = 0; i < n; i++) {
+    JsonArray pt = points.createNestedArray();
+    pt.add(p[i].ts);
+    pt.add(p[i].temp);
+  }
+  return serializeJson(doc, out, cap);
+}
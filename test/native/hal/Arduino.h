@@ -0,0 +1,98 @@
+#pragma once
+// ===== SIL: Arduino.h de mentira (env native) =====
+// Só o que os módulos compilados no host usam; implementação em sil.cpp
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <ctype.h>
+#include <algorithm>
+#include <string>
+
+#include "esp_attr.h"
+// como no core do ESP32 (esp32-hal.h): FreeRTOS já vem junto
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+using std::min;
+using std::max;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT        0x01
+#define OUTPUT       0x03
+#define INPUT_PULLUP 0x05
+
+#define RISING  0x01
+#define FALLING 0x02
+#define CHANGE  0x03
+
+typedef uint8_t byte;
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+
+void pinMode(uint8_t pin, uint8_t mode);
+int  digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t val);
+
+#define digitalPinToInterrupt(p) (p)
+void attachInterruptArg(uint8_t pin, void (*fn)(void*), void* arg, int mode);
+void detachInterrupt(uint8_t pin);
+
+uint32_t esp_random();
+
+// NTP do core: no SIL a hora vem de sil_set_epoch/sil_ntp_sync
+void configTime(long gmtOffsetSec, int dstOffsetSec, const char* server1,
+                const char* server2 = nullptr, const char* server3 = nullptr);
+
+// String do core: só o que wifi_ip() usa
+class String {
+ public:
+  String(const char* s = "") : _s(s ? s : "") {}
+  const char* c_str() const { return _s.c_str(); }
+  size_t      length() const { return _s.size(); }
+
+ private:
+  std::string _s;
+};
+
+// ESP: ciclos a 240 MHz no relógio simulado, MAC e heap fixos
+class EspClass {
+ public:
+  uint32_t getCycleCount();
+  uint64_t getEfuseMac();
+  uint32_t getFreeHeap();
+};
+extern EspClass ESP;
+
+#if defined(__GLIBC__) && !__GLIBC_PREREQ(2, 38)
+static inline size_t strlcpy(char* dst, const char* src, size_t n) {
+  const size_t len = strlen(src);
+  if (n) {
+    const size_t k = (len < n - 1) ? len : n - 1;
+    memcpy(dst, src, k);
+    dst[k] = '\0';
+  }
+  return len;
+}
+#endif
+
+// Serial: descarta (SIL_VERBOSE=1 no ambiente manda p/ stdout)
+class HardwareSerial {
+ public:
+  void   begin(unsigned long) {}
+  size_t print(const char* s);
+  size_t print(long v);
+  size_t println(const char* s = "");
+  size_t println(long v);
+  size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+};
+extern HardwareSerial Serial;
@@ -0,0 +1,6 @@
+#pragma once
+// Cliente de rede genérico (o PubSubClient só guarda a referência)
+class Client {
+ public:
+  virtual ~Client() {}
+};
@@ -0,0 +1,26 @@
+#pragma once
+#include <stdint.h>
+#include "OneWire.h"
+
+// ===== SIL: DS18B20 de mentira (sil_ds18b20 em sil.h) =====
+// requestTemperatures guarda a temperatura do mundo na resolução pedida;
+// getTempC devolve a última conversão ou DEVICE_DISCONNECTED_C sem sensor.
+#define DEVICE_DISCONNECTED_C -127
+
+class DallasTemperature {
+ public:
+  explicit DallasTemperature(OneWire* w) : _w(w) {}
+
+  void    begin() {}
+  void    setWaitForConversion(bool wait) { _wait = wait; }
+  void    setResolution(uint8_t bits) { _bits = bits; }
+  uint8_t getDeviceCount();
+  void    requestTemperatures();
+  float   getTempCByIndex(uint8_t i);
+
+ private:
+  OneWire* _w;
+  bool     _wait = true;
+  uint8_t  _bits = 12;
+  float    _scratch = 85.0f;   // valor de power-on do DS18B20
+};
@@ -0,0 +1,17 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// ===== SIL: LCD I2C de mentira (sil_lcd_row em sil.h) =====
+class LiquidCrystal_I2C {
+ public:
+  LiquidCrystal_I2C(uint8_t addr, uint8_t cols, uint8_t rows);
+  void   init();
+  void   backlight() {}
+  void   clear();
+  void   setCursor(uint8_t col, uint8_t row);
+  size_t write(uint8_t ch);
+
+ private:
+  uint8_t _cols, _rows, _col = 0, _row = 0;
+};
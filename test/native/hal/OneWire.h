@@ -0,0 +1,12 @@
+#pragma once
+#include <stdint.h>
+
+// Barramento 1-Wire de mentira: o DS18B20 mora no DallasTemperature
+class OneWire {
+ public:
+  explicit OneWire(uint8_t pin) : _pin(pin) {}
+  uint8_t pin() const { return _pin; }
+
+ private:
+  uint8_t _pin;
+};
@@ -0,0 +1,32 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// NVS em RAM (sobrevive a sil_power_cut, como a flash)
+class Preferences {
+ public:
+  bool   begin(const char* name, bool readOnly = false, const char* partition = nullptr);
+  void   end();
+  bool   clear();
+  bool   remove(const char* key);
+  bool   isKey(const char* key);
+
+  size_t putUChar(const char* key, uint8_t v);
+  size_t putUInt(const char* key, uint32_t v);
+  size_t putFloat(const char* key, float v);
+  size_t putBytes(const char* key, const void* v, size_t len);
+  size_t putString(const char* key, const char* v);
+
+  uint8_t  getUChar(const char* key, uint8_t def = 0);
+  uint32_t getUInt(const char* key, uint32_t def = 0);
+  float    getFloat(const char* key, float def = NAN);
+  size_t   getBytesLength(const char* key);
+  size_t   getBytes(const char* key, void* buf, size_t maxLen);
+  size_t   getString(const char* key, char* buf, size_t maxLen);
+
+ private:
+  bool get(const char* key, void* buf, size_t len);
+  char _ns[16] = {0};
+  bool _open = false;
+  bool _ro = false;
+};
@@ -0,0 +1,36 @@
+#pragma once
+#include <Arduino.h>
+#include "Client.h"
+
+// ===== SIL: PubSubClient de mentira (broker em sil_libs.cpp) =====
+// Conecta só com WiFi e broker no ar; publish falha como o da lib (sem
+// sessão ou pacote maior que o buffer). Comando do teste (sil_mqtt_cmd)
+// chega pelo callback, um por loop(), se o tópico estiver assinado.
+class PubSubClient {
+ public:
+  typedef void (*Callback)(char* topic, uint8_t* payload, unsigned int len);
+
+  explicit PubSubClient(Client& c) { (void)c; }
+
+  PubSubClient& setServer(const char* host, uint16_t port) { (void)host; (void)port; return *this; }
+  PubSubClient& setCallback(Callback cb) { _cb = cb; return *this; }
+  PubSubClient& setKeepAlive(uint16_t s) { (void)s; return *this; }
+  PubSubClient& setSocketTimeout(uint16_t s) { (void)s; return *this; }
+  bool setBufferSize(uint16_t n);
+
+  bool connect(const char* id, const char* user, const char* pass,
+               const char* willTopic, uint8_t willQos, bool willRetain, const char* willMsg);
+  void disconnect();
+  bool connected();
+  bool loop();
+
+  bool publish(const char* topic, const char* payload, bool retained);
+  bool publish(const char* topic, const uint8_t* payload, unsigned int len, bool retained);
+  bool subscribe(const char* topic, uint8_t qos = 0);
+  bool unsubscribe(const char* topic);
+
+ private:
+  Callback _cb = nullptr;
+  uint16_t _bufSize = 256;
+  uint8_t* _buf = nullptr;
+};
@@ -0,0 +1,29 @@
+#pragma once
+#include <Arduino.h>
+
+// ===== SIL: WiFi de mentira (sil_wifi em sil.h) =====
+// Associa no begin/reconnect se o AP estiver no ar; AP cai = desassocia.
+typedef enum { WL_IDLE_STATUS = 0, WL_CONNECTED = 3, WL_CONNECTION_LOST = 5, WL_DISCONNECTED = 6 } wl_status_t;
+typedef enum { WIFI_OFF = 0, WIFI_STA = 1 } wifi_mode_t;
+
+class IPAddress {
+ public:
+  IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) : _b{ a, b, c, d } {}
+  String toString() const;
+
+ private:
+  uint8_t _b[4];
+};
+
+class WiFiClass {
+ public:
+  bool        mode(wifi_mode_t m) { (void)m; return true; }
+  bool        setSleep(bool on) { (void)on; return true; }
+  bool        setHostname(const char* h) { (void)h; return true; }
+  wl_status_t begin(const char* ssid, const char* pass);
+  bool        reconnect();
+  wl_status_t status();
+  IPAddress   localIP();
+  int8_t      RSSI();
+};
+extern WiFiClass WiFi;
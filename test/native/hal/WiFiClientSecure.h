@@ -0,0 +1,11 @@
+#pragma once
+#include <Arduino.h>
+#include "Client.h"
+
+// TLS de mentira: a "conexão" é a sessão do broker em sil_libs.cpp
+class WiFiClientSecure : public Client {
+ public:
+  void setInsecure() {}
+  void setTimeout(uint32_t s) { (void)s; }
+  void stop() {}
+};
@@ -0,0 +1,2 @@
+#pragma once
+// I2C de mentira: o LiquidCrystal_I2C daqui não passa por ele
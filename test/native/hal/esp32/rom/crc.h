@@ -0,0 +1,5 @@
+#pragma once
+#include <stdint.h>
+
+// CRC-32 (IEEE, refletido) como o da ROM: crc32_le(0, ..) == zlib.crc32
+uint32_t crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len);
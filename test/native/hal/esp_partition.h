@@ -0,0 +1,31 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+// Uma partição de dados "spiffs" (0x30000, como em partitions/ota_4mb.csv)
+// em RAM, com semântica de NOR: apagar = 0xFF por setor, gravar só zera bits
+
+#define SPI_FLASH_SEC_SIZE 4096
+
+typedef enum { ESP_PARTITION_TYPE_APP = 0x00, ESP_PARTITION_TYPE_DATA = 0x01 } esp_partition_type_t;
+typedef enum {
+  ESP_PARTITION_SUBTYPE_DATA_NVS    = 0x02,
+  ESP_PARTITION_SUBTYPE_DATA_SPIFFS = 0x82,
+  ESP_PARTITION_SUBTYPE_ANY         = 0xff,
+} esp_partition_subtype_t;
+
+typedef struct {
+  esp_partition_type_t    type;
+  esp_partition_subtype_t subtype;
+  uint32_t                address;
+  uint32_t                size;
+  char                    label[17];
+  bool                    encrypted;
+} esp_partition_t;
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char* label);
+esp_err_t esp_partition_read(const esp_partition_t* p, size_t off, void* dst, size_t len);
+esp_err_t esp_partition_write(const esp_partition_t* p, size_t off, const void* src, size_t len);
+esp_err_t esp_partition_erase_range(const esp_partition_t* p, size_t off, size_t len);
@@ -0,0 +1,36 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// ===== SIL: FreeRTOS de mentira (env native) =====
+// Escalonamento cooperativo no relógio simulado (test/native/sil.cpp): só um
+// contexto roda por vez e troca só em chamada que bloqueia, então o código
+// das tasks roda sem corrida e o teste é determinístico. Tick = 1 ms.
+
+typedef int32_t  BaseType_t;
+typedef uint32_t UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint8_t  StackType_t;
+
+#define pdFALSE 0
+#define pdTRUE  1
+#define pdPASS  pdTRUE
+#define pdFAIL  pdFALSE
+
+#define portMAX_DELAY     ((TickType_t)0xFFFFFFFF)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define configTICK_RATE_HZ 1000
+
+// Um contexto por vez: seção crítica não precisa travar nada
+typedef struct { int unused; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED { 0 }
+#define portENTER_CRITICAL(m)     ((void)(m))
+#define portEXIT_CRITICAL(m)      ((void)(m))
+#define portENTER_CRITICAL_ISR(m) ((void)(m))
+#define portEXIT_CRITICAL_ISR(m)  ((void)(m))
+#define taskENTER_CRITICAL(m)     ((void)(m))
+#define taskEXIT_CRITICAL(m)      ((void)(m))
+#define portYIELD_FROM_ISR(...)   ((void)0)
+
+TickType_t xTaskGetTickCount();
@@ -0,0 +1,20 @@
+#pragma once
+#include "FreeRTOS.h"
+
+struct SilQueue;
+typedef SilQueue* QueueHandle_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t len, UBaseType_t itemSize);
+// estática: o buffer do chamador fica sem uso (a fila do SIL é dinâmica)
+typedef struct { int unused; } StaticQueue_t;
+QueueHandle_t xQueueCreateStatic(UBaseType_t len, UBaseType_t itemSize, uint8_t* buf, StaticQueue_t* q);
+BaseType_t    xQueueSend(QueueHandle_t q, const void* item, TickType_t ticks);
+BaseType_t    xQueueSendToFront(QueueHandle_t q, const void* item, TickType_t ticks);
+BaseType_t    xQueueOverwrite(QueueHandle_t q, const void* item);
+BaseType_t    xQueueReceive(QueueHandle_t q, void* out, TickType_t ticks);
+BaseType_t    xQueuePeek(QueueHandle_t q, void* out, TickType_t ticks);
+BaseType_t    xQueueSendFromISR(QueueHandle_t q, const void* item, BaseType_t* woken);
+UBaseType_t   uxQueueMessagesWaiting(QueueHandle_t q);
+BaseType_t    xQueueReset(QueueHandle_t q);
+
+#define xQueueSendToBack xQueueSend
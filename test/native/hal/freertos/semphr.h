@@ -0,0 +1,11 @@
+#pragma once
+#include "FreeRTOS.h"
+#include "queue.h"
+
+struct SilSem;
+typedef SilSem* SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+SemaphoreHandle_t xSemaphoreCreateBinary();
+BaseType_t        xSemaphoreTake(SemaphoreHandle_t s, TickType_t ticks);
+BaseType_t        xSemaphoreGive(SemaphoreHandle_t s);
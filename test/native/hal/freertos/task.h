@@ -0,0 +1,18 @@
+#pragma once
+#include "FreeRTOS.h"
+
+struct SilTask;
+typedef SilTask* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+                                   UBaseType_t prio, TaskHandle_t* out, BaseType_t core);
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+                       UBaseType_t prio, TaskHandle_t* out);
+void       vTaskDelete(TaskHandle_t t);
+void       vTaskDelay(TickType_t ticks);
+TaskHandle_t xTaskGetCurrentTaskHandle();
+UBaseType_t  uxTaskGetNumberOfTasks();
+
+void       xTaskNotifyGive(TaskHandle_t t);
+uint32_t   ulTaskNotifyTake(BaseType_t clear, TickType_t ticks);
@@ -0,0 +1,2 @@
+#pragma once
+// esp-dsp (vem com o core do ESP32): o controlador inclui mas não usa nada
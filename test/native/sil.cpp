@@ -0,0 +1,644 @@
+#include "sil.h"
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <esp_timer.h>
+#include <esp_partition.h>
+#include <esp32/rom/crc.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+
+#include <sys/time.h>
+#include <time.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+
+// ================= Escalonador =================
+// g_run = contexto com a "CPU"; os outros esperam em g_cv. Task bloqueada
+// devolve a CPU para a thread do teste, que roda as prontas (por ordem de
+// criação) até nenhuma estar pronta e só então anda o relógio.
+struct SilKill {};
+
+struct SilTask {
+  std::string name;
+  TaskFunction_t fn;
+  void*    arg;
+  bool     blocked;
+  bool     killed;
+  bool     finished;
+  const std::function<bool()>* ready;   // condição do bloqueio atual
+  uint64_t deadline;                    // us (NO_DL = sem prazo)
+  uint32_t notify;
+};
+
+static const uint64_t NO_DL = UINT64_MAX;
+
+static std::mutex              g_m;
+static std::condition_variable g_cv;
+static SilTask                 g_main = { "test", nullptr, nullptr, false, false, false, nullptr, NO_DL, 0 };
+static SilTask*                g_run = &g_main;
+static std::vector<SilTask*>   g_tasks;
+static thread_local SilTask*   t_self = nullptr;
+
+static uint64_t g_us = 0;          // relógio simulado (desde o boot)
+static uint64_t g_wallUs = 0;      // hora de parede em g_us = 0
+static bool     g_synced = false;
+
+static SilTask* self() { return t_self ? t_self : &g_main; }
+
+static bool runnable(const SilTask* t) {
+  if (t->finished) return false;
+  if (t->killed || !t->blocked) return true;
+  return (*t->ready)() || g_us >= t->deadline;
+}
+
+// Dá a CPU para t e espera ela bloquear/terminar (só da thread do teste)
+static void run_task(std::unique_lock<std::mutex>& lk, SilTask* t) {
+  g_run = t;
+  g_cv.notify_all();
+  g_cv.wait(lk, [] { return g_run == &g_main; });
+}
+
+static void run_ready(std::unique_lock<std::mutex>& lk) {
+  for (bool any = true; any; ) {
+    any = false;
+    for (size_t i = 0; i < g_tasks.size(); i++) {   // tasks criam tasks
+      SilTask* t = g_tasks[i];
+      if (!runnable(t)) continue;
+      run_task(lk, t);
+      any = true;
+    }
+  }
+}
+
+static uint64_t next_deadline() {
+  uint64_t dl = NO_DL;
+  for (SilTask* t : g_tasks) {
+    if (!t->finished && t->blocked && t->deadline < dl) dl = t->deadline;
+  }
+  return dl;
+}
+
+// Bloqueia o contexto atual até ready() ou ticks (ms); true = ready()
+static bool wait_until(std::unique_lock<std::mutex>& lk, const std::function<bool()>& ready, TickType_t ticks) {
+  if (ready()) return true;
+  if (ticks == 0) return false;
+  const uint64_t dl = (ticks == portMAX_DELAY) ? NO_DL : g_us + (uint64_t)ticks * 1000;
+
+  SilTask* me = self();
+  if (me == &g_main) {
+    // o teste espera: roda as tasks e anda o relógio até o prazo
+    for (;;) {
+      run_ready(lk);
+      if (ready()) return true;
+      if (g_us >= dl) return false;
+      const uint64_t next = std::min(dl, next_deadline());
+      if (next == NO_DL) {
+        fprintf(stderr, "[SIL] teste bloqueado sem prazo e sem task que o acorde\n");
+        abort();
+      }
+      g_us = next;
+    }
+  }
+
+  me->ready    = &ready;
+  me->deadline = dl;
+  me->blocked  = true;
+  g_run = &g_main;
+  g_cv.notify_all();
+  g_cv.wait(lk, [me] { return g_run == me; });
+  me->blocked = false;
+  me->ready   = nullptr;
+  if (me->killed) throw SilKill();
+  return ready();
+}
+
+static void task_entry(SilTask* t) {
+  t_self = t;
+  {
+    std::unique_lock<std::mutex> lk(g_m);
+    g_cv.wait(lk, [t] { return g_run == t; });
+  }
+  if (!t->killed) {
+    try { t->fn(t->arg); } catch (const SilKill&) {}
+  }
+  std::unique_lock<std::mutex> lk(g_m);
+  t->finished = true;
+  g_run = &g_main;
+  g_cv.notify_all();
+}
+
+static void kill_all(std::unique_lock<std::mutex>& lk) {
+  for (SilTask* t : g_tasks) {
+    if (t->finished) continue;
+    t->killed = true;
+    run_task(lk, t);
+  }
+  g_tasks.clear();   // SilTask fica (a thread ainda pode estar saindo)
+}
+
+static void at_exit() {
+  std::unique_lock<std::mutex> lk(g_m);
+  kill_all(lk);
+}
+
+// ================= FreeRTOS =================
+TickType_t xTaskGetTickCount() { return (TickType_t)(g_us / 1000); }
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+                                   UBaseType_t prio, TaskHandle_t* out, BaseType_t core) {
+  (void)stack; (void)prio; (void)core;
+  static bool hooked = false;
+  if (!hooked) { hooked = true; atexit(at_exit); }
+
+  SilTask* t = new SilTask{ name ? name : "", fn, arg, false, false, false, nullptr, NO_DL, 0 };
+  {
+    std::lock_guard<std::mutex> lk(g_m);
+    g_tasks.push_back(t);
+  }
+  std::thread(task_entry, t).detach();
+  if (out) *out = t;
+  return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+                       UBaseType_t prio, TaskHandle_t* out) {
+  return xTaskCreatePinnedToCore(fn, name, stack, arg, prio, out, 0);
+}
+
+void vTaskDelete(TaskHandle_t t) {
+  if (t && t != self()) {
+    std::lock_guard<std::mutex> lk(g_m);
+    t->killed = true;   // sai quando a thread do teste der a CPU para ela
+    return;
+  }
+  if (self() != &g_main) throw SilKill();
+}
+
+void vTaskDelay(TickType_t ticks) {
+  std::unique_lock<std::mutex> lk(g_m);
+  wait_until(lk, [] { return false; }, ticks ? ticks : 1);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() { return self(); }
+
+UBaseType_t uxTaskGetNumberOfTasks() {
+  std::lock_guard<std::mutex> lk(g_m);
+  UBaseType_t n = 1;   // + a do teste
+  for (SilTask* t : g_tasks) if (!t->finished) n++;
+  return n;
+}
+
+void xTaskNotifyGive(TaskHandle_t t) {
+  std::lock_guard<std::mutex> lk(g_m);
+  if (t) t->notify++;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) {
+  std::unique_lock<std::mutex> lk(g_m);
+  SilTask* me = self();
+  if (!wait_until(lk, [me] { return me->notify > 0; }, ticks)) return 0;
+  const uint32_t v = me->notify;
+  me->notify = clear ? 0 : v - 1;
+  return v;
+}
+
+struct SilQueue {
+  size_t item;
+  size_t len;
+  std::deque<std::vector<uint8_t>> q;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t len, UBaseType_t itemSize) {
+  return new SilQueue{ itemSize, len, {} };
+}
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t len, UBaseType_t itemSize, uint8_t* buf, StaticQueue_t* q) {
+  (void)buf; (void)q;
+  return xQueueCreate(len, itemSize);
+}
+
+static BaseType_t q_send(QueueHandle_t q, const void* item, TickType_t ticks, bool front) {
+  std::unique_lock<std::mutex> lk(g_m);
+  if (!wait_until(lk, [q] { return q->q.size() < q->len; }, ticks)) return pdFALSE;
+  const uint8_t* p = (const uint8_t*)item;
+  if (front) q->q.emplace_front(p, p + q->item);
+  else       q->q.emplace_back(p, p + q->item);
+  return pdTRUE;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void* item, TickType_t ticks) {
+  return q_send(q, item, ticks, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t q, const void* item, TickType_t ticks) {
+  return q_send(q, item, ticks, true);
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t q, const void* item) {
+  std::lock_guard<std::mutex> lk(g_m);
+  const uint8_t* p = (const uint8_t*)item;
+  q->q.clear();
+  q->q.emplace_back(p, p + q->item);
+  return pdTRUE;
+}
+
+static BaseType_t q_recv(QueueHandle_t q, void* out, TickType_t ticks, bool peek) {
+  std::unique_lock<std::mutex> lk(g_m);
+  if (!wait_until(lk, [q] { return !q->q.empty(); }, ticks)) return pdFALSE;
+  memcpy(out, q->q.front().data(), q->item);
+  if (!peek) q->q.pop_front();
+  return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void* out, TickType_t ticks) { return q_recv(q, out, ticks, false); }
+BaseType_t xQueuePeek(QueueHandle_t q, void* out, TickType_t ticks)    { return q_recv(q, out, ticks, true); }
+
+BaseType_t xQueueSendFromISR(QueueHandle_t q, const void* item, BaseType_t* woken) {
+  if (woken) *woken = pdFALSE;
+  return q_send(q, item, 0, false);
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q) {
+  std::lock_guard<std::mutex> lk(g_m);
+  return (UBaseType_t)q->q.size();
+}
+
+BaseType_t xQueueReset(QueueHandle_t q) {
+  std::lock_guard<std::mutex> lk(g_m);
+  q->q.clear();
+  return pdPASS;
+}
+
+struct SilSem {
+  bool     mutex;
+  uint32_t count;
+  SilTask* holder;
+};
+
+SemaphoreHandle_t xSemaphoreCreateMutex()  { return new SilSem{ true, 1, nullptr }; }
+SemaphoreHandle_t xSemaphoreCreateBinary() { return new SilSem{ false, 0, nullptr }; }
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t ticks) {
+  std::unique_lock<std::mutex> lk(g_m);
+  if (!wait_until(lk, [s] { return s->count > 0; }, ticks)) return pdFALSE;
+  s->count--;
+  s->holder = self();
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s) {
+  std::lock_guard<std::mutex> lk(g_m);
+  if (s->count) return pdFALSE;
+  s->count = 1;
+  s->holder = nullptr;
+  return pdTRUE;
+}
+
+// ================= Tempo =================
+unsigned long millis() { return (unsigned long)(g_us / 1000); }
+unsigned long micros() { return (unsigned long)g_us; }
+int64_t esp_timer_get_time() { return (int64_t)g_us; }
+void delay(uint32_t ms) { vTaskDelay(pdMS_TO_TICKS(ms)); }
+
+// time() do libc: hora simulada (0 sem "NTP")
+extern "C" time_t time(time_t* out) noexcept {
+  const time_t now = (time_t)sil_epoch();
+  if (out) *out = now;
+  return now;
+}
+
+// gettimeofday: igual ao ESP32, segundos desde o boot até o "NTP"
+extern "C" int gettimeofday(struct timeval* tv, void* tz) noexcept {
+  (void)tz;
+  const uint64_t us = g_synced ? g_wallUs + g_us : g_us;   // glibc: tv nonnull
+  tv->tv_sec  = (time_t)(us / 1000000);
+  tv->tv_usec = (suseconds_t)(us % 1000000);
+  return 0;
+}
+
+void sil_advance(uint32_t ms) {
+  if (self() != &g_main) abort();
+  std::unique_lock<std::mutex> lk(g_m);
+  const uint64_t target = g_us + (uint64_t)ms * 1000;
+  for (;;) {
+    run_ready(lk);
+    const uint64_t next = next_deadline();
+    if (next > target) break;
+    g_us = next;
+  }
+  g_us = target;
+  run_ready(lk);
+}
+
+void sil_idle() {
+  std::unique_lock<std::mutex> lk(g_m);
+  run_ready(lk);
+}
+
+void sil_set_epoch(uint32_t epoch) {
+  g_wallUs = (uint64_t)epoch * 1000000 - g_us;
+  g_synced = (epoch != 0);
+}
+
+void sil_ntp_sync() { g_synced = true; }
+
+uint32_t sil_epoch() {
+  return g_synced ? (uint32_t)((g_wallUs + g_us) / 1000000) : 0;
+}
+
+// ================= GPIO =================
+struct SilIsr {
+  void (*fn)(void*);
+  void* arg;
+  int   mode;
+};
+
+static const uint8_t PINS = 40;
+static uint8_t g_level[PINS];
+static SilIsr  g_isr[PINS];
+static bool    g_gpioInit = false;
+
+static void gpio_init() {
+  if (g_gpioInit) return;
+  g_gpioInit = true;
+  memset(g_level, HIGH, sizeof(g_level));   // pull-up solto
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  (void)pin; (void)mode;
+  gpio_init();
+}
+
+int digitalRead(uint8_t pin) {
+  gpio_init();
+  return pin < PINS ? g_level[pin] : LOW;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  gpio_init();
+  if (pin < PINS) g_level[pin] = val ? HIGH : LOW;
+}
+
+void attachInterruptArg(uint8_t pin, void (*fn)(void*), void* arg, int mode) {
+  if (pin < PINS) g_isr[pin] = { fn, arg, mode };
+}
+
+void detachInterrupt(uint8_t pin) {
+  if (pin < PINS) g_isr[pin] = { nullptr, nullptr, 0 };
+}
+
+void sil_gpio_in(uint8_t pin, uint8_t level) {
+  gpio_init();
+  if (pin >= PINS) return;
+  level = level ? HIGH : LOW;
+  if (g_level[pin] == level) return;
+  g_level[pin] = level;
+
+  const SilIsr& h = g_isr[pin];
+  const bool fire = (h.mode == CHANGE) || (h.mode == RISING && level) || (h.mode == FALLING && !level);
+  if (h.fn && fire) h.fn(h.arg);
+}
+
+uint8_t sil_gpio_out(uint8_t pin) {
+  gpio_init();
+  return pin < PINS ? g_level[pin] : LOW;
+}
+
+uint32_t esp_random() {
+  static uint32_t s = 0x2545F491;
+  s ^= s << 13; s ^= s >> 17; s ^= s << 5;
+  return s;
+}
+
+// ================= Flash (partição "spiffs") =================
+static const uint32_t FLASH_SIZE = 0x30000;
+static uint8_t  g_flash[FLASH_SIZE];
+static bool     g_flashInit = false;
+static uint32_t g_erases = 0;
+static bool     g_cutArmed = false;
+static uint32_t g_cutLeft = 0;
+static bool     g_dead = false;    // energia acabou: nada mais grava
+
+static const esp_partition_t g_part = {
+  ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_SPIFFS, 0x3D0000, FLASH_SIZE, "spiffs", false,
+};
+
+static void flash_init() {
+  if (g_flashInit) return;
+  g_flashInit = true;
+  memset(g_flash, 0xFF, sizeof(g_flash));
+}
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char* label) {
+  flash_init();
+  if (type != g_part.type) return nullptr;
+  if (subtype != ESP_PARTITION_SUBTYPE_ANY && subtype != g_part.subtype) return nullptr;
+  if (label && strcmp(label, g_part.label) != 0) return nullptr;
+  return &g_part;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t* p, size_t off, void* dst, size_t len) {
+  if (p != &g_part || off + len > FLASH_SIZE) return ESP_ERR_INVALID_SIZE;
+  memcpy(dst, g_flash + off, len);
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t* p, size_t off, const void* src, size_t len) {
+  if (p != &g_part || off + len > FLASH_SIZE) return ESP_ERR_INVALID_SIZE;
+  if (g_dead) return ESP_FAIL;
+  size_t n = len;
+  if (g_cutArmed && n > g_cutLeft) n = g_cutLeft;
+  const uint8_t* s = (const uint8_t*)src;
+  for (size_t i = 0; i < n; i++) g_flash[off + i] &= s[i];   // NOR: só zera bits
+  if (g_cutArmed) {
+    g_cutLeft -= (uint32_t)n;
+    if (n < len || !g_cutLeft) g_dead = true;
+    if (n < len) return ESP_FAIL;
+  }
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t* p, size_t off, size_t len) {
+  if (p != &g_part || off + len > FLASH_SIZE) return ESP_ERR_INVALID_SIZE;
+  if (off % SPI_FLASH_SEC_SIZE || len % SPI_FLASH_SEC_SIZE) return ESP_ERR_INVALID_ARG;
+  if (g_dead) return ESP_FAIL;
+  memset(g_flash + off, 0xFF, len);
+  g_erases += (uint32_t)(len / SPI_FLASH_SEC_SIZE);
+  return ESP_OK;
+}
+
+void sil_flash_cut_after(uint32_t bytes) {
+  g_cutArmed = true;
+  g_cutLeft  = bytes;
+  g_dead     = (bytes == 0);
+}
+
+uint8_t* sil_flash(size_t* size) {
+  flash_init();
+  if (size) *size = FLASH_SIZE;
+  return g_flash;
+}
+
+void sil_flash_erase_all() {
+  g_flashInit = false;
+  flash_init();
+}
+
+uint32_t sil_flash_erases() { return g_erases; }
+
+uint32_t crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len) {
+  crc = ~crc;
+  while (len--) {
+    crc ^= *buf++;
+    for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+  }
+  return ~crc;
+}
+
+// ================= NVS (Preferences) =================
+typedef std::map<std::string, std::vector<uint8_t>> NvsNs;
+static std::map<std::string, NvsNs> g_nvs;
+
+bool Preferences::begin(const char* name, bool readOnly, const char* partition) {
+  (void)partition;
+  strlcpy(_ns, name, sizeof(_ns));
+  _ro   = readOnly;
+  _open = true;
+  return true;
+}
+
+void Preferences::end() { _open = false; }
+
+bool Preferences::clear() {
+  if (!_open || _ro) return false;
+  g_nvs[_ns].clear();
+  return true;
+}
+
+bool Preferences::remove(const char* key) {
+  if (!_open || _ro) return false;
+  return g_nvs[_ns].erase(key) > 0;
+}
+
+bool Preferences::isKey(const char* key) {
+  return _open && g_nvs[_ns].count(key);
+}
+
+size_t Preferences::putBytes(const char* key, const void* v, size_t len) {
+  if (!_open || _ro) return 0;
+  const uint8_t* p = (const uint8_t*)v;
+  g_nvs[_ns][key].assign(p, p + len);
+  return len;
+}
+
+size_t Preferences::putUChar(const char* key, uint8_t v)      { return putBytes(key, &v, sizeof(v)); }
+size_t Preferences::putUInt(const char* key, uint32_t v)      { return putBytes(key, &v, sizeof(v)); }
+size_t Preferences::putFloat(const char* key, float v)        { return putBytes(key, &v, sizeof(v)); }
+size_t Preferences::putString(const char* key, const char* v) { return putBytes(key, v, strlen(v) + 1); }
+
+bool Preferences::get(const char* key, void* buf, size_t len) {
+  if (!_open) return false;
+  NvsNs& ns = g_nvs[_ns];
+  auto it = ns.find(key);
+  if (it == ns.end() || it->second.size() != len) return false;
+  memcpy(buf, it->second.data(), len);
+  return true;
+}
+
+uint8_t Preferences::getUChar(const char* key, uint8_t def) {
+  uint8_t v;
+  return get(key, &v, sizeof(v)) ? v : def;
+}
+
+uint32_t Preferences::getUInt(const char* key, uint32_t def) {
+  uint32_t v;
+  return get(key, &v, sizeof(v)) ? v : def;
+}
+
+float Preferences::getFloat(const char* key, float def) {
+  float v;
+  return get(key, &v, sizeof(v)) ? v : def;
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+  if (!_open) return 0;
+  NvsNs& ns = g_nvs[_ns];
+  auto it = ns.find(key);
+  return it == ns.end() ? 0 : it->second.size();
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+  const size_t n = getBytesLength(key);
+  if (!n || n > maxLen) return 0;
+  memcpy(buf, g_nvs[_ns][key].data(), n);
+  return n;
+}
+
+size_t Preferences::getString(const char* key, char* buf, size_t maxLen) {
+  return getBytes(key, buf, maxLen);
+}
+
+void sil_nvs_clear() { g_nvs.clear(); }
+
+bool sil_nvs_has(const char* ns, const char* key) {
+  auto it = g_nvs.find(ns);
+  return it != g_nvs.end() && it->second.count(key);
+}
+
+// ================= Energia =================
+void sil_libs_power_cut();   // sil_libs.cpp
+void sil_libs_reset();
+
+void sil_power_cut(uint32_t offMs) {
+  std::unique_lock<std::mutex> lk(g_m);
+  kill_all(lk);
+  const uint64_t wall = g_wallUs + g_us + (uint64_t)offMs * 1000;
+  g_us     = 0;
+  g_wallUs = wall;
+  g_synced = false;
+  g_main.notify = 0;
+  memset(g_isr, 0, sizeof(g_isr));
+  g_gpioInit = false;
+  g_cutArmed = false;
+  g_dead     = false;
+  sil_libs_power_cut();
+}
+
+void sil_reset() {
+  sil_power_cut(0);
+  g_wallUs = 0;
+  g_erases = 0;
+  sil_flash_erase_all();
+  sil_nvs_clear();
+  sil_libs_reset();
+}
+
+// ================= Serial =================
+HardwareSerial Serial;
+
+static bool verbose() {
+  static const bool v = getenv("SIL_VERBOSE") != nullptr;
+  return v;
+}
+
+size_t HardwareSerial::print(const char* s) { return verbose() ? (size_t)fputs(s, stdout) : strlen(s); }
+size_t HardwareSerial::print(long v)        { return verbose() ? (size_t)::printf("%ld", v) : 0; }
+size_t HardwareSerial::println(const char* s) { return print(s) + print("\n"); }
+size_t HardwareSerial::println(long v)        { return print(v) + print("\n"); }
+
+size_t HardwareSerial::printf(const char* fmt, ...) {
+  if (!verbose()) return 0;
+  va_list ap;
+  va_start(ap, fmt);
+  const int n = vprintf(fmt, ap);
+  va_end(ap);
+  return n > 0 ? (size_t)n : 0;
+}
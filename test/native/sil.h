@@ -0,0 +1,80 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+// ===== SIL: controle do hardware de mentira (env native) =====
+// Os módulos compilam contra test/native/hal (Arduino.h, FreeRTOS, partição,
+// NVS, OneWire/DallasTemperature, WiFi, PubSubClient, LCD...) e os testes
+// mexem no "mundo" por aqui. O firmware roda pelo app.h (os mesmos passos
+// das tasks do main.cpp); OTA, LAN, bench e heap_guard ficam de fora
+// (svc_fake.cpp).
+//
+// Tempo: relógio simulado (millis/micros/esp_timer). Só anda por
+// sil_advance ou quando o teste bloqueia: dias de estufa em segundos.
+// Tasks: cada xTaskCreate vira uma thread, mas só um contexto roda por vez e
+// a troca só acontece em chamada que bloqueia (fila, notify, delay, mutex).
+// Quem acorda uma task (xQueueSend, jrnl_flush...) chama sil_idle() para ela
+// rodar; depois disso todas estão paradas e o teste vê um estado fixo.
+// A thread do teste faz o papel das tasks de controle/rede ou cria tasks que
+// chamam app_ctrl_step/app_net_step como as do main.cpp.
+
+// ---- tempo ----
+void     sil_advance(uint32_t ms);      // roda as tasks até cada prazo no caminho
+void     sil_idle();
+// Hora de parede: time()/gettimeofday() só valem depois do "NTP"
+// (sil_set_epoch/sil_ntp_sync); antes, gettimeofday conta desde o boot
+void     sil_set_epoch(uint32_t epoch); // acerta e sincroniza; 0 = sem hora
+void     sil_ntp_sync();                // de novo na hora de parede (depois da queda)
+uint32_t sil_epoch();                   // o que o time() vê agora
+
+// ---- energia ----
+// Queda: para as tasks onde estão (RAM perdida), millis volta a 0, a hora
+// de parede anda offMs e o time() fica sem hora até sil_ntp_sync(). Flash e
+// NVS ficam. Depois, o teste refaz o boot (xxx_begin) como o setup().
+void     sil_power_cut(uint32_t offMs = 0);
+void     sil_reset();                   // queda + flash/NVS/mundo de fábrica (setUp)
+// A energia acaba depois de mais 'bytes' gravados na flash: a gravação que
+// cruzar o limite fica pela metade e as seguintes falham (até sil_power_cut)
+void     sil_flash_cut_after(uint32_t bytes);
+
+// ---- GPIO ----
+// Nível de entrada; borda com interrupção anexada chama a ISR na hora
+void     sil_gpio_in(uint8_t pin, uint8_t level);
+uint8_t  sil_gpio_out(uint8_t pin);     // último digitalWrite
+
+// ---- flash (partição do TSDB/journal) ----
+uint8_t* sil_flash(size_t* size);
+void     sil_flash_erase_all();
+uint32_t sil_flash_erases();
+
+// ---- NVS (Preferences) ----
+void     sil_nvs_clear();
+bool     sil_nvs_has(const char* ns, const char* key);
+
+// ---- DS18B20 (sensor_ds18b20 via DallasTemperature) ----
+// Temperatura da próxima conversão; ausente = getTempC desconectado
+void     sil_ds18b20(bool present, float c);
+
+// ---- WiFi (AP no ar; o wifi_link reassocia sozinho) ----
+void     sil_wifi(bool up);
+
+// ---- MQTT (broker do PubSubClient; o mqtt_link é o de verdade) ----
+struct SilMsg {
+  std::string topic;     // sem MQTT_BASE/CTRL_ID/: "evt", "ack", "hist/bin", ...
+  std::string payload;
+};
+// Broker no ar/fora; a sessão abre no próximo mqtt_update (WiFi + intervalo
+// de reconexão), fora = cai na hora
+void     sil_mqtt_set_connected(bool on);
+std::vector<SilMsg>& sil_mqtt_msgs();
+size_t   sil_mqtt_count(const char* topic, const char* needle = nullptr);
+// Comando p/ o controlador: entregue um por mqtt.loop() se o tópico estiver
+// assinado (senão se perde). topic relativo a MQTT_BASE ("all/cmd", ...);
+// nullptr = o cmd deste controlador
+void     sil_mqtt_cmd(const char* json, const char* topic = nullptr);
+size_t   sil_mqtt_pending();   // ainda no broker
+
+// ---- LCD (o que está no vidro) ----
+std::string sil_lcd_row(uint8_t row);
@@ -0,0 +1,268 @@
+#include "sil.h"
+
+#include <Arduino.h>
+#include <DallasTemperature.h>
+#include <LiquidCrystal_I2C.h>
+#include <PubSubClient.h>
+#include <WiFi.h>
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+
+#include <deque>
+#include <set>
+
+#include "config.h"
+
+// ===== SIL: bibliotecas do core/Arduino de mentira =====
+// O "mundo" de cada uma (sensor, AP, broker, vidro do LCD) fica aqui e o
+// teste mexe por sil.h; os módulos de src/ rodam sem saber.
+
+// ================= ESP / core =================
+EspClass ESP;
+
+uint32_t EspClass::getCycleCount() { return (uint32_t)((uint64_t)micros() * 240); }
+uint64_t EspClass::getEfuseMac()   { return 0x0000A1B2C3D4E5F6ULL; }
+uint32_t EspClass::getFreeHeap()   { return 180000; }
+
+void configTime(long gmtOffsetSec, int dstOffsetSec, const char* server1,
+                const char* server2, const char* server3) {
+  (void)gmtOffsetSec; (void)dstOffsetSec; (void)server1; (void)server2; (void)server3;
+}
+
+size_t heap_caps_get_free_size(uint32_t caps)          { (void)caps; return 180000; }
+size_t heap_caps_get_minimum_free_size(uint32_t caps)  { (void)caps; return 150000; }
+size_t heap_caps_get_largest_free_block(uint32_t caps) { (void)caps; return 110000; }
+
+static vprintf_like_t g_logFn = vprintf;
+
+vprintf_like_t esp_log_set_vprintf(vprintf_like_t fn) {
+  const vprintf_like_t prev = g_logFn;
+  g_logFn = fn;
+  return prev;
+}
+
+// ================= DS18B20 =================
+static bool  g_dsPresent = true;
+static float g_dsC       = 20.0f;
+
+void sil_ds18b20(bool present, float c) {
+  g_dsPresent = present;
+  g_dsC       = c;
+}
+
+uint8_t DallasTemperature::getDeviceCount() { return g_dsPresent ? 1 : 0; }
+
+void DallasTemperature::requestTemperatures() {
+  if (!g_dsPresent) return;
+  const float lsb = 0.0625f * (float)(1 << (12 - _bits));   // 10 bits = 0.25 °C
+  _scratch = lroundf(g_dsC / lsb) * lsb;
+}
+
+float DallasTemperature::getTempCByIndex(uint8_t i) {
+  return (g_dsPresent && i == 0) ? _scratch : DEVICE_DISCONNECTED_C;
+}
+
+// ================= WiFi =================
+WiFiClass WiFi;
+
+static bool g_apUp  = true;
+static bool g_assoc = false;
+
+void sil_wifi(bool up) {
+  g_apUp = up;
+  if (!up) g_assoc = false;
+}
+
+String IPAddress::toString() const {
+  char s[16];
+  snprintf(s, sizeof(s), "%u.%u.%u.%u", _b[0], _b[1], _b[2], _b[3]);
+  return String(s);
+}
+
+wl_status_t WiFiClass::begin(const char* ssid, const char* pass) {
+  (void)ssid; (void)pass;
+  g_assoc = g_apUp;
+  return status();
+}
+
+bool WiFiClass::reconnect() {
+  g_assoc = g_apUp;
+  return g_assoc;
+}
+
+wl_status_t WiFiClass::status()  { return g_assoc ? WL_CONNECTED : WL_DISCONNECTED; }
+IPAddress   WiFiClass::localIP() { return g_assoc ? IPAddress(192, 168, 0, 50) : IPAddress(); }
+int8_t      WiFiClass::RSSI()    { return g_assoc ? -61 : 0; }
+
+// ================= Broker MQTT =================
+// Uma sessão (este controlador). Tópicos dos SilMsg sem o prefixo
+// MQTT_BASE/CTRL_ID/; os de comando do teste, relativos a MQTT_BASE/.
+struct SilInbound {
+  std::string topic;
+  std::string payload;
+};
+
+static bool                   g_brokerUp = true;
+static bool                   g_session  = false;
+static std::set<std::string>  g_subs;
+static std::deque<SilInbound> g_inbox;
+static std::vector<SilMsg>    g_msgs;
+
+static std::string own_prefix() { return std::string(MQTT_BASE "/" CTRL_ID "/"); }
+
+static void session_drop() {
+  g_session = false;
+  g_subs.clear();
+}
+
+void sil_mqtt_set_connected(bool on) {
+  g_brokerUp = on;
+  if (!on) session_drop();
+}
+
+std::vector<SilMsg>& sil_mqtt_msgs() { return g_msgs; }
+
+size_t sil_mqtt_count(const char* topic, const char* needle) {
+  size_t n = 0;
+  for (const SilMsg& m : g_msgs) {
+    if (m.topic != topic) continue;
+    if (needle && m.payload.find(needle) == std::string::npos) continue;
+    n++;
+  }
+  return n;
+}
+
+void sil_mqtt_cmd(const char* json, const char* topic) {
+  const std::string t = topic ? std::string(MQTT_BASE "/") + topic : own_prefix() + "cmd";
+  g_inbox.push_back({ t, json });
+}
+
+size_t sil_mqtt_pending() { return g_inbox.size(); }
+
+bool PubSubClient::setBufferSize(uint16_t n) {
+  uint8_t* b = (uint8_t*)realloc(_buf, n);
+  if (!b) return false;
+  _buf = b;
+  _bufSize = n;
+  return true;
+}
+
+bool PubSubClient::connect(const char* id, const char* user, const char* pass,
+                           const char* willTopic, uint8_t willQos, bool willRetain, const char* willMsg) {
+  (void)id; (void)user; (void)pass; (void)willTopic; (void)willQos; (void)willRetain; (void)willMsg;
+  if (!_buf) setBufferSize(_bufSize);
+  if (WiFi.status() != WL_CONNECTED || !g_brokerUp) return false;
+  session_drop();   // sessão limpa: assina de novo
+  g_session = true;
+  return true;
+}
+
+void PubSubClient::disconnect() { session_drop(); }
+
+bool PubSubClient::connected() {
+  if (g_session && WiFi.status() != WL_CONNECTED) session_drop();   // AP caiu
+  return g_session;
+}
+
+// Um pacote por volta, como a lib: comando em tópico não assinado se perde
+bool PubSubClient::loop() {
+  if (!connected()) return false;
+  if (g_inbox.empty()) return true;
+  const SilInbound in = g_inbox.front();
+  g_inbox.pop_front();
+  if (!g_subs.count(in.topic)) return true;
+  if (7 + in.topic.size() + in.payload.size() > _bufSize) return true;   // não cabe: descartado
+
+  std::vector<char> topic(in.topic.begin(), in.topic.end());
+  topic.push_back('\0');
+  memcpy(_buf, in.payload.data(), in.payload.size());
+  if (_cb) _cb(topic.data(), _buf, (unsigned int)in.payload.size());
+  return true;
+}
+
+bool PubSubClient::publish(const char* topic, const char* payload, bool retained) {
+  return publish(topic, (const uint8_t*)payload, (unsigned int)strlen(payload), retained);
+}
+
+// MQTT_MAX_HEADER_SIZE (5) + tamanho do tópico (2) + tópico + payload
+bool PubSubClient::publish(const char* topic, const uint8_t* payload, unsigned int len, bool retained) {
+  (void)retained;
+  if (!connected()) return false;
+  if (7 + strlen(topic) + len > _bufSize) return false;
+
+  std::string t = topic;
+  const std::string pre = own_prefix();
+  if (t.compare(0, pre.size(), pre) == 0) t = t.substr(pre.size());
+  g_msgs.push_back({ t, std::string((const char*)payload, len) });
+  return true;
+}
+
+bool PubSubClient::subscribe(const char* topic, uint8_t qos) {
+  (void)qos;
+  if (!connected()) return false;
+  g_subs.insert(topic);
+  return true;
+}
+
+bool PubSubClient::unsubscribe(const char* topic) {
+  if (!connected()) return false;
+  g_subs.erase(topic);
+  return true;
+}
+
+// ================= LCD =================
+static const uint8_t LCD_MAX_ROWS = 4;
+static const uint8_t LCD_MAX_COLS = 20;
+static char    g_glass[LCD_MAX_ROWS][LCD_MAX_COLS];
+static uint8_t g_lcdCols = LCD_MAX_COLS;
+
+std::string sil_lcd_row(uint8_t row) {
+  if (row >= LCD_MAX_ROWS) return std::string();
+  return std::string(g_glass[row], g_lcdCols);
+}
+
+LiquidCrystal_I2C::LiquidCrystal_I2C(uint8_t addr, uint8_t cols, uint8_t rows)
+  : _cols(cols > LCD_MAX_COLS ? LCD_MAX_COLS : cols), _rows(rows > LCD_MAX_ROWS ? LCD_MAX_ROWS : rows) {
+  (void)addr;
+}
+
+void LiquidCrystal_I2C::init() {
+  g_lcdCols = _cols;
+  clear();
+}
+
+void LiquidCrystal_I2C::clear() {
+  memset(g_glass, ' ', sizeof(g_glass));
+  _col = _row = 0;
+}
+
+void LiquidCrystal_I2C::setCursor(uint8_t col, uint8_t row) {
+  _col = col;
+  _row = row;
+}
+
+size_t LiquidCrystal_I2C::write(uint8_t ch) {
+  if (_row >= _rows || _col >= _cols) return 0;
+  g_glass[_row][_col++] = (char)ch;
+  return 1;
+}
+
+// ================= Energia =================
+// Queda: a placa some do AP e do broker (o mundo continua)
+void sil_libs_power_cut() {
+  g_assoc = false;
+  session_drop();
+  g_inbox.clear();
+}
+
+// Fábrica: sensor a 20 °C, AP e broker no ar, nada publicado
+void sil_libs_reset() {
+  sil_libs_power_cut();
+  g_dsPresent = true;
+  g_dsC       = 20.0f;
+  g_apUp      = true;
+  g_brokerUp  = true;
+  g_msgs.clear();
+  memset(g_glass, ' ', sizeof(g_glass));
+  g_logFn = vprintf;
+}
@@ -0,0 +1,31 @@
+#include <Arduino.h>
+
+#include "bench.h"
+#include "heap_guard.h"
+#include "lan_link.h"
+#include "ota_service.h"
+
+// ===== SIL: módulos de src/ que ficam fora do env native =====
+// OTA (HTTP/flash), LAN (UDP/mDNS/HMAC), bench (ciclos do ESP32) e o guarda
+// do heap (-Wl,--wrap) não têm o que simular no host: o app chama e nada
+// acontece (OTA e bench recusam o comando).
+
+bool ota_start_url(const char* url, bool reboot_after, const char* sha256_hex) {
+  (void)url; (void)reboot_after; (void)sha256_hex;
+  return false;
+}
+bool ota_resume_pending() { return false; }
+void ota_poll() {}
+bool ota_is_running() { return false; }
+
+void lan_begin() {}
+void lan_update(uint32_t now) { (void)now; }
+bool lan_state_due(uint32_t now) { (void)now; return false; }
+void lan_publish_state(const MqttState& s, uint32_t now) { (void)s; (void)now; }
+
+bool bench_start(const char* msgId, uint16_t iters) { (void)msgId; (void)iters; return false; }
+void bench_poll() {}
+
+void   heap_guard_seal() {}
+void   heap_guard_poll(uint32_t nowMs) { (void)nowMs; }
+size_t heap_guard_json(char* out, size_t cap) { (void)out; (void)cap; return 0; }
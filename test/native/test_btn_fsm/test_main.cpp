@@ -0,0 +1,192 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "btn_fsm.h"
+#include "config.h"
+
+// btn_fsm por replay de bordas (btn_pad_edge/btn_pad_advance), com o loop
+// de buttons_update em 10 ms, 700 ms e 2 s: toque curto, PRESS/RELEASE e
+// LONG saem com o mesmo instante; repeat atrasado sai um só e o ritmo
+// recomeça dali. Mesma config do buttons.cpp (UP/DOWN).
+
+enum { B_UP = 0, B_DOWN = 1 };
+
+struct Ev {
+  uint8_t  btn;
+  BtnEvent ev;
+  uint32_t t;
+};
+
+struct Edge {
+  uint32_t t;
+  uint8_t  btn;
+  uint8_t  level;   // pull-up: 0 = apertado
+};
+
+static std::vector<Ev> g_evs;
+
+static void sink(void*, uint8_t btn, BtnEvent ev, uint32_t t) {
+  g_evs.push_back({ btn, ev, t });
+}
+
+// Loop de 'periodMs' até 'endMs': a cada volta, as bordas que a ISR já
+// enfileirou (t <= agora) e depois o advance, como buttons_update
+static void replay(const Edge* e, size_t n, uint32_t periodMs, uint32_t endMs, bool chord = true) {
+  static const BtnCfg cfg = { 30, 500, 150, BTN_LONG_MS };
+  static BtnPad pad;
+  btn_pad_init(pad, sink, nullptr);
+  btn_pad_add(pad, cfg, 1, 0);
+  btn_pad_add(pad, cfg, 1, 0);
+  if (chord) btn_pad_set_chord(pad, B_UP, B_DOWN, BTN_CHORD_MS);
+  g_evs.clear();
+
+  size_t i = 0;
+  for (uint32_t now = periodMs; now <= endMs; now += periodMs) {
+    for (; i < n && e[i].t <= now; i++) btn_pad_edge(pad, e[i].btn, e[i].level, e[i].t);
+    btn_pad_advance(pad, now);
+  }
+  TEST_ASSERT_EQUAL(n, i);
+}
+
+static void assert_trace(const Ev* want, size_t n, uint32_t periodMs) {
+  char msg[64];
+  snprintf(msg, sizeof(msg), "loop %u ms: eventos", (unsigned)periodMs);
+  TEST_ASSERT_EQUAL_MESSAGE(n, g_evs.size(), msg);
+  for (size_t i = 0; i < n; i++) {
+    snprintf(msg, sizeof(msg), "loop %u ms: evento %u", (unsigned)periodMs, (unsigned)i);
+    TEST_ASSERT_EQUAL_UINT8_MESSAGE(want[i].btn, g_evs[i].btn, msg);
+    TEST_ASSERT_EQUAL_UINT8_MESSAGE(want[i].ev, g_evs[i].ev, msg);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(want[i].t, g_evs[i].t, msg);
+  }
+}
+
+static const uint32_t LOOPS[] = { 10, 700, 2000 };
+
+void setUp() {}
+void tearDown() {}
+
+// Bounce nas duas bordas: 1 PRESS/1 RELEASE, 30 ms depois da última borda
+static void test_bounce_single_press_release() {
+  const Edge e[] = {
+    { 100, B_UP, 0 }, { 103, B_UP, 1 }, { 105, B_UP, 0 }, { 110, B_UP, 1 }, { 112, B_UP, 0 },
+    { 400, B_UP, 1 }, { 402, B_UP, 0 }, { 404, B_UP, 1 },
+  };
+  const Ev want[] = { { B_UP, EV_PRESS, 142 }, { B_UP, EV_RELEASE, 434 } };
+  for (uint32_t p : LOOPS) {
+    replay(e, sizeof(e) / sizeof(e[0]), p, 6000);
+    assert_trace(want, 2, p);
+  }
+}
+
+// Toque de 40 ms: sobrevive a um loop bem mais lento que ele
+static void test_short_tap_any_loop() {
+  const Edge e[] = { { 100, B_DOWN, 0 }, { 140, B_DOWN, 1 } };
+  const Ev want[] = { { B_DOWN, EV_PRESS, 130 }, { B_DOWN, EV_RELEASE, 170 } };
+  for (uint32_t p : LOOPS) {
+    replay(e, 2, p, 6000);
+    assert_trace(want, 2, p);
+  }
+
+  // bounce mais curto que o debounce: nada
+  const Edge glitch[] = { { 100, B_DOWN, 0 }, { 120, B_DOWN, 1 } };
+  for (uint32_t p : LOOPS) {
+    replay(glitch, 2, p, 6000);
+    TEST_ASSERT_EQUAL(0, g_evs.size());
+  }
+}
+
+// Segurado 2 s: repeat em press+500 e depois a cada 150, LONG em press+1500
+static void test_hold_repeat_and_long() {
+  const Edge e[] = { { 100, B_UP, 0 }, { 2100, B_UP, 1 } };
+
+  const Ev fast[] = {
+    { B_UP, EV_PRESS, 130 },
+    { B_UP, EV_REPEAT, 630 },  { B_UP, EV_REPEAT, 780 },  { B_UP, EV_REPEAT, 930 },
+    { B_UP, EV_REPEAT, 1080 }, { B_UP, EV_REPEAT, 1230 }, { B_UP, EV_REPEAT, 1380 },
+    { B_UP, EV_REPEAT, 1530 }, { B_UP, EV_LONG, 1630 },   { B_UP, EV_REPEAT, 1680 },
+    { B_UP, EV_REPEAT, 1830 }, { B_UP, EV_REPEAT, 1980 },
+    { B_UP, EV_RELEASE, 2130 },   // repeat de 2130 não sai: soltou no mesmo instante
+  };
+  replay(e, 2, 10, 6000);
+  assert_trace(fast, sizeof(fast) / sizeof(fast[0]), 10);
+
+  // 700 ms: volta em 1400 acha 780 e 930 vencidos -> só 780, próximo em 1400+150
+  const Ev mid[] = {
+    { B_UP, EV_PRESS, 130 }, { B_UP, EV_REPEAT, 630 }, { B_UP, EV_REPEAT, 780 },
+    { B_UP, EV_REPEAT, 1550 }, { B_UP, EV_LONG, 1630 }, { B_UP, EV_RELEASE, 2130 },
+  };
+  replay(e, 2, 700, 6000);
+  assert_trace(mid, sizeof(mid) / sizeof(mid[0]), 700);
+
+  // 2 s: um repeat por volta; PRESS/LONG/RELEASE no instante certo
+  const Ev slow[] = {
+    { B_UP, EV_PRESS, 130 }, { B_UP, EV_REPEAT, 630 }, { B_UP, EV_LONG, 1630 },
+    { B_UP, EV_RELEASE, 2130 },
+  };
+  replay(e, 2, 2000, 6000);
+  assert_trace(slow, sizeof(slow) / sizeof(slow[0]), 2000);
+}
+
+// UP+DOWN dentro de BTN_CHORD_MS: só o CHORD, mesmo segurando 2 s
+static void test_chord() {
+  const Edge e[] = {
+    { 100, B_UP, 0 }, { 150, B_DOWN, 0 },
+    { 2500, B_UP, 1 }, { 2520, B_DOWN, 1 },
+  };
+  const Ev want[] = { { B_UP, EV_CHORD, 180 } };
+  for (uint32_t p : LOOPS) {
+    replay(e, sizeof(e) / sizeof(e[0]), p, 6000);
+    assert_trace(want, 1, p);
+  }
+
+  // depois do acorde os botões voltam ao normal
+  const Edge after[] = {
+    { 100, B_UP, 0 }, { 150, B_DOWN, 0 }, { 300, B_UP, 1 }, { 320, B_DOWN, 1 },
+    { 1000, B_DOWN, 0 }, { 1100, B_DOWN, 1 },
+  };
+  const Ev wantAfter[] = {
+    { B_UP, EV_CHORD, 180 }, { B_DOWN, EV_PRESS, 1030 }, { B_DOWN, EV_RELEASE, 1130 },
+  };
+  for (uint32_t p : LOOPS) {
+    replay(after, sizeof(after) / sizeof(after[0]), p, 6000);
+    assert_trace(wantAfter, 3, p);
+  }
+}
+
+// Fora da janela: dois PRESS normais, com o instante real de cada um
+// (o PRESS espera a janela, mas sai com o timestamp do aperto)
+static void test_chord_window_missed() {
+  const Edge e[] = {
+    { 100, B_UP, 0 }, { 300, B_DOWN, 0 },
+    { 400, B_UP, 1 }, { 450, B_DOWN, 1 },
+  };
+  const Ev want[] = {
+    { B_UP, EV_PRESS, 130 }, { B_DOWN, EV_PRESS, 330 },
+    { B_UP, EV_RELEASE, 430 }, { B_DOWN, EV_RELEASE, 480 },
+  };
+  for (uint32_t p : LOOPS) {
+    replay(e, sizeof(e) / sizeof(e[0]), p, 6000);
+    assert_trace(want, 4, p);
+  }
+
+  // loop parado em 130: com acorde o PRESS ainda espera a janela (até 210),
+  // sem acorde configurado já saiu
+  const Edge solo[] = { { 100, B_UP, 0 } };
+  const Ev wantSolo[] = { { B_UP, EV_PRESS, 130 } };
+  replay(solo, 1, 10, 130);
+  TEST_ASSERT_EQUAL(0, g_evs.size());
+  replay(solo, 1, 10, 130, false);
+  assert_trace(wantSolo, 1, 10);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_bounce_single_press_release);
+  RUN_TEST(test_short_tap_any_loop);
+  RUN_TEST(test_hold_repeat_and_long);
+  RUN_TEST(test_chord);
+  RUN_TEST(test_chord_window_missed);
+  return UNITY_END();
+}
@@ -0,0 +1,147 @@
+#include <unity.h>
+#include <Arduino.h>
+#include <vector>
+
+#include "sil.h"
+#include "buttons.h"
+#include "config.h"
+
+// buttons.cpp inteiro: ISR na borda do GPIO -> fila -> btn_fsm no
+// buttons_update da "task de controle" (esta thread, a cada 10 ms)
+
+static const uint8_t P_ONOFF = 32;
+static const uint8_t P_UP    = 33;
+static const uint8_t P_DOWN  = 25;
+
+static std::vector<BtnInput> g_ev;
+
+static void drain() {
+  BtnInput b;
+  while (buttons_next(b)) g_ev.push_back(b);
+}
+
+// loop da task de controle com período 'periodMs' durante 'ms'
+static void loop_for(uint32_t ms, uint32_t periodMs = 10) {
+  for (uint32_t k = 0; k < ms; k += periodMs) {
+    sil_advance(periodMs);
+    buttons_update(millis());
+    drain();
+  }
+}
+
+// contato batendo: 'n' trocas a cada 1 ms e termina em 'level'
+static uint32_t bounce(uint8_t pin, uint8_t level, int n) {
+  for (int i = n - 1; i >= 0; i--) {
+    sil_gpio_in(pin, (i % 2) ? !level : level);
+    if (i) sil_advance(1);
+  }
+  return millis();   // última borda
+}
+
+static size_t count(uint8_t btn, BtnEvent ev) {
+  size_t n = 0;
+  for (const BtnInput& b : g_ev) if (b.btn == btn && b.ev == ev) n++;
+  return n;
+}
+
+void setUp() {
+  sil_reset();
+  g_ev.clear();
+  sil_advance(1000);
+  buttons_begin(P_ONOFF, P_UP, P_DOWN);
+  loop_for(100);
+  drain();
+  g_ev.clear();
+}
+
+void tearDown() {}
+
+static void test_bounce_gives_one_press() {
+  const uint32_t tDown = bounce(P_ONOFF, LOW, 5);
+  loop_for(300);
+  const uint32_t tUp = bounce(P_ONOFF, HIGH, 4);
+  loop_for(100);
+
+  TEST_ASSERT_EQUAL(2, g_ev.size());
+  TEST_ASSERT_EQUAL(EV_PRESS, g_ev[0].ev);
+  TEST_ASSERT_EQUAL_UINT32(tDown + 30, g_ev[0].t);
+  TEST_ASSERT_EQUAL(EV_RELEASE, g_ev[1].ev);
+  TEST_ASSERT_EQUAL_UINT32(tUp + 30, g_ev[1].t);
+  TEST_ASSERT_EQUAL_UINT32(0, buttons_edges_lost());
+}
+
+static void test_hold_repeat_and_long() {
+  sil_gpio_in(P_UP, LOW);
+  const uint32_t tp = millis() + 30;
+  loop_for(2000);
+  sil_gpio_in(P_UP, HIGH);
+  loop_for(100);
+
+  TEST_ASSERT_EQUAL(1, count(BTN_UP, EV_PRESS));
+  TEST_ASSERT_EQUAL(1, count(BTN_UP, EV_LONG));
+  TEST_ASSERT_EQUAL(1, count(BTN_UP, EV_RELEASE));
+  // repeat em +500 e depois a cada 150 até soltar (+2000-30)
+  TEST_ASSERT_EQUAL((1850 - 500) / 150 + 1, count(BTN_UP, EV_REPEAT));
+
+  uint32_t expect = tp + 500;
+  for (const BtnInput& b : g_ev) {
+    if (b.ev == EV_LONG) TEST_ASSERT_EQUAL_UINT32(tp + BTN_LONG_MS, b.t);
+    if (b.ev != EV_REPEAT) continue;
+    TEST_ASSERT_EQUAL_UINT32(expect, b.t);
+    expect += 150;
+  }
+}
+
+// Loop de 700 ms (task travada): o toque de 40 ms chega pela ISR com o
+// horário certo
+static void test_slow_loop_keeps_tap() {
+  sil_advance(200);
+  const uint32_t t0 = millis();
+  sil_gpio_in(P_ONOFF, LOW);
+  sil_advance(40);
+  sil_gpio_in(P_ONOFF, HIGH);
+  loop_for(1400, 700);
+
+  TEST_ASSERT_EQUAL(2, g_ev.size());
+  TEST_ASSERT_EQUAL(EV_PRESS, g_ev[0].ev);
+  TEST_ASSERT_EQUAL_UINT32(t0 + 30, g_ev[0].t);
+  TEST_ASSERT_EQUAL(EV_RELEASE, g_ev[1].ev);
+  TEST_ASSERT_EQUAL_UINT32(t0 + 40 + 30, g_ev[1].t);
+}
+
+static void test_chord_up_down() {
+  sil_gpio_in(P_UP, LOW);
+  sil_advance(20);
+  sil_gpio_in(P_DOWN, LOW);
+  loop_for(1000);
+  sil_gpio_in(P_DOWN, HIGH);
+  sil_gpio_in(P_UP, HIGH);
+  loop_for(200);
+
+  TEST_ASSERT_EQUAL(1, g_ev.size());
+  TEST_ASSERT_EQUAL(EV_CHORD, g_ev[0].ev);
+  TEST_ASSERT_EQUAL(BTN_UP, g_ev[0].btn);
+}
+
+// Mais bordas que a fila entre dois updates: ressincroniza pelo pino
+static void test_edge_queue_overflow_resyncs() {
+  for (int i = 0; i < BTN_EDGE_QUEUE + 8; i++) {
+    sil_gpio_in(P_ONOFF, (i % 2) ? HIGH : LOW);
+  }
+  sil_gpio_in(P_ONOFF, LOW);
+  loop_for(300, 100);
+
+  TEST_ASSERT_GREATER_THAN(0, buttons_edges_lost());
+  TEST_ASSERT_EQUAL(1, count(BTN_ONOFF, EV_PRESS));
+  TEST_ASSERT_EQUAL(0, count(BTN_ONOFF, EV_RELEASE));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_bounce_gives_one_press);
+  RUN_TEST(test_hold_repeat_and_long);
+  RUN_TEST(test_slow_loop_keeps_tap);
+  RUN_TEST(test_chord_up_down);
+  RUN_TEST(test_edge_queue_overflow_resyncs);
+  return UNITY_END();
+}
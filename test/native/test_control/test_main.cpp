@@ -0,0 +1,86 @@
+#include <unity.h>
+#include <Arduino.h>
+#include <math.h>
+
+#include "sil.h"
+#include "controlador_caap.h"
+
+// controlador_update contra uma planta de 1ª ordem (estufa + aquecedor) e
+// controlador_apply_output no GPIO do SSR
+
+static const uint8_t PIN_SSR = 26;
+
+// T[k+1] = a·T + b·u + (1-a)·Tamb   (ganho estático 0.4 °C/%)
+struct Plant {
+  float a, b, amb, T;
+  void step(float u) { T = a * T + b * u + (1.0f - a) * amb; }
+};
+
+// 'secs' passos de 1 s; devolve o maior |T - sp| nos últimos 'tailSecs'
+static float run(CAAP_Data& c, Plant& p, float sp, uint32_t secs, uint32_t tailSecs) {
+  float worst = 0;
+  for (uint32_t k = 0; k < secs; k++) {
+    controlador_update(c, p.T, sp, 1.0f);
+    TEST_ASSERT_TRUE(c.u_calculado >= 0.0f && c.u_calculado <= 100.0f);
+    p.step(c.u_calculado);
+    if (k >= secs - tailSecs && fabsf(p.T - sp) > worst) worst = fabsf(p.T - sp);
+  }
+  return worst;
+}
+
+void setUp() { sil_reset(); }
+void tearDown() {}
+
+static void test_converges_on_first_order_plant() {
+  Plant p = { 0.99f, 0.004f, 20.0f, 20.0f };
+  CAAP_Data c;
+  controlador_begin(c, p.T);
+
+  TEST_ASSERT_LESS_THAN_FLOAT(0.5f, run(c, p, 30.0f, 1200, 300));
+  TEST_ASSERT_TRUE(c.a1 >= 0.80f && c.a1 <= 0.999f);
+  TEST_ASSERT_TRUE(c.b0 >= 0.0001f && c.b0 <= 0.5f);
+  TEST_ASSERT_FLOAT_WITHIN(5.0f, 25.0f, c.u_calculado);   // (30-20)/0.4
+}
+
+static void test_follows_setpoint_step() {
+  Plant p = { 0.99f, 0.004f, 20.0f, 20.0f };
+  CAAP_Data c;
+  controlador_begin(c, p.T);
+  run(c, p, 30.0f, 1200, 1);
+
+  // sem integrador e com zona morta no RLS: erro de regime fica < 1 °C
+  TEST_ASSERT_LESS_THAN_FLOAT(1.0f, run(c, p, 35.0f, 1800, 300));
+  TEST_ASSERT_LESS_THAN_FLOAT(1.0f, run(c, p, 28.0f, 1800, 300));
+}
+
+// Duty do SSR numa janela de 1 s com o apply a cada 10 ms
+static uint32_t ssr_on_ms(const CAAP_Data& c) {
+  uint32_t on = 0;
+  for (int i = 0; i < 100; i++) {
+    controlador_apply_output(c, PIN_SSR, 1000);
+    if (sil_gpio_out(PIN_SSR) == HIGH) on += 10;
+    sil_advance(10);
+  }
+  return on;
+}
+
+static void test_ssr_duty() {
+  CAAP_Data c;
+  controlador_begin(c, 25.0f);
+  sil_advance(5000);   // fora do início da janela
+
+  c.u_calculado = 25.0f;
+  TEST_ASSERT_UINT32_WITHIN(10, 250, ssr_on_ms(c));
+  c.u_calculado = 0.0f;
+  TEST_ASSERT_EQUAL_UINT32(0, ssr_on_ms(c));
+  c.u_calculado = 100.0f;
+  TEST_ASSERT_EQUAL_UINT32(1000, ssr_on_ms(c));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_converges_on_first_order_plant);
+  RUN_TEST(test_follows_setpoint_step);
+  RUN_TEST(test_ssr_duty);
+  return UNITY_END();
+}
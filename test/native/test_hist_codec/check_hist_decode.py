@@ -0,0 +1,65 @@
+#!/usr/bin/env python3
+"""Confere tools/hist_decode.py contra o fixture do hist_codec (fixture.h).
+
+  python3 test/native/test_hist_codec/check_hist_decode.py
+
+O mesmo FIX_BLOCK que o test_main.cpp confere com o encoder tem que sair do
+decoder Python nas mesmas FIX_ROWS (e com o header certo). Sai != 0 se não.
+"""
+import os
+import re
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, os.path.join(HERE, "..", "..", "..", "tools"))
+import hist_decode  # noqa: E402
+
+
+def c_int(expr):
+    # só literais decimais/hex, sufixo u e "-2147483647 - 1"
+    expr = re.sub(r"(?<=[0-9a-fA-F])[uU]\b", "", expr.strip())
+    if not re.fullmatch(r"[-+ 0-9a-fA-Fx]+", expr):
+        raise ValueError("expressão inesperada: %r" % expr)
+    return eval(expr, {"__builtins__": {}})  # noqa: S307
+
+
+def load_fixture():
+    src = open(os.path.join(HERE, "fixture.h")).read()
+    src = re.sub(r"//[^\n]*", "", src)
+    defs = {k: v for k, v in re.findall(r"#define\s+(FIX_\w+)\s+(\S+)", src)}
+
+    rows_src = re.search(r"FIX_ROWS\[\]\s*=\s*\{(.*?)\n\};", src, re.S).group(1)
+    rows = []
+    for ts, vals in re.findall(r"\{\s*([^,{}]+),\s*\{([^}]*)\}\s*\}", rows_src):
+        rows.append((c_int(ts), [c_int(v) for v in vals.split(",")]))
+
+    blk_src = re.search(r"FIX_BLOCK\[\d+\]\s*=\s*\{(.*?)\};", src, re.S).group(1)
+    block = bytes(int(b, 16) for b in re.findall(r"0x[0-9a-fA-F]{2}", blk_src))
+    return defs, rows, block
+
+
+def main():
+    defs, rows, block = load_fixture()
+    tier, seq, flags, qid, got = hist_decode.decode_block(block)
+
+    ok = True
+    want_hdr = (c_int(defs["FIX_TIER"]), c_int(defs["FIX_SEQ"]), hist_decode.FLAG_LAST,
+                c_int(defs["FIX_QID"]))
+    if (tier, seq, flags, qid) != want_hdr:
+        print("header: %r != %r" % ((tier, seq, flags, qid), want_hdr))
+        ok = False
+    if len(got) != len(rows):
+        print("linhas: %d != %d" % (len(got), len(rows)))
+        ok = False
+    for i, (g, w) in enumerate(zip(got, rows)):
+        if g[0] != w[0] or list(g[1]) != w[1]:
+            print("linha %d: %r != %r" % (i, g, w))
+            ok = False
+
+    print("hist_decode.py x fixture: %s (%d linhas, %d bytes)" %
+          ("ok" if ok else "FALHOU", len(rows), len(block)))
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
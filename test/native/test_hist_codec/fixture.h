@@ -0,0 +1,40 @@
+#pragma once
+// Fixture fixa do hist_codec: as linhas e o bloco que hc_block_* gera com
+// elas. test_main.cpp confere o encoder; check_hist_decode.py confere que
+// tools/hist_decode.py decodifica o mesmo bloco nas mesmas linhas.
+#include <stdint.h>
+#include "hist_codec.h"
+
+#define FIX_TIER   1
+#define FIX_SEQ    0x1234
+#define FIX_QID    7
+#define FIX_FLAGS  HC_FLAG_LAST
+
+// ts, n, nT, tMin, tAvg, tMax, spMin, spAvg, spMax, uMin, uAvg, uMax, onPct
+static const HcRow FIX_ROWS[] = {
+  { 1700000000u, { 60, 60, 2480, 2500, 2530, 2500, 2500, 2500,    0, 3300, 10000, 33 } },  // 1º ponto
+  { 1700000060u, { 60, 60, 2490, 2510, 2530, 2500, 2500, 2500,    0, 3200, 10000, 32 } },
+  { 1700000120u, { 60, 60, 2490, 2510, 2530, 2500, 2500, 2500,    0, 3200, 10000, 32 } },  // repetida
+  { 1700003720u, { 60,  0,    0,    0,    0, 2500, 2500, 2500,    0,    0,     0,  0 } },  // buraco, sem sensor
+  { 1699999000u, { 60, 60, 2400, 2410, 2420, 3000, 3000, 3000, 10000, 10000, 10000, 100 } }, // ts volta
+  {          0u, { 59, 59, -5500, 0, 12500, -32768, 0, 32767,   0, 5000, 10000, 50 } },        // sem NTP
+  { 4294967295u, { 2147483647, -2147483647 - 1, 2147483647, -2147483647 - 1, 0, 1, -1, 15, -16, 255, -256, 65535 } },
+  {         59u, { -2147483647 - 1, 2147483647, -2147483647 - 1, 2147483647, 0, 0, 0, 0, 0, 0, 0, 0 } },  // ts dá a volta
+};
+#define FIX_ROW_COUNT (sizeof(FIX_ROWS) / sizeof(FIX_ROWS[0]))
+
+// hc_block_begin(FIX_TIER, FIX_SEQ, FIX_QID) + FIX_ROWS + hc_block_end(FIX_FLAGS)
+static const uint8_t FIX_BLOCK[189] = {
+  0x48, 0x43, 0x01, 0x01, 0x34, 0x12, 0x01, 0x07, 0x08, 0x00, 0xfc, 0xaa, 0x7e, 0x20, 0x0c, 0xf1,
+  0x9e, 0x38, 0x4d, 0x83, 0x84, 0xe2, 0x38, 0x4f, 0x13, 0x84, 0xe2, 0x38, 0x4e, 0x23, 0x84, 0xe2,
+  0x1c, 0x33, 0x91, 0xc9, 0xc4, 0x19, 0x0b, 0xf2, 0xa9, 0xf8, 0x61, 0xcc, 0x29, 0x85, 0x01, 0xb1,
+  0xd0, 0x80, 0x03, 0x86, 0xea, 0x19, 0xdf, 0x84, 0xdc, 0xf8, 0x4e, 0x6f, 0x84, 0xf0, 0xc3, 0x86,
+  0x3f, 0xf9, 0x38, 0x7f, 0x1f, 0xf2, 0x07, 0xfb, 0x3c, 0x70, 0x96, 0x07, 0x09, 0x6a, 0x70, 0x97,
+  0x47, 0x01, 0xf4, 0x70, 0x1f, 0x47, 0x01, 0xf4, 0x72, 0x71, 0x07, 0x27, 0x10, 0x72, 0x71, 0x06,
+  0xc8, 0xfc, 0xaa, 0x7b, 0x54, 0xf8, 0x61, 0xe3, 0xdb, 0x7e, 0x12, 0xd3, 0xe4, 0xec, 0x0f, 0x00,
+  0x01, 0x17, 0x6f, 0xe1, 0x76, 0xfe, 0xe8, 0x8e, 0xe4, 0xe1, 0xfe, 0x27, 0x0f, 0x66, 0x3f, 0xca,
+  0xa7, 0xda, 0x2e, 0xff, 0xff, 0xff, 0xf8, 0x8f, 0xff, 0xff, 0xff, 0x8a, 0xff, 0xff, 0xfd, 0x50,
+  0x9f, 0xff, 0xff, 0xff, 0xff, 0xe6, 0x1a, 0x7f, 0x00, 0x01, 0x00, 0x02, 0x87, 0xbf, 0xf7, 0xf0,
+  0xff, 0x12, 0x88, 0xf2, 0x80, 0xff, 0x80, 0x00, 0xff, 0xcd, 0x67, 0xa8, 0xa1, 0x8a, 0x14, 0x31,
+  0x61, 0xdc, 0x41, 0xc0, 0x3f, 0xbc, 0x04, 0x01, 0xe0, 0x00, 0x3f, 0xff, 0xa0,
+};
@@ -0,0 +1,290 @@
+#include <unity.h>
+#include <Arduino.h>
+#include <math.h>
+#include <string.h>
+
+#include "sil.h"
+#include "hist_codec.h"
+#include "tsdb.h"
+#include "fixture.h"
+
+// hist_codec: round-trip nos extremos (ts delta-of-delta, prefixos dos
+// valores, bloco cheio) e o bloco fixo de fixture.h, que
+// check_hist_decode.py confere contra tools/hist_decode.py
+
+static uint8_t g_buf[4096];
+
+static void assert_row(const HcRow& want, const HcRow& got) {
+  TEST_ASSERT_EQUAL_UINT32(want.ts, got.ts);
+  TEST_ASSERT_EQUAL_INT32_ARRAY(want.v, got.v, HC_FIELDS);
+}
+
+// codifica rows num writer só, decodifica e compara; devolve bits usados
+static size_t roundtrip(const HcRow* rows, size_t n) {
+  HcWriter w;
+  HcState  s;
+  hc_writer_init(w, g_buf, sizeof(g_buf));
+  hc_state_reset(s);
+  for (size_t i = 0; i < n; i++) TEST_ASSERT_TRUE(hc_put_row(w, s, rows[i]));
+
+  HcReader r;
+  HcState  rs;
+  HcRow    got;
+  hc_reader_init(r, g_buf, hc_writer_bytes(w));
+  hc_state_reset(rs);
+  for (size_t i = 0; i < n; i++) {
+    TEST_ASSERT_TRUE(hc_get_row(r, rs, got));
+    assert_row(rows[i], got);
+  }
+  return w.bits;
+}
+
+static uint32_t g_rnd = 0x2545F491;
+static uint32_t rnd() {
+  g_rnd ^= g_rnd << 13; g_rnd ^= g_rnd >> 17; g_rnd ^= g_rnd << 5;
+  return g_rnd;
+}
+
+void setUp() { sil_reset(); }
+void tearDown() {}
+
+static void test_fixture_block() {
+  HcBlock b;
+  TEST_ASSERT_TRUE(hc_block_begin(b, g_buf, sizeof(g_buf), FIX_TIER, FIX_SEQ, FIX_QID));
+  for (size_t i = 0; i < FIX_ROW_COUNT; i++) TEST_ASSERT_TRUE(hc_block_add(b, FIX_ROWS[i]));
+  const size_t len = hc_block_end(b, FIX_FLAGS);
+
+  // bytes fixos: mudou o formato, muda o decoder do host junto
+  TEST_ASSERT_EQUAL(sizeof(FIX_BLOCK), len);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(FIX_BLOCK, g_buf, len);
+
+  HcReader r;
+  HcState  s;
+  HcRow    got;
+  hc_reader_init(r, FIX_BLOCK + HC_BLOCK_HDR, sizeof(FIX_BLOCK) - HC_BLOCK_HDR);
+  hc_state_reset(s);
+  for (size_t i = 0; i < FIX_ROW_COUNT; i++) {
+    TEST_ASSERT_TRUE(hc_get_row(r, s, got));
+    assert_row(FIX_ROWS[i], got);
+  }
+}
+
+static void test_ts_delta_of_delta_edges() {
+  HcRow rows[10];
+  memset(rows, 0, sizeof(rows));
+  const uint32_t ts[10] = {
+    1700000000u,                 // 1º ponto: dod = ts inteiro (estado zerado)
+    1700000060u, 1700000120u,    // regular
+    1700007320u,                 // buraco de 2 h
+    1700007380u,
+    1699990000u,                 // volta no tempo (NTP corrigiu)
+    0u,                          // sem NTP
+    0xFFFFFFC4u, 0x00000000u,    // dá a volta em 2^32
+    0x0000003Cu,
+  };
+  for (int i = 0; i < 10; i++) rows[i].ts = ts[i];
+  roundtrip(rows, 10);
+
+  // 1º ponto sozinho também volta (estado zerado = linha autocontida)
+  roundtrip(rows, 1);
+}
+
+static void test_regular_repeated_rows_cost_one_bit_each() {
+  HcRow rows[50];
+  for (int i = 0; i < 50; i++) {
+    rows[i].ts = 1700000000u + 60u * i;
+    for (int f = 0; f < HC_FIELDS; f++) rows[i].v[f] = 2500 + f;
+  }
+  const size_t two = roundtrip(rows, 2);
+  // a partir da 3ª linha: dod 0 e todos os deltas 0 -> 1 bit por valor
+  TEST_ASSERT_EQUAL(two + 48 * (HC_FIELDS + 1), roundtrip(rows, 50));
+}
+
+static void test_value_prefix_boundaries() {
+  struct { int32_t d; size_t bits; } cases[] = {
+    { 0, 1 }, { -1, 6 }, { 7, 6 }, { 8, 11 }, { -128, 11 }, { 128, 20 },
+    { -32768, 20 }, { 32768, 36 }, { INT32_MAX, 36 }, { INT32_MIN, 36 },
+  };
+  for (size_t k = 0; k < sizeof(cases) / sizeof(cases[0]); k++) {
+    HcRow row;
+    memset(&row, 0, sizeof(row));
+    row.v[3] = cases[k].d;
+    // ts 0 (dod 0) + 11 campos parados + o campo testado
+    TEST_ASSERT_EQUAL(1 + (HC_FIELDS - 1) + cases[k].bits, roundtrip(&row, 1));
+  }
+}
+
+static void test_large_swings() {
+  static HcRow rows[400];
+  for (int i = 0; i < 400; i++) {
+    const bool hi = i & 1;
+    rows[i].ts = hi ? 0xFFFFFFFFu : 0u;
+    for (int f = 0; f < HC_FIELDS; f++) rows[i].v[f] = ((f & 1) ^ hi) ? INT32_MAX : INT32_MIN;
+  }
+  roundtrip(rows, 60);   // campos a 32 bits por linha: 60 cabem em g_buf
+
+  // aleatório: tamanhos de delta misturados
+  for (int i = 0; i < 400; i++) {
+    rows[i].ts = (i && (rnd() & 3)) ? rows[i - 1].ts + 60 : rnd();
+    for (int f = 0; f < HC_FIELDS; f++) {
+      const uint32_t x = rnd();
+      rows[i].v[f] = (x & 1) ? (int32_t)x : (int32_t)(x >> (x & 31));
+    }
+  }
+  size_t done = 0;
+  while (done < 400) {   // em pedaços que cabem em g_buf
+    const size_t n = (400 - done < 50) ? 400 - done : 50;
+    roundtrip(rows + done, n);
+    done += n;
+  }
+}
+
+// i-ésima linha que custa exatamente HC_ROW_MAX_BITS: dod e deltas sempre
+// INT32_MIN (ts 2^31,2^31,0,0,... e campos MIN,0,MIN,...)
+static void worst_row(HcRow& r, int i) {
+  r.ts = (i & 2) ? 0u : 0x80000000u;
+  for (int f = 0; f < HC_FIELDS; f++) r.v[f] = (i & 1) ? 0 : INT32_MIN;
+}
+
+static void test_block_full_boundary() {
+  HcBlock b;
+  TEST_ASSERT_FALSE(hc_block_begin(b, g_buf, HC_BLOCK_HDR + HC_ROW_MAX_BYTES - 1, 0, 0));
+
+  // cabe exatamente 3 linhas no pior caso
+  const size_t cap = HC_BLOCK_HDR + 3 * HC_ROW_MAX_BYTES;
+  TEST_ASSERT_TRUE(hc_block_begin(b, g_buf, cap, 2, 1));
+  HcRow rows[4];
+  for (int i = 0; i < 4; i++) worst_row(rows[i], i);
+  for (int i = 0; i < 3; i++) TEST_ASSERT_TRUE(hc_block_add(b, rows[i]));
+  TEST_ASSERT_EQUAL(3 * HC_ROW_MAX_BITS, b.w.bits);
+
+  // recusa não mexe em nada
+  const HcState st = b.st;
+  TEST_ASSERT_FALSE(hc_block_add(b, rows[3]));
+  TEST_ASSERT_EQUAL(3, b.count);
+  TEST_ASSERT_EQUAL(3 * HC_ROW_MAX_BITS, b.w.bits);
+  TEST_ASSERT_EQUAL_MEMORY(&st, &b.st, sizeof(st));
+
+  const size_t len = hc_block_end(b, HC_FLAG_LAST);
+  TEST_ASSERT_TRUE(len <= cap);
+  TEST_ASSERT_EQUAL_UINT8(3, g_buf[8]);
+  TEST_ASSERT_EQUAL_UINT8(HC_FLAG_LAST, g_buf[6]);
+
+  HcReader r;
+  HcState  s;
+  HcRow    got;
+  hc_reader_init(r, g_buf + HC_BLOCK_HDR, len - HC_BLOCK_HDR);
+  hc_state_reset(s);
+  for (int i = 0; i < 3; i++) {
+    TEST_ASSERT_TRUE(hc_get_row(r, s, got));
+    assert_row(rows[i], got);
+  }
+  // bits que sobram (zeros de preenchimento) não chegam a uma linha
+  const HcState before = s;
+  TEST_ASSERT_FALSE(hc_get_row(r, s, got));
+  TEST_ASSERT_EQUAL_MEMORY(&before, &s, sizeof(s));
+
+  // linhas baratas: o bloco fecha quando não sobra o pior caso, não quando enche
+  TEST_ASSERT_TRUE(hc_block_begin(b, g_buf, cap, 2, 2));
+  HcRow cheap;
+  memset(&cheap, 0, sizeof(cheap));
+  uint32_t n = 0;
+  while (hc_block_add(b, cheap)) n++;
+  TEST_ASSERT_EQUAL((3 * HC_ROW_MAX_BYTES * 8 - HC_ROW_MAX_BITS) / (HC_FIELDS + 1) + 1, n);
+
+  // o próximo bloco recomeça o estado: 1ª linha se decodifica sozinha
+  TEST_ASSERT_TRUE(hc_block_begin(b, g_buf, cap, 2, 3));
+  TEST_ASSERT_TRUE(hc_block_add(b, rows[1]));
+  hc_block_end(b, 0);
+  hc_reader_init(r, g_buf + HC_BLOCK_HDR, cap - HC_BLOCK_HDR);
+  hc_state_reset(s);
+  TEST_ASSERT_TRUE(hc_get_row(r, s, got));
+  assert_row(rows[1], got);
+}
+
+static void test_truncated_block() {
+  HcRow rows[6];
+  memset(rows, 0, sizeof(rows));
+  for (int i = 0; i < 6; i++) { rows[i].ts = 1700000000u + 60u * i; rows[i].v[0] = 100000 * i; }
+  HcWriter w;
+  HcState  s;
+  hc_writer_init(w, g_buf, sizeof(g_buf));
+  hc_state_reset(s);
+  for (int i = 0; i < 6; i++) hc_put_row(w, s, rows[i]);
+
+  // sem o último byte: as linhas inteiras saem, a cortada não
+  HcReader r;
+  HcRow    got;
+  hc_reader_init(r, g_buf, hc_writer_bytes(w) - 1);
+  hc_state_reset(s);
+  int n = 0;
+  while (hc_get_row(r, s, got)) { assert_row(rows[n], got); n++; }
+  TEST_ASSERT_TRUE(n >= 4 && n < 6);
+}
+
+// NaN não chega no codec: tsdb quantiza em 0.01 °C e amostra sem leitura
+// (ou NaN/inf mesmo marcada válida) vira nT menor e t* zerados
+static void test_nan_samples_through_tsdb() {
+  const uint32_t T0 = 1699920000;
+  sil_set_epoch(T0);
+  TEST_ASSERT_TRUE(tsdb_begin());
+  sil_idle();
+
+  for (uint32_t i = 0; i < 3 * 60; i++) {
+    sil_advance(1000);
+    const uint32_t m = (sil_epoch() - T0) / 60;
+    const bool odd = i & 1;
+    if (m == 0)      tsdb_add(millis(), false, NAN, 30.0f, 50.0f, true);
+    else if (m == 1) tsdb_add(millis(), true, odd ? NAN : 25.0f, 30.0f, 50.0f, true);
+    else             tsdb_add(millis(), true, odd ? INFINITY : -10.5f, 30.0f, 50.0f, true);
+  }
+  sil_advance(60000);
+  tsdb_add(millis(), true, 20.0f, 30.0f, 50.0f, true);   // fecha o 3º minuto
+  sil_idle();
+
+  TsdbCursor c;
+  TsdbRec rec[3];
+  tsdb_seek(c, TSDB_MIN, 0);
+  for (int i = 0; i < 3; i++) TEST_ASSERT_TRUE(tsdb_next(c, rec[i]));
+
+  TEST_ASSERT_EQUAL_UINT32(0, rec[0].nT);
+  TEST_ASSERT_EQUAL_INT16(0, rec[0].tMin);
+  TEST_ASSERT_EQUAL_INT16(0, rec[0].tMax);
+  TEST_ASSERT_EQUAL_UINT32(30, rec[1].nT);
+  TEST_ASSERT_EQUAL_INT16(2500, rec[1].tMin);
+  TEST_ASSERT_EQUAL_INT16(2500, rec[1].tMax);
+  TEST_ASSERT_EQUAL_UINT32(30, rec[2].nT);
+  TEST_ASSERT_EQUAL_INT16(-1050, rec[2].tAvg);
+
+  // e o bloco de transmissão devolve os mesmos registros
+  HcBlock b;
+  TEST_ASSERT_TRUE(hc_block_begin(b, g_buf, sizeof(g_buf), TSDB_MIN, 0));
+  HcRow rows[3];
+  for (int i = 0; i < 3; i++) { tsdb_to_row(rec[i], rows[i]); TEST_ASSERT_TRUE(hc_block_add(b, rows[i])); }
+  const size_t len = hc_block_end(b, HC_FLAG_LAST);
+
+  HcReader r;
+  HcState  s;
+  HcRow    got;
+  hc_reader_init(r, g_buf + HC_BLOCK_HDR, len - HC_BLOCK_HDR);
+  hc_state_reset(s);
+  for (int i = 0; i < 3; i++) {
+    TEST_ASSERT_TRUE(hc_get_row(r, s, got));
+    TsdbRec back;
+    tsdb_from_row(got, TSDB_MIN, back);
+    TEST_ASSERT_EQUAL_MEMORY(&rec[i], &back, sizeof(back));
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_fixture_block);
+  RUN_TEST(test_ts_delta_of_delta_edges);
+  RUN_TEST(test_regular_repeated_rows_cost_one_bit_each);
+  RUN_TEST(test_value_prefix_boundaries);
+  RUN_TEST(test_large_swings);
+  RUN_TEST(test_block_full_boundary);
+  RUN_TEST(test_truncated_block);
+  RUN_TEST(test_nan_samples_through_tsdb);
+  return UNITY_END();
+}
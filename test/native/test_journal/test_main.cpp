@@ -0,0 +1,220 @@
+#include <unity.h>
+#include <Arduino.h>
+
+#include "sil.h"
+#include <Preferences.h>
+#include "journal.h"
+#include "hist24.h"
+#include "config.h"
+
+// journal.cpp na partição de mentira, com a task de flush e quedas de energia
+
+static void boot() {
+  TEST_ASSERT_TRUE(jrnl_begin());
+  sil_idle();
+}
+
+static uint32_t get_u32(uint8_t key, uint32_t def = 0xDEAD) {
+  uint32_t v;
+  return jrnl_get(key, &v, sizeof(v)) ? v : def;
+}
+
+static void put_u32(uint8_t key, uint32_t v) {
+  TEST_ASSERT_TRUE(jrnl_put(key, &v, sizeof(v)));
+}
+
+void setUp() {
+  sil_reset();
+  boot();
+}
+
+void tearDown() {}
+
+static void test_put_get_and_batched_flush() {
+  put_u32(JK_BOOTS, 1);
+  put_u32(JK_BOOTS, 2);
+  put_u32(JK_BOOTS, 3);
+  TEST_ASSERT_EQUAL_UINT32(3, get_u32(JK_BOOTS));   // pendente já vale
+
+  JrnlStats s;
+  jrnl_get_stats(s);
+  TEST_ASSERT_EQUAL_UINT32(0, s.records);
+  TEST_ASSERT_EQUAL_UINT32(2, s.coalesced);
+
+  sil_advance(JRNL_FLUSH_MS);
+  jrnl_get_stats(s);
+  TEST_ASSERT_EQUAL_UINT32(1, s.records);   // 3 puts, 1 gravação
+
+  uint8_t wrong[3];
+  TEST_ASSERT_FALSE(jrnl_get(JK_BOOTS, wrong, sizeof(wrong)));
+  TEST_ASSERT_FALSE(jrnl_get(JK_SETPOINT, wrong, sizeof(wrong)));
+}
+
+static void test_power_cut_before_flush_loses_only_pending() {
+  put_u32(JK_BOOTS, 7);
+  jrnl_flush();
+  sil_idle();
+  put_u32(JK_BOOTS, 8);
+  sil_advance(JRNL_FLUSH_MS - 100);
+  sil_power_cut(1000);
+  boot();
+  TEST_ASSERT_EQUAL_UINT32(7, get_u32(JK_BOOTS));
+}
+
+static void test_power_cut_after_flush_keeps_value() {
+  put_u32(JK_BOOTS, 9);
+  sil_advance(JRNL_FLUSH_MS);
+  sil_power_cut(1000);
+  boot();
+  TEST_ASSERT_EQUAL_UINT32(9, get_u32(JK_BOOTS));
+}
+
+// Muitas voltas no anel: compactação leva as chaves vivas junto
+static void test_ring_wraps_and_compacts() {
+  const float sp = 31.5f;
+  TEST_ASSERT_TRUE(jrnl_put(JK_SETPOINT, &sp, sizeof(sp)));
+  jrnl_flush();
+  sil_idle();
+
+  const uint32_t erases0 = sil_flash_erases();
+  for (uint32_t i = 0; i < 3000; i++) {   // 1 registro por flush
+    put_u32(JK_BOOTS, i);
+    jrnl_flush();
+    sil_idle();
+  }
+
+  JrnlStats s;
+  jrnl_get_stats(s);
+  TEST_ASSERT_GREATER_THAN(JRNL_SECTORS, s.erases);
+  TEST_ASSERT_GREATER_THAN(0, s.relocated);
+  TEST_ASSERT_GREATER_THAN(erases0, sil_flash_erases());
+
+  sil_power_cut(0);
+  boot();
+  float back = 0;
+  TEST_ASSERT_TRUE(jrnl_get(JK_SETPOINT, &back, sizeof(back)));
+  TEST_ASSERT_EQUAL_FLOAT(sp, back);
+  TEST_ASSERT_EQUAL_UINT32(2999, get_u32(JK_BOOTS));
+}
+
+// Queda no meio de um registro: o torto é pulado, o anterior vale e a
+// escrita continua depois dele
+static void test_torn_record_resyncs() {
+  put_u32(JK_BOOTS, 41);
+  jrnl_flush();
+  sil_idle();
+
+  put_u32(JK_BOOTS, 42);
+  sil_flash_cut_after(5);   // registro de 10 B fica pela metade
+  jrnl_flush();
+  sil_idle();
+
+  sil_power_cut(0);
+  boot();
+  TEST_ASSERT_EQUAL_UINT32(41, get_u32(JK_BOOTS));
+  JrnlStats s;
+  jrnl_get_stats(s);
+  TEST_ASSERT_EQUAL_UINT32(1, s.crcErrors);
+
+  put_u32(JK_BOOTS, 43);
+  jrnl_flush();
+  sil_idle();
+  sil_power_cut(0);
+  boot();
+  TEST_ASSERT_EQUAL_UINT32(43, get_u32(JK_BOOTS));
+}
+
+// crc32_le do registro de JK_BOOTS=180 termina em 0xFF: o fim do setor
+// não pode ser o último byte != 0xFF (perdia o valor e a escrita seguinte
+// caía em cima dele)
+static void test_record_crc_ending_in_ff() {
+  put_u32(JK_BOOTS, 5);
+  jrnl_flush();
+  sil_idle();
+  put_u32(JK_BOOTS, 180);
+  jrnl_flush();
+  sil_idle();
+
+  sil_power_cut(1000);
+  boot();
+  TEST_ASSERT_EQUAL_UINT32(180, get_u32(JK_BOOTS));
+
+  put_u32(JK_BOOTS, 181);
+  jrnl_flush();
+  sil_idle();
+  sil_power_cut(1000);
+  boot();
+  TEST_ASSERT_EQUAL_UINT32(181, get_u32(JK_BOOTS));
+  JrnlStats s;
+  jrnl_get_stats(s);
+  TEST_ASSERT_EQUAL_UINT32(0, s.crcErrors);
+}
+
+// Anel antigo de 24 pontos no NVS (antes do journal): 3 pontos, head 3
+static void legacy_nvs_hist() {
+  HistPoint blob[24] = {};
+  for (uint8_t i = 0; i < 3; i++) blob[i] = { 1700000000u + 3600u * i, 20.0f + i };
+  Preferences p;
+  p.begin("smarttemp", false);
+  p.putUChar("h_head", 3);
+  p.putUChar("h_cnt", 3);
+  p.putBytes("h_blob", blob, sizeof(blob));
+  p.end();
+}
+
+static void assert_hist_imported() {
+  HistPoint h[24];
+  TEST_ASSERT_EQUAL_UINT8(3, hist24_copy(h));
+  for (uint8_t i = 0; i < 3; i++) {
+    TEST_ASSERT_EQUAL_UINT32(1700000000u + 3600u * i, h[i].ts);
+    TEST_ASSERT_EQUAL_FLOAT(20.0f + i, h[i].temp);
+  }
+}
+
+// Importação do NVS: as chaves antigas só somem depois que o journal
+// gravou; queda logo depois do boot não perde o histórico
+static void test_hist_nvs_import_survives_power_cut() {
+  legacy_nvs_hist();
+  hist24_begin();
+  TEST_ASSERT_FALSE(sil_nvs_has("smarttemp", "h_blob"));
+  TEST_ASSERT_FALSE(sil_nvs_has("smarttemp", "h_head"));
+  assert_hist_imported();
+
+  sil_power_cut(1000);   // sem sil_idle: a task do journal nem rodou
+  boot();
+  hist24_begin();
+  assert_hist_imported();
+}
+
+// Flash falhou na importação: NVS fica e o próximo boot importa de novo
+static void test_hist_nvs_kept_when_journal_write_fails() {
+  legacy_nvs_hist();
+  sil_flash_cut_after(0);
+  hist24_begin();
+  TEST_ASSERT_TRUE(sil_nvs_has("smarttemp", "h_blob"));
+  TEST_ASSERT_TRUE(sil_nvs_has("smarttemp", "h_cnt"));
+
+  sil_power_cut(1000);
+  boot();
+  hist24_begin();
+  TEST_ASSERT_FALSE(sil_nvs_has("smarttemp", "h_blob"));
+  assert_hist_imported();
+
+  sil_power_cut(1000);
+  boot();
+  hist24_begin();
+  assert_hist_imported();
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_put_get_and_batched_flush);
+  RUN_TEST(test_power_cut_before_flush_loses_only_pending);
+  RUN_TEST(test_power_cut_after_flush_keeps_value);
+  RUN_TEST(test_ring_wraps_and_compacts);
+  RUN_TEST(test_torn_record_resyncs);
+  RUN_TEST(test_record_crc_ending_in_ff);
+  RUN_TEST(test_hist_nvs_import_survives_power_cut);
+  RUN_TEST(test_hist_nvs_kept_when_journal_write_fails);
+  return UNITY_END();
+}
@@ -0,0 +1,155 @@
+#include <unity.h>
+#include <Arduino.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+#include "aj_ref.h"
+#include "json_out.h"
+#include "msg_json.h"
+
+// Benchmark no host: JsonOut (msg_json) x StaticJsonDocument + serializeJson
+// (aj_ref.h) nas mesmas mensagens e entradas. Mede ns/mensagem (mediana de
+// ROUNDS rodadas) e a stack de cada caminho de publicação; a saída tem de
+// ser a mesma. No ESP32 a proporção muda (bench.cpp mede lá, em ciclos).
+
+#define ROUNDS 7
+#define ITERS  20000
+
+static char g_out[768];
+static char g_ref[768];
+static volatile size_t g_sink;   // segura o resultado fora do otimizador
+
+void setUp() {}
+void tearDown() {}
+
+// ----- entradas: variam com i (floats em toda a faixa do campo) -----
+static MqttState state_in(uint32_t i) {
+  MqttState s = { CTRL_ID, true, (i & 1) != 0, true, 20.0f + (i % 997) * 0.0625f, 30.0f,
+                  (float)(i % 101), 0.95f + (i % 89) * 0.0005f, 0.0001f + (i % 83) * 1e-5f,
+                  -61, 123456789UL + i };
+  return s;
+}
+
+static HistPoint g_pts[8];
+static void hist_in(uint32_t i) {
+  for (uint8_t k = 0; k < 8; k++) {
+    g_pts[k].ts   = 1700000000u + (i + k) * 3600u;
+    g_pts[k].temp = 18.0f + ((i + k) % 211) * 0.1f;
+  }
+}
+
+static MsgOtaStats stats_in(uint32_t i) {
+  MsgOtaStats s = { "delta", true, 123456 + i, 1048576, 1048576, 20500 + i,
+                    5.88f + (i % 50) * 0.01f, 49.95f + (i % 70) * 0.1f,
+                    1200, 300, 8100, 2100, 4, 4096, 1, 65536, true, 41000, 38000, 61234, 30100 };
+  return s;
+}
+
+// ----- cada mensagem: um passo com JsonOut, um com ArduinoJson -----
+static size_t out_state(uint32_t i) { return msg_state_json(state_in(i), g_out, sizeof(g_out)); }
+static size_t ref_state(uint32_t i) { return aj_state(g_ref, sizeof(g_ref), state_in(i)); }
+
+static size_t out_hist(uint32_t i) { hist_in(i); return msg_hist_json(g_out, sizeof(g_out), 0, 3, g_pts, 8); }
+static size_t ref_hist(uint32_t i) { hist_in(i); return aj_hist(g_ref, sizeof(g_ref), 0, 3, g_pts, 8); }
+
+static size_t out_stats(uint32_t i) { return msg_ota_stats_json(g_out, sizeof(g_out), stats_in(i)); }
+static size_t ref_stats(uint32_t i) { return aj_ota_stats(g_ref, sizeof(g_ref), stats_in(i)); }
+
+static size_t out_log(uint32_t i) {
+  return msg_log_json(g_out, sizeof(g_out), i, "W", "fila cheia: 12 itens, 3 descartados", 0);
+}
+static size_t ref_log(uint32_t i) {
+  return aj_log(g_ref, sizeof(g_ref), i, "W", "fila cheia: 12 itens, 3 descartados");
+}
+
+static size_t out_ack(uint32_t i) {
+  return msg_ack_json(g_out, sizeof(g_out), (i & 1) ? "m-000001" : "m-000002", true, nullptr);
+}
+static size_t ref_ack(uint32_t i) {
+  return aj_ack(g_ref, sizeof(g_ref), (i & 1) ? "m-000001" : "m-000002", true, nullptr);
+}
+
+// ns/mensagem, mediana das rodadas
+static double time_ns(size_t (*fn)(uint32_t)) {
+  double r[ROUNDS];
+  for (uint8_t k = 0; k < ROUNDS; k++) {
+    const auto t0 = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ITERS; i++) g_sink = fn(i);
+    const auto t1 = std::chrono::steady_clock::now();
+    r[k] = std::chrono::duration<double, std::nano>(t1 - t0).count() / ITERS;
+  }
+  std::sort(r, r + ROUNDS);
+  return r[ROUNDS / 2];
+}
+
+// Stack de um publish: antes documento + buffer de saída do mesmo tamanho;
+// agora JsonOut + o buffer que ainda fica na stack (0 = buffer estático ou
+// o próprio item da fila)
+struct BenchMsg {
+  const char* name;
+  size_t (*out)(uint32_t);
+  size_t (*ref)(uint32_t);
+  size_t oldStack;
+  size_t newBuf;
+};
+
+static const BenchMsg MSGS[] = {
+  // state: buf[384] do lan_link (no mqtt_link é o g_out estático)
+  { "state",     out_state, ref_state, sizeof(StaticJsonDocument<AJ_DOC_STATE>) + AJ_DOC_STATE, 384 },
+  // hist: out[384] do hist24_publish_all
+  { "hist",      out_hist,  ref_hist,  sizeof(StaticJsonDocument<AJ_DOC_HIST>) + AJ_DOC_HIST, 384 },
+  // OTA stats: direto no OtaEvtItem::json que vai p/ a fila
+  { "ota_stats", out_stats, ref_stats, sizeof(StaticJsonDocument<AJ_DOC_OTA_STATS>) + AJ_DOC_OTA_STATS, 0 },
+  // LOG: out[384] do log_mirror_poll
+  { "log",       out_log,   ref_log,   sizeof(StaticJsonDocument<AJ_DOC_LOG>) + AJ_DOC_LOG, 384 },
+  // ack: g_out estático do mqtt_link
+  { "ack",       out_ack,   ref_ack,   sizeof(StaticJsonDocument<AJ_DOC_EVT>) + AJ_DOC_EVT, 0 },
+};
+
+// Mesmos bytes nas entradas do benchmark (a varredura fica no test_msg_json)
+static void test_same_output() {
+  for (const BenchMsg& m : MSGS) {
+    for (uint32_t i = 0; i < 1000; i++) {
+      const size_t n = m.out(i);
+      TEST_ASSERT_EQUAL(m.ref(i), n);
+      TEST_ASSERT_NOT_EQUAL(0, n);
+      TEST_ASSERT_EQUAL_STRING_MESSAGE(g_ref, g_out, m.name);
+    }
+  }
+}
+
+// "metade da stack": JsonOut + buffer <= (documento + buffer) / 2
+static void test_stack() {
+  printf("%-10s %10s %10s\n", "msg", "old_stack", "new_stack");
+  for (const BenchMsg& m : MSGS) {
+    const size_t now = sizeof(JsonOut) + m.newBuf;
+    printf("%-10s %10u %10u\n", m.name, (unsigned)m.oldStack, (unsigned)now);
+    TEST_ASSERT_TRUE_MESSAGE(2 * now <= m.oldStack, m.name);
+  }
+}
+
+// "menos tempo de serialização": no conjunto das mensagens; por mensagem só
+// imprime (mensagem curta, sem float, fica no ruído do host)
+static void test_time() {
+  double refSum = 0, nowSum = 0;
+  printf("%-10s %10s %10s %6s\n", "msg", "arduinojson", "jsonout", "x");
+  for (const BenchMsg& m : MSGS) {
+    const double ref = time_ns(m.ref);
+    const double now = time_ns(m.out);
+    printf("%-10s %8.0fns %8.0fns %6.2f\n", m.name, ref, now, ref / now);
+    refSum += ref;
+    nowSum += now;
+  }
+  TEST_ASSERT_TRUE(nowSum < refSum);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_same_output);
+  RUN_TEST(test_stack);
+  RUN_TEST(test_time);
+  return UNITY_END();
+}
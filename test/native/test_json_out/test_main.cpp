@@ -0,0 +1,129 @@
+#include <unity.h>
+#include <math.h>
+#include <string.h>
+
+#include "json_out.h"
+
+// JsonOut: formato dos floats (como o ArduinoJson; casas fixas, zeros caem,
+// exponencial acima de ~2^53), escapes, aninhamento e estouro do buffer
+
+static char g_out[256];
+
+// {"v":<f(v, dec)>}
+static const char* fmt(float v, uint8_t dec) {
+  JsonOut j(g_out);
+  j.obj().f("v", v, dec).end();
+  TEST_ASSERT_TRUE(j.ok());
+  return g_out;
+}
+
+// {"v":<f(v)>}
+static const char* fmt_aj(float v) {
+  JsonOut j(g_out);
+  j.obj().f("v", v).end();
+  TEST_ASSERT_TRUE(j.ok());
+  return g_out;
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_float_fixed_decimals() {
+  TEST_ASSERT_EQUAL_STRING("{\"v\":30.5}", fmt(30.5f, 2));
+  TEST_ASSERT_EQUAL_STRING("{\"v\":1}", fmt(1.0f, 6));
+  TEST_ASSERT_EQUAL_STRING("{\"v\":0}", fmt(0.0f, 2));
+  TEST_ASSERT_EQUAL_STRING("{\"v\":0}", fmt(-0.001f, 2));       // sem "-0"
+  TEST_ASSERT_EQUAL_STRING("{\"v\":-12.25}", fmt(-12.25f, 2));
+  TEST_ASSERT_EQUAL_STRING("{\"v\":23.44}", fmt(23.4375f, 2));   // arredonda
+  TEST_ASSERT_EQUAL_STRING("{\"v\":0.000512}", fmt(0.000512f, 6));
+  TEST_ASSERT_EQUAL_STRING("{\"v\":0.0001}", fmt(0.0001f, 7));
+  TEST_ASSERT_EQUAL_STRING("{\"v\":99.995}", fmt(99.995f, 3));
+  TEST_ASSERT_EQUAL_STRING("{\"v\":100}", fmt(99.9999f, 2));
+  TEST_ASSERT_EQUAL_STRING("{\"v\":0.123456791}", fmt(0.123456789f, 12));   // dec > 9 -> 9 (valor do float)
+}
+
+// f(v): bytes do ArduinoJson 6 (float -> double, 9 casas menos as da parte
+// inteira, exponencial fora de [1e-5, 1e7))
+static void test_float_arduinojson() {
+  TEST_ASSERT_EQUAL_STRING("{\"v\":29.87000084}", fmt_aj(29.87f));
+  TEST_ASSERT_EQUAL_STRING("{\"v\":-29.87000084}", fmt_aj(-29.87f));
+  TEST_ASSERT_EQUAL_STRING("{\"v\":30}", fmt_aj(30.0f));
+  TEST_ASSERT_EQUAL_STRING("{\"v\":42.5}", fmt_aj(42.5f));
+  TEST_ASSERT_EQUAL_STRING("{\"v\":0}", fmt_aj(-0.0f));
+  TEST_ASSERT_EQUAL_STRING("{\"v\":0.100000001}", fmt_aj(0.1f));
+  TEST_ASSERT_EQUAL_STRING("{\"v\":0.987653971}", fmt_aj(0.987654f));
+  TEST_ASSERT_EQUAL_STRING("{\"v\":0.0012345}", fmt_aj(0.0012345f));
+  TEST_ASSERT_EQUAL_STRING("{\"v\":0.00001001}", fmt_aj(1.001e-5f));
+  TEST_ASSERT_EQUAL_STRING("{\"v\":9.999999747e-6}", fmt_aj(1e-5f));
+  TEST_ASSERT_EQUAL_STRING("{\"v\":1.401298464e-45}", fmt_aj(1.4e-45f));   // subnormal
+  TEST_ASSERT_EQUAL_STRING("{\"v\":123456.7891}", fmt_aj(123456.789f));
+  TEST_ASSERT_EQUAL_STRING("{\"v\":100}", fmt_aj(99.9999999f));
+  TEST_ASSERT_EQUAL_STRING("{\"v\":9999999}", fmt_aj(9999999.0f));
+  TEST_ASSERT_EQUAL_STRING("{\"v\":1e7}", fmt_aj(1e7f));
+  TEST_ASSERT_EQUAL_STRING("{\"v\":1.6777216e7}", fmt_aj(16777216.0f));
+  TEST_ASSERT_EQUAL_STRING("{\"v\":1.00000002e20}", fmt_aj(1e20f));
+  TEST_ASSERT_EQUAL_STRING("{\"v\":3.402823466e38}", fmt_aj(3.4028235e38f));   // FLT_MAX
+  TEST_ASSERT_EQUAL_STRING("{\"v\":null}", fmt_aj(NAN));
+  TEST_ASSERT_EQUAL_STRING("{\"v\":null}", fmt_aj(-INFINITY));
+}
+
+static void test_float_nan_inf_null() {
+  TEST_ASSERT_EQUAL_STRING("{\"v\":null}", fmt(NAN, 2));
+  TEST_ASSERT_EQUAL_STRING("{\"v\":null}", fmt(INFINITY, 2));
+  TEST_ASSERT_EQUAL_STRING("{\"v\":null}", fmt(-INFINITY, 2));
+}
+
+// Acima do inteiro exato: casas caem, depois exponencial (antes: cast de
+// double >= 2^64 p/ uint64_t, comportamento indefinido)
+static void test_float_large_values() {
+  TEST_ASSERT_EQUAL_STRING("{\"v\":16777216}", fmt(16777216.0f, 2));
+  TEST_ASSERT_EQUAL_STRING("{\"v\":8589934592}", fmt(8589934592.0f, 9));
+  TEST_ASSERT_EQUAL_STRING("{\"v\":8999999815811072}", fmt(9.0e15f, 2));   // float abaixo de 9e15: exato
+  TEST_ASSERT_EQUAL_STRING("{\"v\":9.007199e15}", fmt(9007199254740992.0f, 2));   // 2^53
+  TEST_ASSERT_EQUAL_STRING("{\"v\":1.844674e19}", fmt(18446744073709551616.0f, 2));
+  TEST_ASSERT_EQUAL_STRING("{\"v\":-1.844674e19}", fmt(-18446744073709551616.0f, 0));
+  TEST_ASSERT_EQUAL_STRING("{\"v\":1e20}", fmt(1.0e20f, 2));
+  TEST_ASSERT_EQUAL_STRING("{\"v\":3.402823e38}", fmt(3.4028235e38f, 2));   // FLT_MAX
+  TEST_ASSERT_EQUAL_STRING("{\"v\":1e16}", fmt(9.9999999e15f, 2));         // arredonda p/ 10
+}
+
+static void test_strings_and_nesting() {
+  JsonOut j(g_out);
+  j.obj().s("a", "x\"y\\z\n\t\x01").s("n", nullptr).b("t", true).b("f", false);
+  j.u("u", 4294967295u).i("i", -2147483647 - 1).null("z");
+  j.arr("l").u(nullptr, 1).obj().end().arr().end().end();
+  j.obj("o").end().end();
+  TEST_ASSERT_TRUE(j.ok());
+  TEST_ASSERT_EQUAL_STRING(
+    "{\"a\":\"x\\\"y\\\\z\\n\\t\\u0001\",\"n\":\"\",\"t\":true,\"f\":false,"
+    "\"u\":4294967295,\"i\":-2147483648,\"z\":null,\"l\":[1,{},[]],\"o\":{}}", g_out);
+  TEST_ASSERT_EQUAL(strlen(g_out), j.len());
+}
+
+static void test_overflow_and_unbalanced() {
+  char small[16];
+  JsonOut j(small);
+  j.obj().s("msg", "mais que dezesseis bytes").end();
+  TEST_ASSERT_FALSE(j.ok());
+  TEST_ASSERT_EQUAL(0, j.len());
+  TEST_ASSERT_TRUE(strlen(small) < sizeof(small));   // nunca passa do fim
+
+  JsonOut open(g_out);
+  open.obj().u("x", 1);
+  TEST_ASSERT_FALSE(open.ok());   // falta o end()
+
+  JsonOut deep(g_out);
+  for (int d = 0; d <= JSON_OUT_DEPTH; d++) deep.arr();
+  TEST_ASSERT_FALSE(deep.ok());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_float_fixed_decimals);
+  RUN_TEST(test_float_arduinojson);
+  RUN_TEST(test_float_nan_inf_null);
+  RUN_TEST(test_float_large_values);
+  RUN_TEST(test_strings_and_nesting);
+  RUN_TEST(test_overflow_and_unbalanced);
+  return UNITY_END();
+}
@@ -0,0 +1,297 @@
+#include <unity.h>
+#include <Arduino.h>
+#include <math.h>
+#include <string.h>
+
+#include "aj_ref.h"
+#include "sil.h"
+#include "config.h"
+#include "cmd_trace.h"
+#include "hist24.h"
+#include "journal.h"
+#include "msg_json.h"
+#include "wifi_link.h"
+
+// Strings de referência das mensagens publicadas (msg_json.h), iguais às do
+// firmware com ArduinoJson (floats com 9 casas do double): mudou aqui,
+// mudou o protocolo (app, Node-RED, tools/)
+
+static char g_out[640];
+
+#define ID "\"" CTRL_ID "\""
+
+void setUp() { sil_reset(); }
+void tearDown() {}
+
+static void test_state() {
+  MqttState s = { CTRL_ID, true, false, true, 29.87f, 30.0f, 42.5f,
+                  0.987654f, 0.0012345f, -61, 123456789UL };
+  TEST_ASSERT_NOT_EQUAL(0, msg_state_json(s, g_out, sizeof(g_out)));
+  TEST_ASSERT_EQUAL_STRING(
+    "{\"id\":" ID ",\"online\":true,\"ms\":123456789,\"tempC\":29.87000084,\"tempValid\":true,"
+    "\"setpoint\":30,\"systemOn\":true,\"heating\":false,\"u_pct\":42.5,"
+    "\"a1\":0.987653971,\"b0\":0.0012345,\"rssi\":-61}", g_out);
+
+  // sensor fora: tempC null; b0 perto de B0_MIN
+  s.tempValid = false; s.tempC = NAN; s.b0 = 0.000123456f; s.u_pct = 0.0f; s.heating = true;
+  TEST_ASSERT_NOT_EQUAL(0, msg_state_json(s, g_out, sizeof(g_out)));
+  TEST_ASSERT_EQUAL_STRING(
+    "{\"id\":" ID ",\"online\":true,\"ms\":123456789,\"tempC\":null,\"tempValid\":false,"
+    "\"setpoint\":30,\"systemOn\":true,\"heating\":true,\"u_pct\":0,"
+    "\"a1\":0.987653971,\"b0\":0.000123456,\"rssi\":-61}", g_out);
+
+  // não coube: 0, nada p/ publicar
+  TEST_ASSERT_EQUAL(0, msg_state_json(s, g_out, 64));
+}
+
+static void test_ack() {
+  TEST_ASSERT_NOT_EQUAL(0, msg_ack_json(g_out, sizeof(g_out), "m-1", true, nullptr));
+  TEST_ASSERT_EQUAL_STRING("{\"type\":\"ack\",\"id\":\"m-1\",\"ok\":true}", g_out);
+
+  msg_ack_json(g_out, sizeof(g_out), "m-2", false, "fora da faixa");
+  TEST_ASSERT_EQUAL_STRING("{\"type\":\"ack\",\"id\":\"m-2\",\"ok\":false,\"msg\":\"fora da faixa\"}", g_out);
+}
+
+// Comando rastreado (cmd_trace): "lat" em us desde a chegada e, com NTP, a
+// hora da chegada; o efeito vem depois, no evt "eff"
+static void test_ack_with_latency() {
+  sil_advance(10);
+  sil_set_epoch(1700000000);
+
+  MqttCommand c;
+  memset(&c, 0, sizeof(c));
+  strcpy(c.msgId, "m-3");
+  c.scope = CMD_DIRECT;
+  c.rxUs  = micros();
+  c.netUs = 250;
+  sil_advance(1);
+  cmd_trace_dispatch(c);
+  const uint8_t tag = cmd_trace_tag();
+  sil_advance(3);
+  msg_ack_json(g_out, sizeof(g_out), "m-3", true, nullptr);
+  cmd_trace_done();
+  TEST_ASSERT_EQUAL_STRING(
+    "{\"type\":\"ack\",\"id\":\"m-3\",\"ok\":true,"
+    "\"lat\":{\"net\":250,\"disp\":1000,\"ack\":4000},"
+    "\"rx_s\":1700000000,\"rx_ms\":0}", g_out);
+
+  // task de controle aplicou depois do ack
+  sil_advance(2);
+  TEST_ASSERT_EQUAL(0, cmd_trace_effect((uint8_t)(tag + 1), micros(), g_out, sizeof(g_out)));
+  TEST_ASSERT_TRUE(cmd_trace_effect(tag, micros(), g_out, sizeof(g_out)) > 0);
+  TEST_ASSERT_EQUAL_STRING("{\"type\":\"eff\",\"id\":\"m-3\",\"eff\":6000}", g_out);
+  TEST_ASSERT_EQUAL(0, cmd_trace_effect(tag, micros(), g_out, sizeof(g_out)));   // 1x só
+
+  // grupo: efeito só no histograma
+  c.scope = CMD_GROUP;
+  c.rxUs  = micros();
+  cmd_trace_dispatch(c);
+  const uint8_t gtag = cmd_trace_tag();
+  cmd_trace_done();
+  TEST_ASSERT_EQUAL(0, cmd_trace_effect(gtag, micros(), g_out, sizeof(g_out)));
+
+  // sem NTP: só "lat"
+  sil_power_cut();
+  sil_advance(5);
+  c.rxUs = micros();
+  c.netUs = 0;
+  cmd_trace_dispatch(c);
+  sil_advance(1);
+  msg_ack_json(g_out, sizeof(g_out), "m-4", true, nullptr);
+  cmd_trace_done();
+  TEST_ASSERT_EQUAL_STRING(
+    "{\"type\":\"ack\",\"id\":\"m-4\",\"ok\":true,\"lat\":{\"net\":0,\"disp\":0,\"ack\":1000}}", g_out);
+}
+
+static void test_acks_batch() {
+  MsgAck a[2];
+  memset(a, 0, sizeof(a));
+  strcpy(a[0].msgId, "g-1");
+  a[0].ok = true;
+  strcpy(a[1].msgId, "g-2");
+  strcpy(a[1].msg, "busy");
+  msg_acks_json(g_out, sizeof(g_out), 3, a, 2);
+  TEST_ASSERT_EQUAL_STRING(
+    "{\"type\":\"acks\",\"lost\":3,\"a\":[{\"id\":\"g-1\",\"ok\":true},"
+    "{\"id\":\"g-2\",\"ok\":false,\"msg\":\"busy\"}]}", g_out);
+
+  msg_acks_json(g_out, sizeof(g_out), 0, a, 0);
+  TEST_ASSERT_EQUAL_STRING("{\"type\":\"acks\",\"lost\":0,\"a\":[]}", g_out);
+}
+
+static void test_reset() {
+  msg_reset_json(g_out, sizeof(g_out), "watchdog \"ctrl\"\n");
+  TEST_ASSERT_EQUAL_STRING("{\"type\":\"RESET\",\"msg\":\"watchdog \\\"ctrl\\\"\\n\"}", g_out);
+}
+
+static void test_ota() {
+  msg_ota_json(g_out, sizeof(g_out), "DOWNLOAD", 42, nullptr);
+  TEST_ASSERT_EQUAL_STRING("{\"type\":\"OTA\",\"stage\":\"DOWNLOAD\",\"pct\":42}", g_out);
+  msg_ota_json(g_out, sizeof(g_out), "FAIL", -1, "sha256 invalido");
+  TEST_ASSERT_EQUAL_STRING("{\"type\":\"OTA\",\"stage\":\"FAIL\",\"msg\":\"sha256 invalido\"}", g_out);
+  msg_ota_json(g_out, sizeof(g_out), "OK", -1, "");
+  TEST_ASSERT_EQUAL_STRING("{\"type\":\"OTA\",\"stage\":\"OK\"}", g_out);
+
+  MsgOtaStats s = { "delta", true, 123456, 1048576, 1048576, 20500, 5.88f, 49.95f,
+                    1200, 300, 8100, 2100, 4, 4096, 1, 65536, true, 41000, 38000,
+                    61234, 30100 };
+  TEST_ASSERT_NOT_EQUAL(0, msg_ota_stats_json(g_out, sizeof(g_out), s));
+  TEST_ASSERT_EQUAL_STRING(
+    "{\"type\":\"OTA\",\"stage\":\"STATS\",\"fmt\":\"delta\",\"gzip\":true,"
+    "\"bytes\":123456,\"unz_bytes\":1048576,\"out_bytes\":1048576,\"ms\":20500,"
+    "\"kbps\":5.880000114,\"unz_kbps\":49.95000076,\"net_stall_ms\":1200,\"flash_idle_ms\":300,"
+    "\"write_max_us\":8100,\"write_avg_us\":2100,\"bufs\":4,\"buf_size\":4096,"
+    "\"resumes\":1,\"resumed_from\":65536,\"mqtt_kept\":true,\"tls_mqtt\":41000,"
+    "\"tls_http\":38000,\"heap_min\":61234,\"blk_min\":30100}", g_out);
+  // cabe no item da fila do OTA (OtaEvtItem::json)
+  TEST_ASSERT_LESS_THAN(600, strlen(g_out));
+}
+
+static void test_log() {
+  msg_log_json(g_out, sizeof(g_out), 98765, "W", "fila\tcheia\x01", 0);
+  TEST_ASSERT_EQUAL_STRING(
+    "{\"type\":\"LOG\",\"id\":" ID ",\"ms\":98765,\"lvl\":\"W\",\"msg\":\"fila\\tcheia\\u0001\"}", g_out);
+  msg_log_json(g_out, sizeof(g_out), 1, "E", "x", 5);
+  TEST_ASSERT_EQUAL_STRING(
+    "{\"type\":\"LOG\",\"id\":" ID ",\"ms\":1,\"lvl\":\"E\",\"msg\":\"x\",\"drop\":5}", g_out);
+}
+
+static void test_hist_chunk() {
+  const HistPoint p[3] = { { 0, 24.5f }, { 1700000000u, 25.126f }, { 1700003600u, NAN } };
+  msg_hist_json(g_out, sizeof(g_out), 1, 3, p, 3);
+  TEST_ASSERT_EQUAL_STRING(
+    "{\"id\":" ID ",\"seq\":1,\"total\":3,\"points\":[[0,24.5],[1700000000,25.12599945],[1700003600,null]]}", g_out);
+  msg_hist_json(g_out, sizeof(g_out), 0, 1, p, 0);
+  TEST_ASSERT_EQUAL_STRING("{\"id\":" ID ",\"seq\":0,\"total\":1,\"points\":[]}", g_out);
+}
+
+// req_hist de ponta a ponta: 10 pontos -> 2 chunks (8 + 2) no tópico hist
+static void test_hist_publish_all() {
+  sil_set_epoch(1700000000);
+  TEST_ASSERT_TRUE(jrnl_begin());
+  hist24_begin();
+  sil_idle();
+  for (int i = 0; i < 10; i++) {
+    sil_advance(3600000);
+    hist24_maybe_store(millis(), true, 20.0f + i * 0.25f);
+  }
+  wifi_begin();
+  mqtt_begin();
+  sil_mqtt_set_connected(true);
+  mqtt_update();   // conecta
+  TEST_ASSERT_TRUE(mqtt_is_connected());
+  sil_mqtt_msgs().clear();
+  hist24_publish_all();
+
+  TEST_ASSERT_EQUAL(2, sil_mqtt_count("hist"));
+  const std::vector<SilMsg>& m = sil_mqtt_msgs();
+  TEST_ASSERT_EQUAL_STRING(
+    "{\"id\":" ID ",\"seq\":0,\"total\":2,\"points\":[[1700003600,20],[1700007200,20.25],"
+    "[1700010800,20.5],[1700014400,20.75],[1700018000,21],[1700021600,21.25],"
+    "[1700025200,21.5],[1700028800,21.75]]}", m[0].payload.c_str());
+  TEST_ASSERT_EQUAL_STRING(
+    "{\"id\":" ID ",\"seq\":1,\"total\":2,\"points\":[[1700032400,22],[1700036000,22.25]]}",
+    m[1].payload.c_str());
+}
+
+// ----- compatibilidade com o firmware anterior (ArduinoJson, aj_ref.h) -----
+// A saída do msg_json tem de bater byte a byte numa varredura de valores
+static char g_ref[640];
+
+static void same(size_t ref, size_t got) {
+  TEST_ASSERT_NOT_EQUAL(0, got);
+  TEST_ASSERT_EQUAL_STRING(g_ref, g_out);
+  TEST_ASSERT_EQUAL(ref, got);
+}
+
+// LCG fixo: a mesma varredura em toda execução
+static uint32_t g_rng = 12345;
+static uint32_t rnd() { g_rng = g_rng * 1664525u + 1013904223u; return g_rng; }
+static float rndf(float lo, float hi) { return lo + (hi - lo) * (float)(rnd() >> 8) / 16777216.0f; }
+static float rnd_bits() {   // qualquer float finito (todas as faixas de expoente)
+  for (;;) {
+    const uint32_t b = rnd();
+    float v;
+    memcpy(&v, &b, sizeof(v));
+    if (isfinite(v)) return v;
+  }
+}
+
+static void test_compat_state() {
+  static const float EDGE[] = { 0.0f, -0.0f, 1e-5f, 1e7f, 9999999.0f, 99.9999999f, -40.0f,
+                                125.0f, 0.1f, 1e-4f, 3.4028235e38f, 1.4e-45f, NAN, INFINITY };
+  MqttState s = { CTRL_ID, true, false, true, 0, 0, 0, 0, 0, -61, 0 };
+  for (uint16_t i = 0; i < 4000; i++) {
+    s.tempC     = i < 14 ? EDGE[i] : rndf(-10.0f, 120.0f);
+    s.tempValid = isfinite(s.tempC);
+    s.setpoint  = rndf(20.0f, 60.0f);
+    s.u_pct     = i & 1 ? rndf(0.0f, 100.0f) : (float)(rnd() % 101);
+    s.a1        = rndf(0.9f, 1.0f);
+    s.b0        = i & 2 ? rnd_bits() : rndf(1e-5f, 1e-2f);
+    s.heating   = i & 4;
+    s.rssi      = -(int)(rnd() % 100);
+    s.ms        = rnd();
+    same(aj_state(g_ref, sizeof(g_ref), s), msg_state_json(s, g_out, sizeof(g_out)));
+  }
+}
+
+static void test_compat_events() {
+  same(aj_ack(g_ref, sizeof(g_ref), "m-1", true, nullptr),
+       msg_ack_json(g_out, sizeof(g_out), "m-1", true, nullptr));
+  same(aj_ack(g_ref, sizeof(g_ref), nullptr, false, "fora \"da\" faixa\n"),
+       msg_ack_json(g_out, sizeof(g_out), nullptr, false, "fora \"da\" faixa\n"));
+  same(aj_reset(g_ref, sizeof(g_ref), "watchdog\t\"ctrl\"\\"),
+       msg_reset_json(g_out, sizeof(g_out), "watchdog\t\"ctrl\"\\"));
+  same(aj_reset(g_ref, sizeof(g_ref), nullptr), msg_reset_json(g_out, sizeof(g_out), nullptr));
+  same(aj_ota(g_ref, sizeof(g_ref), "DOWNLOAD", 0, nullptr),
+       msg_ota_json(g_out, sizeof(g_out), "DOWNLOAD", 0, nullptr));
+  same(aj_ota(g_ref, sizeof(g_ref), "FAIL", -1, "sha256"),
+       msg_ota_json(g_out, sizeof(g_out), "FAIL", -1, "sha256"));
+  same(aj_ota(g_ref, sizeof(g_ref), "OK", 100, ""), msg_ota_json(g_out, sizeof(g_out), "OK", 100, ""));
+  same(aj_log(g_ref, sizeof(g_ref), 4294967295u, "E", "r\b\f\r"),
+       msg_log_json(g_out, sizeof(g_out), 4294967295u, "E", "r\b\f\r", 0));
+
+  MsgOtaStats st;
+  memset(&st, 0, sizeof(st));
+  for (uint16_t i = 0; i < 1000; i++) {
+    st.fmt = i & 1 ? "delta" : "raw";
+    st.gzip = i & 2;
+    st.bytes = rnd(); st.unzBytes = rnd(); st.outBytes = rnd(); st.ms = rnd() % 600000;
+    st.kbps = rndf(0.0f, 200.0f);
+    st.unzKbps = i & 4 ? rnd_bits() : rndf(0.0f, 2000.0f);
+    st.netStallMs = rnd(); st.writeMaxUs = rnd() % 20000; st.writeAvgUs = rnd() % 5000;
+    st.bufs = 4; st.bufSize = 4096; st.resumes = rnd() % 4; st.resumedFrom = rnd();
+    st.mqttKept = i & 8; st.tlsMqtt = rnd() % 50000; st.heapMin = rnd() % 200000;
+    same(aj_ota_stats(g_ref, sizeof(g_ref), st), msg_ota_stats_json(g_out, sizeof(g_out), st));
+  }
+}
+
+static void test_compat_hist() {
+  HistPoint p[8];
+  for (uint16_t i = 0; i < 500; i++) {
+    const uint8_t n = i % 9;
+    for (uint8_t k = 0; k < n; k++) {
+      p[k].ts   = (rnd() & 3) ? 1700000000u + rnd() % 86400 : 0;
+      p[k].temp = (rnd() % 16) ? rndf(-10.0f, 120.0f) : NAN;
+    }
+    same(aj_hist(g_ref, sizeof(g_ref), i % 3, 3, p, n),
+         msg_hist_json(g_out, sizeof(g_out), i % 3, 3, p, n));
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_state);
+  RUN_TEST(test_ack);
+  RUN_TEST(test_ack_with_latency);
+  RUN_TEST(test_acks_batch);
+  RUN_TEST(test_reset);
+  RUN_TEST(test_ota);
+  RUN_TEST(test_log);
+  RUN_TEST(test_hist_chunk);
+  RUN_TEST(test_hist_publish_all);
+  RUN_TEST(test_compat_state);
+  RUN_TEST(test_compat_events);
+  RUN_TEST(test_compat_hist);
+  return UNITY_END();
+}
@@ -0,0 +1,76 @@
+#pragma once
+// Gerado por gen_fixture.py (tools/ota_delta.py make). Não editar.
+#include <stdint.h>
+
+#define FIX_BASE_SIZE 4096
+#define FIX_BASE_SEED 0x12345678u
+#define FIX_ADD_SEED  0x9E3779B9u
+#define FIX_ADD_LEN   300
+#define FIX_TARGET_SIZE 3996
+
+static const uint8_t FIX_PATCH[1018] = {
+  0x45, 0x44, 0x50, 0x31, 0x00, 0x10, 0x00, 0x00, 0x56, 0x28, 0x9d, 0x0e, 0x35, 0xf8, 0xf9, 0x24,
+  0x67, 0x31, 0x4c, 0x24, 0x0e, 0x03, 0xdd, 0xa1, 0xe5, 0x4d, 0x31, 0x6e, 0xae, 0xa4, 0x04, 0xf7,
+  0xc5, 0x52, 0xc8, 0xff, 0x99, 0xff, 0x2f, 0x93, 0x9c, 0x0f, 0x00, 0x00, 0xa1, 0x73, 0x14, 0x6b,
+  0x4b, 0xf9, 0xf5, 0xd9, 0xa8, 0x2e, 0x6f, 0x42, 0xa1, 0x0c, 0x6c, 0x95, 0x12, 0xe4, 0x43, 0xf5,
+  0xa6, 0x99, 0x3e, 0x97, 0x79, 0xa2, 0x4f, 0x22, 0x27, 0x9f, 0x4f, 0x07, 0x01, 0x00, 0x00, 0x00,
+  0x00, 0xe8, 0x03, 0x00, 0x00, 0x02, 0x2c, 0x01, 0x00, 0x00, 0x19, 0x3e, 0x3a, 0xb5, 0x1f, 0x37,
+  0xd0, 0xbf, 0x39, 0xb8, 0xee, 0xb4, 0xd3, 0x3c, 0xb8, 0x5f, 0x8a, 0xde, 0x7d, 0x3f, 0xbf, 0xde,
+  0xd8, 0xa2, 0x1c, 0x49, 0xea, 0x8e, 0xe1, 0x74, 0xa6, 0x9a, 0x6b, 0x41, 0xc7, 0x7a, 0x7e, 0x7e,
+  0xae, 0xdf, 0x9d, 0x73, 0x29, 0xb4, 0x76, 0x65, 0x3d, 0xa6, 0xdb, 0x74, 0xce, 0xfd, 0x7d, 0x44,
+  0x0f, 0x68, 0x77, 0xe5, 0x29, 0xb8, 0x94, 0x98, 0x2e, 0xc0, 0x53, 0xcf, 0xe2, 0xec, 0xb0, 0xab,
+  0x2c, 0xbd, 0xcb, 0xb7, 0xc7, 0xc0, 0x87, 0x2b, 0x76, 0x01, 0x05, 0x9f, 0xfb, 0xe0, 0x84, 0xa4,
+  0x86, 0xd8, 0x1b, 0x6c, 0xf1, 0x69, 0x1c, 0x09, 0x0f, 0xf8, 0x1b, 0x0c, 0xed, 0xdd, 0xca, 0xa1,
+  0xbd, 0x42, 0x9d, 0x0c, 0xde, 0xbf, 0xa9, 0x35, 0xe0, 0x55, 0x4f, 0xb3, 0xd7, 0x78, 0x83, 0x65,
+  0xbb, 0x8f, 0x16, 0xbb, 0x30, 0x1b, 0x4d, 0xe1, 0x1d, 0xc1, 0xe5, 0x78, 0x99, 0xd8, 0x72, 0xac,
+  0xae, 0x2d, 0xc6, 0x8d, 0x2f, 0x91, 0x90, 0x78, 0x5d, 0x74, 0x74, 0x19, 0xc2, 0xf4, 0x77, 0x2e,
+  0x31, 0xec, 0x2b, 0x03, 0x16, 0x06, 0xfa, 0x10, 0x85, 0xa2, 0x99, 0x24, 0xd3, 0xb1, 0xc8, 0x00,
+  0xc7, 0xfc, 0xa6, 0x83, 0x4c, 0xbe, 0xe6, 0x08, 0x51, 0xf3, 0xef, 0xb5, 0x10, 0xaf, 0x0d, 0x86,
+  0x8a, 0x93, 0x2e, 0x65, 0xe9, 0x86, 0x2b, 0xd6, 0x49, 0xb5, 0xfe, 0x36, 0xac, 0xcd, 0xe7, 0xf6,
+  0xee, 0x18, 0xac, 0x06, 0xc0, 0x75, 0xfd, 0x18, 0x2e, 0x8a, 0xba, 0x1a, 0x5a, 0x30, 0xf9, 0xff,
+  0x02, 0x41, 0xf1, 0xb6, 0x44, 0x6a, 0xd8, 0x23, 0x13, 0xea, 0xc4, 0xb0, 0xa0, 0xc2, 0xae, 0x24,
+  0xb7, 0xf6, 0xb8, 0xa0, 0x65, 0xa2, 0xd8, 0xb5, 0x91, 0x0c, 0xaf, 0x6e, 0xbc, 0x3d, 0x81, 0xd6,
+  0x93, 0x32, 0x19, 0x89, 0x08, 0xee, 0x72, 0xcc, 0x6a, 0x93, 0xf6, 0xc5, 0xb0, 0x87, 0x18, 0x92,
+  0x70, 0xad, 0x37, 0x09, 0xce, 0x7d, 0x52, 0xfd, 0x0b, 0x79, 0x34, 0xfc, 0xa8, 0xd3, 0x03, 0xe0,
+  0xd8, 0x35, 0x7e, 0x27, 0xe7, 0x1d, 0xa4, 0x06, 0xba, 0x70, 0x99, 0xab, 0xef, 0xf8, 0x04, 0x67,
+  0x2e, 0x5b, 0x52, 0x71, 0x05, 0xb3, 0x01, 0xe8, 0x03, 0x00, 0x00, 0xe8, 0x03, 0x00, 0x00, 0x03,
+  0xd0, 0x07, 0x00, 0x00, 0x58, 0x02, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x01, 0xb8, 0x0b, 0x00, 0x00, 0x48, 0x04, 0x00, 0x00, 0x00,
+};
@@ -0,0 +1,91 @@
+#!/usr/bin/env python3
+"""Gera fixture.h do test_ota_delta com o patch de tools/ota_delta.py make.
+
+  python3 test/native/test_ota_delta/gen_fixture.py
+
+Base e alvo saem do mesmo xorshift32 e da mesma receita que
+test_main.cpp refaz em C++ (mudou aqui, muda lá):
+  alvo = base[0:1000]            COPY
+       + 300 bytes novos         ADD
+       + base[1000:2000]         COPY
+       + base[2000:2600] com +1 a cada 4 bytes   DIFF
+       + base[3000:]             COPY (2600..3000 some)
+Só o patch vai no fixture; o teste confere que tem COPY, ADD e DIFF.
+"""
+import os
+import subprocess
+import sys
+import tempfile
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+TOOL = os.path.join(HERE, "..", "..", "..", "tools", "ota_delta.py")
+
+BASE_SIZE = 4096
+BASE_SEED = 0x12345678
+ADD_SEED = 0x9E3779B9
+ADD_LEN = 300
+
+
+def xorshift_bytes(seed, n):
+    s = seed
+    out = bytearray()
+    for _ in range(n):
+        s ^= (s << 13) & 0xFFFFFFFF
+        s ^= s >> 17
+        s ^= (s << 5) & 0xFFFFFFFF
+        out.append(s & 0xFF)
+    return out
+
+
+def make_base():
+    return bytes(xorshift_bytes(BASE_SEED, BASE_SIZE))
+
+
+def make_target(base):
+    t = bytearray(base[0:1000])
+    t += xorshift_bytes(ADD_SEED, ADD_LEN)
+    t += base[1000:2000]
+    t += bytes(((b + 1) & 0xFF) if i % 4 == 0 else b
+               for i, b in enumerate(base[2000:2600]))
+    t += base[3000:]
+    return bytes(t)
+
+
+def main():
+    base = make_base()
+    target = make_target(base)
+    # image_sha256 do tool trataria como imagem ESP32 com hash anexado
+    assert not (base[0] == 0xE9 and base[23] == 1)
+
+    with tempfile.TemporaryDirectory() as tmp:
+        pb = os.path.join(tmp, "base.bin")
+        pt = os.path.join(tmp, "new.bin")
+        pp = os.path.join(tmp, "out.patch")
+        open(pb, "wb").write(base)
+        open(pt, "wb").write(target)
+        subprocess.run([sys.executable, TOOL, "make", pb, pt, pp], check=True)
+        patch = open(pp, "rb").read()
+
+    lines = [
+        "#pragma once",
+        "// Gerado por gen_fixture.py (tools/ota_delta.py make). Não editar.",
+        "#include <stdint.h>",
+        "",
+        "#define FIX_BASE_SIZE %d" % BASE_SIZE,
+        "#define FIX_BASE_SEED 0x%08Xu" % BASE_SEED,
+        "#define FIX_ADD_SEED  0x%08Xu" % ADD_SEED,
+        "#define FIX_ADD_LEN   %d" % ADD_LEN,
+        "#define FIX_TARGET_SIZE %d" % len(target),
+        "",
+        "static const uint8_t FIX_PATCH[%d] = {" % len(patch),
+    ]
+    for i in range(0, len(patch), 16):
+        lines.append("  " + ", ".join("0x%02x" % b for b in patch[i:i + 16]) + ",")
+    lines.append("};")
+    open(os.path.join(HERE, "fixture.h"), "w").write("\n".join(lines) + "\n")
+    print("fixture.h: patch=%d bytes" % len(patch))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
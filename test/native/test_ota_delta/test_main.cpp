@@ -0,0 +1,164 @@
+#include <unity.h>
+#include <string.h>
+#include <vector>
+
+#include "ota_delta.h"
+#include "fixture.h"
+#include "sha256.h"
+
+// ota_delta contra um patch de tools/ota_delta.py make (fixture.h, ver
+// gen_fixture.py): base/alvo refeitos aqui com a mesma receita
+
+static uint32_t xs_next(uint32_t& s) {
+  s ^= s << 13; s ^= s >> 17; s ^= s << 5;
+  return s;
+}
+
+static std::vector<uint8_t> xs_bytes(uint32_t seed, size_t n) {
+  std::vector<uint8_t> v(n);
+  for (size_t i = 0; i < n; i++) v[i] = (uint8_t)xs_next(seed);
+  return v;
+}
+
+static std::vector<uint8_t> g_base, g_target;
+
+static void make_images() {
+  g_base = xs_bytes(FIX_BASE_SEED, FIX_BASE_SIZE);
+  const std::vector<uint8_t> add = xs_bytes(FIX_ADD_SEED, FIX_ADD_LEN);
+  const uint8_t* b = g_base.data();
+
+  g_target.assign(b, b + 1000);
+  g_target.insert(g_target.end(), add.begin(), add.end());
+  g_target.insert(g_target.end(), b + 1000, b + 2000);
+  for (int i = 0; i < 600; i++) g_target.push_back((uint8_t)(b[2000 + i] + (i % 4 == 0 ? 1 : 0)));
+  g_target.insert(g_target.end(), b + 3000, b + FIX_BASE_SIZE);
+}
+
+// ---- "partições" do teste ----
+struct Ctx {
+  const std::vector<uint8_t>* base;
+  std::vector<uint8_t> out;
+  bool headerOk;
+};
+
+// Mesmo papel de ota_delta_header: base do patch tem que ser a que roda
+static bool on_header(void* p, const DeltaHeader& h) {
+  Ctx& c = *(Ctx*)p;
+  uint8_t sha[32];
+  sha256(c.base->data(), c.base->size(), sha);
+  c.headerOk = h.base_size == c.base->size() && memcmp(sha, h.base_sha256, 32) == 0;
+  return c.headerOk;
+}
+
+static bool read_base(void* p, uint32_t off, uint8_t* buf, size_t len) {
+  const Ctx& c = *(Ctx*)p;
+  if (off + len > c.base->size()) return false;
+  memcpy(buf, c.base->data() + off, len);
+  return true;
+}
+
+static bool write_out(void* p, const uint8_t* buf, size_t len) {
+  ((Ctx*)p)->out.insert(((Ctx*)p)->out.end(), buf, buf + len);
+  return true;
+}
+
+// Alimenta 'len' bytes do patch em pedaços aleatórios de 1..maxChunk
+static DeltaStatus feed(DeltaApply& d, const uint8_t* p, size_t len, uint32_t seed, uint32_t maxChunk) {
+  DeltaStatus st = DELTA_OK;
+  size_t i = 0;
+  while (i < len && st == DELTA_OK) {
+    size_t n = 1 + xs_next(seed) % maxChunk;
+    if (n > len - i) n = len - i;
+    st = delta_feed(d, p + i, n);
+    i += n;
+  }
+  return st;
+}
+
+static DeltaApply g_d;
+
+void setUp() { make_images(); }
+void tearDown() {}
+
+static void test_fixture_has_all_ops() {
+  bool seen[4] = {};
+  size_t i = DELTA_HDR_SIZE;
+  while (FIX_PATCH[i] != DOP_END) {
+    const uint8_t op = FIX_PATCH[i];
+    TEST_ASSERT_TRUE(op == DOP_COPY || op == DOP_ADD || op == DOP_DIFF);
+    seen[op] = true;
+    const uint32_t arg = FIX_PATCH[i + 1] | (FIX_PATCH[i + 2] << 8) | (FIX_PATCH[i + 3] << 16) | ((uint32_t)FIX_PATCH[i + 4] << 24);
+    const uint32_t len = (op == DOP_ADD) ? arg
+                       : (FIX_PATCH[i + 5] | (FIX_PATCH[i + 6] << 8) | (FIX_PATCH[i + 7] << 16) | ((uint32_t)FIX_PATCH[i + 8] << 24));
+    i += (op == DOP_ADD) ? 5 + len : (op == DOP_COPY) ? 9 : 9 + len;
+  }
+  TEST_ASSERT_EQUAL(sizeof(FIX_PATCH) - 1, i);
+  TEST_ASSERT_TRUE(seen[DOP_COPY] && seen[DOP_ADD] && seen[DOP_DIFF]);
+  TEST_ASSERT_EQUAL(FIX_TARGET_SIZE, g_target.size());
+}
+
+static void test_random_chunks_rebuild_target() {
+  uint8_t want[32];
+  sha256(g_target.data(), g_target.size(), want);
+
+  // 1 byte por vez, pedaços pequenos (cortam header/args) e maiores que o scratch
+  const uint32_t maxChunk[] = { 1, 7, 100, 3000 };
+  for (uint32_t k = 0; k < sizeof(maxChunk) / sizeof(maxChunk[0]); k++) {
+    for (uint32_t seed = 1; seed <= 20; seed++) {
+      Ctx c = { &g_base, {}, false };
+      delta_begin(g_d, on_header, read_base, write_out, &c);
+      TEST_ASSERT_EQUAL(DELTA_DONE, feed(g_d, FIX_PATCH, sizeof(FIX_PATCH), seed * 7919u, maxChunk[k]));
+      TEST_ASSERT_TRUE(delta_done(g_d));
+      TEST_ASSERT_TRUE(c.headerOk);
+
+      uint8_t got[32];
+      sha256(c.out.data(), c.out.size(), got);
+      TEST_ASSERT_EQUAL(FIX_TARGET_SIZE, c.out.size());
+      TEST_ASSERT_EQUAL_UINT8_ARRAY(want, got, 32);
+      TEST_ASSERT_EQUAL_UINT8_ARRAY(g_d.hdr.target_sha256, got, 32);
+    }
+  }
+}
+
+static void test_wrong_base_rejected() {
+  std::vector<uint8_t> other = g_base;
+  other[1234] ^= 0x01;   // mesmo tamanho, hash diferente
+  Ctx c = { &other, {}, false };
+  delta_begin(g_d, on_header, read_base, write_out, &c);
+  TEST_ASSERT_EQUAL(DELTA_ERR_HEADER, feed(g_d, FIX_PATCH, sizeof(FIX_PATCH), 3, 64));
+  TEST_ASSERT_FALSE(delta_done(g_d));
+  TEST_ASSERT_EQUAL(0, c.out.size());
+  // erro é definitivo
+  TEST_ASSERT_EQUAL(DELTA_ERR_HEADER, delta_feed(g_d, FIX_PATCH, 1));
+}
+
+static void test_truncated_patch_not_done() {
+  // no meio do header, dos args, do ADD, do DIFF e só sem o END
+  const size_t cut[] = { 40, DELTA_HDR_SIZE + 3, DELTA_HDR_SIZE + 9 + 5 + 100,
+                         sizeof(FIX_PATCH) - 20, sizeof(FIX_PATCH) - 1 };
+  for (size_t k = 0; k < sizeof(cut) / sizeof(cut[0]); k++) {
+    Ctx c = { &g_base, {}, false };
+    delta_begin(g_d, on_header, read_base, write_out, &c);
+    TEST_ASSERT_EQUAL(DELTA_OK, feed(g_d, FIX_PATCH, cut[k], 5, 33));
+    TEST_ASSERT_FALSE(delta_done(g_d));
+    TEST_ASSERT_TRUE(c.out.size() < (size_t)FIX_TARGET_SIZE || cut[k] == sizeof(FIX_PATCH) - 1);
+  }
+}
+
+static void test_trailing_data_rejected() {
+  std::vector<uint8_t> p(FIX_PATCH, FIX_PATCH + sizeof(FIX_PATCH));
+  p.push_back(0x00);
+  Ctx c = { &g_base, {}, false };
+  delta_begin(g_d, on_header, read_base, write_out, &c);
+  TEST_ASSERT_EQUAL(DELTA_ERR_TRAILING, feed(g_d, p.data(), p.size(), 9, 50));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_fixture_has_all_ops);
+  RUN_TEST(test_random_chunks_rebuild_target);
+  RUN_TEST(test_wrong_base_rejected);
+  RUN_TEST(test_truncated_patch_not_done);
+  RUN_TEST(test_trailing_data_rejected);
+  return UNITY_END();
+}
@@ -0,0 +1,286 @@
+#include <unity.h>
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <math.h>
+
+#include "sil.h"
+#include "app.h"
+#include "config.h"
+#include "ctrl_state.h"
+#include "display_lcd.h"
+#include "hist24.h"
+#include "log_mirror.h"
+#include "tsdb.h"
+
+// ===== Cenários: o firmware (app.h) numa estufa de mentira =====
+// Mesmas tasks do main.cpp: controle (app_ctrl_step a cada 10 ms e no
+// disparo do timer de 1 s), rede (app_net_step) e display. O DS18B20 lê a
+// planta, que esquenta pelo duty medido no pino do SSR; comandos chegam pelo
+// broker (PubSubClient de mentira) e as respostas saem nos tópicos ack/evt.
+
+static const uint32_t DAY0    = 1699920000;   // 2023-11-14 00:00 UTC
+static const uint8_t  PIN_SSR = 26;
+
+struct Plant {
+  float a, b, amb, T;
+  void step(float u) { T = a * T + b * u + (1.0f - a) * amb; }
+};
+
+static Plant    g_plant;
+static bool     g_sensorOk = true;
+static uint32_t g_ssrOnMs = 0;   // desde o último zerar
+
+// ----- tasks do main.cpp -----
+static TaskHandle_t     g_ctrlTask = nullptr;
+static volatile int64_t g_fireUs   = 0;
+
+static void task_ctrl(void* pv) {
+  uint32_t ticks = 0;
+  for (;;) {
+    app_ctrl_step(ticks, g_fireUs);
+    ticks = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SSR_TICK_MS));
+  }
+}
+
+// esp_timer periódico do controlador
+static void task_timer(void* pv) {
+  for (;;) {
+    vTaskDelay(pdMS_TO_TICKS(CONTROL_UPDATE_MS));
+    g_fireUs = esp_timer_get_time();
+    xTaskNotifyGive(g_ctrlTask);
+  }
+}
+
+static void task_net(void* pv) {
+  for (;;) {
+    app_net_step();
+    vTaskDelay(pdMS_TO_TICKS(NET_TICK_MS));
+  }
+}
+
+// setup() do main.cpp
+static void boot() {
+  sil_ds18b20(g_sensorOk, g_plant.T);
+  log_mirror_begin(true);
+  app_begin("POWERON");
+  xTaskCreatePinnedToCore(task_ctrl, "ctrl", 8192, nullptr, 3, &g_ctrlTask, 1);
+  xTaskCreate(task_timer, "esp_timer", 4096, nullptr, 22, nullptr);
+  xTaskCreatePinnedToCore(task_net, "net", 8192, nullptr, 1, nullptr, 0);
+  display_start_task(LCD_UPDATE_MS);
+  sil_idle();
+}
+
+// 1 s de estufa: duty do SSR amostrado a cada 10 ms, planta, sensor
+static void second() {
+  uint32_t onTicks = 0;
+  for (int i = 0; i < 100; i++) {
+    sil_advance(10);
+    if (sil_gpio_out(PIN_SSR) == HIGH) onTicks++;
+  }
+  g_ssrOnMs += onTicks * 10;
+  g_plant.step((float)onTicks);   // % do segundo com o SSR ligado
+  sil_ds18b20(g_sensorOk, g_plant.T);
+}
+
+static void run(uint32_t secs) {
+  for (uint32_t i = 0; i < secs; i++) second();
+}
+
+static CtrlSnapshot snap() {
+  CtrlSnapshot s;
+  ctrl_state_read(s);
+  return s;
+}
+
+static uint32_t minutes(TsdbRec* first, TsdbRec* last, uint32_t* noTemp = nullptr) {
+  TsdbCursor c;
+  TsdbRec r;
+  uint32_t n = 0;
+  if (noTemp) *noTemp = 0;
+  tsdb_seek(c, TSDB_MIN, 0);
+  while (tsdb_next(c, r)) {
+    if (!n && first) *first = r;
+    if (last) *last = r;
+    if (noTemp && r.n == 60 && r.nT == 0) (*noTemp)++;
+    n++;
+  }
+  return n;
+}
+
+// "max" do histograma 'name' no último diag sys (us)
+static long diag_max(const char* name) {
+  for (size_t i = sil_mqtt_msgs().size(); i-- > 0; ) {
+    const SilMsg& m = sil_mqtt_msgs()[i];
+    if (m.topic != "diag" || m.payload.find("\"type\":\"sys\"") == std::string::npos) continue;
+    const size_t h = m.payload.find(std::string("\"") + name + "\":{");
+    const size_t k = m.payload.find("\"max\":", h);
+    if (h == std::string::npos || k == std::string::npos) return -1;
+    return atol(m.payload.c_str() + k + 6);
+  }
+  return -1;
+}
+
+void setUp() {
+  sil_reset();
+  sil_set_epoch(DAY0 + 8 * 3600);
+  g_plant = { 0.99f, 0.004f, 20.0f, 20.0f };
+  g_sensorOk = true;
+  boot();
+}
+
+void tearDown() {}
+
+// Queda de energia de 5 min no meio de uma rampa: volta desligado (aquecedor
+// parado), o programa continua do ponto certo quando o NTP volta e o
+// histórico (24h, tsdb, setpoint) sobrevive
+static void test_outage_mid_ramp() {
+  sil_mqtt_cmd("{\"cmd\":\"sched_set\",\"id\":\"p1\",\"value\":\"R:0=25,~120=35\"}");
+  sil_mqtt_cmd("{\"cmd\":\"set_on\",\"id\":\"on1\",\"value\":true}");
+  run(61 * 60);
+  TEST_ASSERT_EQUAL(1, sil_mqtt_count("ack", "\"id\":\"p1\",\"ok\":true"));
+  TEST_ASSERT_EQUAL(1, sil_mqtt_count("ack", "\"id\":\"on1\",\"ok\":true"));
+
+  const float spBefore = snap().setpoint;
+  TEST_ASSERT_FLOAT_WITHIN(1.0f, 30.0f + 10.0f / 120.0f, spBefore);
+  TEST_ASSERT_FLOAT_WITHIN(1.0f, spBefore, g_plant.T);
+  HistPoint h[24];
+  TEST_ASSERT_EQUAL(2, hist24_copy(h));
+  const uint32_t cutAt = sil_epoch();
+
+  sil_power_cut(5 * 60 * 1000);
+  for (int i = 0; i < 5 * 60; i++) g_plant.step(0.0f);   // esfria desligada
+  boot();
+
+  // setpoint e histórico voltam do journal
+  TEST_ASSERT_FLOAT_WITHIN(0.2f, spBefore, snap().setpoint);
+  TEST_ASSERT_EQUAL(2, hist24_copy(h));
+  TEST_ASSERT_EQUAL_UINT32(DAY0 + 8 * 3600 + 3, h[0].ts);
+
+  // sem NTP ainda e desligado: programa espera, SSR parado
+  g_ssrOnMs = 0;
+  run(30);
+  TEST_ASSERT_EQUAL_UINT32(0, g_ssrOnMs);
+  TEST_ASSERT_EQUAL_INT8(-1, snap().schedSeg);
+  TEST_ASSERT_FALSE(snap().systemOn);
+  TEST_ASSERT_EQUAL(2, sil_mqtt_count("evt", "POWERON"));   // RESET de cada boot
+
+  sil_ntp_sync();
+  run(2);
+  const float el = (float)(sil_epoch() - (DAY0 + 8 * 3600)) / 60.0f;
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, 25.0f + 10.0f * el / 120.0f, snap().setpoint);
+
+  sil_mqtt_cmd("{\"cmd\":\"set_on\",\"id\":\"on2\",\"value\":true}");   // usuário religa
+  run(30 * 60);
+  TEST_ASSERT_FLOAT_WITHIN(1.0f, snap().setpoint, g_plant.T);
+
+  // tsdb: nada no buraco da queda, minutos dos dois lados e os 30 s sem
+  // NTP num registro com ts 0
+  TsdbRec first, last;
+  TsdbCursor c;
+  TsdbRec r;
+  uint32_t gapMin = 0, noTime = 0, prev = 0;
+  minutes(&first, &last);
+  TEST_ASSERT_EQUAL_UINT32(DAY0 + 8 * 3600, first.ts);
+  tsdb_seek(c, TSDB_MIN, 0);
+  while (tsdb_next(c, r)) {
+    if (!r.ts) { noTime++; continue; }
+    if (prev && r.ts - prev > 60) gapMin = (r.ts - prev) / 60;
+    prev = r.ts;
+  }
+  TEST_ASSERT_UINT32_WITHIN(1, 6, gapMin);
+  TEST_ASSERT_EQUAL_UINT32(1, noTime);
+  TEST_ASSERT_GREATER_THAN(cutAt + 25 * 60, last.ts);
+
+  // hora das 8h fechou inteira antes da queda (desde o 1º passo do boot)
+  TsdbRec h8;
+  tsdb_seek(c, TSDB_HOUR, DAY0 + 8 * 3600);
+  TEST_ASSERT_TRUE(tsdb_next(c, h8));
+  TEST_ASSERT_EQUAL_UINT32(DAY0 + 8 * 3600, h8.ts);
+  TEST_ASSERT_EQUAL_UINT32(3600 - 4, h8.n);
+}
+
+// DS18B20 some por 2 min com a estufa em regime: aquecedor cortado no GPIO,
+// alerta no LCD, 1 raise e 1 clear no evt, minutos sem temperatura no tsdb,
+// e o controle volta sozinho
+static void test_sensor_fault() {
+  sil_mqtt_cmd("{\"cmd\":\"set_on\",\"id\":\"on1\",\"value\":true}");
+  run(20 * 60);
+  TEST_ASSERT_FLOAT_WITHIN(1.0f, 30.0f, g_plant.T);
+  TEST_ASSERT_EQUAL(0, sil_mqtt_count("evt", "\"type\":\"fault\""));
+
+  // até a leitura falhar e o próximo passo (1 s) ainda vale o u anterior
+  g_sensorOk = false;
+  run(2);
+  g_ssrOnMs = 0;
+  run(118);
+  TEST_ASSERT_EQUAL_UINT32(0, g_ssrOnMs);
+  TEST_ASSERT_EQUAL(1, sil_mqtt_count("evt", "\"state\":\"raise\""));
+  TEST_ASSERT_EQUAL(1, sil_mqtt_count("evt", "\"code\":\"SENSOR\""));
+  TEST_ASSERT_EQUAL(0, sil_mqtt_count("evt", "\"state\":\"clear\""));
+  const std::string lcd0 = sil_lcd_row(0);
+  TEST_ASSERT_EQUAL_STRING("ERRO SENSOR     ", lcd0.c_str());
+  TEST_ASSERT_FALSE(snap().tempValid);
+
+  g_sensorOk = true;
+  run(FAULT_CLEAR_MS / 1000 + 2);
+  TEST_ASSERT_EQUAL(1, sil_mqtt_count("evt", "\"state\":\"clear\""));
+  TEST_ASSERT_EQUAL(1, sil_mqtt_count("evt", "\"dur\":120"));
+
+  run(10 * 60);
+  TEST_ASSERT_FLOAT_WITHIN(1.0f, 30.0f, g_plant.T);
+  TEST_ASSERT_EQUAL(2, sil_mqtt_count("evt", "\"type\":\"fault\""));
+  TEST_ASSERT_TRUE(snap().tempValid);
+
+  // minuto inteiro sem leitura: t* inválidos (nT = 0), resto do registro vale
+  TsdbRec first, last;
+  uint32_t noTemp;
+  minutes(&first, &last, &noTemp);
+  TEST_ASSERT_GREATER_OR_EQUAL(1, noTemp);
+  TEST_ASSERT_EQUAL_UINT32(60, last.nT);
+}
+
+// Rajada de comandos (painel reenviando, vários usuários): todos com ack e
+// evt "eff", nenhum perdido, setpoint final = soma dos passos. O diag pedido
+// logo depois mostra que a volta da rede não ficou presa esperando o
+// controle (o callback do MQTT não espera o efeito).
+static void test_cmd_burst() {
+  run(5);
+  TEST_ASSERT_EQUAL(1, sil_mqtt_count("lwt", "\"online\":true"));
+  sil_mqtt_msgs().clear();
+
+  const int N = 16;
+  char json[96];
+  for (int i = 0; i < N; i++) {
+    snprintf(json, sizeof(json), "{\"cmd\":\"inc_sp\",\"id\":\"b%02d\",\"value\":0.5}", i);
+    sil_mqtt_cmd(json);
+  }
+  sil_mqtt_cmd("{\"cmd\":\"diag\",\"id\":\"d1\"}");
+  run(2);
+
+  TEST_ASSERT_EQUAL(0, sil_mqtt_pending());
+  TEST_ASSERT_EQUAL(N, sil_mqtt_count("ack", "\"id\":\"b"));
+  TEST_ASSERT_EQUAL(N + 1, sil_mqtt_count("ack", "\"ok\":true"));
+  TEST_ASSERT_EQUAL(0, sil_mqtt_count("ack", "\"eff\":"));
+  TEST_ASSERT_EQUAL(N, sil_mqtt_count("evt", "\"type\":\"eff\""));
+  for (int i = 0; i < N; i++) {
+    snprintf(json, sizeof(json), "\"id\":\"b%02d\"", i);
+    TEST_ASSERT_EQUAL_MESSAGE(1, sil_mqtt_count("ack", json), json);
+    TEST_ASSERT_EQUAL_MESSAGE(1, sil_mqtt_count("evt", json), json);
+  }
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 30.0f + N * 0.5f, snap().setpoint);
+
+  const long netMax = diag_max("net");
+  TEST_ASSERT_GREATER_OR_EQUAL(0, netMax);
+  TEST_ASSERT_LESS_THAN((long)NET_TICK_MS * 1000, netMax);   // nenhuma volta bloqueou
+  char msg[64];
+  snprintf(msg, sizeof(msg), "volta da rede na rajada: max %ld us", netMax);
+  TEST_MESSAGE(msg);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_outage_mid_ramp);
+  RUN_TEST(test_sensor_fault);
+  RUN_TEST(test_cmd_burst);
+  return UNITY_END();
+}
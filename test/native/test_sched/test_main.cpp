@@ -0,0 +1,147 @@
+#include <unity.h>
+#include <Arduino.h>
+
+#include "sil.h"
+#include "sched_prog.h"
+#include "journal.h"
+
+// sched_prog: texto/avaliação (puros) e o runtime com o journal por baixo
+
+static const uint32_t DAY0 = 1699920000;   // 2023-11-14 00:00 UTC
+
+static SchedProg parse_ok(const char* txt) {
+  SchedProg p;
+  char err[32] = "";
+  TEST_ASSERT_TRUE_MESSAGE(sched_parse(txt, 20.0f, 40.0f, p, err, sizeof(err)), err);
+  return p;
+}
+
+static void boot() {
+  TEST_ASSERT_TRUE(jrnl_begin());
+  sched_begin();
+  sil_idle();
+}
+
+void setUp() {
+  sil_reset();
+  sil_set_epoch(DAY0);
+  boot();
+}
+
+void tearDown() {}
+
+static void test_parse_errors() {
+  static const struct { const char* txt; const char* err; } BAD[] = {
+    { "X:0=25",          "tipo (D/R/L)" },
+    { "D@900:0=25",      "tz" },
+    { "D0=25",           "falta ':'" },
+    { "D:1440=25",       "minuto" },
+    { "D:0=45",          "sp fora da faixa" },
+    { "D:60=25,30=26",   "minutos fora de ordem" },
+    { "R:10=25",         "1o passo em 0" },
+    { "R:~0=25",         "rampa no 1o passo" },
+    { "L:0=25",          "loop precisa de 2 passos" },
+    { "D:0=25;60=26",    "separador" },
+  };
+  for (const auto& b : BAD) {
+    SchedProg p;
+    char err[32] = "";
+    TEST_ASSERT_FALSE_MESSAGE(sched_parse(b.txt, 20.0f, 40.0f, p, err, sizeof(err)), b.txt);
+    TEST_ASSERT_EQUAL_STRING_MESSAGE(b.err, err, b.txt);
+  }
+}
+
+static void test_format_round_trip() {
+  char out[128];
+  const SchedProg p = parse_ok("D@-180:360=30,~480=35.5,1320=28.25");
+  TEST_ASSERT_GREATER_THAN(0, sched_format(p, out, sizeof(out)));
+  TEST_ASSERT_EQUAL_STRING("D@-180:360=30,~480=35.5,1320=28.25", out);
+
+  char small[12];
+  TEST_ASSERT_EQUAL(0, sched_format(p, small, sizeof(small)));
+  TEST_ASSERT_EQUAL_STRING("", small);
+}
+
+static void test_eval_daily_with_tz() {
+  const SchedProg p = parse_ok("D@-180:360=30,~480=35,1320=28");
+  SchedOut o;
+
+  // 03:00 local (06:00 UTC): ainda vale o 22h de ontem
+  TEST_ASSERT_TRUE(sched_eval(p, DAY0 + 6 * 3600, o));
+  TEST_ASSERT_EQUAL_FLOAT(28.0f, o.sp);
+  TEST_ASSERT_EQUAL_UINT8(2, o.seg);
+
+  // 07:00 local: metade da rampa 30 -> 35
+  TEST_ASSERT_TRUE(sched_eval(p, DAY0 + 10 * 3600, o));
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 32.5f, o.sp);
+  TEST_ASSERT_EQUAL_UINT32(DAY0 + 9 * 3600, o.segStart);
+
+  TEST_ASSERT_FALSE(sched_eval(p, 0, o));   // sem hora
+}
+
+static void test_eval_ramp_and_loop() {
+  SchedProg r = parse_ok("R:0=25,~120=35,360=35,~420=28");
+  SchedOut o;
+  TEST_ASSERT_FALSE(sched_eval(r, DAY0, o));   // sem início
+  r.start = DAY0;
+  TEST_ASSERT_TRUE(sched_eval(r, DAY0 + 3600, o));
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 30.0f, o.sp);
+  TEST_ASSERT_TRUE(sched_eval(r, DAY0 + 8 * 3600, o));
+  TEST_ASSERT_TRUE(o.done);
+  TEST_ASSERT_EQUAL_FLOAT(28.0f, o.sp);
+
+  SchedProg l = parse_ok("L:0=25,60=30,120=25");
+  l.start = DAY0;
+  TEST_ASSERT_TRUE(sched_eval(l, DAY0 + 2 * 3600 + 90 * 60, o));
+  TEST_ASSERT_EQUAL_FLOAT(30.0f, o.sp);
+  TEST_ASSERT_EQUAL_UINT32(DAY0 + 2 * 3600 + 3600, o.segStart);
+}
+
+// Rampa em andamento atravessa a queda: programa e início vêm do journal
+static void test_ramp_survives_reboot() {
+  sched_post(parse_ok("R:0=25,~120=35"));
+  float sp = 0;
+  TEST_ASSERT_TRUE(sched_step(sil_epoch(), sp));
+  TEST_ASSERT_EQUAL_FLOAT(25.0f, sp);
+  TEST_ASSERT_EQUAL_UINT32(DAY0, sched_start());
+
+  sil_advance(3600 * 1000);   // journal grava sozinho no caminho
+  TEST_ASSERT_TRUE(sched_step(sil_epoch(), sp));
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 30.0f, sp);
+
+  sil_power_cut(10 * 60 * 1000);
+  boot();
+  TEST_ASSERT_FALSE(sched_step(0, sp));   // sem NTP: espera
+  sil_ntp_sync();
+  TEST_ASSERT_TRUE(sched_step(sil_epoch(), sp));
+  TEST_ASSERT_EQUAL_UINT32(DAY0, sched_start());
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 30.0f + 10 * (10.0f / 120.0f), sp);
+
+  char txt[64];
+  sched_format(sched_prog(), txt, sizeof(txt));
+  TEST_ASSERT_EQUAL_STRING("R@-180:0=25,~120=35", txt);
+}
+
+// Ajuste manual segura até o próximo passo
+static void test_override_until_next_step() {
+  sched_post(parse_ok("D@0:0=25,600=30"));
+  float sp = 0;
+  TEST_ASSERT_TRUE(sched_step(DAY0 + 60, sp));
+  sched_override();
+  TEST_ASSERT_TRUE(sched_overridden());
+  TEST_ASSERT_FALSE(sched_step(DAY0 + 3600, sp));
+  TEST_ASSERT_TRUE(sched_step(DAY0 + 600 * 60, sp));
+  TEST_ASSERT_EQUAL_FLOAT(30.0f, sp);
+  TEST_ASSERT_FALSE(sched_overridden());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_parse_errors);
+  RUN_TEST(test_format_round_trip);
+  RUN_TEST(test_eval_daily_with_tz);
+  RUN_TEST(test_eval_ramp_and_loop);
+  RUN_TEST(test_ramp_survives_reboot);
+  RUN_TEST(test_override_until_next_step);
+  return UNITY_END();
+}
@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+"""Microbenchmark na placa (cmd "bench", ver include/bench.h) e comparação.
+
+  bench_fleet.py --host H [--user U --password P] [--ctrl ctrl02 | --all | --grp G]
+                 [-n 32] [--wait 20] [--save arq.jsonl]
+  bench_fleet.py --load a.jsonl [b.jsonl ...]        # compara resultados salvos
+
+Um controlador (--ctrl), a frota (--all, tópico all/cmd) ou um grupo (--grp).
+Tabela em us (ciclos / mhz), mediana por trecho; min entre parênteses quando
+a mediana passa de 2x o min (preempção no meio da medida). Uma linha por
+controlador, com chip/rev/idf/build p/ separar o que mudou.
+"""
+import argparse
+import json
+import sys
+import threading
+import time
+
+BASE = "perferro/estufa/v1"
+KERNELS = ("ctrl", "state", "parse", "log", "lcd", "ds18b20")
+
+
+def collect(a):
+    import paho.mqtt.client as mqtt
+    res = {}
+    lock = threading.Lock()
+    mid = "bench-%d" % int(time.time())
+
+    def on_msg(c, u, m):
+        try:
+            j = json.loads(m.payload)
+        except ValueError:
+            return
+        if j.get("type") == "bench" and j.get("id") == mid:
+            with lock:
+                res[m.topic.split("/")[-2]] = j
+
+    c = mqtt.Client()
+    c.username_pw_set(a.user, a.password)
+    if a.port == 8883:
+        c.tls_set()
+        c.tls_insecure_set(True)
+    c.on_message = on_msg
+    c.connect(a.host, a.port, 30)
+    c.subscribe("%s/+/evt" % BASE, 1)
+    c.loop_start()
+    time.sleep(1.0)
+
+    if a.all:
+        topic = "%s/all/cmd" % BASE
+    elif a.grp:
+        topic = "%s/grp/%s/cmd" % (BASE, a.grp)
+    else:
+        topic = "%s/%s/cmd" % (BASE, a.ctrl)
+    c.publish(topic, json.dumps({"cmd": "bench", "value": a.n, "id": mid}), qos=1)
+
+    end = time.time() + a.wait
+    while time.time() < end:
+        time.sleep(0.2)
+        if not (a.all or a.grp) and res:
+            break
+    c.loop_stop()
+    return res
+
+
+def fmt(k, mhz):
+    if not k:
+        return "-"
+    mn, med = k[0] / mhz, k[1] / mhz
+    s = "%.1f" % med if med < 1000 else "%.0f" % med
+    return s + (" (%.1f)" % mn if med > 2 * mn else "")
+
+
+def show(res):
+    print("%-10s %-14s %3s %-8s %-20s " % ("ctrl", "chip", "rev", "idf", "build") +
+          " ".join("%12s" % k for k in KERNELS))
+    for name in sorted(res):
+        r = res[name]
+        mhz = float(r.get("mhz") or 240)
+        ks = r.get("k", {})
+        print("%-10s %-14s %3s %-8s %-20s " % (name, r.get("chip", "?"), r.get("rev", "?"),
+                                                r.get("idf", "?"), r.get("build", "?")) +
+              " ".join("%12s" % fmt(ks.get(k), mhz) for k in KERNELS))
+
+
+def main(argv):
+    ap = argparse.ArgumentParser(usage=__doc__)
+    ap.add_argument("--host")
+    ap.add_argument("--port", type=int, default=8883)
+    ap.add_argument("--user", default="")
+    ap.add_argument("--password", default="")
+    ap.add_argument("--ctrl", default="ctrl02")
+    ap.add_argument("--all", action="store_true")
+    ap.add_argument("--grp")
+    ap.add_argument("-n", type=int, default=32)
+    ap.add_argument("--wait", type=float, default=20.0)
+    ap.add_argument("--save")
+    ap.add_argument("--load", nargs="+")
+    a = ap.parse_args(argv[1:])
+
+    if a.load:
+        res = {}
+        for fn in a.load:
+            with open(fn) as f:
+                for line in f:
+                    d = json.loads(line)
+                    res["%s@%s" % (d["ctrl"], fn)] = d["r"]
+    elif a.host:
+        res = collect(a)
+        if a.save:
+            with open(a.save, "a") as f:
+                for name, r in res.items():
+                    f.write(json.dumps({"ctrl": name, "r": r}) + "\n")
+    else:
+        print(__doc__)
+        return 2
+
+    if not res:
+        print("sem resultados")
+        return 1
+    show(res)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,181 @@
+#!/usr/bin/env python3
+"""Latência ponta a ponta dos comandos (ver include/cmd_trace.h).
+
+  cmd_latency.py run  [-n 20] [--cmd JSON] [conexão]   # manda e mede
+  cmd_latency.py hist [--reset] [conexão]              # histogramas do controlador
+
+Conexão: --ctrl ctrl02 --host H --port 8883 --user U --password P (MQTT/TLS,
+precisa de paho-mqtt) ou --lan HOST --psk K (tools/lan_client.py).
+
+Para cada ack: rtt = ida+volta vista daqui; dev = chegada->ack no
+controlador; broker = rtt - dev (ida + volta pela nuvem, sem depender de
+relógio). Com NTP nos dois lados, rx_s/rx_ms do ack separam ida e volta
+(~ms de erro do NTP). As etapas do controlador: net (espera no socket até o
+loop de rede ler), disp (até o handler), eff (task de controle aplicou; vem
+depois do ack no evt "eff", só pelo MQTT).
+O comando padrão (inc_sp 0) passa pela task de controle sem mudar nada.
+"""
+import argparse
+import json
+import os
+import sys
+import threading
+import time
+
+BASE = "perferro/estufa/v1"
+
+
+def pct(xs, p):
+    xs = sorted(xs)
+    return xs[min(len(xs) - 1, int(p / 100.0 * len(xs)))] if xs else float("nan")
+
+
+class MqttLink:
+    def __init__(self, a):
+        import paho.mqtt.client as mqtt
+        self.q = []
+        self.cv = threading.Condition()
+        self.t_cmd = "%s/%s/cmd" % (BASE, a.ctrl)
+        self.c = mqtt.Client()
+        self.c.username_pw_set(a.user, a.password)
+        if a.port == 8883:
+            self.c.tls_set()
+            self.c.tls_insecure_set(True)
+        self.c.on_message = self._msg
+        self.c.connect(a.host, a.port, 30)
+        self.c.subscribe("%s/%s/evt" % (BASE, a.ctrl), 1)
+        self.c.subscribe("%s/%s/ack" % (BASE, a.ctrl), 1)   # acks (MQTT_ACK_SUFFIX)
+        self.c.loop_start()
+        time.sleep(1.0)
+
+    def _msg(self, c, u, m):
+        with self.cv:
+            self.q.append((time.time(), json.loads(m.payload)))
+            self.cv.notify()
+
+    def send(self, cmd):
+        self.c.publish(self.t_cmd, json.dumps(cmd, separators=(",", ":")), qos=1)
+
+    def recv(self, timeout):
+        with self.cv:
+            if not self.q:
+                self.cv.wait(timeout)
+            return self.q.pop(0) if self.q else (None, None)
+
+
+class LanLink:
+    def __init__(self, a):
+        sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+        from lan_client import Lan
+        self.lan = Lan(a.lan, a.psk)
+        self.lan.hello()
+
+    def send(self, cmd):
+        self.lan.send(cmd)
+
+    def recv(self, timeout):
+        m = self.lan.recv(timeout)
+        return (time.time(), m) if m is not None else (None, None)
+
+
+def wait_id(link, mid, kinds, timeout=5.0):
+    """{tipo: (t, msg)} das respostas 'kinds' (ack, eff) do comando mid."""
+    got = {}
+    end = time.time() + timeout
+    while time.time() < end and len(got) < len(kinds):
+        t, m = link.recv(end - time.time())
+        if m and m.get("id") == mid and m.get("type") in kinds:
+            got[m["type"]] = (t, m)
+    return got
+
+
+def run(link, a):
+    base = json.loads(a.cmd)
+    rows = []
+    kinds = ("ack",) if isinstance(link, LanLink) else ("ack", "eff")
+    print("%4s %8s %8s %8s %7s %7s %7s %7s %7s" %
+          ("#", "rtt", "broker", "dev", "net", "disp", "eff", "up", "down"))
+    for i in range(a.n):
+        cmd = dict(base, id="lat%d-%d" % (os.getpid(), i))
+        t0 = time.time()
+        link.send(cmd)
+        got = wait_id(link, cmd["id"], kinds)
+        if "ack" not in got:
+            print("%4d sem ack" % i)
+            continue
+        t1, ack = got["ack"]
+        eff = got["eff"][1]["eff"] if "eff" in got else float("nan")
+        lat = ack.get("lat", {})
+        rtt = (t1 - t0) * 1000
+        dev = lat.get("ack", 0) / 1000.0
+        r = {"rtt": rtt, "dev": dev, "broker": rtt - dev,
+             "net": lat.get("net", 0) / 1000.0, "disp": lat.get("disp", 0) / 1000.0,
+             "eff": eff / 1000.0}
+        if "rx_s" in ack:
+            rx = ack["rx_s"] + ack["rx_ms"] / 1000.0
+            r["up"] = (rx - t0) * 1000
+            r["down"] = (t1 - rx) * 1000 - dev
+        rows.append(r)
+        print("%4d %8.1f %8.1f %8.1f %7.1f %7.2f %7.1f %7s %7s" %
+              (i, r["rtt"], r["broker"], r["dev"], r["net"], r["disp"], r["eff"],
+               "%.1f" % r["up"] if "up" in r else "-", "%.1f" % r["down"] if "down" in r else "-"))
+        time.sleep(a.gap)
+
+    if rows:
+        print("\nms      p50      p90      max")
+        for k in ("rtt", "broker", "dev", "net", "eff"):
+            xs = [r[k] for r in rows if r[k] == r[k]]
+            if xs:
+                print("%-6s %8.1f %8.1f %8.1f" % (k, pct(xs, 50), pct(xs, 90), max(xs)))
+
+
+def hist(link, a):
+    link.send({"cmd": "lat_hist", "value": bool(a.reset), "id": "lat-hist"})
+    end = time.time() + 5
+    while time.time() < end:
+        t, m = link.recv(end - time.time())
+        if m and m.get("type") == "lat":
+            b0 = m["b0"]
+            print("n=%d  max(us): %s" % (m["n"], dict(zip(("net", "disp", "eff", "ack"), m["max"]))))
+            print("%10s %6s %6s %6s %6s" % ("< us", "net", "disp", "eff", "ack"))
+            for i in range(len(m["net"])):
+                row = [m[k][i] for k in ("net", "disp", "eff", "ack")]
+                if any(row):
+                    lim = "inf" if i == len(m["net"]) - 1 else str(b0 << i)
+                    print("%10s %6d %6d %6d %6d" % (lim, *row))
+            return 0
+    print("sem resposta")
+    return 1
+
+
+def main(argv):
+    ap = argparse.ArgumentParser(usage=__doc__)
+    ap.add_argument("mode", choices=("run", "hist"))
+    ap.add_argument("-n", type=int, default=20)
+    ap.add_argument("--gap", type=float, default=0.5)
+    ap.add_argument("--cmd", default='{"cmd":"inc_sp","value":0}')
+    ap.add_argument("--reset", action="store_true")
+    ap.add_argument("--ctrl", default="ctrl02")
+    ap.add_argument("--host")
+    ap.add_argument("--port", type=int, default=8883)
+    ap.add_argument("--user", default="")
+    ap.add_argument("--password", default="")
+    ap.add_argument("--lan")
+    ap.add_argument("--psk", default=os.environ.get("LAN_PSK", ""))
+    a = ap.parse_args(argv[1:])
+
+    if a.lan:
+        link = LanLink(a)
+    elif a.host:
+        link = MqttLink(a)
+    else:
+        print(__doc__)
+        return 2
+    if a.mode == "hist":
+        return hist(link, a)
+    run(link, a)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
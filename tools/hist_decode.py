@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+"""Decodifica o histórico comprimido (hist_codec, ver include/hist_codec.h).
+
+  hist_decode.py block blk0.bin [blk1.bin ...]   # payloads de <ctrl>/hist/bin
+                                                 # (req_hist fmt=bin ou hist_query)
+  hist_decode.py flash spiffs.bin                # dump da partição do TSDB
+
+Saída em CSV no stdout. Temperatura/setpoint em °C, duty em %.
+
+Dump da partição:
+  esptool.py read_flash 0x3D0000 0x30000 spiffs.bin
+"""
+import struct
+import sys
+import zlib
+
+FIELDS = ("n", "nT", "tMin", "tAvg", "tMax", "spMin", "spAvg", "spMax",
+          "uMin", "uAvg", "uMax", "onPct")
+SCALE = {"n": 1, "nT": 1, "onPct": 1}    # resto em centésimos
+TIERS = ("min", "hour", "day")
+
+BLOCK_HDR = 10
+FLAG_LAST = 0x01
+
+SECT = 4096
+TSDB_MAGIC = 0x42445354
+TSDB_VER = 2
+SECT_HDR = 32
+WIDTH = (0, 4, 8, 16, 32)
+
+
+class Bits:
+    def __init__(self, buf):
+        self.buf = buf
+        self.bit = 0
+
+    def get(self, n):
+        if self.bit + n > len(self.buf) * 8:
+            raise EOFError
+        v = 0
+        for _ in range(n):
+            byte = self.buf[self.bit >> 3]
+            v = (v << 1) | ((byte >> (7 - (self.bit & 7))) & 1)
+            self.bit += 1
+        return v
+
+
+def s32(v):
+    v &= 0xFFFFFFFF
+    return v - (1 << 32) if v & 0x80000000 else v
+
+
+def get_val(r):
+    ones = 0
+    while ones < 4 and r.get(1):
+        ones += 1
+    z = r.get(WIDTH[ones]) if WIDTH[ones] else 0
+    return s32((z >> 1) ^ -(z & 1))
+
+
+def new_state():
+    return {"ts": 0, "dts": 0, "v": [0] * len(FIELDS)}
+
+
+def get_row(r, st):
+    dts = s32(st["dts"] + get_val(r))
+    ts = (st["ts"] + dts) & 0xFFFFFFFF
+    v = [s32(st["v"][i] + get_val(r)) for i in range(len(FIELDS))]
+    st.update(ts=ts, dts=dts, v=v)
+    return ts, v
+
+
+def decode_block(buf):
+    if len(buf) < BLOCK_HDR or buf[:2] != b"HC":
+        raise ValueError("não é bloco HC")
+    ver, tier, seq, flags, qid, count = struct.unpack_from("<BBHBBH", buf, 2)
+    if ver != 1:
+        raise ValueError("versão %d não suportada" % ver)
+    r = Bits(buf[BLOCK_HDR:])
+    st = new_state()
+    rows = [get_row(r, st) for _ in range(count)]
+    return tier, seq, flags, qid, rows
+
+
+def decode_sector(sect):
+    """-> (tier, seq, rows) ou None se não for setor do TSDB"""
+    magic, tier, ver, _rsv, seq, _first = struct.unpack_from("<IBBHII", sect, 0)
+    if magic != TSDB_MAGIC or ver != TSDB_VER or tier >= len(TIERS):
+        return None
+    rows = []
+    st = new_state()
+    off = SECT_HDR
+    while off + 2 <= SECT:
+        ln = sect[off]
+        if ln == 0xFF:
+            break
+        if ln == 0 or off + ln + 2 > SECT:
+            print("# tier %s seq %d: frame inválido em %d" % (TIERS[tier], seq, off), file=sys.stderr)
+            break
+        if (zlib.crc32(sect[off:off + 1 + ln]) & 0xFF) != sect[off + 1 + ln]:
+            print("# tier %s seq %d: crc em %d" % (TIERS[tier], seq, off), file=sys.stderr)
+            break
+        rows.append(get_row(Bits(sect[off + 1:off + 1 + ln]), st))
+        off += ln + 2
+    return tier, seq, rows
+
+
+def print_rows(tier, rows):
+    for ts, v in rows:
+        cols = [TIERS[tier] if tier < len(TIERS) else str(tier), str(ts)]
+        for name, x in zip(FIELDS, v):
+            cols.append(str(x) if SCALE.get(name) else "%.2f" % (x / 100.0))
+        print(",".join(cols))
+
+
+def main(argv):
+    if len(argv) < 3 or argv[1] not in ("block", "flash"):
+        print(__doc__)
+        return 2
+
+    print(",".join(("tier", "ts") + FIELDS))
+
+    if argv[1] == "block":
+        for path in argv[2:]:
+            tier, seq, flags, qid, rows = decode_block(open(path, "rb").read())
+            print("# %s: qid %d seq %d, %d linhas%s" % (path, qid, seq, len(rows),
+                  ", último" if flags & FLAG_LAST else ""), file=sys.stderr)
+            print_rows(tier, rows)
+        return 0
+
+    img = open(argv[2], "rb").read()
+    sects = []
+    for off in range(0, len(img) - SECT + 1, SECT):
+        s = decode_sector(img[off:off + SECT])
+        if s:
+            sects.append(s)
+    for tier, _seq, rows in sorted(sects, key=lambda s: (s[0], s[1])):
+        print_rows(tier, rows)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+"""Cliente do controle local (LAN/UDP, ver include/lan_link.h).
+
+  lan_client.py HOST CMD_JSON [CMD_JSON ...]   # manda e mostra as respostas
+  lan_client.py HOST --sub MS [--secs N]       # stream do state
+  lan_client.py --find                         # procura _perferro._udp (avahi-browse)
+
+  HOST = IP ou nome mDNS (ctrl02.local); chave em LAN_PSK (env) ou --psk.
+Ex.:
+  LAN_PSK=segredo lan_client.py ctrl02.local '{"cmd":"set_sp","value":31,"id":"a1"}'
+"""
+import argparse
+import hashlib
+import hmac
+import json
+import os
+import socket
+import struct
+import subprocess
+import sys
+import time
+
+PORT = 47800
+VER = 1
+HELLO, WELCOME, CMD, MSG = 1, 2, 3, 4
+HDR = struct.Struct("<2sBBII")
+TAG = 16
+
+
+class Lan:
+    def __init__(self, host, psk, port=PORT, timeout=1.0):
+        self.addr = (socket.gethostbyname(host), port)
+        self.psk = psk.encode()
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.settimeout(timeout)
+        self.session = 0
+        self.seq = 0
+        self.rx_seq = 0
+
+    def _pack(self, typ, payload):
+        body = HDR.pack(b"PL", VER, typ, self.session, self.seq) + payload
+        return body + hmac.new(self.psk, body, hashlib.sha256).digest()[:TAG]
+
+    def _unpack(self, pkt):
+        if len(pkt) < HDR.size + TAG:
+            return None
+        body, tag = pkt[:-TAG], pkt[-TAG:]
+        if not hmac.compare_digest(tag, hmac.new(self.psk, body, hashlib.sha256).digest()[:TAG]):
+            return None
+        magic, ver, typ, session, seq = HDR.unpack_from(body)
+        if magic != b"PL" or ver != VER:
+            return None
+        return typ, session, seq, body[HDR.size:]
+
+    def hello(self):
+        nonce = os.urandom(8)
+        self.session, self.seq = 0, 0
+        t0 = time.monotonic()
+        self.sock.sendto(self._pack(HELLO, nonce), self.addr)
+        while True:
+            r = self._unpack(self.sock.recv(2048))
+            if r and r[0] == WELCOME and r[3] == nonce:
+                self.session, self.rx_seq = r[1], r[2]
+                return (time.monotonic() - t0) * 1000
+
+    def send(self, cmd):
+        if not self.session:
+            self.hello()
+        self.seq += 1
+        payload = json.dumps(cmd, separators=(",", ":")).encode() if isinstance(cmd, dict) else cmd.encode()
+        self.sock.sendto(self._pack(CMD, payload), self.addr)
+
+    def recv(self, timeout=None):
+        if timeout is not None:
+            self.sock.settimeout(timeout)
+        try:
+            r = self._unpack(self.sock.recv(2048))
+        except socket.timeout:
+            return None
+        # só da sessão atual e em ordem (descarta repetido/velho)
+        if not r or r[0] != MSG or r[1] != self.session or r[2] <= self.rx_seq:
+            return None
+        self.rx_seq = r[2]
+        return json.loads(r[3])
+
+
+def find():
+    out = subprocess.run(["avahi-browse", "-rtp", "_perferro._udp"],
+                         capture_output=True, text=True).stdout
+    for line in out.splitlines():
+        f = line.split(";")
+        if f[0] == "=" and len(f) >= 10:
+            print("%s %s:%s %s" % (f[3], f[7], f[8], f[9]))
+
+
+def main(argv):
+    ap = argparse.ArgumentParser(usage=__doc__)
+    ap.add_argument("host", nargs="?")
+    ap.add_argument("cmds", nargs="*")
+    ap.add_argument("--psk", default=os.environ.get("LAN_PSK", ""))
+    ap.add_argument("--port", type=int, default=PORT)
+    ap.add_argument("--sub", type=int)
+    ap.add_argument("--secs", type=float, default=10.0)
+    ap.add_argument("--find", action="store_true")
+    a = ap.parse_args(argv[1:])
+
+    if a.find:
+        find()
+        return 0
+    if not a.host or not a.psk:
+        print(__doc__)
+        return 2
+
+    lan = Lan(a.host, a.psk, a.port)
+    try:
+        print("hello %.1f ms" % lan.hello())
+    except socket.timeout:
+        print("sem WELCOME (endereço, porta ou chave errada?)")
+        return 1
+
+    for c in a.cmds:
+        t0 = time.monotonic()
+        lan.send(c)
+        while True:
+            m = lan.recv(1.0)
+            if m is None:
+                print("sem resposta")
+                break
+            print("%.1f ms %s" % ((time.monotonic() - t0) * 1000, json.dumps(m)))
+            if m.get("type") == "ack":
+                break
+
+    if a.sub:
+        lan.send({"cmd": "lan_sub", "value": a.sub})
+        end = time.monotonic() + a.secs
+        renew = time.monotonic() + 30
+        while time.monotonic() < end:
+            m = lan.recv(1.0)
+            if m is not None:
+                print(json.dumps(m))
+            if time.monotonic() > renew:
+                lan.send({"cmd": "lan_sub", "value": a.sub})
+                renew = time.monotonic() + 30
+        lan.send({"cmd": "lan_sub", "value": 0})
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,178 @@
+#!/usr/bin/env python3
+"""Gera/aplica patches de delta OTA (formato EDP1, ver include/ota_delta.h).
+
+  ota_delta.py make  base.bin new.bin out.patch   # base = firmware que está rodando
+  ota_delta.py apply base.bin in.patch out.bin    # referência (confere hash)
+  ota_delta.py info  in.patch
+
+Patch (ou .bin) pode ir comprimido: `gzip -9n out.patch` -> out.patch.gz;
+o OTA detecta o gzip pelos bytes mágicos e descomprime em streaming.
+
+O hash da base é o mesmo que esp_partition_get_sha256() devolve no ESP32:
+se a imagem tem o SHA-256 anexado (byte 23 do header = 1), é o digest
+anexado; senão é o SHA-256 da imagem inteira.
+"""
+import hashlib
+import struct
+import sys
+
+MAGIC = b"EDP1"
+OP_END, OP_COPY, OP_ADD, OP_DIFF = 0, 1, 2, 3
+
+K = 16          # tamanho da âncora de busca
+STEP = 4        # base indexada a cada STEP bytes
+MIN_MATCH = 24  # match exato mínimo que vale um COPY
+MAX_CAND = 8
+
+
+def image_sha256(img):
+    if len(img) > 24 + 32 and img[0] == 0xE9 and img[23] == 1:
+        return img[-32:]
+    return hashlib.sha256(img).digest()
+
+
+def build_index(base):
+    idx = {}
+    for i in range(0, len(base) - K + 1, STEP):
+        lst = idx.setdefault(base[i:i + K], [])
+        if len(lst) < MAX_CAND:
+            lst.append(i)
+    return idx
+
+
+def find_matches(base, target):
+    """Lista de (t_off, b_off, len) exatos, crescentes e sem sobreposição."""
+    idx = build_index(base)
+    out = []
+    j = 0
+    n = len(target)
+    while j <= n - K:
+        cands = idx.get(target[j:j + K])
+        if not cands:
+            j += 1
+            continue
+        best = None
+        for b in cands:
+            # volta (alinhamento STEP) e estende pra frente
+            tb, bb = j, b
+            lo = out[-1][0] + out[-1][2] if out else 0
+            while tb > lo and bb > 0 and target[tb - 1] == base[bb - 1]:
+                tb -= 1
+                bb -= 1
+            e = j + K
+            be = b + K
+            while e < n and be < len(base) and target[e] == base[be]:
+                e += 1
+                be += 1
+            if best is None or (e - tb) > best[2]:
+                best = (tb, bb, e - tb)
+        if best[2] >= MIN_MATCH:
+            out.append(best)
+            j = best[0] + best[2]
+        else:
+            j += 1
+    return out
+
+
+def make_patch(base, target):
+    ops = bytearray()
+    matches = find_matches(base, target)
+
+    def emit_gap(t0, t1, b0):
+        """Trecho sem match exato: DIFF na diagonal anterior se parecido, senão ADD."""
+        if t1 <= t0:
+            return
+        g = t1 - t0
+        if b0 is not None and b0 + g <= len(base):
+            same = sum(1 for i in range(g) if target[t0 + i] == base[b0 + i])
+            if same * 2 >= g:
+                d = bytes((target[t0 + i] - base[b0 + i]) & 0xFF for i in range(g))
+                ops.extend(struct.pack("<BII", OP_DIFF, b0, g))
+                ops.extend(d)
+                return
+        ops.extend(struct.pack("<BI", OP_ADD, g))
+        ops.extend(target[t0:t1])
+
+    t = 0
+    diag = None  # offset da base que continua o último match
+    for (tm, bm, ln) in matches:
+        emit_gap(t, tm, diag)
+        ops.extend(struct.pack("<BII", OP_COPY, bm, ln))
+        t = tm + ln
+        diag = bm + ln
+    emit_gap(t, len(target), diag)
+    ops.append(OP_END)
+
+    hdr = MAGIC + struct.pack("<I", len(base)) + image_sha256(base) + \
+        struct.pack("<I", len(target)) + hashlib.sha256(target).digest()
+    return hdr + bytes(ops)
+
+
+def apply_patch(base, patch):
+    if patch[:4] != MAGIC:
+        raise ValueError("magic invalido")
+    base_size, = struct.unpack_from("<I", patch, 4)
+    base_sha = patch[8:40]
+    target_size, = struct.unpack_from("<I", patch, 40)
+    target_sha = patch[44:76]
+    if base_size != len(base) or image_sha256(base) != base_sha:
+        raise ValueError("base incompativel")
+
+    out = bytearray()
+    p = 76
+    while True:
+        op = patch[p]
+        p += 1
+        if op == OP_END:
+            break
+        if op == OP_COPY:
+            off, ln = struct.unpack_from("<II", patch, p)
+            p += 8
+            out += base[off:off + ln]
+        elif op == OP_ADD:
+            ln, = struct.unpack_from("<I", patch, p)
+            p += 4
+            out += patch[p:p + ln]
+            p += ln
+        elif op == OP_DIFF:
+            off, ln = struct.unpack_from("<II", patch, p)
+            p += 8
+            out += bytes((base[off + i] + patch[p + i]) & 0xFF for i in range(ln))
+            p += ln
+        else:
+            raise ValueError("op invalida %d" % op)
+    if p != len(patch):
+        raise ValueError("dados apos END")
+    if len(out) != target_size or hashlib.sha256(out).digest() != target_sha:
+        raise ValueError("hash do alvo nao confere")
+    return bytes(out)
+
+
+def main(argv):
+    if len(argv) >= 5 and argv[1] == "make":
+        base = open(argv[2], "rb").read()
+        target = open(argv[3], "rb").read()
+        patch = make_patch(base, target)
+        apply_patch(base, patch)  # sanidade antes de publicar
+        open(argv[4], "wb").write(patch)
+        print("base=%d alvo=%d patch=%d (%.1fx)" %
+              (len(base), len(target), len(patch), len(target) / max(1, len(patch))))
+        return 0
+    if len(argv) >= 5 and argv[1] == "apply":
+        base = open(argv[2], "rb").read()
+        patch = open(argv[3], "rb").read()
+        open(argv[4], "wb").write(apply_patch(base, patch))
+        return 0
+    if len(argv) >= 3 and argv[1] == "info":
+        patch = open(argv[2], "rb").read()
+        base_size, = struct.unpack_from("<I", patch, 4)
+        target_size, = struct.unpack_from("<I", patch, 40)
+        print("base_size=%d base_sha=%s" % (base_size, patch[8:40].hex()))
+        print("target_size=%d target_sha=%s" % (target_size, patch[44:76].hex()))
+        return 0
+    print(__doc__)
+    return 2
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))